@@ -1,8 +1,10 @@
 #ifndef ADDRESS_RULE_HPP
 #define ADDRESS_RULE_HPP
 
+#include <content_hash.hpp>
 #include <optional>
 #include <os2dsrules.hpp>
+#include <prescreen.hpp>
 #include <string>
 #include <string_view>
 
@@ -18,20 +20,35 @@ public:
   constexpr AddressRule &operator=(const AddressRule &) noexcept = default;
   constexpr AddressRule &operator=(AddressRule &&) noexcept = default;
 
-  [[nodiscard]] MatchResults find_matches(const std::string &) const noexcept;
+  [[nodiscard]] MatchResults find_matches(std::string_view) const noexcept;
+  [[nodiscard]] ScanResult find_matches(std::string_view,
+                                        const ScanOptions &) const noexcept;
+
+  // A street name starts with an uppercase letter, and is followed by a
+  // house number.
+  [[nodiscard]] static constexpr PreScreen::Requirements
+  requirements() noexcept {
+    return {.min_digit_run = 1, .min_uppercase = 1};
+  }
+
+  // Identifies the configuration of the rule in result cache keys.
+  [[nodiscard]] constexpr std::uint64_t config_hash() const noexcept {
+    return ContentHash::fnv1a("AddressRule/1");
+  }
 
 private:
   [[nodiscard]] bool contains(const std::string_view) const noexcept;
   [[nodiscard]] bool contains(const std::string) const noexcept;
-  [[nodiscard]] bool contains(const std::string::const_iterator,
-                              const std::string::const_iterator) const noexcept;
-  [[nodiscard]] MatchResults filter_matches(const MatchResults &matches,
-                                            const std::string &) const noexcept;
+  [[nodiscard]] bool
+  contains(const std::string_view::const_iterator,
+           const std::string_view::const_iterator) const noexcept;
   [[nodiscard]] std::optional<MatchResult>
-  append_number(const MatchResult &, const std::string &) const noexcept;
+  append_number(const MatchResult &, std::string_view) const noexcept;
 };
 }; // namespace AddressRule
 
+template <> constexpr End end_of<AddressRule::AddressRule> = End::Inclusive;
+
 }; // namespace OS2DSRules
 
 #endif
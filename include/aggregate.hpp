@@ -0,0 +1,156 @@
+#ifndef AGGREGATE_HPP
+#define AGGREGATE_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <checkpoint.hpp>
+#include <cpr-detector.hpp>
+#include <os2dsrules.hpp>
+
+namespace OS2DSRules {
+
+/*
+  Unique matches with their number of occurrences.
+
+  Documents such as registries and mailing lists repeat the same names
+  and addresses many times over. Rather than a MatchResult per
+  occurrence, a Counter keeps an entry per distinct normalized match, in
+  a flat open-addressed hash table. find_unique scans the document a
+  block at a time and feeds the matches of every block to it, so only the
+  matches of a single block exist at any time.
+ */
+namespace Aggregate {
+
+// How matches are normalized before they are counted.
+enum class Normalize : unsigned char {
+  // Runs of whitespace become a single space, and letters are lower-cased
+  // (ASCII and Latin-1).
+  Text,
+  // Only the digits are kept, so that 111111-1118 and 1111111118 count as
+  // the same.
+  Digits,
+};
+
+template <typename Rule> constexpr Normalize normalize_of = Normalize::Text;
+template <>
+constexpr Normalize normalize_of<CPRDetector::CPRDetector> = Normalize::Digits;
+
+// Appends match, normalized, to out.
+void normalize(std::string_view match, Normalize how,
+               std::string &out) noexcept;
+
+struct Unique {
+  // The normalized match.
+  std::string match;
+  std::size_t count = 0;
+  // The starts of the first and the last occurrence.
+  std::size_t first = 0;
+  std::size_t last = 0;
+  // The highest of the occurrences.
+  Sensitivity sensitivity = Sensitivity::Information;
+  double probability = 0.0;
+
+  bool operator==(const Unique &) const noexcept = default;
+};
+
+class Counter {
+public:
+  explicit Counter(Normalize normalize = Normalize::Text) noexcept
+      : normalize_(normalize) {}
+
+  // Adds a match found in a part of the document that starts at base.
+  void add(const MatchResult &match, std::size_t base = 0) noexcept;
+
+  void add(const MatchResults &matches, std::size_t base = 0) noexcept {
+    for (const auto &match : matches)
+      add(match, base);
+  }
+
+  // The unique matches, in the order of their first occurrence.
+  [[nodiscard]] const std::vector<Unique> &unique() const noexcept {
+    return unique_;
+  }
+
+  // The number of matches added.
+  [[nodiscard]] std::size_t occurrences() const noexcept {
+    return occurrences_;
+  }
+
+  // Moves the unique matches out, and clears the counter.
+  [[nodiscard]] std::vector<Unique> take() noexcept;
+
+  void clear() noexcept;
+
+private:
+  void grow() noexcept;
+
+  // A slot of the table holds the index of a unique match plus one, and
+  // zero if it is empty, next to part of its hash.
+  struct Slot {
+    std::uint32_t hash = 0;
+    std::uint32_t index = 0;
+  };
+
+  Normalize normalize_;
+  std::vector<Slot> slots_;
+  std::vector<Unique> unique_;
+  // The hashes of the unique matches, for growing the table.
+  std::vector<std::uint64_t> hashes_;
+  std::size_t occurrences_ = 0;
+  // The normalized match being added.
+  std::string key_;
+};
+
+struct Options {
+  // The number of bytes scanned at a time.
+  std::size_t block_size = 64 * 1024;
+};
+
+/*
+  The unique matches of rule in content, counted as content is scanned a
+  block at a time. Every block is scanned with a byte budget, and the next
+  one starts where the scan left off, so a match across the end of a
+  block is found whole by the next scan. The offsets are the same as
+  those of a scan of the whole content. A rule that is not resumable
+  scans the whole content at once, see Checkpoint::resumable.
+ */
+template <typename Rule>
+[[nodiscard]] std::vector<Unique>
+find_unique(Rule &rule, std::string_view content,
+            const Options &options = Options()) noexcept {
+  Counter counter(normalize_of<Rule>);
+  if (!Checkpoint::resumable(rule)) {
+    counter.add(rule.find_matches(content));
+    return counter.take();
+  }
+
+  const auto block = std::max<std::size_t>(options.block_size, 1);
+  ScanOptions scan;
+  scan.byte_budget = block;
+
+  for (std::size_t at = 0; at < content.size();) {
+    auto result = rule.find_matches(content.substr(at), scan);
+    counter.add(result.matches, at);
+
+    // A token longer than the budget is scanned again with a larger one.
+    if (result.offset == 0) {
+      scan.byte_budget *= 2;
+      continue;
+    }
+    at += result.offset;
+    scan.byte_budget = block;
+  }
+
+  return counter.take();
+}
+
+}; // namespace Aggregate
+
+}; // namespace OS2DSRules
+
+#endif
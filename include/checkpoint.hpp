@@ -0,0 +1,156 @@
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <os2dsrules.hpp>
+
+namespace OS2DSRules {
+
+/*
+  Incremental scans of streams that grow at the end, such as log files
+  and mailboxes.
+
+  A Stream feeds the pieces of a stream to a rule with
+  ScanOptions::partial, so that the rule leaves any token that is still
+  open at the end of a piece for the next one. The state of the scan is
+  then only where the stream has got to and the bytes of the open token,
+  which a Checkpoint holds. A Stream resumed from a checkpoint finds the
+  same matches in what is appended as a scan of the whole stream would.
+ */
+namespace Checkpoint {
+
+struct Checkpoint {
+  // The version of the serialized format.
+  static constexpr std::uint32_t version = 2;
+
+  // The configuration of the rule that made the checkpoint.
+  std::uint64_t config = 0;
+  // The number of bytes of the stream that have been fed.
+  std::uint64_t offset = 0;
+  // The bytes before offset that belong to a token that is still open.
+  // They are scanned again together with the next piece.
+  std::string pending;
+
+  // The position in the stream of the first pending byte.
+  [[nodiscard]] std::uint64_t resume() const noexcept {
+    return offset - pending.size();
+  }
+
+  bool operator==(const Checkpoint &) const noexcept = default;
+};
+
+[[nodiscard]] std::string serialize(const Checkpoint &checkpoint) noexcept;
+
+// Returns std::nullopt if data is damaged or of another version.
+[[nodiscard]] std::optional<Checkpoint>
+deserialize(std::string_view data) noexcept;
+
+/*
+  Reads what has been appended to the file at path since checkpoint was
+  made, to be fed to a resumed Stream. Returns std::nullopt if the file
+  cannot be read, or if it is shorter than when the checkpoint was made
+  or its pending bytes have changed, in which case it has to be scanned
+  from the start.
+ */
+[[nodiscard]] std::optional<std::string>
+read_appended(const std::string &path, const Checkpoint &checkpoint) noexcept;
+
+// Rules whose matches depend on the whole content declare that they
+// cannot be resumed.
+template <typename Rule>
+concept DeclaresResumable = requires(const Rule &rule) {
+  { rule.resumable() } -> std::same_as<bool>;
+};
+
+template <typename Rule>
+[[nodiscard]] constexpr bool resumable(const Rule &rule) noexcept {
+  if constexpr (DeclaresResumable<Rule>)
+    return rule.resumable();
+  else
+    return true;
+}
+
+/*
+  A scan of a stream by a rule, fed one piece at a time.
+
+  The matches of a stream are those returned by every call to feed,
+  followed by those returned by finish once the stream has ended. A rule
+  that is not resumable keeps the whole stream pending, and finds all of
+  its matches in finish.
+ */
+template <typename Rule> class Stream {
+public:
+  explicit Stream(Rule &rule) noexcept : rule_(rule) {
+    checkpoint_.config = rule.config_hash();
+  }
+
+  // Continues a scan from checkpoint, unless it was made by a rule with
+  // another configuration.
+  [[nodiscard]] static std::optional<Stream>
+  resume(Rule &rule, Checkpoint checkpoint) noexcept {
+    if (checkpoint.config != rule.config_hash())
+      return std::nullopt;
+
+    Stream stream(rule);
+    stream.checkpoint_ = std::move(checkpoint);
+    return stream;
+  }
+
+  // Scans the next piece of the stream, and returns the matches in it
+  // that nothing appended later can change.
+  [[nodiscard]] MatchResults feed(std::string_view piece) noexcept {
+    checkpoint_.pending.append(piece);
+    checkpoint_.offset += piece.size();
+
+    if (!resumable(rule_))
+      return MatchResults();
+
+    ScanOptions options;
+    options.partial = true;
+
+    const auto base = checkpoint_.resume();
+    auto result = rule_.find_matches(checkpoint_.pending, options);
+    checkpoint_.pending.erase(0, result.offset);
+    return shift(std::move(result.matches), base);
+  }
+
+  // Returns the rest of the matches, if the stream ends here. The state
+  // of the stream is left as it is, so more may still be fed.
+  [[nodiscard]] MatchResults finish() noexcept {
+    return shift(rule_.find_matches(checkpoint_.pending),
+                 checkpoint_.resume());
+  }
+
+  [[nodiscard]] const Checkpoint &checkpoint() const noexcept {
+    return checkpoint_;
+  }
+
+private:
+  static MatchResults shift(MatchResults matches,
+                            std::uint64_t base) noexcept {
+    if (base == 0)
+      return matches;
+
+    const auto offset = static_cast<std::size_t>(base);
+    for (auto &m : matches)
+      m = MatchResult(m.match(), m.start() + offset, m.end() + offset,
+                      m.sensitivity(), m.probability());
+    return matches;
+  }
+
+  Rule &rule_;
+  Checkpoint checkpoint_;
+};
+
+}; // namespace Checkpoint
+
+}; // namespace OS2DSRules
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef CONTENT_HASH_HPP
+#define CONTENT_HASH_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace OS2DSRules {
+
+namespace ContentHash {
+
+/*
+  A 128-bit hash of some content, used to recognize content that has
+  been scanned before. It is fast, not cryptographic: it must not be
+  used where an adversary could profit from a collision.
+ */
+struct Hash128 {
+  std::uint64_t low = 0;
+  std::uint64_t high = 0;
+
+  bool operator==(const Hash128 &) const noexcept = default;
+
+  // 32 lowercase hex digits, high half first.
+  [[nodiscard]] std::string to_hex() const;
+};
+
+/*
+  MurmurHash3 (x64, 128-bit variant) of content. The result only depends
+  on the bytes of content and seed, and is the same on every platform.
+ */
+[[nodiscard]] Hash128 hash128(std::string_view content,
+                              std::uint64_t seed = 0) noexcept;
+
+// FNV-1a, for hashing short tags at compile time.
+[[nodiscard]] constexpr std::uint64_t fnv1a(std::string_view s) noexcept {
+  std::uint64_t hash = 0xcbf29ce484222325ULL;
+  for (char c : s) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+// Mixes a value into a hash, so that the order of values matters.
+[[nodiscard]] constexpr std::uint64_t combine(std::uint64_t hash,
+                                              std::uint64_t value) noexcept {
+  value += 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+  value ^= value >> 33;
+  value *= 0xff51afd7ed558ccdULL;
+  value ^= value >> 33;
+  return hash ^ value;
+}
+
+}; // namespace ContentHash
+
+}; // namespace OS2DSRules
+
+#endif
@@ -3,16 +3,20 @@
 
 #include <array>
 #include <concepts>
+#include <content_hash.hpp>
 #include <cstddef>
 #include <functional>
 #include <iterator>
 #include <os2dsrules.hpp>
+#include <prescreen.hpp>
 #include <string>
 #include <string_view>
 #include <vector>
 
 namespace OS2DSRules {
 
+class ScanLimiter;
+
 namespace CPRDetector {
 
 constexpr bool is_nonzero_digit(char c) noexcept { return '0' < c && c <= '9'; }
@@ -53,7 +57,7 @@ private:
   void check_and_append_cpr(std::string &, MatchResults &, size_t, size_t,
                             char) noexcept;
   bool check_mod11(const MatchResult &) noexcept;
-  bool examine_context(const std::string &) noexcept;
+  bool examine_context(std::string_view, ScanLimiter &) noexcept;
   [[nodiscard]] std::string format_cpr(std::string &, char) const noexcept;
 
 public:
@@ -67,12 +71,44 @@ public:
   constexpr CPRDetector &operator=(CPRDetector &&) noexcept = default;
   ~CPRDetector() = default;
 
-  MatchResults find_matches(const std::string &) noexcept;
+  MatchResults find_matches(std::string_view) noexcept;
+  ScanResult find_matches(std::string_view, const ScanOptions &) noexcept;
 
   static const Sensitivity sensitivity = Sensitivity::Critical;
+
+  // A CPR-number starts with six consecutive digits.
+  [[nodiscard]] static constexpr PreScreen::Requirements
+  requirements() noexcept {
+    return {.min_size = 10, .min_digit_run = 6};
+  }
+
+  // Identifies the configuration of the detector in result cache keys.
+  [[nodiscard]] constexpr std::uint64_t config_hash() const noexcept {
+    return ContentHash::combine(ContentHash::fnv1a("CPRDetector/2"),
+                                (check_mod11_ ? 1u : 0u) |
+                                    (examine_context_ ? 2u : 0u));
+  }
+
+  // Matches never span a blank line, unless the context of the whole
+  // document is examined.
+  [[nodiscard]] constexpr bool chunkable() const noexcept {
+    return !examine_context_;
+  }
+
+  // Nor can a scan be resumed on what is appended to a document.
+  [[nodiscard]] constexpr bool resumable() const noexcept {
+    return !examine_context_;
+  }
+
+  // CPR-numbers, their separators and the words of the context are all
+  // ASCII.
+  [[nodiscard]] static constexpr bool ascii() noexcept { return true; }
 };
 
 }; // namespace CPRDetector
+
+template <> constexpr End end_of<CPRDetector::CPRDetector> = End::Inclusive;
+
 }; // namespace OS2DSRules
 
 #endif
@@ -14,6 +14,9 @@
 #include <type_traits>
 #include <utility>
 
+#include <probes.hpp>
+#include <stats.hpp>
+
 namespace OS2DSRules {
 
 namespace DataStructures {
@@ -96,6 +99,17 @@ protected:
       }
     }
 
+    // Like contains, but also counts the links that were followed.
+    [[nodiscard]] constexpr bool contains(const std::size_t hash,
+                                          std::size_t &walked) const noexcept {
+      ++walked;
+
+      if (hash_ == hash)
+        return true;
+
+      return next_ != nullptr && next_->contains(hash, walked);
+    }
+
     [[nodiscard]] constexpr std::size_t hash() const noexcept { return hash_; }
 
     [[nodiscard]] std::size_t length() const noexcept {
@@ -142,15 +156,19 @@ public:
   FrozenHashSet() noexcept = delete;
 
   FrozenHashSet(std::array<const char *, Size> initializer) noexcept {
+    OS2DSRULES_PROBE2(dictionary__start, "FrozenHashSet", Size);
     for (const char *value : initializer) {
       insert(std::string_view(value));
     }
+    OS2DSRULES_PROBE2(dictionary__done, "FrozenHashSet", Size);
   }
 
   FrozenHashSet(std::array<std::string_view, Size> initializer) noexcept {
+    OS2DSRULES_PROBE2(dictionary__start, "FrozenHashSet", Size);
     for (auto value : initializer) {
       insert(value);
     }
+    OS2DSRULES_PROBE2(dictionary__done, "FrozenHashSet", Size);
   }
 
   FrozenHashSet(FrozenHashSet &&) noexcept = default;
@@ -160,7 +178,19 @@ public:
   [[nodiscard]] bool contains(const std::string_view value) const noexcept {
     auto hash = get_hash(value);
     auto index = hash % Size;
-    return container_[index].contains(hash);
+
+    if constexpr (Stats::enabled) {
+      std::size_t walked = 0;
+      bool found = container_[index].contains(hash, walked);
+
+      OS2DSRULES_STAT(DictionaryProbes, 1);
+      OS2DSRULES_STAT(DictionaryHits, found);
+      OS2DSRULES_STAT(ChainLinksWalked, walked);
+
+      return found;
+    } else {
+      return container_[index].contains(hash);
+    }
   }
 };
 
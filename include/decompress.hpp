@@ -0,0 +1,213 @@
+#ifndef DECOMPRESS_HPP
+#define DECOMPRESS_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <checkpoint.hpp>
+#include <os2dsrules.hpp>
+
+namespace OS2DSRules {
+
+/*
+  Scanning of compressed files.
+
+  A compressed file is decompressed a block at a time on a thread of its
+  own, and the blocks are scanned in place on the calling thread as they
+  become ready. The two threads are connected by a ring of
+  a few blocks, so decompression and scanning overlap, a file is scanned
+  at the speed of the slower of the two, and the memory used does not
+  grow with the size of the file.
+ */
+namespace Decompress {
+
+enum class Format : unsigned char {
+  Plain,
+  Gzip,
+  Zstd,
+};
+
+// The format of a file that starts with head, going by its magic number.
+[[nodiscard]] Format detect(std::string_view head) noexcept;
+
+// Whether the library was built with support for format. Gzip needs
+// zlib, and Zstd needs libzstd.
+[[nodiscard]] bool supported(Format format) noexcept;
+
+/*
+  Reads a file and decompresses it according to its format. Gzip files
+  and Zstandard files of several members or frames, as written by
+  concatenating files, are read as one.
+ */
+class Decoder {
+public:
+  // Opens the file at path. Returns std::nullopt if it cannot be read or
+  // its format is not supported.
+  [[nodiscard]] static std::optional<Decoder>
+  open(const std::string &path) noexcept;
+
+  Decoder(Decoder &&other) noexcept;
+  Decoder &operator=(Decoder &&other) noexcept;
+  ~Decoder() noexcept;
+
+  // Decompresses up to size bytes into data. Returns the number of bytes,
+  // which is only less than size at the end of the file, or std::nullopt
+  // if the file cannot be read or is damaged or truncated.
+  [[nodiscard]] std::optional<std::size_t> read(char *data,
+                                                std::size_t size) noexcept;
+
+  [[nodiscard]] Format format() const noexcept;
+
+private:
+  struct State;
+
+  explicit Decoder(std::unique_ptr<State> state) noexcept;
+
+  std::unique_ptr<State> state_;
+};
+
+/*
+  A bounded ring of blocks, passed from one producer thread to one
+  consumer thread in order.
+
+  The producer acquires a free block, fills it and publishes it, and
+  waits while every block is full. The consumer takes the next full block
+  and releases it when it is done with it, and waits while every block is
+  free. The producer closes the ring when it is done.
+
+  The ring is lock-free: each side only writes its own counter, and waits
+  on the counter of the other side.
+ */
+class BlockRing {
+public:
+  BlockRing(std::size_t blocks, std::size_t block_size) noexcept;
+  BlockRing(const BlockRing &) = delete;
+  BlockRing &operator=(const BlockRing &) = delete;
+
+  // The next free block, to be filled by the producer.
+  [[nodiscard]] std::span<char> acquire() noexcept;
+
+  // Hands the block that was acquired to the consumer, holding size bytes.
+  void publish(std::size_t size) noexcept;
+
+  // Ends the blocks. A ring that is closed as failed is still drained.
+  void close(bool failed = false) noexcept;
+
+  // The next full block, or std::nullopt once the ring is closed and
+  // every block has been taken.
+  [[nodiscard]] std::optional<std::string_view> next() noexcept;
+
+  // Frees the block returned by next.
+  void release() noexcept;
+
+  [[nodiscard]] bool failed() const noexcept {
+    return failed_.load(std::memory_order_acquire);
+  }
+
+  [[nodiscard]] std::size_t block_size() const noexcept {
+    return block_size_;
+  }
+
+private:
+  // Set in published_ when the ring is closed.
+  static constexpr std::uint64_t closed = std::uint64_t(1) << 63;
+
+  const std::size_t block_size_;
+  std::vector<char> storage_;
+  std::vector<std::size_t> sizes_;
+  // The number of blocks published, and the number released.
+  std::atomic<std::uint64_t> published_ = 0;
+  std::atomic<std::uint64_t> released_ = 0;
+  std::atomic<bool> failed_ = false;
+};
+
+// Fills ring with what decoder reads, until the end of the file or an
+// error, and closes it.
+void decompress(Decoder &decoder, BlockRing &ring) noexcept;
+
+struct Options {
+  // The size of a block of decompressed bytes.
+  std::size_t block_size = 256 * 1024;
+  // The number of blocks in the ring.
+  std::size_t blocks = 4;
+};
+
+/*
+  Scans the file at path with rule, decompressing it on another thread
+  if it is compressed. The matches are those of a scan of the whole
+  decompressed content. Returns std::nullopt if the file cannot be read,
+  is damaged, or is in a format that is not supported, and if the rule is
+  not resumable, as its matches depend on the whole content.
+
+  Every block is scanned in place in the ring with ScanOptions::partial,
+  and only the bytes of a token that is open at its end are copied, to be
+  scanned again in front of the next block. At most options.blocks blocks
+  are held at a time, plus the open token and a copy of a block to join
+  it with.
+ */
+template <typename Rule>
+[[nodiscard]] std::optional<MatchResults>
+scan_file(Rule &rule, const std::string &path,
+          const Options &options = Options()) noexcept {
+  if (!Checkpoint::resumable(rule))
+    return std::nullopt;
+
+  auto decoder = Decoder::open(path);
+  if (!decoder)
+    return std::nullopt;
+
+  BlockRing ring(options.blocks, options.block_size);
+  std::thread producer([&] { decompress(decoder.value(), ring); });
+
+  ScanOptions partial;
+  partial.partial = true;
+  MatchResults matches;
+  // The open token, which starts at base in the content, and the token
+  // joined with the next block.
+  std::string open;
+  std::string joined;
+  std::size_t base = 0;
+
+  const auto add = [&](const MatchResults &found) {
+    for (const auto &m : found)
+      matches.emplace_back(m.match(), m.start() + base, m.end() + base,
+                           m.sensitivity(), m.probability());
+  };
+
+  while (auto block = ring.next()) {
+    std::string_view content = block.value();
+    if (!open.empty()) {
+      joined.assign(open);
+      joined.append(content);
+      content = joined;
+    }
+
+    auto result = rule.find_matches(content, partial);
+    add(result.matches);
+    open.assign(content.substr(result.offset));
+    base += result.offset;
+    ring.release();
+  }
+
+  producer.join();
+  if (ring.failed())
+    return std::nullopt;
+
+  add(rule.find_matches(open));
+  return matches;
+}
+
+}; // namespace Decompress
+
+}; // namespace OS2DSRules
+
+#endif
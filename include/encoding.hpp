@@ -0,0 +1,197 @@
+#ifndef ENCODING_HPP
+#define ENCODING_HPP
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <checkpoint.hpp>
+#include <os2dsrules.hpp>
+
+namespace OS2DSRules {
+
+/*
+  Scanning of content in encodings other than UTF-8.
+
+  The rules scan UTF-8. Content in UTF-16LE, Latin-1 or Windows-1252 is
+  scanned without transcoding the whole of it first:
+
+  - Rules whose matches are ASCII and delimited by ASCII, such as the
+    CPRDetector, scan single-byte content as it is, and UTF-16LE content
+    narrowed to a byte per code unit a block at a time.
+  - Other rules scan the content decoded to UTF-8 a block at a time, as
+    partial scans like those of a Checkpoint::Stream.
+
+  Either way, memory does not grow with the size of the content, and
+  offsets are reported in code units of the source encoding: bytes for
+  Latin-1 and Windows-1252, and 16-bit units for UTF-16LE.
+ */
+namespace Encoding {
+
+enum class Encoding : unsigned char {
+  UTF8,
+  UTF16LE,
+  Latin1,
+  Windows1252,
+};
+
+// The size in bytes of a code unit.
+[[nodiscard]] constexpr std::size_t unit_size(Encoding encoding) noexcept {
+  return encoding == Encoding::UTF16LE ? 2 : 1;
+}
+
+// Parses a name such as "utf-16-le", "latin-1" or "cp1252", in any case.
+[[nodiscard]] std::optional<Encoding> parse(std::string_view name) noexcept;
+
+// Rules whose matches consist of ASCII, and are only delimited by ASCII,
+// declare it. Any other byte may then stand in for a character that is
+// not ASCII.
+template <typename Rule>
+concept DeclaresAscii = requires(const Rule &rule) {
+  { rule.ascii() } -> std::same_as<bool>;
+};
+
+template <typename Rule>
+[[nodiscard]] constexpr bool ascii(const Rule &rule) noexcept {
+  if constexpr (DeclaresAscii<Rule>)
+    return rule.ascii();
+  else
+    return false;
+}
+
+// The byte that stands in for a code unit that is not ASCII, U+001A
+// SUBSTITUTE.
+constexpr char substitute = '\x1a';
+
+// Appends a byte per code unit of UTF-16LE source to out: the unit itself
+// if it is ASCII, and substitute otherwise. A trailing odd byte is
+// ignored.
+void narrow(std::string_view source, std::string &out) noexcept;
+
+/*
+  A streaming decoder to UTF-8.
+
+  For every byte of UTF-8 it appends to the text, it appends to units the
+  code unit of the source that the byte comes from: the first unit of
+  its character, except that the last byte of a character encoded as a
+  UTF-16 surrogate pair comes from the second unit. The start of a match
+  in the text, and its end whether it is inclusive or exclusive, are then
+  the units at those positions.
+
+  Source may be fed in pieces of any size. Unpaired surrogates and a
+  trailing odd byte of UTF-16LE are decoded as U+FFFD.
+ */
+class Decoder {
+public:
+  explicit Decoder(Encoding encoding) noexcept : encoding_(encoding) {}
+
+  void decode(std::string_view source, std::string &text,
+              std::vector<std::size_t> &units) noexcept;
+
+  // Ends the source.
+  void finish(std::string &text, std::vector<std::size_t> &units) noexcept;
+
+  // The number of code units decoded.
+  [[nodiscard]] std::size_t unit() const noexcept { return unit_; }
+
+private:
+  void decode_utf16(std::string_view source, std::string &text,
+                    std::vector<std::size_t> &units) noexcept;
+  void decode_bytes(std::string_view source, std::string &text,
+                    std::vector<std::size_t> &units) noexcept;
+  void append(char32_t c, std::size_t first, std::size_t last,
+              std::string &text, std::vector<std::size_t> &units) noexcept;
+
+  Encoding encoding_;
+  std::size_t unit_ = 0;
+  // A byte of UTF-16LE whose unit is completed by the next piece.
+  std::optional<unsigned char> odd_;
+  // A high surrogate waiting for the low surrogate of its pair.
+  std::optional<char16_t> high_;
+};
+
+// The number of code units of source decoded per block.
+constexpr std::size_t block_units = 16 * 1024;
+
+namespace detail {
+
+inline MatchResult shift(const MatchResult &m, std::size_t start,
+                         std::size_t end) noexcept {
+  return MatchResult(m.match(), start, end, m.sensitivity(), m.probability());
+}
+
+} // namespace detail
+
+/*
+  Scans content in encoding with rule, and reports the matches with
+  offsets in code units of encoding. UTF-8 content is scanned as it is.
+ */
+template <typename Rule>
+[[nodiscard]] MatchResults find_matches(Rule &rule, std::string_view content,
+                                        Encoding encoding) noexcept {
+  if (encoding == Encoding::UTF8 || (unit_size(encoding) == 1 && ascii(rule)))
+    return rule.find_matches(content);
+
+  // A rule that cannot be resumed sees the whole content at once.
+  const std::size_t step = Checkpoint::resumable(rule)
+                               ? block_units * unit_size(encoding)
+                               : content.size();
+  ScanOptions options;
+  MatchResults matches;
+  std::string text;
+
+  if (ascii(rule)) {
+    // Every unit is a byte of the text, so offsets only need the unit of
+    // the first byte of the text added.
+    std::size_t base = 0;
+    for (std::size_t pos = 0; pos < content.size();) {
+      const auto piece = content.substr(pos, step);
+      pos += piece.size();
+      narrow(piece, text);
+
+      options.partial = pos < content.size();
+      auto result = rule.find_matches(text, options);
+      for (const auto &m : result.matches)
+        matches.push_back(
+            detail::shift(m, base + m.start(), base + m.end()));
+
+      text.erase(0, result.offset);
+      base += result.offset;
+    }
+    return matches;
+  }
+
+  Decoder decoder(encoding);
+  std::vector<std::size_t> units;
+  for (std::size_t pos = 0; pos < content.size();) {
+    const auto piece = content.substr(pos, step);
+    pos += piece.size();
+    decoder.decode(piece, text, units);
+
+    options.partial = pos < content.size();
+    if (!options.partial)
+      decoder.finish(text, units);
+
+    auto result = rule.find_matches(text, options);
+    const auto unit = [&](std::size_t i) {
+      return i < units.size() ? units[i] : decoder.unit();
+    };
+    for (const auto &m : result.matches)
+      matches.push_back(detail::shift(m, unit(m.start()), unit(m.end())));
+
+    text.erase(0, result.offset);
+    units.erase(units.begin(),
+                units.begin() + static_cast<std::ptrdiff_t>(result.offset));
+  }
+  return matches;
+}
+
+}; // namespace Encoding
+
+}; // namespace OS2DSRules
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef HEALTH_RULE_HPP
 #define HEALTH_RULE_HPP
 
+#include <content_hash.hpp>
 #include <os2dsrules.hpp>
 #include <string>
 #include <string_view>
@@ -17,7 +18,17 @@ public:
   HealthRule(HealthRule &&) noexcept = default;
   ~HealthRule() noexcept = default;
 
-  [[nodiscard]] MatchResults find_matches(const std::string &) const noexcept;
+  [[nodiscard]] MatchResults find_matches(std::string_view) const noexcept;
+  [[nodiscard]] ScanResult find_matches(std::string_view,
+                                        const ScanOptions &) const noexcept;
+
+  // Identifies the configuration of the rule in result cache keys.
+  [[nodiscard]] constexpr std::uint64_t config_hash() const noexcept {
+    return ContentHash::fnv1a("HealthRule/1");
+  }
+
+  // Health terms never span a delimiter.
+  [[nodiscard]] constexpr bool chunkable() const noexcept { return true; }
 
 private:
   OS2DSRules::WordListRule::WordListRule rule_;
@@ -0,0 +1,129 @@
+#ifndef INGEST_HPP
+#define INGEST_HPP
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace OS2DSRules {
+
+/*
+  Batched reading of many small files.
+
+  When most files are small, opening, reading and closing them costs more
+  than scanning them. An Ingester reads files a batch at a time into a pool
+  of buffers that it keeps for its lifetime. On Linux it uses io_uring:
+  the opens of a batch are submitted together, then its reads into
+  registered buffers, and the closes go along with the opens of the next
+  batch. A batch then takes two system calls instead of three per file.
+  Where io_uring is not available, or is not permitted, the files are read
+  with plain system calls into the same buffers.
+
+  A file may also be lent out in its buffer, to be scanned on another
+  thread without a copy. The pool has two buffers for every file of a
+  batch, so that a batch can be read while the one before it is scanned,
+  and a batch waits for buffers that are still lent out.
+ */
+namespace Ingest {
+
+enum class Backend : unsigned char {
+  Uring,
+  Syscalls,
+};
+
+struct Options {
+  // The number of files opened and read together.
+  std::size_t batch = 64;
+  // The size of each pooled buffer. A file that does not fit is read in
+  // full into memory of its own.
+  std::size_t buffer_size = 64 * 1024;
+  // Whether to try io_uring at all.
+  bool uring = true;
+};
+
+struct Pool;
+
+/*
+  A file lent out in a pooled buffer of an Ingester. The buffer goes back
+  to the pool when the Buffer is destroyed, and stays valid until then,
+  even if the Ingester is gone. A file that does not fit a pooled buffer
+  is held in memory of its own.
+ */
+class Buffer {
+public:
+  Buffer() noexcept = default;
+  Buffer(Buffer &&other) noexcept;
+  Buffer &operator=(Buffer &&other) noexcept;
+  Buffer(const Buffer &) = delete;
+  Buffer &operator=(const Buffer &) = delete;
+  ~Buffer() noexcept;
+
+  [[nodiscard]] std::string_view view() const noexcept {
+    return pool_ != nullptr ? std::string_view(data_, size_) : spill_;
+  }
+
+private:
+  friend struct Pool;
+
+  Buffer(std::shared_ptr<Pool> pool, std::size_t slot,
+         std::size_t size) noexcept;
+  explicit Buffer(std::string spill) noexcept : spill_(std::move(spill)) {}
+
+  void release() noexcept;
+
+  std::shared_ptr<Pool> pool_;
+  std::size_t slot_ = 0;
+  const char *data_ = nullptr;
+  std::size_t size_ = 0;
+  std::string spill_;
+};
+
+// Receives the content of the file with index i of the paths, or
+// std::nullopt if it could not be read. The content is only valid until
+// the consumer returns.
+using Consumer =
+    std::function<void(std::size_t i, std::optional<std::string_view>)>;
+
+// Receives the file with index i of the paths in the buffer it was read
+// into, or std::nullopt if it could not be read.
+using Borrower = std::function<void(std::size_t i, std::optional<Buffer>)>;
+
+/*
+  Reads files with the pooled buffers of one thread. An Ingester is not
+  thread-safe, but every thread may have its own.
+ */
+class Ingester {
+public:
+  explicit Ingester(Options options = Options()) noexcept;
+  ~Ingester() noexcept;
+
+  Ingester(Ingester &&) noexcept;
+  Ingester &operator=(Ingester &&) noexcept;
+
+  // Reads every file in paths and passes it to consumer, in the order of
+  // paths.
+  void read(std::span<const std::string> paths,
+            const Consumer &consumer) noexcept;
+
+  // Reads every file in paths and lends it to borrower, in the order of
+  // paths.
+  void lend(std::span<const std::string> paths,
+            const Borrower &borrower) noexcept;
+
+  [[nodiscard]] Backend backend() const noexcept;
+
+private:
+  struct State;
+  std::unique_ptr<State> state_;
+};
+
+}; // namespace Ingest
+
+}; // namespace OS2DSRules
+
+#endif
@@ -0,0 +1,227 @@
+#ifndef LATENCY_HPP
+#define LATENCY_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/*
+  Scan latency histograms by rule and document size.
+
+  Every call to find_matches is timed and recorded in an HDR-style
+  histogram: values below 16 ns are counted exactly, and every power of
+  two above that is split into 16 linear sub-buckets, so a recorded
+  value is never off by more than 1/16 (about 6%). Recording is two
+  clock reads and a relaxed increment in a block owned by the calling
+  thread, which is cheap enough to leave on. Snapshots sum the blocks of
+  all threads and can be merged further, e.g. across processes.
+ */
+namespace OS2DSRules {
+
+namespace Latency {
+
+enum class Rule : std::size_t {
+  CPRDetector,
+  NameRule,
+  AddressRule,
+  HealthRule,
+  WordListRule,
+  Count,
+};
+
+inline constexpr std::size_t rule_count = static_cast<std::size_t>(Rule::Count);
+
+// Documents are bucketed by size, in powers of 16 from 1 KiB to 4 MiB.
+enum class SizeBucket : std::size_t {
+  UpTo1KiB,
+  UpTo16KiB,
+  UpTo256KiB,
+  UpTo4MiB,
+  Larger,
+  Count,
+};
+
+inline constexpr std::size_t size_bucket_count =
+    static_cast<std::size_t>(SizeBucket::Count);
+
+[[nodiscard]] constexpr SizeBucket size_bucket(std::size_t bytes) noexcept {
+  if (bytes <= (std::size_t(1) << 10))
+    return SizeBucket::UpTo1KiB;
+  if (bytes <= (std::size_t(1) << 14))
+    return SizeBucket::UpTo16KiB;
+  if (bytes <= (std::size_t(1) << 18))
+    return SizeBucket::UpTo256KiB;
+  if (bytes <= (std::size_t(1) << 22))
+    return SizeBucket::UpTo4MiB;
+  return SizeBucket::Larger;
+}
+
+[[nodiscard]] std::string_view rule_name(Rule) noexcept;
+[[nodiscard]] std::string_view size_bucket_name(SizeBucket) noexcept;
+
+class Snapshot;
+[[nodiscard]] Snapshot snapshot() noexcept;
+
+/*
+  A histogram of durations in nanoseconds. Values above max_value, about
+  73 minutes, are recorded in the last bucket.
+ */
+class Histogram {
+public:
+  static constexpr std::size_t sub_bucket_bits = 4;
+  static constexpr std::size_t sub_buckets = std::size_t(1) << sub_bucket_bits;
+  static constexpr std::size_t max_exponent = 41;
+  static constexpr std::size_t bucket_count =
+      (max_exponent - sub_bucket_bits + 2) * sub_buckets;
+  static constexpr std::uint64_t max_value =
+      (std::uint64_t(1) << (max_exponent + 1)) - 1;
+
+  [[nodiscard]] static constexpr std::size_t
+  bucket_index(std::uint64_t value) noexcept {
+    if (value < sub_buckets)
+      return static_cast<std::size_t>(value);
+
+    value = std::min(value, max_value);
+    const auto exponent = std::size_t(std::bit_width(value)) - 1;
+    const auto shift = exponent - sub_bucket_bits;
+    const auto sub_bucket = (value >> shift) & (sub_buckets - 1);
+
+    return (exponent - sub_bucket_bits + 1) * sub_buckets +
+           static_cast<std::size_t>(sub_bucket);
+  }
+
+  // The largest value that is recorded in a bucket.
+  [[nodiscard]] static constexpr std::uint64_t
+  bucket_upper_bound(std::size_t index) noexcept {
+    if (index < sub_buckets)
+      return index;
+
+    const auto exponent = index / sub_buckets + sub_bucket_bits - 1;
+    const auto shift = exponent - sub_bucket_bits;
+    const auto lower = (sub_buckets + index % sub_buckets) << shift;
+    return lower + (std::uint64_t(1) << shift) - 1;
+  }
+
+  void record(std::uint64_t nanoseconds, std::uint64_t count = 1) noexcept;
+  Histogram &merge(const Histogram &other) noexcept;
+
+  [[nodiscard]] std::uint64_t count() const noexcept { return count_; }
+  [[nodiscard]] std::uint64_t max() const noexcept { return max_; }
+  [[nodiscard]] double mean() const noexcept;
+
+  /*
+    The smallest recorded value such that at least a fraction q of all
+    values are at most that value, e.g. q = 0.99 for the 99th percentile.
+    Returns 0 for an empty histogram.
+   */
+  [[nodiscard]] std::uint64_t percentile(double q) const noexcept;
+
+  [[nodiscard]] const std::array<std::uint64_t, bucket_count> &
+  buckets() const noexcept {
+    return buckets_;
+  }
+
+private:
+  friend Snapshot snapshot() noexcept;
+
+  std::array<std::uint64_t, bucket_count> buckets_{};
+  std::uint64_t count_ = 0;
+  std::uint64_t sum_ = 0;
+  std::uint64_t max_ = 0;
+};
+
+/*
+  The histograms of every rule and size bucket at some point in time.
+ */
+class Snapshot {
+public:
+  [[nodiscard]] Histogram &at(Rule rule, SizeBucket size) noexcept {
+    return histograms_[static_cast<std::size_t>(rule)]
+                      [static_cast<std::size_t>(size)];
+  }
+
+  [[nodiscard]] const Histogram &at(Rule rule, SizeBucket size) const noexcept {
+    return histograms_[static_cast<std::size_t>(rule)]
+                      [static_cast<std::size_t>(size)];
+  }
+
+  Snapshot &merge(const Snapshot &other) noexcept;
+
+  /*
+    A table with count, p50, p99, p99.9 and max for every rule and size
+    bucket that has recorded scans.
+   */
+  [[nodiscard]] std::string to_text() const;
+
+private:
+  std::array<std::array<Histogram, size_bucket_count>, rule_count>
+      histograms_{};
+};
+
+// Sums the histograms of all threads.
+Snapshot snapshot() noexcept;
+
+// Clears all histograms. Only reset while no scans are running.
+void reset() noexcept;
+
+// Recording is on by default.
+void set_enabled(bool) noexcept;
+[[nodiscard]] bool is_enabled() noexcept;
+
+// Records one scan in the block of the calling thread.
+void record(Rule, std::size_t bytes, std::uint64_t nanoseconds) noexcept;
+
+namespace detail {
+
+// Nesting depth of timed scans on the calling thread.
+[[nodiscard]] std::size_t &scan_depth() noexcept;
+
+} // namespace detail
+
+/*
+  Times a call to find_matches and records it when it goes out of scope.
+  Only the outermost timer on a thread records, so HealthRule delegating
+  to WordListRule is one HealthRule scan, as with Stats::ScanScope.
+ */
+class ScanTimer {
+public:
+  ScanTimer(Rule rule, std::size_t bytes) noexcept
+      : rule_(rule), bytes_(bytes),
+        enabled_(detail::scan_depth()++ == 0 && is_enabled()) {
+    if (enabled_)
+      start_ = std::chrono::steady_clock::now();
+  }
+
+  ScanTimer(const ScanTimer &) = delete;
+  ScanTimer &operator=(const ScanTimer &) = delete;
+
+  ~ScanTimer() noexcept {
+    --detail::scan_depth();
+    if (!enabled_)
+      return;
+
+    const auto elapsed = std::chrono::steady_clock::now() - start_;
+    record(rule_, bytes_,
+           static_cast<std::uint64_t>(
+               std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+                   .count()));
+  }
+
+private:
+  Rule rule_;
+  std::size_t bytes_;
+  bool enabled_;
+  std::chrono::steady_clock::time_point start_{};
+};
+
+}; // namespace Latency
+
+}; // namespace OS2DSRules
+
+#endif
@@ -0,0 +1,226 @@
+#ifndef MARKUP_HPP
+#define MARKUP_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <os2dsrules.hpp>
+
+namespace OS2DSRules {
+
+/*
+  Scanning of HTML and XML documents.
+
+  Tags and entities split names and addresses, and make up much of the
+  bytes of a document. A Stripper turns markup into the text a reader
+  would see: tags, comments, scripts and stylesheets are dropped, block
+  tags such as <p> and <td> become a line break, and entities are
+  decoded. The text is produced as Segments that refer to the source, and
+  an OffsetMap takes positions in the text back to the source, so that
+  matches found in the text can be reported where they are in the
+  document.
+ */
+namespace Markup {
+
+/*
+  A piece of text, and the bytes of the source it comes from.
+
+  Text that is not markup is a view of the source. Decoded entities and
+  the line breaks of block tags are held by the segment itself, or refer
+  to static storage, so no segment ever needs to be freed.
+ */
+class Segment {
+public:
+  // Text that is the source bytes at source.
+  [[nodiscard]] static Segment view(std::string_view text,
+                                    std::size_t source) noexcept {
+    return Segment(text, source, text.size(), true);
+  }
+
+  // Text that replaces source_size bytes of markup at source. text must
+  // outlive the segment, e.g. be a string literal.
+  [[nodiscard]] static Segment replace(std::string_view text,
+                                       std::size_t source,
+                                       std::size_t source_size) noexcept {
+    return Segment(text, source, source_size, false);
+  }
+
+  // Like replace, but with up to four bytes of text copied into the
+  // segment. Text of the same size as the source is taken to be verbatim.
+  [[nodiscard]] static Segment inline_text(std::string_view text,
+                                           std::size_t source,
+                                           std::size_t source_size) noexcept;
+
+  [[nodiscard]] std::string_view text() const noexcept {
+    return inline_size_ > 0 ? std::string_view(inline_.data(), inline_size_)
+                            : text_;
+  }
+
+  [[nodiscard]] std::size_t source() const noexcept { return source_; }
+  [[nodiscard]] std::size_t source_size() const noexcept {
+    return source_size_;
+  }
+
+  // Whether every byte of the text is the byte at the same position in
+  // the source.
+  [[nodiscard]] bool verbatim() const noexcept { return verbatim_; }
+
+private:
+  Segment(std::string_view text, std::size_t source, std::size_t source_size,
+          bool verbatim) noexcept
+      : text_(text), source_(source), source_size_(source_size),
+        verbatim_(verbatim) {}
+
+  std::string_view text_;
+  std::size_t source_;
+  std::size_t source_size_;
+  bool verbatim_;
+  std::uint8_t inline_size_ = 0;
+  std::array<char, 4> inline_{};
+};
+
+/*
+  Maps positions in stripped text back to the source.
+
+  The map holds one span for every run of text copied verbatim from the
+  source, and one for every replaced piece of markup, so its size is
+  proportional to the number of tags and entities and not to the size of
+  the text. Lookups are a binary search.
+ */
+class OffsetMap {
+public:
+  // Appends the next segment of the text.
+  void append(const Segment &segment) noexcept;
+
+  // The first byte in the source of the text byte at pos.
+  [[nodiscard]] std::size_t to_source(std::size_t pos) const noexcept;
+
+  // The last byte in the source of the text byte at pos. This differs
+  // from to_source for text that replaces markup.
+  [[nodiscard]] std::size_t to_source_end(std::size_t pos) const noexcept;
+
+  // The size of the text.
+  [[nodiscard]] std::size_t size() const noexcept { return size_; }
+
+  // The number of spans in the map.
+  [[nodiscard]] std::size_t spans() const noexcept { return spans_.size(); }
+
+  void clear() noexcept;
+
+private:
+  struct Span {
+    std::size_t text;
+    std::size_t source;
+    std::uint32_t source_size;
+    bool verbatim;
+  };
+
+  [[nodiscard]] const Span *find(std::size_t pos) const noexcept;
+
+  std::vector<Span> spans_;
+  std::size_t size_ = 0;
+  std::size_t source_end_ = 0;
+};
+
+/*
+  A streaming markup stripper.
+
+  The source is fed in pieces of any size, and the segments of text
+  found in each piece are appended to a vector. Segments that are views
+  refer to the piece they were found in, so they must be used before it
+  goes away. Tags, comments and entities may span pieces.
+
+  Text is found 16 bytes at a time where SSE2 is available.
+ */
+class Stripper {
+public:
+  Stripper() noexcept = default;
+
+  // Strips the next piece of the source.
+  void feed(std::string_view piece, std::vector<Segment> &segments) noexcept;
+
+  // Ends the source. An entity that was not terminated is kept as text,
+  // while an unterminated tag or comment is dropped.
+  void finish(std::vector<Segment> &segments) noexcept;
+
+  // The number of source bytes fed.
+  [[nodiscard]] std::size_t offset() const noexcept { return offset_; }
+
+private:
+  enum class State : unsigned char {
+    Text,
+    TagOpen,
+    TagName,
+    Tag,
+    Quote,
+    Bang,
+    Comment,
+    RawText,
+    Entity,
+  };
+
+  void end_tag(std::size_t end, std::vector<Segment> &segments) noexcept;
+  void end_entity(std::string_view piece, std::size_t pos,
+                  std::vector<Segment> &segments) noexcept;
+  void emit_literal(std::string_view piece, std::size_t pos,
+                    std::vector<Segment> &segments) noexcept;
+
+  State state_ = State::Text;
+  // The position in the source of the first byte of the piece.
+  std::size_t offset_ = 0;
+  // Where the tag, comment or entity being read starts in the source.
+  std::size_t markup_ = 0;
+  // The first bytes of the lowercase name of the tag being read, packed
+  // into an int.
+  std::uint64_t name_ = 0;
+  std::size_t name_size_ = 0;
+  bool closing_ = false;
+  // An '=' was the last non-space byte of a tag, so a quote starts a value.
+  bool equals_ = false;
+  char quote_ = 0;
+  // Consecutive dashes seen last in a comment, or after "<!".
+  unsigned dashes_ = 0;
+  // How much of the end tag of a script or stylesheet has been seen.
+  std::string_view raw_end_;
+  std::size_t raw_matched_ = 0;
+  // The bytes of the entity being read, after '&'.
+  std::string entity_;
+};
+
+/*
+  A document stripped of markup, for rules to scan.
+ */
+struct Document {
+  std::string text;
+  OffsetMap map;
+
+  // Translates a match in the text, found by a rule whose ends are end,
+  // to the source. The match string is the text that was matched, and the
+  // end keeps the convention of the rule: the last source byte of the
+  // last matched byte if inclusive, and the first source byte of the byte
+  // after the match if exclusive.
+  [[nodiscard]] MatchResult to_source(const MatchResult &m,
+                                      End end) const noexcept;
+};
+
+[[nodiscard]] Document strip(std::string_view source) noexcept;
+
+// Scans a stripped document, and reports the matches in the source.
+template <typename Rule>
+[[nodiscard]] MatchResults find_matches(Rule &rule,
+                                        const Document &document) noexcept {
+  MatchResults results = rule.find_matches(document.text);
+  for (auto &m : results)
+    m = document.to_source(m, end_of<Rule>);
+  return results;
+}
+
+}; // namespace Markup
+
+}; // namespace OS2DSRules
+
+#endif
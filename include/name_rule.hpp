@@ -1,7 +1,9 @@
 #ifndef NAME_RULE_HPP
 #define NAME_RULE_HPP
 
+#include <content_hash.hpp>
 #include <os2dsrules.hpp>
+#include <prescreen.hpp>
 #include <string>
 #include <string_view>
 
@@ -19,15 +21,31 @@ public:
   constexpr NameRule &operator=(NameRule &&) noexcept = default;
   ~NameRule() noexcept = default;
 
-  [[nodiscard]] MatchResults find_matches(const std::string &) const noexcept;
+  [[nodiscard]] MatchResults find_matches(std::string_view) const noexcept;
+  [[nodiscard]] ScanResult find_matches(std::string_view,
+                                        const ScanOptions &) const noexcept;
+
+  // Every name starts with an uppercase letter.
+  [[nodiscard]] static constexpr PreScreen::Requirements
+  requirements() noexcept {
+    return {.min_uppercase = 1};
+  }
+
+  // Identifies the configuration of the rule in result cache keys.
+  [[nodiscard]] constexpr std::uint64_t config_hash() const noexcept {
+    return ContentHash::fnv1a("NameRule/1");
+  }
+
+  // Names are only composed across a single delimiter, so matches never
+  // span a blank line.
+  [[nodiscard]] constexpr bool chunkable() const noexcept { return true; }
 
 private:
   [[nodiscard]] bool contains(const std::string_view) const noexcept;
   [[nodiscard]] bool contains(const std::string) const noexcept;
-  [[nodiscard]] bool contains(const std::string::const_iterator,
-                              const std::string::const_iterator) const noexcept;
-  [[nodiscard]] MatchResults
-  filter_matches(const MatchResults &matches) const noexcept;
+  [[nodiscard]] bool
+  contains(const std::string_view::const_iterator,
+           const std::string_view::const_iterator) const noexcept;
 };
 
 }; // namespace NameRule
@@ -1,9 +1,12 @@
 #ifndef OS2DSRULES_HPP_
 #define OS2DSRULES_HPP_
 
+#include <chrono>
 #include <concepts>
 #include <cstddef>
 #include <functional>
+#include <limits>
+#include <optional>
 #include <string>
 #include <type_traits>
 #include <vector>
@@ -68,7 +71,7 @@ struct MatchResult {
 
   [[nodiscard]] size_t end() const noexcept { return end_; }
 
-  [[nodiscard]] const std::string match() const noexcept { return match_; }
+  [[nodiscard]] const std::string &match() const noexcept { return match_; }
 
   [[nodiscard]] Sensitivity sensitivity() const noexcept {
     return sensitivity_;
@@ -86,6 +89,78 @@ private:
 
 using MatchResults = std::vector<MatchResult>;
 
+// Whether the ends of the matches of a rule are the offset of their last
+// byte, or of the byte after it. Rules with inclusive ends declare so by
+// specializing end_of.
+enum class End : unsigned char { Inclusive, Exclusive };
+
+template <typename Rule> constexpr End end_of = End::Exclusive;
+
+// Whether the end of m, a match of a rule whose ends are end, is the
+// offset of its last byte. Rules with exclusive ends report a match that
+// runs to the end of the content with the offset of its last byte too,
+// and the text of such a match is one byte longer than end - start.
+[[nodiscard]] constexpr bool ends_at_last_byte(const MatchResult &m,
+                                               End end) noexcept {
+  return end == End::Inclusive || m.end() - m.start() < m.match().size();
+}
+
+/*
+  Limits for a single call to find_matches. When a limit is reached, the
+  scan stops cooperatively and returns the matches found so far.
+ */
+struct ScanOptions {
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr std::size_t unlimited =
+      std::numeric_limits<std::size_t>::max();
+
+  // Stop once this point in time has passed.
+  std::optional<Clock::time_point> deadline = std::nullopt;
+  // Only scan the first byte_budget bytes of the content.
+  std::size_t byte_budget = unlimited;
+  // Stop after this many matches.
+  std::size_t max_matches = unlimited;
+  // The content is a piece of a longer stream, so more may follow its
+  // end. Tokens at the end are then left open instead of being ended by
+  // the end of the content, and offset is where the next piece starts.
+  bool partial = false;
+
+  [[nodiscard]] static ScanOptions
+  with_timeout(std::chrono::nanoseconds timeout) noexcept {
+    ScanOptions options;
+    options.deadline = Clock::now() + timeout;
+    return options;
+  }
+};
+
+enum class StopReason {
+  Completed,
+  Deadline,
+  ByteBudget,
+  MaxMatches,
+};
+
+/*
+  The result of a scan with ScanOptions.
+
+  offset is the position up to which the content has been scanned
+  completely: every match before it has been reported, and scanning
+  content.substr(offset) finds the rest. A token that straddles the
+  point where the scan stopped is left for the rescan, so offset may be
+  smaller than the number of bytes that were looked at.
+
+  A scan of a partial piece of a stream is not truncated because it left
+  a token at the end open; offset is then smaller than the size of the
+  content even though the whole piece has been looked at.
+ */
+struct ScanResult {
+  MatchResults matches;
+  std::size_t offset = 0;
+  bool truncated = false;
+  StopReason reason = StopReason::Completed;
+};
+
 // Concept behind a scanner rule.
 template <typename Rule>
 concept ScannerRule = requires(Rule rule, std::string s) {
@@ -0,0 +1,348 @@
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <new>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <ingest.hpp>
+#include <os2dsrules.hpp>
+#include <prescreen.hpp>
+
+namespace OS2DSRules {
+
+/*
+  Bulk scans of files and directory trees.
+
+  A Pipeline runs the whole flow of a bulk job as stages on threads of
+  their own: one thread enumerates the files, readers read them, scanners
+  run the rules on them, and the calling thread hands the results to a
+  writer. The stages are connected by bounded queues, so a stage that
+  falls behind makes the stages before it wait rather than pile up
+  documents in memory, and a reader that waits for I/O does not keep the
+  scanners from working on what has already been read.
+ */
+namespace Pipeline {
+
+/*
+  A bounded lock-free queue for any number of producers and consumers.
+
+  Every slot carries a sequence number that tells producers and
+  consumers whose turn it is, so that pushes and pops only contend on a
+  single atomic increment. A push to a full queue and a pop from an empty
+  one wait until the other side has made progress; once the queue is
+  closed, pops drain it and then fail.
+ */
+template <typename T> class BoundedQueue {
+public:
+  // The capacity is rounded up to a power of two.
+  explicit BoundedQueue(std::size_t capacity) noexcept
+      : mask_(std::bit_ceil(std::max<std::size_t>(capacity, 2)) - 1),
+        slots_(std::make_unique<Slot[]>(mask_ + 1)) {
+    for (std::size_t i = 0; i <= mask_; ++i)
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  BoundedQueue(const BoundedQueue &) = delete;
+  BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+  [[nodiscard]] bool try_push(T &value) noexcept {
+    auto pos = tail_.load(std::memory_order_relaxed);
+    for (;;) {
+      auto &slot = slots_[pos & mask_];
+      const auto sequence = slot.sequence.load(std::memory_order_acquire);
+      const auto diff = static_cast<std::intptr_t>(sequence) -
+                        static_cast<std::intptr_t>(pos);
+
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+          slot.value = std::move(value);
+          slot.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  [[nodiscard]] std::optional<T> try_pop() noexcept {
+    auto pos = head_.load(std::memory_order_relaxed);
+    for (;;) {
+      auto &slot = slots_[pos & mask_];
+      const auto sequence = slot.sequence.load(std::memory_order_acquire);
+      const auto diff = static_cast<std::intptr_t>(sequence) -
+                        static_cast<std::intptr_t>(pos + 1);
+
+      if (diff == 0) {
+        if (head_.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+          std::optional<T> value(std::move(slot.value));
+          slot.sequence.store(pos + mask_ + 1, std::memory_order_release);
+          return value;
+        }
+      } else if (diff < 0) {
+        return std::nullopt;
+      } else {
+        pos = head_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Pushes value, waiting while the queue is full. Returns false if the
+  // queue has been closed.
+  bool push(T value) noexcept {
+    for (;;) {
+      const auto popped = pops_.load(std::memory_order_acquire);
+      if (closed_.load(std::memory_order_acquire))
+        return false;
+
+      if (try_push(value)) {
+        pushes_.fetch_add(1, std::memory_order_release);
+        pushes_.notify_all();
+        return true;
+      }
+
+      pops_.wait(popped, std::memory_order_acquire);
+    }
+  }
+
+  // Pops a value, waiting while the queue is empty. Returns std::nullopt
+  // once the queue is closed and empty.
+  [[nodiscard]] std::optional<T> pop() noexcept {
+    for (;;) {
+      const auto pushed = pushes_.load(std::memory_order_acquire);
+      const bool closed = closed_.load(std::memory_order_acquire);
+
+      if (auto value = try_pop()) {
+        pops_.fetch_add(1, std::memory_order_release);
+        pops_.notify_all();
+        return value;
+      }
+
+      // Every push happened before the queue was closed.
+      if (closed)
+        return std::nullopt;
+
+      pushes_.wait(pushed, std::memory_order_acquire);
+    }
+  }
+
+  // Ends the values. Waiting producers and consumers are woken.
+  void close() noexcept {
+    closed_.store(true, std::memory_order_release);
+    pushes_.fetch_add(1, std::memory_order_release);
+    pops_.fetch_add(1, std::memory_order_release);
+    pushes_.notify_all();
+    pops_.notify_all();
+  }
+
+  [[nodiscard]] std::size_t capacity() const noexcept { return mask_ + 1; }
+
+private:
+  struct Slot {
+    std::atomic<std::size_t> sequence;
+    T value;
+  };
+
+  // Keeps the counters that producers and consumers write apart.
+  static constexpr std::size_t line = 64;
+
+  const std::size_t mask_;
+  std::unique_ptr<Slot[]> slots_;
+  alignas(line) std::atomic<std::size_t> tail_ = 0;
+  alignas(line) std::atomic<std::size_t> head_ = 0;
+  // Bumped after every push and pop, for the other side to wait on.
+  alignas(line) std::atomic<std::uint32_t> pushes_ = 0;
+  alignas(line) std::atomic<std::uint32_t> pops_ = 0;
+  std::atomic<bool> closed_ = false;
+};
+
+/*
+  The rules a pipeline runs on every file.
+
+  Every scanner thread gets a copy of every rule, so rules need not be
+  thread-safe. Rules are identified by the index add() returns, and are
+  skipped on files that the pre-screen rules out for them.
+ */
+class RuleSet {
+public:
+  using Scan = std::function<MatchResults(std::string_view)>;
+
+  // Adds a copy of rule. Returns its index, or PreScreen::Planner::max_rules
+  // if the set is full.
+  template <typename Rule>
+  std::size_t add(std::string name, const Rule &rule) noexcept {
+    const auto index = planner_.add<Rule>();
+    if (index == PreScreen::Planner::max_rules)
+      return index;
+
+    names_.push_back(std::move(name));
+    factories_.push_back([rule]() -> Scan {
+      return [copy = rule](std::string_view content) mutable {
+        return copy.find_matches(content);
+      };
+    });
+    return index;
+  }
+
+  [[nodiscard]] std::size_t size() const noexcept { return names_.size(); }
+
+  [[nodiscard]] const std::string &name(std::size_t rule) const noexcept {
+    return names_[rule];
+  }
+
+  [[nodiscard]] const PreScreen::Planner &planner() const noexcept {
+    return planner_;
+  }
+
+  // A copy of every rule, for one scanner thread.
+  [[nodiscard]] std::vector<Scan> scans() const noexcept;
+
+private:
+  std::vector<std::string> names_;
+  std::vector<std::function<Scan()>> factories_;
+  PreScreen::Planner planner_;
+};
+
+struct FileResult {
+  std::string path;
+  // Whether the file could be read.
+  bool ok = false;
+  std::uint64_t size = 0;
+  // The matches of every rule, by index. A rule that was skipped by the
+  // pre-screen has none.
+  std::vector<MatchResults> matches;
+};
+
+/*
+  The content of a file, either read into memory, mapped into it, or
+  lent out in the buffer an Ingester read it into. A mapped file must not
+  be truncated while it is scanned.
+ */
+class Content {
+public:
+  Content() noexcept = default;
+  Content(std::string text) noexcept : text_(std::move(text)) {}
+  Content(Ingest::Buffer buffer) noexcept : buffer_(std::move(buffer)) {}
+
+  Content(Content &&other) noexcept;
+  Content &operator=(Content &&other) noexcept;
+  Content(const Content &) = delete;
+  Content &operator=(const Content &) = delete;
+  ~Content() noexcept;
+
+  // Maps the file at path. Returns std::nullopt if it cannot be mapped,
+  // which includes empty files.
+  [[nodiscard]] static std::optional<Content>
+  map(const std::string &path) noexcept;
+
+  [[nodiscard]] std::string_view view() const noexcept {
+    if (mapped_ != nullptr)
+      return std::string_view(mapped_, size_);
+    return buffer_ ? buffer_->view() : text_;
+  }
+
+private:
+  void unmap() noexcept;
+
+  std::string text_;
+  std::optional<Ingest::Buffer> buffer_;
+  const char *mapped_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+// Reads the file at path. Returns std::nullopt if it cannot be read.
+using Reader = std::function<std::optional<Content>(const std::string &)>;
+
+// Receives the results on the calling thread, in the order the scans end.
+using Writer = std::function<void(FileResult &)>;
+
+[[nodiscard]] std::optional<Content> read_file(const std::string &path) noexcept;
+
+// Maps the file at path, and reads it where it cannot be mapped.
+[[nodiscard]] std::optional<Content> map_file(const std::string &path) noexcept;
+
+struct Options {
+  std::size_t readers = 2;
+  // 0 means a scanner per hardware thread.
+  std::size_t scanners = 0;
+  // The capacity of each of the queues between stages.
+  std::size_t queue_size = 64;
+  Reader reader = read_file;
+  // If set, every reader reads the files in batches with an Ingester of
+  // its own instead of one at a time with reader.
+  std::optional<Ingest::Options> ingest;
+};
+
+/*
+  How a stage spent its time. Every thread of a stage is either working
+  on an item, starved waiting for the previous stage, or blocked waiting
+  for the next one to make room.
+ */
+struct StageStats {
+  std::size_t threads = 0;
+  std::uint64_t items = 0;
+  std::chrono::nanoseconds busy{0};
+  std::chrono::nanoseconds starved{0};
+  std::chrono::nanoseconds blocked{0};
+
+  // The share of the time of the threads of the stage spent working.
+  [[nodiscard]] double
+  utilization(std::chrono::nanoseconds wall) const noexcept {
+    const auto total = static_cast<double>(wall.count()) *
+                       static_cast<double>(threads);
+    return total > 0 ? static_cast<double>(busy.count()) / total : 0.0;
+  }
+
+  StageStats &operator+=(const StageStats &other) noexcept;
+};
+
+struct Stats {
+  StageStats enumerate;
+  StageStats read;
+  StageStats scan;
+  StageStats write;
+  std::uint64_t bytes = 0;
+  std::chrono::nanoseconds wall{0};
+};
+
+class Pipeline {
+public:
+  explicit Pipeline(RuleSet rules, Options options = Options()) noexcept
+      : rules_(std::move(rules)), options_(std::move(options)) {}
+
+  /*
+    Scans every regular file in roots, which may be files or directories
+    that are walked recursively, and passes the result for each to writer.
+    Files that cannot be read are passed on with ok set to false.
+   */
+  Stats run(const std::vector<std::string> &roots,
+            const Writer &writer) noexcept;
+
+  [[nodiscard]] const RuleSet &rules() const noexcept { return rules_; }
+
+private:
+  RuleSet rules_;
+  Options options_;
+};
+
+}; // namespace Pipeline
+
+}; // namespace OS2DSRules
+
+#endif
@@ -0,0 +1,186 @@
+#ifndef PRESCREEN_HPP
+#define PRESCREEN_HPP
+
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace OS2DSRules {
+
+/*
+  Document-level pre-screening.
+
+  Most documents contain nothing that any rule can match. A single pass
+  over a document computes a few cheap Features, and every rule declares
+  the Requirements a document must meet before it can possibly contain a
+  match. A Planner then decides which rules to run on the document, so
+  that e.g. a document without a run of six digits never enters the
+  CPRDetector.
+
+  Requirements are conservative: a rule is only skipped if it cannot
+  match anything in the document.
+ */
+namespace PreScreen {
+
+enum class ByteClass {
+  Digit,       // 0-9
+  Upper,       // A-Z
+  Lower,       // a-z
+  Space,       // ' ', \t, \n, \v, \f, \r
+  Punctuation, // Any other printable ASCII character.
+  Control,     // Any other ASCII character.
+  NonAscii,    // Bytes of multi-byte UTF-8 sequences, or other encodings.
+};
+
+inline constexpr std::size_t byte_class_count = 7;
+
+struct Features {
+  // The size of the document in bytes.
+  std::size_t size = 0;
+  // The length of the longest run of consecutive digits.
+  std::size_t longest_digit_run = 0;
+  // The number of tokens, i.e. runs of letters, digits and non-ASCII bytes.
+  std::size_t tokens = 0;
+  // The number of tokens that start with an uppercase letter.
+  std::size_t capitalized_tokens = 0;
+  // The number of bytes in each ByteClass.
+  std::array<std::size_t, byte_class_count> byte_classes{};
+
+  [[nodiscard]] constexpr std::size_t count(ByteClass c) const noexcept {
+    return byte_classes[static_cast<std::size_t>(c)];
+  }
+
+  [[nodiscard]] constexpr double uppercase_token_density() const noexcept {
+    return tokens == 0 ? 0.0 : double(capitalized_tokens) / double(tokens);
+  }
+
+  [[nodiscard]] constexpr double digit_density() const noexcept {
+    return size == 0 ? 0.0 : double(count(ByteClass::Digit)) / double(size);
+  }
+
+  [[nodiscard]] constexpr bool is_ascii() const noexcept {
+    return count(ByteClass::NonAscii) == 0;
+  }
+};
+
+/*
+  Computes the Features of content in a single pass, 16 bytes at a time
+  where SSE2 is available.
+ */
+[[nodiscard]] Features analyze(std::string_view content) noexcept;
+
+/*
+  What a document must have before a rule can find anything in it.
+ */
+struct Requirements {
+  std::size_t min_size = 0;
+  std::size_t min_digit_run = 0;
+  std::size_t min_uppercase = 0;
+
+  [[nodiscard]] constexpr bool met_by(const Features &f) const noexcept {
+    return f.size >= min_size && f.longest_digit_run >= min_digit_run &&
+           f.count(ByteClass::Upper) >= min_uppercase;
+  }
+
+  // Whether every document meets the requirements, in which case the
+  // rule never needs the Features.
+  [[nodiscard]] constexpr bool trivial() const noexcept {
+    return min_size == 0 && min_digit_run == 0 && min_uppercase == 0;
+  }
+};
+
+// Rules declare their requirements with a static requirements() member.
+template <typename Rule>
+concept Screened = requires {
+  { Rule::requirements() } -> std::same_as<Requirements>;
+};
+
+template <typename Rule>
+[[nodiscard]] constexpr Requirements requirements_of() noexcept {
+  if constexpr (Screened<Rule>)
+    return Rule::requirements();
+  else
+    return Requirements();
+}
+
+/*
+  The rules a Planner has chosen to run on a document.
+ */
+struct Plan {
+  Features features;
+  // Whether the document was analyzed at all.
+  bool screened = false;
+  // Bit i is set if the rule with index i should run.
+  std::uint64_t rules = 0;
+
+  [[nodiscard]] constexpr bool runs(std::size_t rule) const noexcept {
+    return (rules >> rule) & 1;
+  }
+};
+
+/*
+  Chooses the rules to run on a document from their requirements.
+
+  Rules are added once, and are identified by the index add() returns. If
+  no rule has any requirements, the document is not analyzed at all.
+ */
+class Planner {
+public:
+  static constexpr std::size_t max_rules = 64;
+
+  Planner() noexcept = default;
+
+  // Adds a rule, and returns its index, or max_rules if the planner is
+  // full.
+  std::size_t add(const Requirements &requirements) noexcept {
+    if (size_ == max_rules)
+      return max_rules;
+
+    requirements_[size_] = requirements;
+    screening_ = screening_ || !requirements.trivial();
+    return size_++;
+  }
+
+  template <typename Rule> std::size_t add() noexcept {
+    return add(requirements_of<Rule>());
+  }
+
+  [[nodiscard]] std::size_t size() const noexcept { return size_; }
+
+  [[nodiscard]] Plan plan(const Features &features) const noexcept {
+    Plan result;
+    result.features = features;
+    result.screened = true;
+
+    for (std::size_t i = 0; i < size_; ++i) {
+      if (requirements_[i].met_by(features))
+        result.rules |= std::uint64_t(1) << i;
+    }
+
+    return result;
+  }
+
+  [[nodiscard]] Plan plan(std::string_view content) const noexcept {
+    if (screening_)
+      return plan(analyze(content));
+
+    Plan result;
+    result.features.size = content.size();
+    result.rules = size_ == max_rules ? ~std::uint64_t(0)
+                                      : (std::uint64_t(1) << size_) - 1;
+    return result;
+  }
+
+private:
+  std::array<Requirements, max_rules> requirements_{};
+  std::size_t size_ = 0;
+  bool screening_ = false;
+};
+
+}; // namespace PreScreen
+
+}; // namespace OS2DSRules
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef PROBES_HPP
+#define PROBES_HPP
+
+/*
+  Static user-space tracepoints (USDT) in the provider "os2dsrules".
+
+  When <sys/sdt.h> is available, every probe compiles to a single nop
+  plus a note in the ELF file, which perf, bpftrace and SystemTap use to
+  attach to it at run time. Nothing is evaluated unless a tracer is
+  attached. The build defines OS2DSRULES_HAVE_SDT_H when it has found
+  the header and probes are enabled; otherwise the probes expand to
+  nothing.
+
+  Probes and their arguments:
+
+    scan__start(const char *rule, const char *content, size_t size)
+    scan__done(const char *rule, size_t size, size_t matches)
+    match(const char *rule, size_t start, size_t end)
+    dictionary__start(const char *kind, size_t entries)
+    dictionary__done(const char *kind, size_t entries)
+
+  The number of entries is not known up front for a WordListRule, so its
+  dictionary__start reports 0.
+
+  For example, to list the documents that take NameRule longer than
+  10 ms to scan:
+
+    bpftrace -e '
+      usdt:./libos2dsrules.so:os2dsrules:scan__start { @t[tid] = nsecs; }
+      usdt:./libos2dsrules.so:os2dsrules:scan__done
+        /str(arg0) == "NameRule" && nsecs - @t[tid] > 10000000/ {
+          printf("%d bytes, %d matches\n", arg1, arg2); }'
+ */
+
+#ifdef OS2DSRULES_HAVE_SDT_H
+#include <sys/sdt.h>
+#define OS2DSRULES_HAVE_PROBES 1
+#endif
+
+namespace OS2DSRules {
+
+namespace Probes {
+
+#ifdef OS2DSRULES_HAVE_PROBES
+inline constexpr bool available = true;
+#else
+inline constexpr bool available = false;
+#endif
+
+}; // namespace Probes
+
+}; // namespace OS2DSRules
+
+#ifdef OS2DSRULES_HAVE_PROBES
+#define OS2DSRULES_PROBE2(name, a, b) STAP_PROBE2(os2dsrules, name, a, b)
+#define OS2DSRULES_PROBE3(name, a, b, c) STAP_PROBE3(os2dsrules, name, a, b, c)
+#else
+#define OS2DSRULES_PROBE2(name, a, b) ((void)0)
+#define OS2DSRULES_PROBE3(name, a, b, c) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,224 @@
+#ifndef REDACT_HPP
+#define REDACT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <address_rule.hpp>
+#include <checkpoint.hpp>
+#include <cpr-detector.hpp>
+#include <os2dsrules.hpp>
+
+namespace OS2DSRules {
+
+/*
+  Redacted copies of documents.
+
+  A Redactor runs a set of rules on a document, and writes it out with
+  the text of every match masked according to the policy of the rule that
+  found it. Matches of different rules that overlap are merged into one
+  span, masked by the policy of the rule that was added first. The masked
+  text is written in a single pass over the document, either to a new
+  string, into the string itself, or a piece at a time for documents that
+  arrive in pieces.
+ */
+namespace Redact {
+
+enum class Policy : unsigned char {
+  // Every character is replaced by the fill character.
+  Fixed,
+  // As Fixed, except that the last four digits and ASCII punctuation and
+  // spaces are kept, so that 111111-1118 becomes ******-1118.
+  KeepLast4,
+  // The whole span is replaced by a tag, such as [cpr].
+  Tag,
+};
+
+struct Mask {
+  Policy policy = Policy::Fixed;
+  char fill = '*';
+  // The tag of Policy::Tag. If empty, the name of the rule in brackets.
+  std::string tag = {};
+};
+
+// A part of a document to mask, from start up to but not including end,
+// and the rule whose mask applies.
+struct Span {
+  std::size_t start = 0;
+  std::size_t end = 0;
+  std::size_t rule = 0;
+
+  bool operator==(const Span &) const noexcept = default;
+};
+
+/*
+  The span of the text of m, a match of a rule whose ends are end, in
+  content, which starts at base in the document and ends at the end of
+  the document if last. The span is in offsets into the document.
+
+  Rules with exclusive ends report the end of a match that runs to the
+  end of the document as its last byte, which is corrected here.
+ */
+[[nodiscard]] Span span_of(const MatchResult &m, End end,
+                           std::string_view content, std::size_t base,
+                           bool last) noexcept;
+
+// Sorts spans, and merges those that overlap. A merged span takes the
+// lowest rule of those it covers.
+void merge(std::vector<Span> &spans) noexcept;
+
+class Stream;
+
+class Redactor {
+public:
+  // Adds a copy of rule, whose matches are masked by mask. Returns its
+  // index.
+  template <typename Rule>
+  std::size_t add(std::string name, const Rule &rule,
+                  Mask mask = Mask()) noexcept {
+    return insert(std::move(name), std::make_shared<Rule>(rule),
+                  std::move(mask));
+  }
+
+  // Adds rule itself rather than a copy. It must outlive the redactor.
+  template <typename Rule>
+  std::size_t add_ref(std::string name, Rule &rule,
+                      Mask mask = Mask()) noexcept {
+    return insert(std::move(name),
+                  std::shared_ptr<Rule>(std::shared_ptr<Rule>(), &rule),
+                  std::move(mask));
+  }
+
+  [[nodiscard]] std::size_t size() const noexcept { return rules_.size(); }
+
+  [[nodiscard]] const std::string &name(std::size_t rule) const noexcept {
+    return rules_[rule].name;
+  }
+
+  [[nodiscard]] const Mask &mask(std::size_t rule) const noexcept {
+    return rules_[rule].mask;
+  }
+
+  // The merged spans of the matches of every rule in content.
+  [[nodiscard]] std::vector<Span> spans(std::string_view content) noexcept;
+
+  // A copy of content with every span masked.
+  [[nodiscard]] std::string redact(std::string_view content) noexcept;
+
+  // Masks every span of content in place. Only as many bytes as tags
+  // grow the text by are held aside while it is rewritten.
+  void redact_in_place(std::string &content) noexcept;
+
+  // Appends content to out with spans, which must be merged and lie in
+  // it, masked.
+  void write(std::string_view content, const std::vector<Span> &spans,
+             std::string &out) const noexcept;
+
+  // Rewrites content with spans, which must be merged and lie in it,
+  // masked.
+  void write_in_place(std::string &content,
+                      const std::vector<Span> &spans) const noexcept;
+
+private:
+  friend class Stream;
+
+  template <typename Rule>
+  std::size_t insert(std::string name, std::shared_ptr<Rule> rule,
+                     Mask mask) noexcept {
+    if (mask.policy == Policy::Tag && mask.tag.empty())
+      mask.tag = "[" + name + "]";
+
+    rules_.push_back(Entry{
+        .name = std::move(name),
+        .mask = std::move(mask),
+        .end = end_of<Rule>,
+        .scan = [rule](std::string_view content) {
+          return rule->find_matches(content);
+        },
+        .stream = [rule]() { return make_feed(*rule); },
+    });
+    return rules_.size() - 1;
+  }
+
+  // A rule scanning a stream, see Checkpoint::Stream.
+  struct Feed {
+    std::function<MatchResults(std::string_view)> feed;
+    std::function<MatchResults()> finish;
+    // The position in the stream of the first byte that the rule may
+    // still find a match in.
+    std::function<std::uint64_t()> resume;
+  };
+
+  template <typename Rule> static Feed make_feed(Rule &rule) noexcept {
+    auto stream = std::make_shared<Checkpoint::Stream<Rule>>(rule);
+    return Feed{
+        .feed = [stream](std::string_view piece) {
+          return stream->feed(piece);
+        },
+        .finish = [stream]() { return stream->finish(); },
+        .resume = [stream]() { return stream->checkpoint().resume(); },
+    };
+  }
+
+  struct Entry {
+    std::string name;
+    Mask mask;
+    End end;
+    std::function<MatchResults(std::string_view)> scan;
+    std::function<Feed()> stream;
+  };
+
+  std::vector<Entry> rules_;
+};
+
+/*
+  Redacts a document that arrives in pieces.
+
+  Every piece is scanned by every rule as it is fed, and the masked text
+  is written out up to the first byte that a rule may still find a match
+  in, so only the text of tokens that are still open is held back. A rule
+  that is not resumable holds back the whole document until finish.
+
+  The rules are those of the redactor, which must outlive the stream and
+  must not be used for anything else while it is being fed.
+ */
+class Stream {
+public:
+  explicit Stream(Redactor &redactor) noexcept;
+
+  // Scans piece, and appends the masked text that nothing fed later can
+  // change to out.
+  void feed(std::string_view piece, std::string &out) noexcept;
+
+  // Ends the document, and appends the rest of the masked text to out.
+  // Nothing may be fed after.
+  void finish(std::string &out) noexcept;
+
+private:
+  void collect(std::size_t rule, const MatchResults &matches,
+               bool last) noexcept;
+  void flush(std::uint64_t until, std::string &out) noexcept;
+
+  Redactor &redactor_;
+  std::vector<Redactor::Feed> feeds_;
+  // The bytes fed but not yet written out, which start at offset_ in the
+  // document.
+  std::string pending_;
+  std::uint64_t offset_ = 0;
+  // The spans found in pending_, in offsets into the document.
+  std::vector<Span> spans_;
+  // The spans being written, relative to pending_.
+  std::vector<Span> written_;
+};
+
+}; // namespace Redact
+
+}; // namespace OS2DSRules
+
+#endif
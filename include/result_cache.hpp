@@ -0,0 +1,188 @@
+#ifndef RESULT_CACHE_HPP
+#define RESULT_CACHE_HPP
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <content_hash.hpp>
+#include <os2dsrules.hpp>
+
+namespace OS2DSRules {
+
+namespace ResultCache {
+
+/*
+  Identifies the results of one rule configuration on some content.
+ */
+struct Key {
+  ContentHash::Hash128 content;
+  std::uint64_t config = 0;
+
+  bool operator==(const Key &) const noexcept = default;
+};
+
+struct KeyHash {
+  std::size_t operator()(const Key &key) const noexcept {
+    return std::size_t(ContentHash::combine(key.content.low, key.config));
+  }
+};
+
+struct CacheStats {
+  std::size_t hits = 0;
+  std::size_t misses = 0;
+  std::size_t insertions = 0;
+  std::size_t evictions = 0;
+  std::size_t entries = 0;
+  std::size_t bytes = 0;
+
+  [[nodiscard]] double hit_rate() const noexcept {
+    const auto lookups = hits + misses;
+    return lookups == 0 ? 0.0 : double(hits) / double(lookups);
+  }
+};
+
+/*
+  Content-defined chunks of a document.
+
+  Documents are only cut right after a blank line ("\n\n"), which no
+  chunkable rule matches across, and only where a rolling hash of the
+  preceding bytes has its top bits clear. The cut points therefore only
+  depend on the content around them, so an edit in one part of a large
+  document leaves the other chunks, and their cached results, intact.
+ */
+struct ChunkOptions {
+  // Chunks are at least min_size bytes, except for the last one.
+  std::size_t min_size = 16 * 1024;
+  // Past max_size, a chunk ends at the next blank line.
+  std::size_t max_size = 256 * 1024;
+  // A blank line ends a chunk with probability 2^-mask_bits.
+  unsigned mask_bits = 2;
+};
+
+[[nodiscard]] std::vector<std::string_view>
+content_defined_chunks(std::string_view content,
+                       const ChunkOptions &options = ChunkOptions()) noexcept;
+
+// Rules that declare chunkable() may be run on chunks of a document.
+template <typename Rule>
+concept Chunkable = requires(const Rule &rule) {
+  { rule.chunkable() } -> std::same_as<bool>;
+};
+
+/*
+  A bounded, thread-safe LRU cache of scan results.
+
+  The cache is split into shards with a lock and an LRU list of their
+  own, chosen by the content hash, so that concurrent scans rarely wait
+  for each other. Every shard holds at most capacity / shards bytes of
+  results, as estimated by entry_size.
+ */
+class ResultCache {
+public:
+  static constexpr std::size_t default_shards = 16;
+
+  explicit ResultCache(std::size_t capacity,
+                       std::size_t shards = default_shards) noexcept;
+  ResultCache(const ResultCache &) = delete;
+  ResultCache &operator=(const ResultCache &) = delete;
+
+  [[nodiscard]] std::optional<MatchResults> find(const Key &key) noexcept;
+  void insert(const Key &key, const MatchResults &results) noexcept;
+  void clear() noexcept;
+
+  [[nodiscard]] std::size_t capacity() const noexcept { return capacity_; }
+  [[nodiscard]] CacheStats stats() const noexcept;
+
+  // The number of bytes an entry with results is accounted for.
+  [[nodiscard]] static std::size_t
+  entry_size(const MatchResults &results) noexcept;
+
+  /*
+    Returns the results of rule on content, from the cache if the same
+    rule configuration has scanned the same content before.
+   */
+  template <typename Rule>
+  [[nodiscard]] MatchResults find_matches(Rule &rule,
+                                          std::string_view content) noexcept {
+    const Key key{ContentHash::hash128(content), rule.config_hash()};
+
+    if (auto cached = find(key))
+      return std::move(cached.value());
+
+    auto results = rule.find_matches(content);
+    insert(key, results);
+    return results;
+  }
+
+  /*
+    Like find_matches, but caches the results of every content-defined
+    chunk separately, so that near-duplicate documents reuse the results
+    for the chunks they have in common. Rules that are not chunkable are
+    cached for the whole document.
+   */
+  template <typename Rule>
+  [[nodiscard]] MatchResults
+  find_matches_chunked(Rule &rule, std::string_view content,
+                       const ChunkOptions &options = ChunkOptions()) noexcept {
+    if constexpr (Chunkable<Rule>) {
+      if (rule.chunkable() && content.size() >= 2 * options.min_size) {
+        MatchResults results;
+
+        for (auto chunk : content_defined_chunks(content, options)) {
+          const auto offset =
+              static_cast<std::size_t>(chunk.data() - content.data());
+          for (const auto &m : find_matches(rule, chunk))
+            results.push_back(MatchResult(m.match(), m.start() + offset,
+                                          m.end() + offset, m.sensitivity(),
+                                          m.probability()));
+        }
+
+        return results;
+      }
+    }
+
+    return find_matches(rule, content);
+  }
+
+private:
+  struct Entry {
+    Key key;
+    MatchResults results;
+    std::size_t bytes;
+  };
+
+  struct Shard {
+    mutable std::mutex mutex;
+    std::list<Entry> lru;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+    std::size_t bytes = 0;
+    std::size_t hits = 0;
+    std::size_t misses = 0;
+    std::size_t insertions = 0;
+    std::size_t evictions = 0;
+  };
+
+  Shard &shard(const Key &key) noexcept {
+    return shards_[std::size_t(key.content.high % shards_.size())];
+  }
+
+  void evict(Shard &shard) noexcept;
+
+  std::size_t capacity_;
+  std::size_t shard_capacity_;
+  std::vector<Shard> shards_;
+};
+
+}; // namespace ResultCache
+
+}; // namespace OS2DSRules
+
+#endif
@@ -0,0 +1,190 @@
+#ifndef SCAN_INDEX_HPP
+#define SCAN_INDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+#include <content_hash.hpp>
+#include <os2dsrules.hpp>
+
+namespace OS2DSRules {
+
+namespace ScanIndex {
+
+/*
+  What the index knows about a file that has been scanned by a rule.
+ */
+struct Entry {
+  std::string path;
+  std::uint64_t size = 0;
+  // The modification time in the caller's unit, e.g. nanoseconds.
+  std::int64_t mtime = 0;
+  ContentHash::Hash128 content;
+  std::uint64_t config = 0;
+  MatchResults results;
+};
+
+// Where the results of scan_file came from.
+enum class Source {
+  // The file is unchanged since it was last scanned.
+  Unchanged,
+  // The file has changed, but its content has been scanned before.
+  KnownContent,
+  // The file has been scanned.
+  Scanned,
+};
+
+struct FileResult {
+  MatchResults matches;
+  Source source = Source::Scanned;
+};
+
+/*
+  A persistent index of scan results, for incremental rescans.
+
+  The index is a single file of records, each holding an Entry. Records
+  are only ever appended, with a single write, and carry a checksum. When
+  the index is opened, it is memory-mapped and read up to the first
+  incomplete or damaged record, which is what a crash during an append
+  leaves behind, and the file is truncated there. Later records for the
+  same file and rule configuration replace earlier ones, and compact()
+  rewrites the file with only the latest records.
+
+  Lookups by (path, config) and by (content hash, config) are O(1) and
+  only decode the record they find. Records are stored in host byte
+  order, so an index cannot be moved between machines of different
+  endianness.
+
+  An index is not thread-safe, and must only be opened by one process
+  at a time.
+ */
+class ScanIndex {
+public:
+  // Opens the index at path, creating it if it does not exist.
+  [[nodiscard]] static std::optional<ScanIndex>
+  open(const std::string &path) noexcept;
+
+  ScanIndex(const ScanIndex &) = delete;
+  ScanIndex &operator=(const ScanIndex &) = delete;
+  ScanIndex(ScanIndex &&other) noexcept;
+  ScanIndex &operator=(ScanIndex &&other) noexcept;
+  ~ScanIndex() noexcept;
+
+  // The results for path, if it has the same size and mtime as when it
+  // was last recorded for config.
+  [[nodiscard]] std::optional<MatchResults>
+  lookup(std::string_view path, std::uint64_t size, std::int64_t mtime,
+         std::uint64_t config) noexcept;
+
+  // The results for any file with the same content and config.
+  [[nodiscard]] std::optional<MatchResults>
+  lookup_content(const ContentHash::Hash128 &content,
+                 std::uint64_t config) noexcept;
+
+  // Appends an entry. Returns false if it could not be written.
+  bool record(const Entry &entry) noexcept;
+
+  // Flushes the appended records to disk.
+  bool sync() noexcept;
+
+  // Rewrites the index with only the latest record for every file and
+  // configuration, and replaces the file atomically.
+  bool compact() noexcept;
+
+  // The number of distinct (path, config) pairs.
+  [[nodiscard]] std::size_t size() const noexcept { return by_path_.size(); }
+
+  /*
+    Scans the file at path with rule, unless the index already has the
+    results: the file is only read if its size or mtime has changed, and
+    only scanned if its content has not been seen before. Returns
+    std::nullopt if the file cannot be read.
+   */
+  template <typename Rule>
+  [[nodiscard]] std::optional<FileResult>
+  scan_file(Rule &rule, const std::string &path) noexcept {
+    const auto config = rule.config_hash();
+    const auto stat = stat_file(path);
+    if (!stat)
+      return std::nullopt;
+
+    if (auto results = lookup(path, stat->first, stat->second, config))
+      return FileResult{std::move(results.value()), Source::Unchanged};
+
+    auto content = read_file(path);
+    if (!content)
+      return std::nullopt;
+
+    Entry entry{path, stat->first, stat->second,
+                ContentHash::hash128(content.value()), config, {}};
+    Source source = Source::KnownContent;
+
+    if (auto results = lookup_content(entry.content, config)) {
+      entry.results = std::move(results.value());
+    } else {
+      entry.results = rule.find_matches(content.value());
+      source = Source::Scanned;
+    }
+
+    (void)record(entry);
+    return FileResult{std::move(entry.results), source};
+  }
+
+  // The size and modification time of the file at path, in nanoseconds.
+  [[nodiscard]] static std::optional<std::pair<std::uint64_t, std::int64_t>>
+  stat_file(const std::string &path) noexcept;
+
+  [[nodiscard]] static std::optional<std::string>
+  read_file(const std::string &path) noexcept;
+
+private:
+  struct PathKey {
+    std::string path;
+    std::uint64_t config;
+
+    bool operator==(const PathKey &) const noexcept = default;
+  };
+
+  struct PathKeyHash {
+    std::size_t operator()(const PathKey &key) const noexcept;
+  };
+
+  struct ContentKey {
+    ContentHash::Hash128 content;
+    std::uint64_t config;
+
+    bool operator==(const ContentKey &) const noexcept = default;
+  };
+
+  struct ContentKeyHash {
+    std::size_t operator()(const ContentKey &key) const noexcept;
+  };
+
+  ScanIndex(std::string path, int fd) noexcept;
+
+  bool load() noexcept;
+  bool map() noexcept;
+  void unmap() noexcept;
+  void close() noexcept;
+  [[nodiscard]] std::optional<Entry> decode_at(std::size_t offset) noexcept;
+  void index(const Entry &entry, std::size_t offset);
+
+  std::string path_;
+  int fd_ = -1;
+  const char *data_ = nullptr;
+  std::size_t mapped_ = 0;
+  std::size_t end_ = 0;
+  std::unordered_map<PathKey, std::size_t, PathKeyHash> by_path_;
+  std::unordered_map<ContentKey, std::size_t, ContentKeyHash> by_content_;
+};
+
+}; // namespace ScanIndex
+
+}; // namespace OS2DSRules
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef SERIALIZER_HPP
+#define SERIALIZER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <os2dsrules.hpp>
+
+namespace OS2DSRules {
+
+/*
+  Output of matches for downstream systems.
+
+  Matches are appended to a std::string supplied by the caller, which is
+  meant to be reused from one document to the next, so that once it has
+  grown to size, writing a match allocates nothing. Numbers are formatted
+  with std::to_chars.
+
+  There are two formats: JSON Lines, with a line per match, and a compact
+  binary format, with a length-prefixed record per document.
+ */
+namespace Serializer {
+
+// What the matches of a JSON line or a binary record belong to. Fields
+// that are empty are left out of JSON lines.
+struct Fields {
+  std::string_view path = {};
+  std::string_view rule = {};
+};
+
+// Appends s as a JSON string. Bytes that are not valid UTF-8 are written
+// as U+FFFD.
+void append_json_string(std::string &out, std::string_view s) noexcept;
+
+// Appends the JSON object of match, with start and end for its offsets:
+// {"match":"1111111118","start":4,"end":13,"sensitivity":1000,
+//  "probability":1}
+void append_json_match(std::string &out, const MatchResult &match,
+                       std::size_t start, std::size_t end) noexcept;
+
+/*
+  Appends a line of JSON per match, with the fields first:
+  {"path":"a.txt","rule":"cpr","match":"1111111118","start":4,...}
+ */
+class JsonLines {
+public:
+  explicit JsonLines(std::string &out, const Fields &fields = Fields()) noexcept;
+
+  void add(const MatchResult &match) noexcept {
+    add(match, match.start(), match.end());
+  }
+
+  // Adds match with start and end for its offsets, such as offsets that
+  // have been translated to code points.
+  void add(const MatchResult &match, std::size_t start,
+           std::size_t end) noexcept;
+
+  void add(const MatchResults &matches) noexcept {
+    for (const auto &match : matches)
+      add(match);
+  }
+
+private:
+  std::string &out_;
+  // The fields, formatted once for every line.
+  std::string prefix_;
+};
+
+/*
+  Appends a binary record of the matches of a document:
+
+    record := u32:length u32:count string:path string:rule match*count
+    match  := varint:start varint:end varint:sensitivity f64:probability
+              string:match
+    string := varint:length bytes
+
+  The length counts the bytes of the record after the length itself.
+  Varints are LEB128. The start of a match is stored as the difference
+  from the start of the match before it, and the end as the difference
+  from its start, both zigzag-encoded, so that offsets into large
+  documents mostly take a byte or two. Everything is little-endian.
+ */
+class BinaryRecord {
+public:
+  explicit BinaryRecord(std::string &out,
+                        const Fields &fields = Fields()) noexcept;
+
+  void add(const MatchResult &match) noexcept {
+    add(match, match.start(), match.end());
+  }
+
+  void add(const MatchResult &match, std::size_t start,
+           std::size_t end) noexcept;
+
+  void add(const MatchResults &matches) noexcept {
+    for (const auto &match : matches)
+      add(match);
+  }
+
+  // Fills in the length and count. Must be called once, after the last
+  // match has been added and before anything else is appended to out.
+  void finish() noexcept;
+
+private:
+  std::string &out_;
+  std::size_t begin_;
+  std::uint32_t count_ = 0;
+  std::size_t last_start_ = 0;
+};
+
+struct Record {
+  std::string path;
+  std::string rule;
+  MatchResults matches;
+};
+
+// Reads the binary record at the start of data, and removes it from
+// data. Returns std::nullopt, leaving data as it was, if data does not
+// start with a whole record.
+[[nodiscard]] std::optional<Record>
+read_record(std::string_view &data) noexcept;
+
+}; // namespace Serializer
+
+}; // namespace OS2DSRules
+
+#endif
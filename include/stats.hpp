@@ -0,0 +1,160 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/*
+  Hot-path instrumentation counters.
+
+  The counters are only compiled in when OS2DSRULES_ENABLE_STATS is
+  defined. Otherwise OS2DSRULES_STAT expands to nothing and ScanScope is
+  an empty type, so a default build pays nothing for them.
+
+  Every thread increments its own block of counters with relaxed
+  atomic loads and stores, which compile to plain moves. The blocks are
+  kept in a lock-free list, and snapshot() sums them without stopping
+  the threads that are scanning. A block is handed on to a new thread
+  when its owner exits, so the totals survive short-lived threads.
+ */
+namespace OS2DSRules {
+
+namespace Stats {
+
+#ifdef OS2DSRULES_ENABLE_STATS
+inline constexpr bool enabled = true;
+#else
+inline constexpr bool enabled = false;
+#endif
+
+enum class Counter : std::size_t {
+  // Number of calls to find_matches, not counting nested calls.
+  Scans,
+  BytesScanned,
+  // CPRDetector state machine.
+  StateTransitions,
+  StateResets,
+  // Tokens that were checked against a dictionary or a CPR-number check.
+  CandidateTokens,
+  DictionaryProbes,
+  DictionaryHits,
+  // Links followed in FrozenHashSet chains, including the first.
+  ChainLinksWalked,
+  // Dictionary lookups made by CPRDetector::examine_context.
+  BlacklistChecks,
+  // Heap allocations made while a scan is running.
+  Allocations,
+  Count,
+};
+
+inline constexpr std::size_t counter_count =
+    static_cast<std::size_t>(Counter::Count);
+
+struct ScanStats {
+  std::uint64_t scans = 0;
+  std::uint64_t bytes_scanned = 0;
+  std::uint64_t state_transitions = 0;
+  std::uint64_t state_resets = 0;
+  std::uint64_t candidate_tokens = 0;
+  std::uint64_t dictionary_probes = 0;
+  std::uint64_t dictionary_hits = 0;
+  std::uint64_t chain_links_walked = 0;
+  std::uint64_t blacklist_checks = 0;
+  std::uint64_t allocations = 0;
+
+  [[nodiscard]] double hit_rate() const noexcept {
+    return dictionary_probes == 0
+               ? 0.0
+               : double(dictionary_hits) / double(dictionary_probes);
+  }
+
+  [[nodiscard]] double average_chain_length() const noexcept {
+    return dictionary_probes == 0
+               ? 0.0
+               : double(chain_links_walked) / double(dictionary_probes);
+  }
+
+  [[nodiscard]] double allocations_per_scan() const noexcept {
+    return scans == 0 ? 0.0 : double(allocations) / double(scans);
+  }
+
+  ScanStats &operator+=(const ScanStats &other) noexcept;
+  bool operator==(const ScanStats &) const noexcept = default;
+};
+
+/*
+  Returns the sum of the counters of every thread. The snapshot is not
+  atomic as a whole: counters that are incremented while it is taken may
+  or may not be included.
+ */
+[[nodiscard]] ScanStats snapshot() noexcept;
+
+/*
+  Sets every counter to zero. Increments that race with a reset may be
+  lost, so only reset while no scans are running.
+ */
+void reset() noexcept;
+
+namespace detail {
+
+struct alignas(64) CounterBlock {
+  std::array<std::atomic<std::uint64_t>, counter_count> values{};
+};
+
+// The counter block of the calling thread.
+[[nodiscard]] CounterBlock &thread_counters() noexcept;
+
+// Nesting depth of scans on the calling thread.
+[[nodiscard]] std::size_t &scan_depth() noexcept;
+
+inline void add(Counter counter, std::uint64_t n) noexcept {
+  // Only the owning thread writes to a block, so a relaxed load and store
+  // is enough and avoids a locked instruction.
+  auto &value = thread_counters().values[static_cast<std::size_t>(counter)];
+  value.store(value.load(std::memory_order_relaxed) + n,
+              std::memory_order_relaxed);
+}
+
+} // namespace detail
+
+/*
+  Marks the duration of a call to find_matches. Only the outermost scope
+  on a thread is counted as a scan, so HealthRule delegating to
+  WordListRule is one scan.
+ */
+#ifdef OS2DSRULES_ENABLE_STATS
+class ScanScope {
+public:
+  explicit ScanScope(std::size_t bytes) noexcept {
+    if (detail::scan_depth()++ == 0) {
+      detail::add(Counter::Scans, 1);
+      detail::add(Counter::BytesScanned, bytes);
+    }
+  }
+
+  ScanScope(const ScanScope &) = delete;
+  ScanScope &operator=(const ScanScope &) = delete;
+  ~ScanScope() noexcept { --detail::scan_depth(); }
+};
+#else
+class ScanScope {
+public:
+  constexpr explicit ScanScope(std::size_t) noexcept {}
+};
+#endif
+
+}; // namespace Stats
+
+}; // namespace OS2DSRules
+
+#ifdef OS2DSRULES_ENABLE_STATS
+#define OS2DSRULES_STAT(counter, n)                                            \
+  ::OS2DSRules::Stats::detail::add(::OS2DSRules::Stats::Counter::counter,      \
+                                   static_cast<std::uint64_t>(n))
+#else
+#define OS2DSRULES_STAT(counter, n) ((void)0)
+#endif
+
+#endif
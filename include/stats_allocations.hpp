@@ -0,0 +1,67 @@
+#ifndef STATS_ALLOCATIONS_HPP
+#define STATS_ALLOCATIONS_HPP
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#include <stats.hpp>
+
+/*
+  Counting of the heap allocations made during scans.
+
+  Allocations can only be counted by replacing the global allocation
+  functions, which affects every allocation of the whole process, so the
+  library does not do it itself. A program that wants
+  ScanStats::allocations includes this header in exactly one of its
+  source files. Only allocations made inside a scan are counted; every
+  allocation is passed on to malloc, and a failed one is retried with the
+  new-handler like the default operator new does.
+
+  Without OS2DSRULES_ENABLE_STATS, or in a program that does not include
+  this header, ScanStats::allocations stays zero. The Python extensions
+  do not include it, so as not to change how the interpreter allocates.
+ */
+#ifdef OS2DSRULES_ENABLE_STATS
+
+namespace OS2DSRules {
+
+namespace Stats {
+
+namespace detail {
+
+inline void *counted_allocation(std::size_t size) {
+  if (scan_depth() > 0)
+    OS2DSRULES_STAT(Allocations, 1);
+
+  for (;;) {
+    if (void *ptr = std::malloc(size == 0 ? 1 : size))
+      return ptr;
+
+    const auto handler = std::get_new_handler();
+    if (handler == nullptr)
+      throw std::bad_alloc();
+    handler();
+  }
+}
+
+} // namespace detail
+
+}; // namespace Stats
+
+}; // namespace OS2DSRules
+
+void *operator new(std::size_t size) {
+  return OS2DSRules::Stats::detail::counted_allocation(size);
+}
+void *operator new[](std::size_t size) {
+  return OS2DSRules::Stats::detail::counted_allocation(size);
+}
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+#endif
+
+#endif
@@ -4,7 +4,9 @@
 #include <cmath>
 #include <concepts>
 #include <cstddef>
+#include <cstdint>
 #include <os2dsrules.hpp>
+#include <probes.hpp>
 #include <string>
 #include <string_view>
 #include <unordered_set>
@@ -20,27 +22,46 @@ public:
   template <typename Iter>
     requires WordIterator<Iter>
   WordListRule(Iter begin, Iter end) noexcept {
+    OS2DSRULES_PROBE2(dictionary__start, "WordListRule", 0);
     for (auto iter = begin; iter != end; ++iter) {
       words_.insert(*iter);
     }
+    OS2DSRULES_PROBE2(dictionary__done, "WordListRule", words_.size());
+    config_hash_ = hash_words(words_);
   }
-  WordListRule(Words words) noexcept : words_(words) {}
-  WordListRule() noexcept = default;
+  WordListRule(Words words) noexcept
+      : words_(words), config_hash_(hash_words(words_)) {}
+  WordListRule() noexcept : config_hash_(hash_words(words_)) {}
   WordListRule(const WordListRule &) noexcept = default;
   WordListRule(WordListRule &&) noexcept = default;
   ~WordListRule() noexcept = default;
 
-  [[nodiscard]] MatchResults find_matches(const std::string &) const noexcept;
+  [[nodiscard]] MatchResults find_matches(std::string_view) const noexcept;
+  [[nodiscard]] ScanResult find_matches(std::string_view,
+                                        const ScanOptions &) const noexcept;
+
+  // Identifies the word list in result cache keys.
+  [[nodiscard]] std::uint64_t config_hash() const noexcept {
+    return config_hash_;
+  }
+
+  // Words never span a delimiter.
+  [[nodiscard]] constexpr bool chunkable() const noexcept { return true; }
 
 protected:
   Words words_;
   
 private:
+  [[nodiscard]] static std::uint64_t hash_words(const Words &) noexcept;
+
+  std::uint64_t config_hash_;
+
   [[nodiscard]] bool contains(const std::string_view) const noexcept;
   [[nodiscard]] bool contains(const std::string) const noexcept;
-  [[nodiscard]] bool contains(const std::string::const_iterator,
-                              const std::string::const_iterator) const noexcept;
-  void check_match(MatchResults &, const std::string, const std::size_t,
+  [[nodiscard]] bool
+  contains(const std::string_view::const_iterator,
+           const std::string_view::const_iterator) const noexcept;
+  bool check_match(MatchResults &, const std::string, const std::size_t,
                    const std::size_t) const noexcept;
 };
 }; // namespace WordListRule
@@ -7,6 +7,11 @@
 
 #include <address_rule.hpp>
 #include <data_structures.hpp>
+#include <latency.hpp>
+#include <probes.hpp>
+#include <stats.hpp>
+
+#include "scan_limiter.hpp"
 
 using namespace OS2DSRules::DataStructures;
 
@@ -23,17 +28,39 @@ static const auto addresses_set = FrozenHashSet(addresses);
 }; // namespace
 
 [[nodiscard]] MatchResults
-AddressRule::find_matches(const std::string &content) const noexcept {
-  MatchResults results;
+AddressRule::find_matches(std::string_view content) const noexcept {
+  return find_matches(content, ScanOptions()).matches;
+}
+
+[[nodiscard]] ScanResult
+AddressRule::find_matches(std::string_view content,
+                          const ScanOptions &options) const noexcept {
+  Stats::ScanScope scope(content.size());
+  Latency::ScanTimer timer(Latency::Rule::AddressRule, content.size());
+  OS2DSRULES_PROBE3(scan__start, "AddressRule", content.data(), content.size());
+  ScanLimiter limiter(options, content.size());
+  MatchResults addresses_found;
 
   static const auto is_end_of_word = [](char c) { return c == ' '; };
 
+  // Everything past the byte budget, or past the end of a partial piece,
+  // is out of sight, including the house number that may follow a street
+  // name.
+  const auto view = content.substr(0, limiter.limit());
+  const bool cut = limiter.cut(view.size());
+  std::size_t offset = view.size();
+
   bool in_word = false;
   std::size_t counter = 0;
   std::size_t word_begin, word_end = counter;
   std::string address = "";
 
-  for (auto iter = content.begin(); iter != content.end(); ++iter) {
+  for (auto iter = view.begin(); iter != view.end(); ++iter) {
+    if (!limiter.proceed(counter)) {
+      offset = counter;
+      break;
+    }
+
     if (!in_word && std::isupper(*iter)) {
       word_begin = counter;
       address = "";
@@ -42,16 +69,43 @@ AddressRule::find_matches(const std::string &content) const noexcept {
 
     if (in_word) {
       if (is_end_of_word(*iter)) {
-	if (*iter == ' ' && std::isupper(*(iter + 1))) {
+	if (*iter == ' ' && iter + 1 != view.end() &&
+	    std::isupper(*(iter + 1))) {
 	  address += ' ';
 	  ++counter;
 	  continue;
 	}
 
+        // The street name may go on past the cut.
+        if (cut && iter + 1 == view.end()) {
+          offset = word_begin;
+          break;
+        }
+
         word_end = counter;
 
-        if (contains(address.begin(), address.end())) {
-          results.push_back(MatchResult(address, word_begin, word_end));
+        if (contains(std::string_view(address))) {
+          const MatchResult m(address, word_begin, word_end);
+          auto address_opt = append_number(m, view);
+
+          // A number that runs into the byte budget may not be complete.
+          const auto last = address_opt ? address_opt->end() : m.end();
+          if (cut && last + 1 >= view.size()) {
+            offset = word_begin;
+            break;
+          }
+
+          if (address_opt) {
+            OS2DSRULES_PROBE3(match, "AddressRule", address_opt->start(),
+                              address_opt->end());
+            addresses_found.push_back(address_opt.value());
+
+            if (limiter.full(addresses_found.size())) {
+              offset = address_opt->end() + 1;
+              in_word = false;
+              break;
+            }
+          }
         }
 
         in_word = false;
@@ -63,26 +117,19 @@ AddressRule::find_matches(const std::string &content) const noexcept {
     ++counter;
   }
 
-  return filter_matches(results, content);
-}
+  // A street name that was cut off is left for a rescan.
+  if (in_word && limiter.cut(offset))
+    offset = std::min(offset, word_begin);
 
-[[nodiscard]] MatchResults
-AddressRule::filter_matches(const MatchResults &matches,
-                            const std::string &content) const noexcept {
-  MatchResults results;
-
-  for (auto m : matches) {
-    auto address_opt = append_number(m, content);
-    if (address_opt) {
-      results.push_back(address_opt.value());
-    }
-  }
-
-  return results;
+  OS2DSRULES_PROBE3(scan__done, "AddressRule", content.size(),
+                    addresses_found.size());
+  return limiter.finish(std::move(addresses_found), offset);
 }
 
 [[nodiscard]] bool
 AddressRule::contains(const std::string_view target) const noexcept {
+  OS2DSRULES_STAT(CandidateTokens, 1);
+
   return addresses_set.contains(target);
 }
 
@@ -92,14 +139,14 @@ AddressRule::contains(const std::string target) const noexcept {
 }
 
 [[nodiscard]] bool
-AddressRule::contains(const std::string::const_iterator start,
-                      const std::string::const_iterator stop) const noexcept {
+AddressRule::contains(const std::string_view::const_iterator start,
+                      const std::string_view::const_iterator stop) const noexcept {
   return contains(std::string_view(start, stop));
 }
 
 [[nodiscard]] std::optional<MatchResult>
 AddressRule::append_number(const MatchResult &m,
-                           const std::string &content) const noexcept {
+                           std::string_view content) const noexcept {
   if (content.size() == m.end() + 1)
     return {};
 
@@ -0,0 +1,142 @@
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <aggregate.hpp>
+#include <content_hash.hpp>
+
+namespace OS2DSRules {
+
+namespace Aggregate {
+
+namespace {
+
+constexpr bool space(char c) noexcept {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' ||
+         c == '\v';
+}
+
+// The table is grown before more than half of its slots are taken.
+constexpr std::size_t initial_slots = 64;
+
+} // namespace
+
+void normalize(std::string_view match, Normalize how,
+               std::string &out) noexcept {
+  if (how == Normalize::Digits) {
+    for (const char c : match)
+      if ('0' <= c && c <= '9')
+        out += c;
+    return;
+  }
+
+  const auto begin = out.size();
+  bool gap = false;
+  for (std::size_t i = 0; i < match.size(); ++i) {
+    char c = match[i];
+    // A no-break space is a space too.
+    const bool nbsp = c == '\xC2' && i + 1 < match.size() &&
+                      match[i + 1] == '\xA0';
+    if (space(c) || nbsp) {
+      gap = true;
+      i += nbsp ? 1 : 0;
+      continue;
+    }
+
+    if (gap && out.size() > begin)
+      out += ' ';
+    gap = false;
+
+    if ('A' <= c && c <= 'Z') {
+      c = static_cast<char>(c - 'A' + 'a');
+    } else if (c == '\xC3' && i + 1 < match.size()) {
+      // The capital letters of Latin-1, from À to Þ except ×, are 0x20
+      // below their small letters.
+      const auto next = static_cast<unsigned char>(match[++i]);
+      out += c;
+      out += static_cast<char>(0x80 <= next && next <= 0x9E && next != 0x97
+                                   ? next + 0x20
+                                   : next);
+      continue;
+    }
+    out += c;
+  }
+}
+
+void Counter::add(const MatchResult &match, std::size_t base) noexcept {
+  ++occurrences_;
+  key_.clear();
+  normalize(match.match(), normalize_, key_);
+
+  if ((unique_.size() + 1) * 2 > slots_.size())
+    grow();
+
+  const auto hash = ContentHash::fnv1a(key_);
+  const auto tag = static_cast<std::uint32_t>(hash >> 32);
+  const auto mask = slots_.size() - 1;
+
+  for (auto i = static_cast<std::size_t>(hash) & mask;; i = (i + 1) & mask) {
+    auto &slot = slots_[i];
+    if (slot.index == 0) {
+      slot = Slot{.hash = tag,
+                  .index = static_cast<std::uint32_t>(unique_.size() + 1)};
+      unique_.push_back(Unique{.match = key_,
+                               .count = 1,
+                               .first = base + match.start(),
+                               .last = base + match.start(),
+                               .sensitivity = match.sensitivity(),
+                               .probability = match.probability()});
+      hashes_.push_back(hash);
+      return;
+    }
+
+    if (slot.hash != tag)
+      continue;
+    auto &unique = unique_[slot.index - 1];
+    if (unique.match != key_)
+      continue;
+
+    ++unique.count;
+    unique.first = std::min(unique.first, base + match.start());
+    unique.last = std::max(unique.last, base + match.start());
+    if (static_cast<int>(match.sensitivity()) >
+        static_cast<int>(unique.sensitivity))
+      unique.sensitivity = match.sensitivity();
+    unique.probability = std::max(unique.probability, match.probability());
+    return;
+  }
+}
+
+std::vector<Unique> Counter::take() noexcept {
+  auto unique = std::move(unique_);
+  clear();
+  return unique;
+}
+
+void Counter::clear() noexcept {
+  slots_.clear();
+  unique_.clear();
+  hashes_.clear();
+  occurrences_ = 0;
+}
+
+void Counter::grow() noexcept {
+  const auto size = slots_.empty() ? initial_slots : slots_.size() * 2;
+  slots_.assign(size, Slot());
+
+  const auto mask = size - 1;
+  for (std::size_t u = 0; u < hashes_.size(); ++u) {
+    auto i = static_cast<std::size_t>(hashes_[u]) & mask;
+    while (slots_[i].index != 0)
+      i = (i + 1) & mask;
+    slots_[i] = Slot{.hash = static_cast<std::uint32_t>(hashes_[u] >> 32),
+                     .index = static_cast<std::uint32_t>(u + 1)};
+  }
+}
+
+}; // namespace Aggregate
+
+}; // namespace OS2DSRules
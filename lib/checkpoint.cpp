@@ -0,0 +1,90 @@
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <checkpoint.hpp>
+#include <content_hash.hpp>
+
+#include "serialization.hpp"
+
+namespace OS2DSRules {
+
+namespace Checkpoint {
+
+namespace {
+
+using Serialization::Reader;
+using Serialization::Writer;
+
+constexpr std::string_view magic = "OS2DSCKP";
+
+} // namespace
+
+std::string serialize(const Checkpoint &checkpoint) noexcept {
+  Writer writer;
+  writer.buffer().append(magic);
+  writer.put(Checkpoint::version);
+  writer.put(checkpoint.config);
+  writer.put(checkpoint.offset);
+  writer.put(std::string_view(checkpoint.pending));
+  writer.put(ContentHash::hash128(writer.buffer()).low);
+  return std::move(writer.buffer());
+}
+
+std::optional<Checkpoint> deserialize(std::string_view data) noexcept {
+  constexpr auto checksum_size = sizeof(std::uint64_t);
+  if (data.size() < magic.size() + checksum_size ||
+      data.substr(0, magic.size()) != magic)
+    return std::nullopt;
+
+  const auto body = data.substr(0, data.size() - checksum_size);
+  std::uint64_t checksum = 0;
+  Reader trailer(data.substr(body.size()));
+  if (!trailer.get(checksum) || ContentHash::hash128(body).low != checksum)
+    return std::nullopt;
+
+  Reader reader(body.substr(magic.size()));
+  std::uint32_t version = 0;
+  Checkpoint checkpoint;
+
+  if (!reader.get(version) || version != Checkpoint::version ||
+      !reader.get(checkpoint.config) || !reader.get(checkpoint.offset) ||
+      !reader.get(checkpoint.pending) || !reader.done() ||
+      checkpoint.pending.size() > checkpoint.offset)
+    return std::nullopt;
+
+  return checkpoint;
+}
+
+std::optional<std::string> read_appended(const std::string &path,
+                                         const Checkpoint &checkpoint) noexcept {
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    return std::nullopt;
+
+  file.seekg(0, std::ios::end);
+  const auto size = static_cast<std::uint64_t>(file.tellg());
+  if (!file || size < checkpoint.offset)
+    return std::nullopt;
+
+  file.seekg(static_cast<std::streamoff>(checkpoint.resume()));
+  std::string content((std::istreambuf_iterator<char>(file)),
+                      std::istreambuf_iterator<char>());
+  if (file.bad())
+    return std::nullopt;
+
+  // The pending bytes are the only part of the scanned prefix there is to
+  // compare with, and catch most rewrites of the end of the file.
+  if (std::string_view(content).substr(0, checkpoint.pending.size()) !=
+      checkpoint.pending)
+    return std::nullopt;
+
+  return content.substr(checkpoint.pending.size());
+}
+
+}; // namespace Checkpoint
+
+}; // namespace OS2DSRules
@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include <content_hash.hpp>
+
+namespace OS2DSRules {
+
+namespace ContentHash {
+
+namespace {
+
+constexpr std::uint64_t c1 = 0x87c37b91114253d5ULL;
+constexpr std::uint64_t c2 = 0x4cf5ad432745937fULL;
+
+constexpr std::uint64_t rotl(std::uint64_t x, int r) noexcept {
+  return (x << r) | (x >> (64 - r));
+}
+
+constexpr std::uint64_t fmix(std::uint64_t k) noexcept {
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdULL;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53ULL;
+  k ^= k >> 33;
+  return k;
+}
+
+// Reads 8 bytes as little-endian, independent of the host.
+inline std::uint64_t load64(const unsigned char *p) noexcept {
+  std::uint64_t value = 0;
+  if constexpr (std::endian::native == std::endian::little) {
+    std::memcpy(&value, p, sizeof(value));
+  } else {
+    for (int i = 7; i >= 0; --i)
+      value = (value << 8) | p[i];
+  }
+  return value;
+}
+
+} // namespace
+
+std::string Hash128::to_hex() const {
+  static constexpr char digits[] = "0123456789abcdef";
+  std::string hex(32, '0');
+
+  for (int i = 0; i < 16; ++i) {
+    hex[std::size_t(15 - i)] = digits[(high >> (4 * i)) & 0xf];
+    hex[std::size_t(31 - i)] = digits[(low >> (4 * i)) & 0xf];
+  }
+
+  return hex;
+}
+
+Hash128 hash128(std::string_view content, std::uint64_t seed) noexcept {
+  const auto *data = reinterpret_cast<const unsigned char *>(content.data());
+  const std::size_t size = content.size();
+  const std::size_t blocks = size / 16;
+
+  std::uint64_t h1 = seed;
+  std::uint64_t h2 = seed;
+
+  for (std::size_t i = 0; i < blocks; ++i) {
+    std::uint64_t k1 = load64(data + 16 * i);
+    std::uint64_t k2 = load64(data + 16 * i + 8);
+
+    k1 *= c1;
+    k1 = rotl(k1, 31);
+    k1 *= c2;
+    h1 ^= k1;
+
+    h1 = rotl(h1, 27);
+    h1 += h2;
+    h1 = h1 * 5 + 0x52dce729;
+
+    k2 *= c2;
+    k2 = rotl(k2, 33);
+    k2 *= c1;
+    h2 ^= k2;
+
+    h2 = rotl(h2, 31);
+    h2 += h1;
+    h2 = h2 * 5 + 0x38495ab5;
+  }
+
+  // The remaining 0 to 15 bytes.
+  const unsigned char *tail = data + 16 * blocks;
+  std::uint64_t k1 = 0;
+  std::uint64_t k2 = 0;
+
+  for (std::size_t i = size & 15; i > 8; --i)
+    k2 |= std::uint64_t(tail[i - 1]) << (8 * (i - 9));
+  if ((size & 15) > 8) {
+    k2 *= c2;
+    k2 = rotl(k2, 33);
+    k2 *= c1;
+    h2 ^= k2;
+  }
+
+  for (std::size_t i = std::min<std::size_t>(size & 15, 8); i > 0; --i)
+    k1 |= std::uint64_t(tail[i - 1]) << (8 * (i - 1));
+  if ((size & 15) > 0) {
+    k1 *= c1;
+    k1 = rotl(k1, 31);
+    k1 *= c2;
+    h1 ^= k1;
+  }
+
+  h1 ^= size;
+  h2 ^= size;
+
+  h1 += h2;
+  h2 += h1;
+
+  h1 = fmix(h1);
+  h2 = fmix(h2);
+
+  h1 += h2;
+  h2 += h1;
+
+  return Hash128{h1, h2};
+}
+
+}; // namespace ContentHash
+
+}; // namespace OS2DSRules
@@ -8,6 +8,11 @@
 
 #include <cpr-detector.hpp>
 #include <data_structures.hpp>
+#include <latency.hpp>
+#include <probes.hpp>
+#include <stats.hpp>
+
+#include "scan_limiter.hpp"
 
 using namespace OS2DSRules::DataStructures;
 
@@ -26,7 +31,7 @@ static const auto blacklist_words_set = FrozenHashSet(blacklist_words);
 }; // namespace
 
 static bool
-find_blacklisted_words(const std::string &content,
+find_blacklisted_words(const std::string_view content,
                        const std::array<std::size_t, 4> indices) noexcept {
 
   for (std::size_t i = 1; i < 4; ++i) {
@@ -37,10 +42,11 @@ find_blacklisted_words(const std::string &content,
       if (end > content.size())
         end = content.size() - begin - 1;
 
-      std::string target = content.substr(begin, end);
+      std::string target(content.substr(begin, end));
       std::transform(target.begin(), target.end(), target.begin(),
                      [](unsigned char c) { return std::tolower(c); });
 
+      OS2DSRULES_STAT(BlacklistChecks, 1);
       if (blacklist_words_set.contains(target))
         return true;
     }
@@ -51,6 +57,7 @@ find_blacklisted_words(const std::string &content,
 
 void CPRDetector::reset(CPRDetectorState &state) noexcept {
   // Set the detector state to Empty.
+  OS2DSRULES_STAT(StateResets, state != CPRDetectorState::Empty);
   state = CPRDetectorState::Empty;
 }
 
@@ -59,6 +66,7 @@ char CPRDetector::update(char c, CPRDetectorState new_state,
                          Predicate is_acceptable) noexcept {
   if (is_acceptable(c)) {
     // If c is in the set of acceptable tokens, change state and return c.
+    OS2DSRULES_STAT(StateTransitions, 1);
     old_state = new_state;
     return c;
   } else {
@@ -118,6 +126,8 @@ std::string CPRDetector::format_cpr(std::string &cpr,
 void CPRDetector::check_and_append_cpr(std::string &cpr, MatchResults &results,
                                        size_t begin, size_t end,
                                        char separator = 0) noexcept {
+  OS2DSRULES_STAT(CandidateTokens, 1);
+
   // Convert the 4 control digits to an int.
   int control = std::stoi(std::string(cpr, 6, 4));
 
@@ -129,6 +139,7 @@ void CPRDetector::check_and_append_cpr(std::string &cpr, MatchResults &results,
     if (check_mod11_ && !check_mod11(result))
       return;
 
+    OS2DSRULES_PROBE3(match, "CPRDetector", begin, end);
     results.push_back(result);
   }
 }
@@ -150,11 +161,15 @@ bool CPRDetector::check_mod11(const MatchResult &result) noexcept {
   return sum % 11 == 0;
 }
 
-bool CPRDetector::examine_context(const std::string &content) noexcept {
+bool CPRDetector::examine_context(std::string_view content,
+                                  ScanLimiter &limiter) noexcept {
   std::size_t spaces = 3;
   std::array<std::size_t, 4> indices = {0, 0, 0, 0};
 
   for (std::size_t i = 0; i < content.size(); ++i) {
+    if (!limiter.proceed(i))
+      return false;
+
     if (content[i] == ' ') {
       indices[4 - spaces] = i;
       --spaces;
@@ -174,15 +189,38 @@ bool CPRDetector::examine_context(const std::string &content) noexcept {
   return false;
 }
 
-MatchResults CPRDetector::find_matches(const std::string &content) noexcept {
+MatchResults CPRDetector::find_matches(std::string_view content) noexcept {
+  return find_matches(content, ScanOptions()).matches;
+}
+
+ScanResult CPRDetector::find_matches(std::string_view content,
+                                     const ScanOptions &options) noexcept {
+  Stats::ScanScope scope(content.size());
+  Latency::ScanTimer timer(Latency::Rule::CPRDetector, content.size());
+  OS2DSRULES_PROBE3(scan__start, "CPRDetector", content.data(), content.size());
+  ScanLimiter limiter(options, content.size());
   MatchResults results;
 
+  // Too short for a CPR-number, but a partial piece may be the start of one.
   if (content.size() < 10) {
-    return results;
+    OS2DSRULES_PROBE3(scan__done, "CPRDetector", content.size(), 0);
+    return limiter.finish(std::move(results),
+                          limiter.cut(content.size()) ? 0 : content.size());
   }
 
-  if (examine_context_ && examine_context(content)) {
-    return results;
+  // The context is only examined within the byte budget, and if the scan
+  // is stopped while it is examined, nothing has been scanned.
+  if (examine_context_) {
+    const bool blacklisted =
+        examine_context(content.substr(0, limiter.limit()), limiter);
+
+    if (blacklisted || limiter.stopped()) {
+      OS2DSRULES_PROBE3(scan__done, "CPRDetector", content.size(), 0);
+      return limiter.finish(std::move(results),
+                            limiter.stopped() ? 0 : content.size());
+    }
+
+    limiter.rewind();
   }
 
   // Initialize.
@@ -192,10 +230,30 @@ MatchResults CPRDetector::find_matches(const std::string &content) noexcept {
   char separator = 0;
   std::size_t begin = 0;
   std::size_t end = 0;
-  bool allow_separator, leap_year = false;
+  bool allow_separator = false, leap_year = false;
   Predicate is_acceptable = [](char) { return false; };
+  std::size_t offset = limiter.limit();
+  // The last position where a scan of the rest of the content would be in
+  // the same state as this one: no candidate, and either a valid previous
+  // byte or a byte that cannot start one, so that an invalid previous byte
+  // makes no difference. Within a run of letters or digits it is at most a
+  // few bytes back, so a stream does not hold the run back.
+  std::size_t ready = 0;
+  static constexpr auto starts_candidate = make_predicate('0', '1', '2', '3');
+
+  const auto stop = std::begin(content) + static_cast<long>(limiter.limit());
+  for (auto it = std::begin(content); it != stop; ++it) {
+    const auto pos =
+        static_cast<std::size_t>(std::distance(std::begin(content), it));
+    if (!limiter.proceed(pos)) {
+      offset = pos;
+      break;
+    }
+
+    if (state == CPRDetectorState::Empty &&
+        (is_previous_ok(previous) || !starts_candidate(*it)))
+      ready = pos;
 
-  for (auto it = std::begin(content); it != std::end(content); ++it) {
     switch (state) {
     case CPRDetectorState::Empty:
       if (!is_previous_ok(previous)) {
@@ -209,6 +267,7 @@ MatchResults CPRDetector::find_matches(const std::string &content) noexcept {
 
       if (state == CPRDetectorState::First) {
         cpr[0] = *it;
+        separator = 0;
         begin =
             static_cast<std::size_t>(std::distance(std::begin(content), it));
       }
@@ -315,10 +374,23 @@ MatchResults CPRDetector::find_matches(const std::string &content) noexcept {
       is_acceptable = is_digit;
       cpr[9] = update(*it, CPRDetectorState::Match, state, is_acceptable);
 
-      auto ahead = it;
-      if (is_previous_ok(*(++ahead))) {
+      // The end of the content counts as a valid character after a match,
+      // unless more content follows that may extend the number.
+      auto ahead = std::next(it);
+      if (ahead == std::end(content) && limiter.cut(content.size())) {
+        state = CPRDetectorState::Match;
+        break;
+      }
+
+      char next = ahead != std::end(content) ? *ahead : 0;
+      if (is_previous_ok(next)) {
         end = static_cast<std::size_t>(std::distance(std::begin(content), it));
         check_and_append_cpr(cpr, results, begin, end, separator);
+
+        // The byte after a match is valid, so a rescan can start there.
+        ready = end + 1;
+        if (limiter.full(results.size()))
+          offset = end + 1;
       }
       previous = *it;
       allow_separator = false;
@@ -326,9 +398,23 @@ MatchResults CPRDetector::find_matches(const std::string &content) noexcept {
 
       break;
     }
+
+    if (limiter.stopped())
+      break;
+  }
+
+  // A candidate that was cut off is left for a rescan from its start, and
+  // a rescan never starts at a byte that an invalid previous byte keeps
+  // from starting a candidate.
+  if (limiter.cut(offset)) {
+    if (state != CPRDetectorState::Empty)
+      offset = std::min(offset, begin);
+    else if (!is_previous_ok(previous))
+      offset = std::min(offset, ready);
   }
 
-  return results;
+  OS2DSRULES_PROBE3(scan__done, "CPRDetector", content.size(), results.size());
+  return limiter.finish(std::move(results), offset);
 }
 
 }; // namespace CPRDetector
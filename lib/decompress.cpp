@@ -0,0 +1,352 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <decompress.hpp>
+
+#ifdef OS2DSRULES_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef OS2DSRULES_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace OS2DSRules {
+
+namespace Decompress {
+
+namespace {
+
+constexpr std::string_view gzip_magic = "\x1f\x8b";
+constexpr std::string_view zstd_magic = "\x28\xb5\x2f\xfd";
+
+// The size of the buffer of compressed bytes read from the file.
+constexpr std::size_t input_size = 64 * 1024;
+
+} // namespace
+
+Format detect(std::string_view head) noexcept {
+  if (head.starts_with(gzip_magic))
+    return Format::Gzip;
+  if (head.starts_with(zstd_magic))
+    return Format::Zstd;
+  return Format::Plain;
+}
+
+bool supported(Format format) noexcept {
+  switch (format) {
+  case Format::Plain:
+    return true;
+  case Format::Gzip:
+#ifdef OS2DSRULES_HAVE_ZLIB
+    return true;
+#else
+    return false;
+#endif
+  case Format::Zstd:
+#ifdef OS2DSRULES_HAVE_ZSTD
+    return true;
+#else
+    return false;
+#endif
+  }
+  return false;
+}
+
+struct Decoder::State {
+  explicit State(Format f) noexcept : format(f) {}
+  State(const State &) = delete;
+  State &operator=(const State &) = delete;
+
+  ~State() noexcept {
+#ifdef OS2DSRULES_HAVE_ZLIB
+    if (format == Format::Gzip)
+      inflateEnd(&zlib);
+#endif
+#ifdef OS2DSRULES_HAVE_ZSTD
+    if (zstd != nullptr)
+      ZSTD_freeDStream(zstd);
+#endif
+  }
+
+  // Reads more compressed bytes, if every byte read has been used.
+  // Returns false if the file cannot be read.
+  bool refill() noexcept {
+    if (position < available || end)
+      return true;
+
+    file.read(input.data(), static_cast<std::streamsize>(input.size()));
+    available = static_cast<std::size_t>(file.gcount());
+    position = 0;
+    end = available == 0;
+    return !file.bad();
+  }
+
+  [[nodiscard]] bool exhausted() const noexcept {
+    return end && position == available;
+  }
+
+  std::optional<std::size_t> read_plain(char *data, std::size_t size) noexcept;
+  std::optional<std::size_t> read_gzip(char *data, std::size_t size) noexcept;
+  std::optional<std::size_t> read_zstd(char *data, std::size_t size) noexcept;
+
+  const Format format;
+  std::ifstream file;
+  std::vector<char> input;
+  std::size_t position = 0;
+  std::size_t available = 0;
+  bool end = false;
+  // Whether the decompressor is between members or frames, where the
+  // file may end.
+  bool boundary = true;
+#ifdef OS2DSRULES_HAVE_ZLIB
+  z_stream zlib{};
+#endif
+#ifdef OS2DSRULES_HAVE_ZSTD
+  ZSTD_DStream *zstd = nullptr;
+#endif
+};
+
+std::optional<std::size_t> Decoder::State::read_plain(char *data,
+                                                      std::size_t size) noexcept {
+  std::size_t produced = 0;
+  while (produced < size) {
+    if (!refill())
+      return std::nullopt;
+    if (exhausted())
+      break;
+
+    const auto n = std::min(size - produced, available - position);
+    std::copy_n(input.data() + position, n, data + produced);
+    position += n;
+    produced += n;
+  }
+  return produced;
+}
+
+std::optional<std::size_t> Decoder::State::read_gzip(char *data,
+                                                     std::size_t size) noexcept {
+#ifdef OS2DSRULES_HAVE_ZLIB
+  std::size_t produced = 0;
+  while (produced < size) {
+    if (!refill())
+      return std::nullopt;
+    if (exhausted()) {
+      if (!boundary)
+        return std::nullopt;
+      break;
+    }
+
+    // The next member of a file of several starts where the last ended.
+    // Like gzip, bytes after the last member that are not a member, such
+    // as the zero padding of tape archives, are ignored.
+    if (boundary) {
+      if (input[position] != gzip_magic[0]) {
+        position = available;
+        end = true;
+        break;
+      }
+      if (inflateReset(&zlib) != Z_OK)
+        return std::nullopt;
+      boundary = false;
+    }
+
+    const auto in = std::min<std::size_t>(available - position, 1u << 30);
+    const auto out = std::min<std::size_t>(size - produced, 1u << 30);
+    zlib.next_in = reinterpret_cast<Bytef *>(input.data() + position);
+    zlib.avail_in = static_cast<uInt>(in);
+    zlib.next_out = reinterpret_cast<Bytef *>(data + produced);
+    zlib.avail_out = static_cast<uInt>(out);
+
+    const int ret = inflate(&zlib, Z_NO_FLUSH);
+    position += in - zlib.avail_in;
+    produced += out - zlib.avail_out;
+
+    if (ret == Z_STREAM_END)
+      boundary = true;
+    else if (ret != Z_OK && ret != Z_BUF_ERROR)
+      return std::nullopt;
+  }
+  return produced;
+#else
+  (void)data;
+  (void)size;
+  return std::nullopt;
+#endif
+}
+
+std::optional<std::size_t> Decoder::State::read_zstd(char *data,
+                                                     std::size_t size) noexcept {
+#ifdef OS2DSRULES_HAVE_ZSTD
+  std::size_t produced = 0;
+  while (produced < size) {
+    if (!refill())
+      return std::nullopt;
+    if (exhausted()) {
+      if (!boundary)
+        return std::nullopt;
+      break;
+    }
+
+    ZSTD_inBuffer in{input.data(), available, position};
+    ZSTD_outBuffer out{data, size, produced};
+    const auto ret = ZSTD_decompressStream(zstd, &out, &in);
+    if (ZSTD_isError(ret))
+      return std::nullopt;
+
+    position = in.pos;
+    produced = out.pos;
+    // ret is 0 when a frame has been decoded and flushed.
+    boundary = ret == 0;
+  }
+  return produced;
+#else
+  (void)data;
+  (void)size;
+  return std::nullopt;
+#endif
+}
+
+Decoder::Decoder(std::unique_ptr<State> state) noexcept
+    : state_(std::move(state)) {}
+
+Decoder::Decoder(Decoder &&other) noexcept = default;
+Decoder &Decoder::operator=(Decoder &&other) noexcept = default;
+Decoder::~Decoder() noexcept = default;
+
+std::optional<Decoder> Decoder::open(const std::string &path) noexcept {
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    return std::nullopt;
+
+  char head[4] = {};
+  file.read(head, sizeof(head));
+  const auto format =
+      detect(std::string_view(head, static_cast<std::size_t>(file.gcount())));
+  if (!supported(format))
+    return std::nullopt;
+
+  file.clear();
+  file.seekg(0);
+  if (!file)
+    return std::nullopt;
+
+  auto state = std::make_unique<State>(format);
+  state->file = std::move(file);
+  state->input.resize(input_size);
+
+#ifdef OS2DSRULES_HAVE_ZLIB
+  // 15 + 16 takes a gzip header and trailer.
+  if (format == Format::Gzip &&
+      inflateInit2(&state->zlib, 15 + 16) != Z_OK)
+    return std::nullopt;
+#endif
+#ifdef OS2DSRULES_HAVE_ZSTD
+  if (format == Format::Zstd) {
+    state->zstd = ZSTD_createDStream();
+    if (state->zstd == nullptr || ZSTD_isError(ZSTD_initDStream(state->zstd)))
+      return std::nullopt;
+  }
+#endif
+
+  return Decoder(std::move(state));
+}
+
+std::optional<std::size_t> Decoder::read(char *data,
+                                         std::size_t size) noexcept {
+  switch (state_->format) {
+  case Format::Plain:
+    return state_->read_plain(data, size);
+  case Format::Gzip:
+    return state_->read_gzip(data, size);
+  case Format::Zstd:
+    return state_->read_zstd(data, size);
+  }
+  return std::nullopt;
+}
+
+Format Decoder::format() const noexcept { return state_->format; }
+
+BlockRing::BlockRing(std::size_t blocks, std::size_t block_size) noexcept
+    : block_size_(std::max<std::size_t>(block_size, 1)),
+      storage_(std::max<std::size_t>(blocks, 1) * block_size_),
+      sizes_(std::max<std::size_t>(blocks, 1), 0) {}
+
+std::span<char> BlockRing::acquire() noexcept {
+  const auto published = published_.load(std::memory_order_relaxed) & ~closed;
+  for (;;) {
+    const auto released = released_.load(std::memory_order_acquire);
+    if (published - released < sizes_.size())
+      break;
+    released_.wait(released, std::memory_order_acquire);
+  }
+
+  const auto slot = static_cast<std::size_t>(published % sizes_.size());
+  return std::span<char>(storage_.data() + slot * block_size_, block_size_);
+}
+
+void BlockRing::publish(std::size_t size) noexcept {
+  const auto published = published_.load(std::memory_order_relaxed);
+  sizes_[static_cast<std::size_t>(published % sizes_.size())] =
+      std::min(size, block_size_);
+  published_.store(published + 1, std::memory_order_release);
+  published_.notify_one();
+}
+
+void BlockRing::close(bool failed) noexcept {
+  if (failed)
+    failed_.store(true, std::memory_order_release);
+  published_.fetch_or(closed, std::memory_order_release);
+  published_.notify_one();
+}
+
+std::optional<std::string_view> BlockRing::next() noexcept {
+  const auto released = released_.load(std::memory_order_relaxed);
+  for (;;) {
+    const auto published = published_.load(std::memory_order_acquire);
+    if ((published & ~closed) > released)
+      break;
+    if (published & closed)
+      return std::nullopt;
+    published_.wait(published, std::memory_order_acquire);
+  }
+
+  const auto slot = static_cast<std::size_t>(released % sizes_.size());
+  return std::string_view(storage_.data() + slot * block_size_, sizes_[slot]);
+}
+
+void BlockRing::release() noexcept {
+  released_.fetch_add(1, std::memory_order_release);
+  released_.notify_one();
+}
+
+void decompress(Decoder &decoder, BlockRing &ring) noexcept {
+  for (;;) {
+    auto block = ring.acquire();
+    auto size = decoder.read(block.data(), block.size());
+    if (!size) {
+      ring.close(true);
+      return;
+    }
+
+    if (size.value() > 0)
+      ring.publish(size.value());
+    if (size.value() < block.size()) {
+      ring.close();
+      return;
+    }
+  }
+}
+
+}; // namespace Decompress
+
+}; // namespace OS2DSRules
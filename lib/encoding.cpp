@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <encoding.hpp>
+
+namespace OS2DSRules {
+
+namespace Encoding {
+
+namespace {
+
+constexpr char32_t replacement = 0xFFFD;
+
+// The characters of Windows-1252 from 0x80 to 0x9F. The five bytes that
+// Windows-1252 leaves undefined are taken to be the C1 controls, as in
+// Latin-1.
+constexpr std::array<char16_t, 32> windows1252 = {
+    0x20AC, 0x0081, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+    0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x008D, 0x017D, 0x008F,
+    0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+    0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x009D, 0x017E, 0x0178};
+
+constexpr auto names = std::to_array<std::pair<std::string_view, Encoding>>({
+    {"utf8", Encoding::UTF8},
+    {"utf16le", Encoding::UTF16LE},
+    {"latin1", Encoding::Latin1},
+    {"iso88591", Encoding::Latin1},
+    {"cp1252", Encoding::Windows1252},
+    {"windows1252", Encoding::Windows1252},
+});
+
+constexpr bool is_high_surrogate(char16_t u) noexcept {
+  return 0xD800 <= u && u < 0xDC00;
+}
+
+constexpr bool is_low_surrogate(char16_t u) noexcept {
+  return 0xDC00 <= u && u < 0xE000;
+}
+
+} // namespace
+
+std::optional<Encoding> parse(std::string_view name) noexcept {
+  // Case, dashes and underscores are ignored, as Python does.
+  std::string key;
+  for (const unsigned char c : name)
+    if (c != '-' && c != '_')
+      key += static_cast<char>(std::tolower(c));
+
+  for (const auto &[n, encoding] : names)
+    if (key == n)
+      return encoding;
+
+  return std::nullopt;
+}
+
+void narrow(std::string_view source, std::string &out) noexcept {
+  const auto units = source.size() / 2;
+  const auto size = out.size();
+  out.resize(size + units);
+
+  auto *dest = out.data() + size;
+  for (std::size_t i = 0; i < units; ++i) {
+    const auto low = static_cast<unsigned char>(source[2 * i]);
+    const auto high = static_cast<unsigned char>(source[2 * i + 1]);
+    dest[i] = high == 0 && low < 0x80 ? static_cast<char>(low) : substitute;
+  }
+}
+
+void Decoder::append(char32_t c, std::size_t first, std::size_t last,
+                     std::string &text,
+                     std::vector<std::size_t> &units) noexcept {
+  if (c < 0x80) {
+    text += static_cast<char>(c);
+    units.push_back(first);
+    return;
+  }
+
+  char bytes[4];
+  std::size_t n = 0;
+  if (c < 0x800) {
+    bytes[n++] = static_cast<char>(0xC0 | (c >> 6));
+  } else if (c < 0x10000) {
+    bytes[n++] = static_cast<char>(0xE0 | (c >> 12));
+    bytes[n++] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+  } else {
+    bytes[n++] = static_cast<char>(0xF0 | (c >> 18));
+    bytes[n++] = static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+    bytes[n++] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+  }
+  bytes[n++] = static_cast<char>(0x80 | (c & 0x3F));
+
+  text.append(bytes, n);
+  units.insert(units.end(), n - 1, first);
+  units.push_back(last);
+}
+
+void Decoder::decode_bytes(std::string_view source, std::string &text,
+                           std::vector<std::size_t> &units) noexcept {
+  for (std::size_t i = 0; i < source.size();) {
+    // Runs of ASCII are copied as they are.
+    const auto run = static_cast<std::size_t>(
+        std::find_if(source.begin() + static_cast<std::ptrdiff_t>(i),
+                     source.end(),
+                     [](char c) { return static_cast<unsigned char>(c) >= 0x80; }) -
+        source.begin()) - i;
+    if (run > 0) {
+      text.append(source.substr(i, run));
+      const auto size = units.size();
+      units.resize(size + run);
+      std::iota(units.begin() + static_cast<std::ptrdiff_t>(size), units.end(),
+                unit_);
+      unit_ += run;
+      i += run;
+      continue;
+    }
+
+    const auto b = static_cast<unsigned char>(source[i]);
+    char32_t c = b;
+    if (encoding_ == Encoding::Windows1252 && b < 0xA0)
+      c = windows1252[b - 0x80];
+
+    append(c, unit_, unit_, text, units);
+    ++unit_;
+    ++i;
+  }
+}
+
+void Decoder::decode_utf16(std::string_view source, std::string &text,
+                           std::vector<std::size_t> &units) noexcept {
+  std::size_t i = 0;
+  if (odd_ && !source.empty()) {
+    // Complete the unit that was split between pieces.
+    std::string pair{static_cast<char>(odd_.value()), source[0]};
+    odd_.reset();
+    decode_utf16(pair, text, units);
+    i = 1;
+  }
+
+  for (; i + 1 < source.size(); i += 2) {
+    const auto u = static_cast<char16_t>(
+        static_cast<unsigned char>(source[i]) |
+        static_cast<unsigned char>(source[i + 1]) << 8);
+    const auto unit = unit_++;
+
+    if (high_) {
+      const auto high = high_.value();
+      high_.reset();
+
+      if (is_low_surrogate(u)) {
+        const char32_t c =
+            0x10000 + ((char32_t(high) - 0xD800) << 10) + (u - 0xDC00);
+        append(c, unit - 1, unit, text, units);
+        continue;
+      }
+      append(replacement, unit - 1, unit - 1, text, units);
+    }
+
+    if (is_high_surrogate(u))
+      high_ = u;
+    else if (is_low_surrogate(u))
+      append(replacement, unit, unit, text, units);
+    else
+      append(u, unit, unit, text, units);
+  }
+
+  if (i < source.size())
+    odd_ = static_cast<unsigned char>(source[i]);
+}
+
+void Decoder::decode(std::string_view source, std::string &text,
+                     std::vector<std::size_t> &units) noexcept {
+  switch (encoding_) {
+  case Encoding::UTF16LE:
+    decode_utf16(source, text, units);
+    break;
+  case Encoding::Latin1:
+  case Encoding::Windows1252:
+    decode_bytes(source, text, units);
+    break;
+  case Encoding::UTF8:
+    for (std::size_t i = 0; i < source.size(); ++i)
+      units.push_back(unit_ + i);
+    text.append(source);
+    unit_ += source.size();
+    break;
+  }
+}
+
+void Decoder::finish(std::string &text,
+                     std::vector<std::size_t> &units) noexcept {
+  if (high_) {
+    append(replacement, unit_ - 1, unit_ - 1, text, units);
+    high_.reset();
+  }
+
+  if (odd_) {
+    append(replacement, unit_, unit_, text, units);
+    odd_.reset();
+    ++unit_;
+  }
+}
+
+}; // namespace Encoding
+
+}; // namespace OS2DSRules
@@ -5,6 +5,9 @@
 
 #include <health_rule.hpp>
 #include <os2dsrules.hpp>
+#include <latency.hpp>
+#include <probes.hpp>
+#include <stats.hpp>
 
 using namespace OS2DSRules::WordListRule;
 
@@ -25,8 +28,21 @@ static const auto health_terms_set = std::unordered_set<std::string_view>(
 HealthRule::HealthRule() noexcept : rule_(health_terms_set) {}
 
 [[nodiscard]] MatchResults
-HealthRule::find_matches(const std::string &content) const noexcept {
-  return rule_.find_matches(content);
+HealthRule::find_matches(std::string_view content) const noexcept {
+  return find_matches(content, ScanOptions()).matches;
+}
+
+[[nodiscard]] ScanResult
+HealthRule::find_matches(std::string_view content,
+                         const ScanOptions &options) const noexcept {
+  Stats::ScanScope scope(content.size());
+  Latency::ScanTimer timer(Latency::Rule::HealthRule, content.size());
+  OS2DSRULES_PROBE3(scan__start, "HealthRule", content.data(), content.size());
+
+  auto result = rule_.find_matches(content, options);
+  OS2DSRULES_PROBE3(scan__done, "HealthRule", content.size(),
+                    result.matches.size());
+  return result;
 }
 
 } // namespace HealthRule
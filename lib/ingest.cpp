@@ -0,0 +1,574 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <ingest.hpp>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#define OS2DSRULES_INGEST_POSIX 1
+#else
+#include <fstream>
+#include <iterator>
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#define OS2DSRULES_INGEST_URING 1
+#endif
+
+namespace OS2DSRules {
+
+namespace Ingest {
+
+namespace {
+
+// Every file of a batch has two buffers, and every kernel lets a ring
+// register 1024.
+constexpr std::size_t max_batch = 512;
+// The most a single read of io_uring takes.
+constexpr std::size_t max_buffer_size = std::size_t(1) << 30;
+
+#ifdef OS2DSRULES_INGEST_POSIX
+// Reads the file from offset filled on, into buffer and then into spill
+// if it does not fit. Returns a view of the whole content.
+std::optional<std::string_view> read_all(int fd, std::span<char> buffer,
+                                         std::size_t filled,
+                                         std::string &spill) noexcept {
+  while (filled < buffer.size()) {
+    const auto n = ::pread(fd, buffer.data() + filled, buffer.size() - filled,
+                           static_cast<off_t>(filled));
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0)
+      return std::nullopt;
+    if (n == 0)
+      return std::string_view(buffer.data(), filled);
+    filled += std::size_t(n);
+  }
+
+  // The file fills the buffer, and may go on.
+  spill.assign(buffer.data(), filled);
+  for (;;) {
+    const auto size = spill.size();
+    spill.resize(std::max(2 * size, size + buffer.size()));
+    const auto n = ::pread(fd, spill.data() + size, spill.size() - size,
+                           static_cast<off_t>(size));
+    spill.resize(size + (n > 0 ? std::size_t(n) : 0));
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0)
+      return std::nullopt;
+    if (n == 0)
+      return std::string_view(spill);
+  }
+}
+#endif
+
+#ifdef OS2DSRULES_INGEST_URING
+int uring_setup(unsigned entries, io_uring_params *params) noexcept {
+  return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int uring_enter(int fd, unsigned submit, unsigned wait) noexcept {
+  return static_cast<int>(::syscall(__NR_io_uring_enter, fd, submit, wait,
+                                    IORING_ENTER_GETEVENTS, nullptr, 0));
+}
+
+int uring_register(int fd, unsigned opcode, void *arg,
+                   unsigned count) noexcept {
+  return static_cast<int>(
+      ::syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+/*
+  An io_uring instance, driven through the system calls directly, so that
+  liburing is not needed. Entries are prepared with prepare() and
+  submitted together by complete(), which waits for all of them.
+ */
+class Ring {
+public:
+  Ring() noexcept = default;
+  Ring(const Ring &) = delete;
+  Ring &operator=(const Ring &) = delete;
+
+  ~Ring() noexcept {
+    if (sqes_ != nullptr)
+      ::munmap(sqes_, sqes_size_);
+    if (cq_ptr_ != nullptr && cq_ptr_ != sq_ptr_)
+      ::munmap(cq_ptr_, cq_size_);
+    if (sq_ptr_ != nullptr)
+      ::munmap(sq_ptr_, sq_size_);
+    if (fd_ >= 0)
+      ::close(fd_);
+  }
+
+  // Sets up the ring for entries at a time, with buffers registered.
+  // Returns false if io_uring is not available or lacks an operation.
+  bool setup(unsigned entries, std::span<iovec> buffers) noexcept {
+    io_uring_params params{};
+    fd_ = uring_setup(entries, &params);
+    if (fd_ < 0)
+      return false;
+
+    sq_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single)
+      sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+
+    sq_ptr_ = map(sq_size_, IORING_OFF_SQ_RING);
+    cq_ptr_ = single ? sq_ptr_ : map(cq_size_, IORING_OFF_CQ_RING);
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe *>(map(sqes_size_, IORING_OFF_SQES));
+    if (sq_ptr_ == nullptr || cq_ptr_ == nullptr || sqes_ == nullptr)
+      return false;
+
+    sq_tail_ = at(sq_ptr_, params.sq_off.tail);
+    sq_mask_ = *at(sq_ptr_, params.sq_off.ring_mask);
+    sq_array_ = at(sq_ptr_, params.sq_off.array);
+    cq_head_ = at(cq_ptr_, params.cq_off.head);
+    cq_tail_ = at(cq_ptr_, params.cq_off.tail);
+    cq_mask_ = *at(cq_ptr_, params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe *>(static_cast<char *>(cq_ptr_) +
+                                             params.cq_off.cqes);
+    tail_ = *sq_tail_;
+
+    return supports({IORING_OP_OPENAT, IORING_OP_READ_FIXED,
+                     IORING_OP_CLOSE}) &&
+           uring_register(fd_, IORING_REGISTER_BUFFERS, buffers.data(),
+                          static_cast<unsigned>(buffers.size())) == 0;
+  }
+
+  // The next entry to submit, cleared.
+  io_uring_sqe &prepare() noexcept {
+    const unsigned index = tail_ & sq_mask_;
+    auto &sqe = sqes_[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sq_array_[index] = index;
+    ++tail_;
+    ++pending_;
+    return sqe;
+  }
+
+  // Submits the prepared entries, and passes the completion of each to
+  // f. Returns false if the ring failed.
+  template <typename F> bool complete(F &&f) noexcept {
+    std::atomic_ref<unsigned>(*sq_tail_).store(tail_,
+                                               std::memory_order_release);
+    unsigned outstanding = pending_;
+
+    while (outstanding > 0) {
+      const int submitted = uring_enter(fd_, pending_, outstanding);
+      if (submitted < 0 && errno != EINTR)
+        return false;
+      if (submitted > 0)
+        pending_ -= static_cast<unsigned>(submitted);
+
+      unsigned head = *cq_head_;
+      const unsigned tail =
+          std::atomic_ref<unsigned>(*cq_tail_).load(std::memory_order_acquire);
+      for (; head != tail; ++head, --outstanding)
+        f(cqes_[head & cq_mask_]);
+      std::atomic_ref<unsigned>(*cq_head_).store(head,
+                                                 std::memory_order_release);
+    }
+    return true;
+  }
+
+private:
+  void *map(std::size_t size, off_t offset) noexcept {
+    void *p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, fd_, offset);
+    return p == MAP_FAILED ? nullptr : p;
+  }
+
+  static unsigned *at(void *base, unsigned offset) noexcept {
+    return reinterpret_cast<unsigned *>(static_cast<char *>(base) + offset);
+  }
+
+  bool supports(std::initializer_list<unsigned> ops) noexcept {
+    constexpr unsigned count = 256;
+    std::vector<char> memory(sizeof(io_uring_probe) +
+                             count * sizeof(io_uring_probe_op));
+    auto *probe = reinterpret_cast<io_uring_probe *>(memory.data());
+    if (uring_register(fd_, IORING_REGISTER_PROBE, probe, count) != 0)
+      return false;
+
+    return std::all_of(ops.begin(), ops.end(), [&](unsigned op) {
+      return op <= probe->last_op &&
+             (probe->ops[op].flags & IO_URING_OP_SUPPORTED);
+    });
+  }
+
+  int fd_ = -1;
+  void *sq_ptr_ = nullptr;
+  void *cq_ptr_ = nullptr;
+  io_uring_sqe *sqes_ = nullptr;
+  std::size_t sq_size_ = 0;
+  std::size_t cq_size_ = 0;
+  std::size_t sqes_size_ = 0;
+
+  unsigned *sq_tail_ = nullptr;
+  unsigned *sq_array_ = nullptr;
+  unsigned sq_mask_ = 0;
+  unsigned *cq_head_ = nullptr;
+  unsigned *cq_tail_ = nullptr;
+  unsigned cq_mask_ = 0;
+  io_uring_cqe *cqes_ = nullptr;
+
+  // Our copy of the tail of the submission queue.
+  unsigned tail_ = 0;
+  // Entries prepared, but not yet taken by the kernel.
+  unsigned pending_ = 0;
+};
+
+// The user data of the completion of a close, which is ignored.
+constexpr std::uint64_t close_data = ~std::uint64_t(0);
+#endif
+
+} // namespace
+
+/*
+  The buffers of an Ingester. Only the Ingester acquires buffers, and
+  they are released by whichever thread destroys the Buffer they were lent
+  out in.
+ */
+struct Pool {
+  Pool(std::size_t buffers, std::size_t buffer_size) noexcept
+      : count(buffers), size(buffer_size),
+        memory(new char[buffers * buffer_size]),
+        free(new std::atomic<bool>[buffers]),
+        available(static_cast<std::uint32_t>(buffers)) {
+    for (std::size_t i = 0; i < count; ++i)
+      free[i].store(true, std::memory_order_relaxed);
+  }
+
+  std::span<char> buffer(std::size_t slot) noexcept {
+    return {memory.get() + slot * size, size};
+  }
+
+  // Takes n free buffers into slots, waiting while too many are lent out.
+  void acquire(std::size_t n, std::vector<std::size_t> &slots) noexcept {
+    for (;;) {
+      const auto current = available.load(std::memory_order_acquire);
+      if (current >= n)
+        break;
+      available.wait(current, std::memory_order_acquire);
+    }
+    available.fetch_sub(static_cast<std::uint32_t>(n),
+                        std::memory_order_relaxed);
+
+    slots.clear();
+    for (std::size_t i = 0; slots.size() < n; ++i)
+      if (free[i].load(std::memory_order_acquire)) {
+        free[i].store(false, std::memory_order_relaxed);
+        slots.push_back(i);
+      }
+  }
+
+  void release(std::size_t slot) noexcept {
+    free[slot].store(true, std::memory_order_release);
+    available.fetch_add(1, std::memory_order_release);
+    available.notify_one();
+  }
+
+  static Buffer lend(std::shared_ptr<Pool> pool, std::size_t slot,
+                     std::size_t size) noexcept {
+    return Buffer(std::move(pool), slot, size);
+  }
+
+  static Buffer own(std::string spill) noexcept {
+    return Buffer(std::move(spill));
+  }
+
+  const std::size_t count;
+  const std::size_t size;
+  std::unique_ptr<char[]> memory;
+  std::unique_ptr<std::atomic<bool>[]> free;
+  std::atomic<std::uint32_t> available;
+};
+
+Buffer::Buffer(std::shared_ptr<Pool> pool, std::size_t slot,
+               std::size_t size) noexcept
+    : pool_(std::move(pool)), slot_(slot),
+      data_(pool_->buffer(slot).data()), size_(size) {}
+
+Buffer::Buffer(Buffer &&other) noexcept
+    : pool_(std::move(other.pool_)), slot_(other.slot_),
+      data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)), spill_(std::move(other.spill_)) {}
+
+Buffer &Buffer::operator=(Buffer &&other) noexcept {
+  if (this != &other) {
+    release();
+    pool_ = std::move(other.pool_);
+    slot_ = other.slot_;
+    data_ = std::exchange(other.data_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+    spill_ = std::move(other.spill_);
+  }
+  return *this;
+}
+
+Buffer::~Buffer() noexcept { release(); }
+
+void Buffer::release() noexcept {
+  if (pool_ != nullptr)
+    pool_->release(slot_);
+  pool_.reset();
+}
+
+struct Ingester::State {
+  explicit State(Options o) noexcept : options(o) {
+    options.batch = std::clamp<std::size_t>(options.batch, 1, max_batch);
+    options.buffer_size =
+        std::clamp<std::size_t>(options.buffer_size, 1, max_buffer_size);
+    pool = allocate();
+  }
+
+  State(const State &) = delete;
+  State &operator=(const State &) = delete;
+
+  ~State() noexcept {
+#ifdef OS2DSRULES_INGEST_URING
+    for (const int fd : closing)
+      ::close(fd);
+#endif
+  }
+
+  std::shared_ptr<Pool> allocate() const noexcept {
+    return std::make_shared<Pool>(2 * options.batch, options.buffer_size);
+  }
+
+#ifdef OS2DSRULES_INGEST_POSIX
+  // Finishes reading the file into the buffer in slot, of which filled
+  // bytes have been read, or into memory of its own if it does not fit.
+  std::optional<Buffer> finish(int fd, std::size_t slot,
+                               std::size_t filled) noexcept {
+    const auto buffer = pool->buffer(slot);
+    std::string spill;
+    const auto content = read_all(fd, buffer, filled, spill);
+    if (content && content->data() == buffer.data())
+      return Pool::lend(pool, slot, content->size());
+
+    pool->release(slot);
+    if (!content)
+      return std::nullopt;
+    return Pool::own(std::move(spill));
+  }
+#endif
+
+  void read_syscalls(std::span<const std::string> paths,
+                     const Borrower &borrower) noexcept {
+    pool->acquire(paths.size(), slots);
+    for (std::size_t i = 0; i < paths.size(); ++i) {
+#ifdef OS2DSRULES_INGEST_POSIX
+      const int fd = ::open(paths[i].c_str(), O_RDONLY | O_CLOEXEC);
+      if (fd < 0) {
+        pool->release(slots[i]);
+        borrower(i, std::nullopt);
+        continue;
+      }
+      auto content = finish(fd, slots[i], 0);
+      ::close(fd);
+      borrower(i, std::move(content));
+#else
+      pool->release(slots[i]);
+      std::ifstream file(paths[i], std::ios::binary);
+      if (!file) {
+        borrower(i, std::nullopt);
+        continue;
+      }
+      std::string spill(std::istreambuf_iterator<char>(file),
+                        std::istreambuf_iterator<char>());
+      borrower(i, Pool::own(std::move(spill)));
+#endif
+    }
+  }
+
+#ifdef OS2DSRULES_INGEST_URING
+  bool start_uring() noexcept {
+    std::vector<iovec> iovecs(pool->count);
+    for (std::size_t i = 0; i < pool->count; ++i)
+      iovecs[i] = {pool->buffer(i).data(), options.buffer_size};
+
+    // Room for the opens of a batch and the closes of the one before.
+    ring = std::make_unique<Ring>();
+    if (ring->setup(static_cast<unsigned>(2 * options.batch), iovecs))
+      return true;
+
+    ring.reset();
+    return false;
+  }
+
+  // Queues the closes of the files of the last batch.
+  void prepare_closes() noexcept {
+    for (const int fd : closing) {
+      auto &sqe = ring->prepare();
+      sqe.opcode = IORING_OP_CLOSE;
+      sqe.fd = fd;
+      sqe.user_data = close_data;
+    }
+    closing.clear();
+  }
+
+  bool read_uring(std::span<const std::string> paths,
+                  const Borrower &borrower) noexcept {
+    const auto n = paths.size();
+    pool->acquire(n, slots);
+    fds.assign(n, -1);
+    sizes.assign(n, -1);
+
+    for (std::size_t i = 0; i < n; ++i) {
+      auto &sqe = ring->prepare();
+      sqe.opcode = IORING_OP_OPENAT;
+      sqe.fd = AT_FDCWD;
+      sqe.addr = reinterpret_cast<std::uint64_t>(paths[i].c_str());
+      sqe.open_flags = O_RDONLY | O_CLOEXEC;
+      sqe.user_data = i;
+    }
+    prepare_closes();
+    if (!ring->complete([&](const io_uring_cqe &cqe) {
+          if (cqe.user_data != close_data)
+            fds[cqe.user_data] = cqe.res;
+        }))
+      return false;
+
+    for (std::size_t i = 0; i < n; ++i) {
+      if (fds[i] < 0)
+        continue;
+      auto &sqe = ring->prepare();
+      sqe.opcode = IORING_OP_READ_FIXED;
+      sqe.fd = fds[i];
+      sqe.addr =
+          reinterpret_cast<std::uint64_t>(pool->buffer(slots[i]).data());
+      sqe.len = static_cast<std::uint32_t>(options.buffer_size);
+      sqe.buf_index = static_cast<std::uint16_t>(slots[i]);
+      sqe.user_data = i;
+    }
+    if (!ring->complete([&](const io_uring_cqe &cqe) {
+          sizes[cqe.user_data] = cqe.res;
+        }))
+      return false;
+
+    for (std::size_t i = 0; i < n; ++i) {
+      std::optional<Buffer> content;
+      if (fds[i] >= 0 && sizes[i] >= 0) {
+        const auto size = std::size_t(sizes[i]);
+        // A full buffer may not be the whole file.
+        if (size == options.buffer_size)
+          content = finish(fds[i], slots[i], size);
+        else
+          content = Pool::lend(pool, slots[i], size);
+      } else {
+        pool->release(slots[i]);
+      }
+      borrower(i, std::move(content));
+
+      if (fds[i] >= 0)
+        closing.push_back(fds[i]);
+    }
+    return true;
+  }
+
+  // Gives up on io_uring after the ring failed.
+  void stop_uring() noexcept {
+    for (const int fd : fds)
+      if (fd >= 0)
+        ::close(fd);
+    for (const int fd : closing)
+      ::close(fd);
+    closing.clear();
+
+    // Requests that were submitted may still complete into the buffers,
+    // which are kept until the ring is gone.
+    retired = std::move(pool);
+    pool = allocate();
+    backend = Backend::Syscalls;
+  }
+
+  std::shared_ptr<Pool> retired;
+  std::vector<int> fds;
+  std::vector<int> sizes;
+  std::vector<int> closing;
+#endif
+
+  Options options;
+  Backend backend = Backend::Syscalls;
+  std::shared_ptr<Pool> pool;
+  // The buffers of the files of the batch being read.
+  std::vector<std::size_t> slots;
+#ifdef OS2DSRULES_INGEST_URING
+  // Declared last, so that the ring is gone before its buffers.
+  std::unique_ptr<Ring> ring;
+#endif
+};
+
+Ingester::Ingester(Options options) noexcept
+    : state_(std::make_unique<State>(options)) {
+#ifdef OS2DSRULES_INGEST_URING
+  if (state_->options.uring && state_->start_uring())
+    state_->backend = Backend::Uring;
+#endif
+}
+
+Ingester::~Ingester() noexcept = default;
+
+Ingester::Ingester(Ingester &&) noexcept = default;
+Ingester &Ingester::operator=(Ingester &&) noexcept = default;
+
+void Ingester::read(std::span<const std::string> paths,
+                    const Consumer &consumer) noexcept {
+  // Every buffer is back in the pool before the next batch is read.
+  lend(paths, [&](std::size_t i, std::optional<Buffer> buffer) {
+    if (buffer)
+      consumer(i, buffer->view());
+    else
+      consumer(i, std::nullopt);
+  });
+}
+
+void Ingester::lend(std::span<const std::string> paths,
+                    const Borrower &borrower) noexcept {
+  auto &state = *state_;
+  const auto batch = state.options.batch;
+
+  for (std::size_t start = 0; start < paths.size(); start += batch) {
+    const auto part = paths.subspan(start, std::min(batch, paths.size() - start));
+    const auto shifted = [&](std::size_t i, std::optional<Buffer> buffer) {
+      borrower(start + i, std::move(buffer));
+    };
+
+#ifdef OS2DSRULES_INGEST_URING
+    if (state.backend == Backend::Uring) {
+      if (state.read_uring(part, shifted))
+        continue;
+      // No file of the batch has been passed on yet.
+      state.stop_uring();
+    }
+#endif
+    state.read_syscalls(part, shifted);
+  }
+}
+
+Backend Ingester::backend() const noexcept { return state_->backend; }
+
+}; // namespace Ingest
+
+}; // namespace OS2DSRules
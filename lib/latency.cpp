@@ -0,0 +1,234 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+#include <latency.hpp>
+
+#include "thread_registry.hpp"
+
+namespace OS2DSRules {
+
+namespace Latency {
+
+namespace {
+
+struct HistogramBlock {
+  std::array<std::atomic<std::uint64_t>, Histogram::bucket_count> buckets{};
+  std::atomic<std::uint64_t> sum{0};
+  std::atomic<std::uint64_t> max{0};
+};
+
+struct alignas(64) LatencyBlock {
+  std::array<std::array<HistogramBlock, size_bucket_count>, rule_count>
+      histograms{};
+};
+
+ThreadRegistry<LatencyBlock> registry;
+
+std::atomic<bool> enabled{true};
+
+thread_local std::size_t depth = 0;
+
+// Formats a duration in nanoseconds with a unit that keeps it short.
+std::string format_duration(std::uint64_t nanoseconds) {
+  char buffer[32];
+
+  if (nanoseconds < 1000)
+    std::snprintf(buffer, sizeof(buffer), "%lluns",
+                  static_cast<unsigned long long>(nanoseconds));
+  else if (nanoseconds < 1000000)
+    std::snprintf(buffer, sizeof(buffer), "%.1fus", double(nanoseconds) / 1e3);
+  else if (nanoseconds < 1000000000)
+    std::snprintf(buffer, sizeof(buffer), "%.1fms", double(nanoseconds) / 1e6);
+  else
+    std::snprintf(buffer, sizeof(buffer), "%.2fs", double(nanoseconds) / 1e9);
+
+  return buffer;
+}
+
+} // namespace
+
+std::string_view rule_name(Rule rule) noexcept {
+  switch (rule) {
+  case Rule::CPRDetector:
+    return "CPRDetector";
+  case Rule::NameRule:
+    return "NameRule";
+  case Rule::AddressRule:
+    return "AddressRule";
+  case Rule::HealthRule:
+    return "HealthRule";
+  case Rule::WordListRule:
+    return "WordListRule";
+  default:
+    return "";
+  }
+}
+
+std::string_view size_bucket_name(SizeBucket size) noexcept {
+  switch (size) {
+  case SizeBucket::UpTo1KiB:
+    return "<=1KiB";
+  case SizeBucket::UpTo16KiB:
+    return "<=16KiB";
+  case SizeBucket::UpTo256KiB:
+    return "<=256KiB";
+  case SizeBucket::UpTo4MiB:
+    return "<=4MiB";
+  case SizeBucket::Larger:
+    return ">4MiB";
+  default:
+    return "";
+  }
+}
+
+void Histogram::record(std::uint64_t nanoseconds, std::uint64_t count) noexcept {
+  buckets_[bucket_index(nanoseconds)] += count;
+  count_ += count;
+  sum_ += nanoseconds * count;
+  max_ = std::max(max_, nanoseconds);
+}
+
+Histogram &Histogram::merge(const Histogram &other) noexcept {
+  for (std::size_t i = 0; i < bucket_count; ++i)
+    buckets_[i] += other.buckets_[i];
+
+  count_ += other.count_;
+  sum_ += other.sum_;
+  max_ = std::max(max_, other.max_);
+  return *this;
+}
+
+double Histogram::mean() const noexcept {
+  return count_ == 0 ? 0.0 : double(sum_) / double(count_);
+}
+
+std::uint64_t Histogram::percentile(double q) const noexcept {
+  if (count_ == 0)
+    return 0;
+
+  q = std::clamp(q, 0.0, 1.0);
+  const auto rank = std::max<std::uint64_t>(
+      1, static_cast<std::uint64_t>(std::ceil(q * double(count_))));
+
+  std::uint64_t seen = 0;
+  for (std::size_t i = 0; i < bucket_count; ++i) {
+    seen += buckets_[i];
+    if (seen >= rank)
+      return std::min(bucket_upper_bound(i), max_);
+  }
+
+  return max_;
+}
+
+Snapshot &Snapshot::merge(const Snapshot &other) noexcept {
+  for (std::size_t r = 0; r < rule_count; ++r) {
+    for (std::size_t s = 0; s < size_bucket_count; ++s)
+      histograms_[r][s].merge(other.histograms_[r][s]);
+  }
+
+  return *this;
+}
+
+std::string Snapshot::to_text() const {
+  std::string text;
+  char line[160];
+
+  std::snprintf(line, sizeof(line), "%-14s%-10s%12s%10s%10s%10s%10s\n",
+                "rule", "size", "count", "p50", "p99", "p99.9", "max");
+  text += line;
+
+  for (std::size_t r = 0; r < rule_count; ++r) {
+    for (std::size_t s = 0; s < size_bucket_count; ++s) {
+      const auto &histogram = histograms_[r][s];
+      if (histogram.count() == 0)
+        continue;
+
+      std::snprintf(
+          line, sizeof(line), "%-14s%-10s%12llu%10s%10s%10s%10s\n",
+          rule_name(static_cast<Rule>(r)).data(),
+          size_bucket_name(static_cast<SizeBucket>(s)).data(),
+          static_cast<unsigned long long>(histogram.count()),
+          format_duration(histogram.percentile(0.5)).c_str(),
+          format_duration(histogram.percentile(0.99)).c_str(),
+          format_duration(histogram.percentile(0.999)).c_str(),
+          format_duration(histogram.max()).c_str());
+      text += line;
+    }
+  }
+
+  return text;
+}
+
+Snapshot snapshot() noexcept {
+  Snapshot result;
+
+  registry.for_each([&](const LatencyBlock &block) {
+    for (std::size_t r = 0; r < rule_count; ++r) {
+      for (std::size_t s = 0; s < size_bucket_count; ++s) {
+        const auto &source = block.histograms[r][s];
+        auto &target =
+            result.at(static_cast<Rule>(r), static_cast<SizeBucket>(s));
+
+        for (std::size_t i = 0; i < Histogram::bucket_count; ++i) {
+          const auto count = source.buckets[i].load(std::memory_order_relaxed);
+          target.buckets_[i] += count;
+          target.count_ += count;
+        }
+
+        target.sum_ += source.sum.load(std::memory_order_relaxed);
+        target.max_ = std::max(target.max_,
+                               source.max.load(std::memory_order_relaxed));
+      }
+    }
+  });
+
+  return result;
+}
+
+void reset() noexcept {
+  registry.for_each([](LatencyBlock &block) {
+    for (auto &row : block.histograms) {
+      for (auto &histogram : row) {
+        for (auto &bucket : histogram.buckets)
+          bucket.store(0, std::memory_order_relaxed);
+        histogram.sum.store(0, std::memory_order_relaxed);
+        histogram.max.store(0, std::memory_order_relaxed);
+      }
+    }
+  });
+}
+
+void set_enabled(bool value) noexcept {
+  enabled.store(value, std::memory_order_relaxed);
+}
+
+bool is_enabled() noexcept { return enabled.load(std::memory_order_relaxed); }
+
+void record(Rule rule, std::size_t bytes, std::uint64_t nanoseconds) noexcept {
+  auto &histogram = registry.local()
+                        .histograms[static_cast<std::size_t>(rule)]
+                                   [static_cast<std::size_t>(size_bucket(bytes))];
+
+  add_relaxed(histogram.buckets[Histogram::bucket_index(nanoseconds)],
+              std::uint64_t(1));
+  add_relaxed(histogram.sum, nanoseconds);
+  if (nanoseconds > histogram.max.load(std::memory_order_relaxed))
+    histogram.max.store(nanoseconds, std::memory_order_relaxed);
+}
+
+namespace detail {
+
+std::size_t &scan_depth() noexcept { return depth; }
+
+} // namespace detail
+
+}; // namespace Latency
+
+}; // namespace OS2DSRules
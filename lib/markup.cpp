@@ -0,0 +1,542 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <markup.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define OS2DSRULES_MARKUP_SSE2 1
+#endif
+
+namespace OS2DSRules {
+
+namespace Markup {
+
+namespace {
+using namespace std::string_view_literals;
+
+using Entity = std::pair<std::string_view, std::string_view>;
+
+// Named entities that occur in Danish text, sorted by name.
+static constexpr auto named_entities = std::to_array<Entity>({
+    {"AElig", "Æ"}, {"Aacute", "Á"}, {"Aring", "Å"},
+    {"Auml", "Ä"},  {"Eacute", "É"}, {"Oslash", "Ø"},
+    {"Ouml", "Ö"},  {"Uuml", "Ü"},   {"aacute", "á"},
+    {"aelig", "æ"}, {"amp", "&"},         {"apos", "'"},
+    {"aring", "å"}, {"auml", "ä"},   {"bull", "•"},
+    {"copy", "©"},  {"eacute", "é"}, {"egrave", "è"},
+    {"euro", "€"},  {"gt", ">"},          {"hellip", "…"},
+    {"laquo", "«"}, {"ldquo", "“"},  {"lsquo", "‘"},
+    {"lt", "<"},         {"mdash", "—"},  {"middot", "·"},
+    // A non-breaking space separates words like a space.
+    {"nbsp", " "},       {"ndash", "–"},  {"oslash", "ø"},
+    {"ouml", "ö"},  {"quot", "\""},       {"raquo", "»"},
+    {"rdquo", "”"}, {"reg", "®"},    {"rsquo", "’"},
+    {"sect", "§"},  {"shy", ""},          {"szlig", "ß"},
+    {"trade", "™"}, {"uuml", "ü"},
+});
+
+static_assert(std::is_sorted(named_entities.begin(), named_entities.end()));
+
+// Tags that start a new line of text, sorted.
+static constexpr auto block_tags = std::to_array<std::string_view>({
+    "address", "article", "aside", "blockquote", "br", "caption", "dd",
+    "div", "dl", "dt", "figcaption", "figure", "footer", "form", "h1",
+    "h2", "h3", "h4", "h5", "h6", "header", "hr", "li", "main", "nav",
+    "ol", "option", "p", "pre", "section", "table", "tbody", "td",
+    "tfoot", "th", "thead", "title", "tr", "ul",
+});
+
+constexpr std::size_t max_entity_size = 32;
+
+// Tag names are compared by their first eight bytes, packed into an int.
+constexpr std::size_t packed_name_size = 8;
+
+constexpr std::uint64_t pack(std::string_view name) noexcept {
+  std::uint64_t packed = 0;
+  for (std::size_t i = 0; i < std::min(name.size(), packed_name_size); ++i)
+    packed |= std::uint64_t(static_cast<unsigned char>(name[i])) << (8 * i);
+  return packed;
+}
+
+static constexpr auto packed_block_tags = [] {
+  std::array<std::uint64_t, block_tags.size()> packed{};
+  std::transform(block_tags.begin(), block_tags.end(), packed.begin(), pack);
+  std::sort(packed.begin(), packed.end());
+  return packed;
+}();
+
+constexpr std::uint64_t packed_script = pack("script");
+constexpr std::uint64_t packed_style = pack("style");
+
+constexpr char to_lower(char c) noexcept {
+  return 'A' <= c && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+constexpr bool is_alpha(char c) noexcept {
+  return ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z');
+}
+
+constexpr bool is_alnum(char c) noexcept {
+  return is_alpha(c) || ('0' <= c && c <= '9');
+}
+
+constexpr bool is_space(char c) noexcept {
+  return c == ' ' || ('\t' <= c && c <= '\r');
+}
+
+/*
+  The position of the first of the bytes a, b, c and d in s at or after
+  from, or s.size() if there is none.
+ */
+std::size_t find_any(std::string_view s, std::size_t from, char a, char b,
+                     char c, char d) noexcept {
+#ifdef OS2DSRULES_MARKUP_SSE2
+  const __m128i va = _mm_set1_epi8(a);
+  const __m128i vb = _mm_set1_epi8(b);
+  const __m128i vc = _mm_set1_epi8(c);
+  const __m128i vd = _mm_set1_epi8(d);
+
+  for (; from + 16 <= s.size(); from += 16) {
+    const __m128i bytes =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(s.data() + from));
+    const __m128i hits =
+        _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, va),
+                                  _mm_cmpeq_epi8(bytes, vb)),
+                     _mm_or_si128(_mm_cmpeq_epi8(bytes, vc),
+                                  _mm_cmpeq_epi8(bytes, vd)));
+    const auto mask = static_cast<unsigned>(_mm_movemask_epi8(hits));
+    if (mask != 0)
+      return from + static_cast<std::size_t>(std::countr_zero(mask));
+  }
+#endif
+
+  for (; from < s.size(); ++from) {
+    const char x = s[from];
+    if (x == a || x == b || x == c || x == d)
+      return from;
+  }
+
+  return s.size();
+}
+
+std::size_t find_any(std::string_view s, std::size_t from, char a,
+                     char b) noexcept {
+  return find_any(s, from, a, b, b, b);
+}
+
+std::size_t find(std::string_view s, std::size_t from, char a) noexcept {
+  return find_any(s, from, a, a, a, a);
+}
+
+// Encodes a code point as UTF-8, and returns the number of bytes.
+std::size_t encode_utf8(char32_t c, std::array<char, 4> &out) noexcept {
+  const auto byte = [](char32_t b) { return static_cast<char>(b); };
+
+  if (c < 0x80) {
+    out[0] = byte(c);
+    return 1;
+  } else if (c < 0x800) {
+    out[0] = byte(0xC0 | (c >> 6));
+    out[1] = byte(0x80 | (c & 0x3F));
+    return 2;
+  } else if (c < 0x10000) {
+    out[0] = byte(0xE0 | (c >> 12));
+    out[1] = byte(0x80 | ((c >> 6) & 0x3F));
+    out[2] = byte(0x80 | (c & 0x3F));
+    return 3;
+  }
+
+  out[0] = byte(0xF0 | (c >> 18));
+  out[1] = byte(0x80 | ((c >> 12) & 0x3F));
+  out[2] = byte(0x80 | ((c >> 6) & 0x3F));
+  out[3] = byte(0x80 | (c & 0x3F));
+  return 4;
+}
+
+// Decodes the digits of a numeric entity, e.g. "#230" or "#xE6".
+bool decode_numeric(std::string_view name, std::array<char, 4> &utf8,
+                    std::size_t &size) noexcept {
+  name.remove_prefix(1);
+  const bool hex = !name.empty() && (name[0] == 'x' || name[0] == 'X');
+  if (hex)
+    name.remove_prefix(1);
+
+  if (name.empty())
+    return false;
+
+  char32_t code = 0;
+  for (char c : name) {
+    unsigned digit;
+    if ('0' <= c && c <= '9')
+      digit = unsigned(c - '0');
+    else if (hex && 'a' <= to_lower(c) && to_lower(c) <= 'f')
+      digit = unsigned(to_lower(c) - 'a' + 10);
+    else
+      return false;
+
+    code = code * (hex ? 16 : 10) + digit;
+    if (code > 0x10FFFF)
+      break;
+  }
+
+  // Invalid code points become the replacement character.
+  if (code == 0 || code > 0x10FFFF || (0xD800 <= code && code <= 0xDFFF))
+    code = 0xFFFD;
+
+  size = encode_utf8(code, utf8);
+  return true;
+}
+
+} // namespace
+
+Segment Segment::inline_text(std::string_view text, std::size_t source,
+                             std::size_t source_size) noexcept {
+  Segment segment({}, source, source_size, text.size() == source_size);
+  segment.inline_size_ =
+      static_cast<std::uint8_t>(std::min(text.size(), segment.inline_.size()));
+  std::copy_n(text.begin(), segment.inline_size_, segment.inline_.begin());
+  return segment;
+}
+
+void OffsetMap::append(const Segment &segment) noexcept {
+  const auto size = segment.text().size();
+  if (size == 0)
+    return;
+
+  // Verbatim text that continues the last span extends it.
+  if (segment.verbatim() && !spans_.empty() && spans_.back().verbatim &&
+      segment.source() == source_end_ &&
+      size_ - spans_.back().text == source_end_ - spans_.back().source) {
+    size_ += size;
+    source_end_ += size;
+    return;
+  }
+
+  spans_.push_back(
+      Span{size_, segment.source(),
+           segment.verbatim() ? 0
+                              : static_cast<std::uint32_t>(std::min<std::size_t>(
+                                    segment.source_size(), UINT32_MAX)),
+           segment.verbatim()});
+  size_ += size;
+  source_end_ = segment.source() + segment.source_size();
+}
+
+const OffsetMap::Span *OffsetMap::find(std::size_t pos) const noexcept {
+  auto it = std::upper_bound(
+      spans_.begin(), spans_.end(), pos,
+      [](std::size_t p, const Span &span) { return p < span.text; });
+  return it == spans_.begin() ? nullptr : &*std::prev(it);
+}
+
+std::size_t OffsetMap::to_source(std::size_t pos) const noexcept {
+  const auto *span = pos < size_ ? find(pos) : nullptr;
+  if (span == nullptr)
+    return pos < size_ ? pos : source_end_;
+
+  return span->verbatim ? span->source + (pos - span->text) : span->source;
+}
+
+std::size_t OffsetMap::to_source_end(std::size_t pos) const noexcept {
+  const auto *span = pos < size_ ? find(pos) : nullptr;
+  if (span == nullptr)
+    return pos < size_ ? pos : source_end_;
+
+  if (span->verbatim)
+    return span->source + (pos - span->text);
+
+  return span->source + std::max<std::uint32_t>(span->source_size, 1) - 1;
+}
+
+void OffsetMap::clear() noexcept {
+  spans_.clear();
+  size_ = 0;
+  source_end_ = 0;
+}
+
+void Stripper::emit_literal(std::string_view piece, std::size_t pos,
+                            std::vector<Segment> &segments) noexcept {
+  // The markup turned out to be text, from markup_ up to pos in piece.
+  const std::size_t end = offset_ + pos;
+
+  if (markup_ >= offset_) {
+    segments.push_back(Segment::view(
+        piece.substr(markup_ - offset_, end - markup_), markup_));
+    return;
+  }
+
+  // The start of it was in an earlier piece, and only its bytes are left.
+  std::string bytes = state_ == State::Entity ? "&" + entity_ : "<";
+  bytes.resize(end - markup_, '\0');
+  const auto earlier = std::min(bytes.size(), offset_ - markup_);
+  for (std::size_t i = 0; i < earlier; i += 4) {
+    const auto n = std::min<std::size_t>(4, earlier - i);
+    auto segment = Segment::inline_text(std::string_view(bytes).substr(i, n),
+                                        markup_ + i, n);
+    segments.push_back(segment);
+  }
+
+  if (end > offset_)
+    segments.push_back(Segment::view(piece.substr(0, end - offset_), offset_));
+}
+
+void Stripper::end_tag(std::size_t end,
+                       std::vector<Segment> &segments) noexcept {
+  if (std::binary_search(packed_block_tags.begin(), packed_block_tags.end(),
+                         name_))
+    segments.push_back(Segment::replace("\n"sv, markup_, end - markup_));
+
+  if (!closing_ && (name_ == packed_script || name_ == packed_style)) {
+    raw_end_ = name_ == packed_script ? "</script"sv : "</style"sv;
+    raw_matched_ = 0;
+    state_ = State::RawText;
+  } else {
+    state_ = State::Text;
+  }
+}
+
+void Stripper::end_entity(std::string_view piece, std::size_t pos,
+                          std::vector<Segment> &segments) noexcept {
+  // The entity ends with the ';' at pos.
+  const std::size_t size = offset_ + pos + 1 - markup_;
+
+  if (!entity_.empty() && entity_[0] == '#') {
+    std::array<char, 4> utf8;
+    std::size_t length = 0;
+    if (decode_numeric(entity_, utf8, length)) {
+      segments.push_back(Segment::inline_text(
+          std::string_view(utf8.data(), length), markup_, size));
+      state_ = State::Text;
+      return;
+    }
+  } else {
+    const auto it = std::lower_bound(
+        named_entities.begin(), named_entities.end(), entity_,
+        [](const Entity &e, const std::string &name) { return e.first < name; });
+    if (it != named_entities.end() && it->first == entity_) {
+      if (!it->second.empty())
+        segments.push_back(Segment::replace(it->second, markup_, size));
+      state_ = State::Text;
+      return;
+    }
+  }
+
+  // Unknown entities are text, including the ';'.
+  emit_literal(piece, pos + 1, segments);
+  state_ = State::Text;
+}
+
+void Stripper::feed(std::string_view piece,
+                    std::vector<Segment> &segments) noexcept {
+  const std::size_t n = piece.size();
+  std::size_t i = 0;
+
+  while (i < n) {
+    switch (state_) {
+    case State::Text: {
+      const auto hit = find_any(piece, i, '<', '&');
+      if (hit > i)
+        segments.push_back(Segment::view(piece.substr(i, hit - i), offset_ + i));
+      if (hit == n) {
+        i = n;
+        break;
+      }
+
+      markup_ = offset_ + hit;
+      state_ = piece[hit] == '<' ? State::TagOpen : State::Entity;
+      entity_.clear();
+      i = hit + 1;
+      break;
+    }
+    case State::TagOpen: {
+      const char c = piece[i];
+      name_ = 0;
+      name_size_ = 0;
+      closing_ = false;
+      equals_ = false;
+
+      if (c == '/') {
+        closing_ = true;
+        state_ = State::TagName;
+        ++i;
+      } else if (is_alpha(c)) {
+        state_ = State::TagName;
+      } else if (c == '!') {
+        dashes_ = 0;
+        state_ = State::Bang;
+        ++i;
+      } else if (c == '?') {
+        state_ = State::Tag;
+        ++i;
+      } else {
+        // A '<' that does not start a tag, as in "a < b".
+        emit_literal(piece, i, segments);
+        state_ = State::Text;
+      }
+      break;
+    }
+    case State::TagName: {
+      for (; i < n && (is_alnum(piece[i]) || piece[i] == '-' || piece[i] == ':');
+           ++i) {
+        if (name_size_ < packed_name_size)
+          name_ |= std::uint64_t(static_cast<unsigned char>(to_lower(piece[i])))
+                   << (8 * name_size_++);
+      }
+
+      if (i < n)
+        state_ = State::Tag;
+      break;
+    }
+    case State::Tag: {
+      const auto hit = find_any(piece, i, '>', '"', '\'', '>');
+
+      // A quote only starts a value right after an '=' and any spaces.
+      auto last = hit;
+      while (last > i && is_space(piece[last - 1]))
+        --last;
+      if (last > i)
+        equals_ = piece[last - 1] == '=';
+
+      if (hit == n) {
+        i = n;
+        break;
+      }
+
+      i = hit + 1;
+      if (piece[hit] == '>') {
+        end_tag(offset_ + i, segments);
+      } else if (equals_) {
+        quote_ = piece[hit];
+        state_ = State::Quote;
+      }
+      equals_ = false;
+      break;
+    }
+    case State::Quote: {
+      const auto hit = find(piece, i, quote_);
+      if (hit < n)
+        state_ = State::Tag;
+      i = std::min(n, hit + 1);
+      break;
+    }
+    case State::Bang: {
+      if (piece[i] == '-') {
+        ++i;
+        if (++dashes_ == 2) {
+          dashes_ = 0;
+          state_ = State::Comment;
+        }
+      } else {
+        // A declaration such as <!DOCTYPE html>.
+        state_ = State::Tag;
+      }
+      break;
+    }
+    case State::Comment: {
+      const auto hit = find(piece, i, '>');
+
+      // Count the dashes right before the '>', or at the end of the piece.
+      std::size_t dashes = 0;
+      while (dashes < 2 && hit - dashes > i && piece[hit - dashes - 1] == '-')
+        ++dashes;
+      if (hit - dashes == i)
+        dashes = std::min<std::size_t>(2, dashes + dashes_);
+
+      if (hit == n) {
+        dashes_ = static_cast<unsigned>(dashes);
+        i = n;
+      } else {
+        dashes_ = 0;
+        i = hit + 1;
+        if (dashes == 2)
+          state_ = State::Text;
+      }
+      break;
+    }
+    case State::RawText: {
+      if (raw_matched_ == 0) {
+        const auto hit = find(piece, i, '<');
+        if (hit < n) {
+          markup_ = offset_ + hit;
+          raw_matched_ = 1;
+        }
+        i = std::min(n, hit + 1);
+      } else if (to_lower(piece[i]) == raw_end_[raw_matched_]) {
+        ++i;
+        if (++raw_matched_ == raw_end_.size()) {
+          // The end tag is read like any other.
+          name_ = pack(raw_end_.substr(2));
+          closing_ = true;
+          equals_ = false;
+          state_ = State::Tag;
+        }
+      } else {
+        raw_matched_ = 0;
+      }
+      break;
+    }
+    case State::Entity: {
+      const char c = piece[i];
+      if (c == ';') {
+        end_entity(piece, i, segments);
+        ++i;
+      } else if ((is_alnum(c) || (c == '#' && entity_.empty())) &&
+                 entity_.size() < max_entity_size) {
+        entity_ += c;
+        ++i;
+      } else {
+        // A '&' that does not start an entity, as in "A & B".
+        emit_literal(piece, i, segments);
+        state_ = State::Text;
+      }
+      break;
+    }
+    }
+  }
+
+  offset_ += n;
+}
+
+void Stripper::finish(std::vector<Segment> &segments) noexcept {
+  if (state_ == State::Entity || state_ == State::TagOpen)
+    emit_literal(std::string_view(), 0, segments);
+
+  state_ = State::Text;
+  entity_.clear();
+}
+
+MatchResult Document::to_source(const MatchResult &m,
+                                End end) const noexcept {
+  const auto stop = ends_at_last_byte(m, end) ? map.to_source_end(m.end())
+                                              : map.to_source(m.end());
+  return MatchResult(m.match(), map.to_source(m.start()), stop,
+                     m.sensitivity(), m.probability());
+}
+
+Document strip(std::string_view source) noexcept {
+  Stripper stripper;
+  std::vector<Segment> segments;
+  stripper.feed(source, segments);
+  stripper.finish(segments);
+
+  Document document;
+  document.text.reserve(source.size());
+  for (const auto &segment : segments) {
+    document.text += segment.text();
+    document.map.append(segment);
+  }
+
+  return document;
+}
+
+}; // namespace Markup
+
+}; // namespace OS2DSRules
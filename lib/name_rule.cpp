@@ -1,10 +1,16 @@
 #include <algorithm>
 #include <array>
+#include <optional>
 #include <string_view>
 
 #include <os2dsrules.hpp>
 #include <data_structures.hpp>
 #include <name_rule.hpp>
+#include <latency.hpp>
+#include <probes.hpp>
+#include <stats.hpp>
+
+#include "scan_limiter.hpp"
 
 using namespace OS2DSRules::DataStructures;
 
@@ -32,15 +38,60 @@ MatchResult compose(const MatchResult &mr1, const MatchResult &mr2) noexcept {
 }
 
 [[nodiscard]] MatchResults
-NameRule::find_matches(const std::string &content) const noexcept {
+NameRule::find_matches(std::string_view content) const noexcept {
+  return find_matches(content, ScanOptions()).matches;
+}
+
+[[nodiscard]] ScanResult
+NameRule::find_matches(std::string_view content,
+                       const ScanOptions &options) const noexcept {
+  Stats::ScanScope scope(content.size());
+  Latency::ScanTimer timer(Latency::Rule::NameRule, content.size());
+  OS2DSRULES_PROBE3(scan__start, "NameRule", content.data(), content.size());
+  ScanLimiter limiter(options, content.size());
   MatchResults results;
 
   static constexpr auto is_end_of_word = make_predicate(' ', '.', '\n', '?', '-', '\t','\0');
 
+  // Names that follow each other are composed into one match, so the last
+  // name found is kept in a cursor until the next one is known.
+  std::optional<MatchResult> cursor = std::nullopt;
+  std::size_t offset = limiter.limit();
+
+  // Returns false once the match cap has been reached.
+  const auto add = [&](const MatchResult &m) {
+    if (cursor && m.is_after(cursor.value())) {
+      cursor = std::make_optional(compose(cursor.value(), m));
+      return true;
+    }
+
+    if (cursor) {
+      OS2DSRULES_PROBE3(match, "NameRule", cursor->start(), cursor->end());
+      results.push_back(cursor.value());
+
+      if (limiter.full(results.size())) {
+        cursor = std::nullopt;
+        offset = m.start();
+        return false;
+      }
+    }
+
+    cursor = std::make_optional(m);
+    return true;
+  };
+
   bool in_word = false;
   auto word_begin = content.cbegin();
+  const auto stop = content.cbegin() + static_cast<long>(limiter.limit());
+
+  for (auto iter = content.cbegin(); iter != stop; ++iter) {
+    const auto pos =
+        static_cast<std::size_t>(std::distance(content.cbegin(), iter));
+    if (!limiter.proceed(pos)) {
+      offset = pos;
+      break;
+    }
 
-  for (auto iter = content.cbegin(); iter != content.cend(); ++iter) {
     if (!in_word && std::isupper(*iter)) {
       word_begin = iter;
       in_word = true;
@@ -48,6 +99,7 @@ NameRule::find_matches(const std::string &content) const noexcept {
 
     if (in_word && is_end_of_word(*iter)) {
       auto word_end = iter;
+      in_word = false;
 
       if (contains(word_begin, word_end)) {
         MatchResult result(
@@ -56,31 +108,56 @@ NameRule::find_matches(const std::string &content) const noexcept {
                 std::distance(content.cbegin(), word_begin)),
             static_cast<std::size_t>(std::distance(content.begin(), word_end)));
 
-        results.push_back(result);
+        if (!add(result))
+          break;
       }
-
-      in_word = false;
     }
   }
 
-  if (in_word) {
-    auto word_end = content.cend();
+  if (limiter.cut(offset)) {
+    // A name that was cut off, or that may continue, is left for a rescan.
+    if (in_word)
+      offset = std::min(offset, static_cast<std::size_t>(std::distance(
+                                    content.cbegin(), word_begin)));
+
+    // The last name is only composed with a name that starts right after
+    // it, so once the rescan starts beyond that, the name is complete.
+    if (cursor && offset > cursor->end() + 1) {
+      OS2DSRULES_PROBE3(match, "NameRule", cursor->start(), cursor->end());
+      results.push_back(cursor.value());
+    } else if (cursor) {
+      offset = std::min(offset, cursor->start());
+    }
+  } else {
+    if (in_word) {
+      auto word_end = content.cend();
 
-    if (contains(word_begin, word_end)) {
-      MatchResult result(
-          std::string(word_begin, word_end),
-          static_cast<std::size_t>(std::distance(content.cbegin(), word_begin)),
-          static_cast<std::size_t>(std::distance(content.begin(), word_end) - 1));
+      if (contains(word_begin, word_end)) {
+        MatchResult result(
+            std::string(word_begin, word_end),
+            static_cast<std::size_t>(
+                std::distance(content.cbegin(), word_begin)),
+            static_cast<std::size_t>(
+                std::distance(content.begin(), word_end) - 1));
+
+        (void)add(result);
+      }
+    }
 
-      results.push_back(result);
+    if (cursor) {
+      OS2DSRULES_PROBE3(match, "NameRule", cursor->start(), cursor->end());
+      results.push_back(cursor.value());
     }
   }
 
-  return filter_matches(results);
+  OS2DSRULES_PROBE3(scan__done, "NameRule", content.size(), results.size());
+  return limiter.finish(std::move(results), offset);
 }
 
 [[nodiscard]] bool
 NameRule::contains(const std::string_view target) const noexcept {
+  OS2DSRULES_STAT(CandidateTokens, 1);
+
   std::string target_upper(target);
   std::transform(target.begin(), target.end(), target_upper.begin(),
                  [](auto ch) { return std::toupper(ch); });
@@ -94,37 +171,11 @@ NameRule::contains(const std::string_view target) const noexcept {
 }
 
 [[nodiscard]] bool
-NameRule::contains(const std::string::const_iterator start,
-                   const std::string::const_iterator stop) const noexcept {
+NameRule::contains(const std::string_view::const_iterator start,
+                   const std::string_view::const_iterator stop) const noexcept {
   return contains(std::string_view(start, stop));
 }
 
-[[nodiscard]] MatchResults
-NameRule::filter_matches(const MatchResults &matches) const noexcept {
-  MatchResults results;
-
-  std::optional<MatchResult> cursor = std::nullopt;
-
-  for (auto m : matches) {
-    if (cursor) {
-      if (m.is_after(cursor.value())) {
-        cursor = std::make_optional(compose(cursor.value(), m));
-      } else {
-        results.push_back(cursor.value());
-        cursor = std::make_optional(m);
-      }
-    } else {
-      cursor = std::make_optional(m);
-    }
-  }
-
-  if (cursor) {
-    results.push_back(cursor.value());
-  }
-
-  return results;
-}
-
 }; // namespace NameRule
 
 }; // namespace OS2DSRules
@@ -0,0 +1,375 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <ingest.hpp>
+#include <pipeline.hpp>
+#include <prescreen.hpp>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define OS2DSRULES_PIPELINE_MMAP 1
+#endif
+
+namespace OS2DSRules {
+
+namespace Pipeline {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Document {
+  std::string path;
+  std::optional<Content> content;
+};
+
+// Measures the time a thread of a stage spends in each state.
+class StageTimer {
+public:
+  explicit StageTimer(StageStats &stats) noexcept
+      : stats_(stats), last_(Clock::now()) {}
+
+  void busy() noexcept { stats_.busy += lap(); }
+  void starved() noexcept { stats_.starved += lap(); }
+  void blocked() noexcept { stats_.blocked += lap(); }
+
+private:
+  std::chrono::nanoseconds lap() noexcept {
+    const auto now = Clock::now();
+    const auto elapsed = now - last_;
+    last_ = now;
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed);
+  }
+
+  StageStats &stats_;
+  Clock::time_point last_;
+};
+
+// Closes queue when the last of the threads that feed it is done.
+template <typename T> class Feeders {
+public:
+  Feeders(BoundedQueue<T> &queue, std::size_t threads) noexcept
+      : queue_(queue), remaining_(threads) {}
+
+  void done() noexcept {
+    if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      queue_.close();
+  }
+
+private:
+  BoundedQueue<T> &queue_;
+  std::atomic<std::size_t> remaining_;
+};
+
+void enumerate(const std::vector<std::string> &roots,
+               BoundedQueue<std::string> &paths, StageStats &stats) noexcept {
+  namespace fs = std::filesystem;
+  StageTimer timer(stats);
+
+  const auto push = [&](std::string path) {
+    ++stats.items;
+    timer.busy();
+    (void)paths.push(std::move(path));
+    timer.blocked();
+  };
+
+  for (const auto &root : roots) {
+    std::error_code error;
+    if (!fs::is_directory(root, error)) {
+      // Anything else is passed on, so that missing files are reported.
+      push(root);
+      continue;
+    }
+
+    fs::recursive_directory_iterator it(
+        root, fs::directory_options::skip_permission_denied, error);
+    for (; !error && it != fs::recursive_directory_iterator();
+         it.increment(error)) {
+      if (it->is_regular_file(error))
+        push(it->path().string());
+    }
+  }
+
+  timer.busy();
+}
+
+void read(const Reader &reader, BoundedQueue<std::string> &paths,
+          BoundedQueue<Document> &documents, StageStats &stats) noexcept {
+  StageTimer timer(stats);
+
+  while (auto path = paths.pop()) {
+    timer.starved();
+    auto content = reader(path.value());
+    Document document{std::move(path.value()), std::move(content)};
+    ++stats.items;
+    timer.busy();
+
+    (void)documents.push(std::move(document));
+    timer.blocked();
+  }
+  timer.starved();
+}
+
+void read_batches(const Ingest::Options &options,
+                  BoundedQueue<std::string> &paths,
+                  BoundedQueue<Document> &documents,
+                  StageStats &stats) noexcept {
+  StageTimer timer(stats);
+  Ingest::Ingester ingester(options);
+  std::vector<std::string> batch;
+
+  while (auto path = paths.pop()) {
+    // A batch is what has queued up, rather than waiting for a full one.
+    batch.clear();
+    batch.push_back(std::move(path.value()));
+    while (batch.size() < options.batch) {
+      auto next = paths.try_pop();
+      if (!next)
+        break;
+      batch.push_back(std::move(next.value()));
+    }
+    timer.starved();
+
+    // The files are scanned in the buffers they were read into, which go
+    // back to the ingester when the scanner is done with them.
+    ingester.lend(batch, [&](std::size_t i,
+                             std::optional<Ingest::Buffer> buffer) {
+      Document document{batch[i], std::nullopt};
+      if (buffer)
+        document.content.emplace(std::move(buffer.value()));
+      ++stats.items;
+      timer.busy();
+
+      (void)documents.push(std::move(document));
+      timer.blocked();
+    });
+  }
+  timer.starved();
+}
+
+void scan(const RuleSet &rules, BoundedQueue<Document> &documents,
+          BoundedQueue<FileResult> &results, StageStats &stats,
+          std::atomic<std::uint64_t> &bytes) noexcept {
+  StageTimer timer(stats);
+  auto scans = rules.scans();
+
+  while (auto document = documents.pop()) {
+    timer.starved();
+
+    FileResult result;
+    result.path = std::move(document->path);
+    result.ok = document->content.has_value();
+    result.matches.resize(scans.size());
+
+    if (result.ok) {
+      const std::string_view content = document->content->view();
+      result.size = content.size();
+      bytes.fetch_add(content.size(), std::memory_order_relaxed);
+
+      const auto plan = rules.planner().plan(content);
+      for (std::size_t i = 0; i < scans.size(); ++i)
+        if (plan.runs(i))
+          result.matches[i] = scans[i](content);
+    }
+
+    // The content is freed here, before waiting for room for the result.
+    document.reset();
+    ++stats.items;
+    timer.busy();
+
+    (void)results.push(std::move(result));
+    timer.blocked();
+  }
+  timer.starved();
+}
+
+} // namespace
+
+std::vector<RuleSet::Scan> RuleSet::scans() const noexcept {
+  std::vector<Scan> scans;
+  scans.reserve(factories_.size());
+  for (const auto &factory : factories_)
+    scans.push_back(factory());
+  return scans;
+}
+
+Content::Content(Content &&other) noexcept
+    : text_(std::move(other.text_)), buffer_(std::move(other.buffer_)),
+      mapped_(std::exchange(other.mapped_, nullptr)),
+      size_(std::exchange(other.size_, 0)) {}
+
+Content &Content::operator=(Content &&other) noexcept {
+  if (this != &other) {
+    unmap();
+    text_ = std::move(other.text_);
+    buffer_ = std::move(other.buffer_);
+    mapped_ = std::exchange(other.mapped_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+  }
+  return *this;
+}
+
+Content::~Content() noexcept { unmap(); }
+
+void Content::unmap() noexcept {
+#ifdef OS2DSRULES_PIPELINE_MMAP
+  if (mapped_ != nullptr)
+    ::munmap(const_cast<char *>(mapped_), size_);
+#endif
+  mapped_ = nullptr;
+  size_ = 0;
+}
+
+std::optional<Content> Content::map(const std::string &path) noexcept {
+#ifdef OS2DSRULES_PIPELINE_MMAP
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return std::nullopt;
+
+  struct stat st;
+  void *data = MAP_FAILED;
+  if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+    data = ::mmap(nullptr, std::size_t(st.st_size), PROT_READ, MAP_PRIVATE,
+                  fd, 0);
+  // The mapping outlives the descriptor.
+  ::close(fd);
+  if (data == MAP_FAILED)
+    return std::nullopt;
+
+  // The file is scanned once, from start to end.
+  ::madvise(data, std::size_t(st.st_size), MADV_SEQUENTIAL);
+
+  Content content;
+  content.mapped_ = static_cast<const char *>(data);
+  content.size_ = std::size_t(st.st_size);
+  return content;
+#else
+  (void)path;
+  return std::nullopt;
+#endif
+}
+
+std::optional<Content> read_file(const std::string &path) noexcept {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file)
+    return std::nullopt;
+
+  const auto size = file.tellg();
+  if (size < 0)
+    return std::nullopt;
+
+  std::string content(static_cast<std::size_t>(size), '\0');
+  file.seekg(0);
+  file.read(content.data(), size);
+  if (file.bad())
+    return std::nullopt;
+
+  // The file may have shrunk since its size was taken.
+  content.resize(static_cast<std::size_t>(file.gcount()));
+  return content;
+}
+
+std::optional<Content> map_file(const std::string &path) noexcept {
+  if (auto content = Content::map(path))
+    return content;
+  return read_file(path);
+}
+
+StageStats &StageStats::operator+=(const StageStats &other) noexcept {
+  threads += other.threads;
+  items += other.items;
+  busy += other.busy;
+  starved += other.starved;
+  blocked += other.blocked;
+  return *this;
+}
+
+Stats Pipeline::run(const std::vector<std::string> &roots,
+                    const Writer &writer) noexcept {
+  const auto start = Clock::now();
+  const std::size_t readers = std::max<std::size_t>(options_.readers, 1);
+  const std::size_t scanners =
+      options_.scanners > 0
+          ? options_.scanners
+          : std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+
+  BoundedQueue<std::string> paths(options_.queue_size);
+  BoundedQueue<Document> documents(options_.queue_size);
+  BoundedQueue<FileResult> results(options_.queue_size);
+  Feeders<Document> reading(documents, readers);
+  Feeders<FileResult> scanning(results, scanners);
+  std::atomic<std::uint64_t> bytes = 0;
+
+  // Every thread records its time in a stats of its own.
+  Stats stats;
+  std::vector<StageStats> read_stats(readers), scan_stats(scanners);
+  std::vector<std::thread> threads;
+  threads.reserve(1 + readers + scanners);
+
+  threads.emplace_back([&] {
+    enumerate(roots, paths, stats.enumerate);
+    paths.close();
+  });
+  for (std::size_t i = 0; i < readers; ++i)
+    threads.emplace_back([&, i] {
+      if (options_.ingest)
+        read_batches(options_.ingest.value(), paths, documents, read_stats[i]);
+      else
+        read(options_.reader, paths, documents, read_stats[i]);
+      reading.done();
+    });
+  for (std::size_t i = 0; i < scanners; ++i)
+    threads.emplace_back([&, i] {
+      scan(rules_, documents, results, scan_stats[i], bytes);
+      scanning.done();
+    });
+
+  {
+    StageTimer timer(stats.write);
+    while (auto result = results.pop()) {
+      timer.starved();
+      writer(result.value());
+      ++stats.write.items;
+      timer.busy();
+    }
+    timer.starved();
+  }
+
+  for (auto &thread : threads)
+    thread.join();
+
+  stats.enumerate.threads = 1;
+  stats.write.threads = 1;
+  for (auto &s : read_stats) {
+    s.threads = 1;
+    stats.read += s;
+  }
+  for (auto &s : scan_stats) {
+    s.threads = 1;
+    stats.scan += s;
+  }
+
+  stats.bytes = bytes.load();
+  stats.wall = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      Clock::now() - start);
+  return stats;
+}
+
+}; // namespace Pipeline
+
+}; // namespace OS2DSRules
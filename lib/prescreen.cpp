@@ -0,0 +1,189 @@
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#include <prescreen.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define OS2DSRULES_PRESCREEN_SSE2 1
+#endif
+
+namespace OS2DSRules {
+
+namespace PreScreen {
+
+namespace {
+
+constexpr std::size_t block_size = 16;
+
+// One bit per byte of a block for each byte class.
+struct Masks {
+  std::uint32_t digit = 0;
+  std::uint32_t upper = 0;
+  std::uint32_t lower = 0;
+  std::uint32_t space = 0;
+  std::uint32_t control = 0;
+  std::uint32_t non_ascii = 0;
+};
+
+#ifdef OS2DSRULES_PRESCREEN_SSE2
+// Bytes in [lo, hi], compared as signed integers, so non-ASCII bytes are
+// never in an ASCII range.
+inline __m128i in_range(__m128i bytes, char lo, char hi) noexcept {
+  return _mm_and_si128(
+      _mm_cmpgt_epi8(bytes, _mm_set1_epi8(static_cast<char>(lo - 1))),
+      _mm_cmplt_epi8(bytes, _mm_set1_epi8(static_cast<char>(hi + 1))));
+}
+
+inline std::uint32_t to_mask(__m128i lanes) noexcept {
+  return static_cast<std::uint32_t>(_mm_movemask_epi8(lanes));
+}
+
+Masks classify(const char *block) noexcept {
+  const __m128i bytes =
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(block));
+
+  Masks masks;
+  masks.digit = to_mask(in_range(bytes, '0', '9'));
+  masks.upper = to_mask(in_range(bytes, 'A', 'Z'));
+  masks.lower = to_mask(in_range(bytes, 'a', 'z'));
+  masks.space = to_mask(_mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(' ')),
+                                     in_range(bytes, '\t', '\r')));
+  masks.control =
+      to_mask(_mm_or_si128(in_range(bytes, '\0', '\x1f'),
+                           _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\x7f')))) &
+      ~masks.space;
+  masks.non_ascii = to_mask(bytes);
+  return masks;
+}
+#else
+Masks classify(const char *block) noexcept {
+  Masks masks;
+
+  for (std::size_t i = 0; i < block_size; ++i) {
+    const auto c = static_cast<unsigned char>(block[i]);
+    const std::uint32_t bit = std::uint32_t(1) << i;
+
+    if ('0' <= c && c <= '9')
+      masks.digit |= bit;
+    else if ('A' <= c && c <= 'Z')
+      masks.upper |= bit;
+    else if ('a' <= c && c <= 'z')
+      masks.lower |= bit;
+    else if (c == ' ' || ('\t' <= c && c <= '\r'))
+      masks.space |= bit;
+    else if (c < 0x20 || c == 0x7f)
+      masks.control |= bit;
+    else if (c >= 0x80)
+      masks.non_ascii |= bit;
+  }
+
+  return masks;
+}
+#endif
+
+inline std::size_t count(std::uint32_t mask) noexcept {
+  return static_cast<std::size_t>(std::popcount(mask));
+}
+
+// Accumulates the features of a block of n bytes, of which only the
+// lowest n bits of the masks are valid.
+class Accumulator {
+public:
+  void add(Masks masks, std::size_t n) noexcept {
+    const std::uint32_t valid =
+        n == 32 ? ~std::uint32_t(0) : (std::uint32_t(1) << n) - 1;
+    masks.digit &= valid;
+    masks.upper &= valid;
+    masks.lower &= valid;
+    masks.space &= valid;
+    masks.control &= valid;
+    masks.non_ascii &= valid;
+
+    const std::size_t classified = count(masks.digit) + count(masks.upper) +
+                                   count(masks.lower) + count(masks.space) +
+                                   count(masks.control) +
+                                   count(masks.non_ascii);
+
+    auto &classes = features.byte_classes;
+    classes[static_cast<std::size_t>(ByteClass::Digit)] += count(masks.digit);
+    classes[static_cast<std::size_t>(ByteClass::Upper)] += count(masks.upper);
+    classes[static_cast<std::size_t>(ByteClass::Lower)] += count(masks.lower);
+    classes[static_cast<std::size_t>(ByteClass::Space)] += count(masks.space);
+    classes[static_cast<std::size_t>(ByteClass::Control)] +=
+        count(masks.control);
+    classes[static_cast<std::size_t>(ByteClass::NonAscii)] +=
+        count(masks.non_ascii);
+    classes[static_cast<std::size_t>(ByteClass::Punctuation)] += n - classified;
+
+    // A token starts at a word byte that does not follow another one.
+    const std::uint32_t word =
+        masks.digit | masks.upper | masks.lower | masks.non_ascii;
+    const std::uint32_t follows_word = (word << 1) | in_word_;
+    features.tokens += count(word & ~follows_word);
+    features.capitalized_tokens += count(masks.upper & ~follows_word);
+    in_word_ = (word >> (n - 1)) & 1;
+
+    add_digit_runs(masks.digit, valid, n);
+  }
+
+  Features finish() noexcept {
+    features.longest_digit_run = std::max(features.longest_digit_run, run_);
+    return features;
+  }
+
+  Features features;
+
+private:
+  void add_digit_runs(std::uint32_t digits, std::uint32_t valid,
+                      std::size_t n) noexcept {
+    if (digits == valid) {
+      run_ += n;
+      return;
+    }
+
+    // The lowest digits continue the run from the previous block.
+    run_ += static_cast<std::size_t>(std::countr_one(digits));
+    features.longest_digit_run = std::max(features.longest_digit_run, run_);
+
+    // Runs inside the block: every step shortens all runs by one.
+    std::size_t longest = 0;
+    for (std::uint32_t m = digits; m != 0; m &= m >> 1)
+      ++longest;
+    features.longest_digit_run = std::max(features.longest_digit_run, longest);
+
+    // The highest digits start a run that may continue in the next block.
+    run_ = static_cast<std::size_t>(
+        std::countl_one(static_cast<std::uint32_t>(digits << (32 - n))));
+  }
+
+  std::uint32_t in_word_ = 0;
+  std::size_t run_ = 0;
+};
+
+} // namespace
+
+Features analyze(std::string_view content) noexcept {
+  Accumulator accumulator;
+  accumulator.features.size = content.size();
+
+  std::size_t i = 0;
+  for (; i + block_size <= content.size(); i += block_size)
+    accumulator.add(classify(content.data() + i), block_size);
+
+  if (i < content.size()) {
+    char tail[block_size] = {};
+    std::memcpy(tail, content.data() + i, content.size() - i);
+    accumulator.add(classify(tail), content.size() - i);
+  }
+
+  return accumulator.finish();
+}
+
+}; // namespace PreScreen
+
+}; // namespace OS2DSRules
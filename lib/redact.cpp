@@ -0,0 +1,321 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <redact.hpp>
+
+namespace OS2DSRules {
+
+namespace Redact {
+
+namespace {
+
+constexpr bool continuation(char c) noexcept {
+  return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+}
+
+constexpr bool digit(char c) noexcept { return '0' <= c && c <= '9'; }
+
+constexpr bool letter(char c) noexcept {
+  return ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z');
+}
+
+constexpr bool ascii(char c) noexcept {
+  return static_cast<unsigned char>(c) < 0x80;
+}
+
+// Whether c may continue a token, so that a match cannot end before it.
+constexpr bool word(char c) noexcept {
+  return digit(c) || letter(c) || !ascii(c);
+}
+
+// The number of characters in text.
+std::size_t characters(std::string_view text) noexcept {
+  std::size_t n = 0;
+  for (const char c : text)
+    n += continuation(c) ? 0 : 1;
+  return n;
+}
+
+// The number of bytes text is masked into.
+std::size_t masked_size(std::string_view text, const Mask &mask) noexcept {
+  return mask.policy == Policy::Tag ? mask.tag.size() : characters(text);
+}
+
+// Appends text masked by mask to out, which is a std::string or anything
+// else with the same append overloads.
+template <typename Out>
+void append_masked(std::string_view text, const Mask &mask, Out &out) noexcept {
+  switch (mask.policy) {
+  case Policy::Fixed:
+    out.append(characters(text), mask.fill);
+    break;
+  case Policy::Tag:
+    out.append(mask.tag);
+    break;
+  case Policy::KeepLast4: {
+    // The digits from keep on are kept.
+    std::size_t keep = text.size();
+    for (std::size_t digits = 0; keep > 0 && digits < 4;)
+      digits += digit(text[--keep]) ? 1 : 0;
+
+    for (std::size_t i = 0; i < text.size(); ++i) {
+      const char c = text[i];
+      if (continuation(c))
+        continue;
+      const bool kept = digit(c) ? i >= keep : ascii(c) && !letter(c);
+      out.append(1, kept ? c : mask.fill);
+    }
+    break;
+  }
+  }
+}
+
+/*
+  Rewrites a string in place, writing bytes from the front while reading
+  what is ahead of them. Bytes that a write reaches before they have been
+  read, which only happens once tags have made the text longer, are saved
+  first.
+ */
+class Rewriter {
+public:
+  Rewriter(std::string &s, std::size_t size) noexcept : s_(s), size_(size) {}
+
+  // Copies the input up to end.
+  void copy(std::size_t end) noexcept {
+    if (saved_.size() == head_ && write_ <= read_) {
+      // Nothing is saved and the writes are behind the reads, which is
+      // always the case unless a tag has grown the text.
+      if (write_ != read_)
+        std::memmove(s_.data() + write_, s_.data() + read_, end - read_);
+      write_ += end - read_;
+      read_ = end;
+      return;
+    }
+
+    while (read_ < end)
+      append(1, take());
+  }
+
+  // Takes the input up to end, to be masked.
+  std::string_view take(std::size_t end) noexcept {
+    text_.clear();
+    while (read_ < end)
+      text_ += take();
+    return text_;
+  }
+
+  void append(std::size_t n, char c) noexcept {
+    for (std::size_t i = 0; i < n; ++i)
+      put(c);
+  }
+
+  void append(std::string_view text) noexcept {
+    for (const char c : text)
+      put(c);
+  }
+
+  [[nodiscard]] std::size_t written() const noexcept { return write_; }
+
+private:
+  char take() noexcept {
+    ++read_;
+    if (head_ == saved_.size())
+      return s_[read_ - 1];
+
+    const char c = saved_[head_++];
+    if (head_ == saved_.size()) {
+      saved_.clear();
+      head_ = 0;
+    }
+    return c;
+  }
+
+  void put(char c) noexcept {
+    // The input from read_ on that has been saved already.
+    const auto saved = read_ + (saved_.size() - head_);
+    if (write_ >= saved && write_ < size_)
+      saved_.append(s_, saved, write_ + 1 - saved);
+    s_[write_++] = c;
+  }
+
+  std::string &s_;
+  // The size of the input.
+  const std::size_t size_;
+  std::size_t read_ = 0;
+  std::size_t write_ = 0;
+  // The input after read_ that writes have reached, from head_ on.
+  std::string saved_;
+  std::size_t head_ = 0;
+  // The text of the span being masked.
+  std::string text_;
+};
+
+} // namespace
+
+Span span_of(const MatchResult &m, End end, std::string_view content,
+             std::size_t base, bool last) noexcept {
+  const auto size = base + content.size();
+  auto stop = m.end();
+
+  if (end == End::Inclusive) {
+    ++stop;
+  } else if (last && stop >= base && stop + 1 == size &&
+             !m.match().empty()) {
+    const char c = content[stop - base];
+    if (word(c) || c == m.match().back())
+      ++stop;
+  }
+
+  stop = std::min(stop, size);
+  const auto start = std::min(std::max(m.start(), base), stop);
+  return Span{.start = start, .end = stop};
+}
+
+void merge(std::vector<Span> &spans) noexcept {
+  if (spans.empty())
+    return;
+
+  std::sort(spans.begin(), spans.end(), [](const Span &a, const Span &b) {
+    return a.start != b.start ? a.start < b.start : a.rule < b.rule;
+  });
+
+  std::size_t n = 0;
+  for (std::size_t i = 1; i < spans.size(); ++i) {
+    auto &last = spans[n];
+    if (spans[i].start < last.end) {
+      last.end = std::max(last.end, spans[i].end);
+      last.rule = std::min(last.rule, spans[i].rule);
+    } else {
+      spans[++n] = spans[i];
+    }
+  }
+  spans.resize(n + 1);
+}
+
+std::vector<Span> Redactor::spans(std::string_view content) noexcept {
+  std::vector<Span> spans;
+  for (std::size_t rule = 0; rule < rules_.size(); ++rule)
+    for (const auto &m : rules_[rule].scan(content)) {
+      auto span = span_of(m, rules_[rule].end, content, 0, true);
+      span.rule = rule;
+      spans.push_back(span);
+    }
+
+  merge(spans);
+  return spans;
+}
+
+std::string Redactor::redact(std::string_view content) noexcept {
+  std::string out;
+  write(content, spans(content), out);
+  return out;
+}
+
+void Redactor::redact_in_place(std::string &content) noexcept {
+  write_in_place(content, spans(content));
+}
+
+void Redactor::write(std::string_view content, const std::vector<Span> &spans,
+                     std::string &out) const noexcept {
+  out.reserve(out.size() + content.size());
+
+  std::size_t at = 0;
+  for (const auto &span : spans) {
+    out.append(content, at, span.start - at);
+    append_masked(content.substr(span.start, span.end - span.start),
+                  rules_[span.rule].mask, out);
+    at = span.end;
+  }
+  out.append(content, at);
+}
+
+void Redactor::write_in_place(std::string &content,
+                              const std::vector<Span> &spans) const noexcept {
+  const auto size = content.size();
+  auto total = size;
+  for (const auto &span : spans)
+    total = total - (span.end - span.start) +
+            masked_size(std::string_view(content).substr(
+                            span.start, span.end - span.start),
+                        rules_[span.rule].mask);
+  content.resize(std::max(size, total));
+
+  Rewriter rewriter(content, size);
+  for (const auto &span : spans) {
+    rewriter.copy(span.start);
+    append_masked(rewriter.take(span.end), rules_[span.rule].mask, rewriter);
+  }
+  rewriter.copy(size);
+  content.resize(rewriter.written());
+}
+
+Stream::Stream(Redactor &redactor) noexcept : redactor_(redactor) {
+  for (const auto &rule : redactor.rules_)
+    feeds_.push_back(rule.stream());
+}
+
+void Stream::feed(std::string_view piece, std::string &out) noexcept {
+  pending_.append(piece);
+  for (std::size_t rule = 0; rule < feeds_.size(); ++rule)
+    collect(rule, feeds_[rule].feed(piece), false);
+  merge(spans_);
+
+  auto until = offset_ + pending_.size();
+  for (const auto &feed : feeds_)
+    until = std::min(until, feed.resume());
+  // A span is written whole.
+  for (const auto &span : spans_)
+    if (span.start < until && until < span.end)
+      until = span.start;
+
+  flush(until, out);
+}
+
+void Stream::finish(std::string &out) noexcept {
+  for (std::size_t rule = 0; rule < feeds_.size(); ++rule)
+    collect(rule, feeds_[rule].finish(), true);
+  merge(spans_);
+  flush(offset_ + pending_.size(), out);
+}
+
+void Stream::collect(std::size_t rule, const MatchResults &matches,
+                     bool last) noexcept {
+  const auto base = static_cast<std::size_t>(offset_);
+  for (const auto &m : matches) {
+    auto span = span_of(m, redactor_.rules_[rule].end, pending_, base, last);
+    span.rule = rule;
+    spans_.push_back(span);
+  }
+}
+
+void Stream::flush(std::uint64_t until, std::string &out) noexcept {
+  if (until <= offset_)
+    return;
+
+  const auto base = static_cast<std::size_t>(offset_);
+  const auto size = static_cast<std::size_t>(until - offset_);
+
+  // The spans are sorted, so those before until come first.
+  std::size_t n = 0;
+  written_.clear();
+  while (n < spans_.size() && spans_[n].end <= until) {
+    written_.push_back(Span{.start = spans_[n].start - base,
+                            .end = spans_[n].end - base,
+                            .rule = spans_[n].rule});
+    ++n;
+  }
+
+  redactor_.write(std::string_view(pending_).substr(0, size), written_, out);
+  spans_.erase(spans_.begin(), spans_.begin() + static_cast<long>(n));
+  pending_.erase(0, size);
+  offset_ = until;
+}
+
+}; // namespace Redact
+
+}; // namespace OS2DSRules
@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include <result_cache.hpp>
+
+namespace OS2DSRules {
+
+namespace ResultCache {
+
+namespace {
+
+// Random values for the rolling hash, one per byte value.
+constexpr std::array<std::uint64_t, 256> gear_table = [] {
+  std::array<std::uint64_t, 256> table{};
+  std::uint64_t state = 0x2545f4914f6cdd1dULL;
+
+  for (auto &value : table) {
+    // splitmix64
+    state += 0x9e3779b97f4a7c15ULL;
+    std::uint64_t z = state;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    value = z ^ (z >> 31);
+  }
+
+  return table;
+}();
+
+} // namespace
+
+std::vector<std::string_view>
+content_defined_chunks(std::string_view content,
+                       const ChunkOptions &options) noexcept {
+  std::vector<std::string_view> chunks;
+  // The high bits of the hash depend on the last 64 bytes.
+  const std::uint64_t mask = options.mask_bits == 0
+                                 ? 0
+                                 : ~std::uint64_t(0)
+                                       << (64 - std::min(options.mask_bits, 63u));
+
+  std::size_t begin = 0;
+  std::uint64_t hash = 0;
+
+  for (std::size_t i = 0; i < content.size(); ++i) {
+    hash = (hash << 1) + gear_table[static_cast<unsigned char>(content[i])];
+
+    const std::size_t size = i + 1 - begin;
+    if (size < options.min_size || i == 0 || content[i] != '\n' ||
+        content[i - 1] != '\n')
+      continue;
+
+    if ((hash & mask) == 0 || size >= options.max_size) {
+      chunks.push_back(content.substr(begin, size));
+      begin = i + 1;
+    }
+  }
+
+  if (begin < content.size())
+    chunks.push_back(content.substr(begin));
+
+  return chunks;
+}
+
+ResultCache::ResultCache(std::size_t capacity, std::size_t shards) noexcept
+    : capacity_(capacity),
+      shard_capacity_(capacity / std::max<std::size_t>(shards, 1)),
+      shards_(std::max<std::size_t>(shards, 1)) {}
+
+std::size_t ResultCache::entry_size(const MatchResults &results) noexcept {
+  std::size_t bytes = sizeof(Entry) + 4 * sizeof(void *);
+  for (const auto &m : results)
+    bytes += sizeof(MatchResult) + m.match().capacity();
+
+  return bytes;
+}
+
+std::optional<MatchResults> ResultCache::find(const Key &key) noexcept {
+  auto &s = shard(key);
+  std::lock_guard<std::mutex> lock(s.mutex);
+
+  auto it = s.index.find(key);
+  if (it == s.index.end()) {
+    ++s.misses;
+    return std::nullopt;
+  }
+
+  ++s.hits;
+  s.lru.splice(s.lru.begin(), s.lru, it->second);
+  return it->second->results;
+}
+
+void ResultCache::insert(const Key &key, const MatchResults &results) noexcept {
+  const std::size_t bytes = entry_size(results);
+  if (bytes > shard_capacity_)
+    return;
+
+  auto &s = shard(key);
+  std::lock_guard<std::mutex> lock(s.mutex);
+
+  auto it = s.index.find(key);
+  if (it != s.index.end()) {
+    s.bytes -= it->second->bytes;
+    it->second->results = results;
+    it->second->bytes = bytes;
+    s.lru.splice(s.lru.begin(), s.lru, it->second);
+  } else {
+    s.lru.push_front(Entry{key, results, bytes});
+    s.index.emplace(key, s.lru.begin());
+    ++s.insertions;
+  }
+
+  s.bytes += bytes;
+  evict(s);
+}
+
+void ResultCache::evict(Shard &s) noexcept {
+  while (s.bytes > shard_capacity_ && !s.lru.empty()) {
+    const auto &last = s.lru.back();
+    s.bytes -= last.bytes;
+    s.index.erase(last.key);
+    s.lru.pop_back();
+    ++s.evictions;
+  }
+}
+
+void ResultCache::clear() noexcept {
+  for (auto &s : shards_) {
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.lru.clear();
+    s.index.clear();
+    s.bytes = 0;
+  }
+}
+
+CacheStats ResultCache::stats() const noexcept {
+  CacheStats stats;
+
+  for (const auto &s : shards_) {
+    std::lock_guard<std::mutex> lock(s.mutex);
+    stats.hits += s.hits;
+    stats.misses += s.misses;
+    stats.insertions += s.insertions;
+    stats.evictions += s.evictions;
+    stats.entries += s.lru.size();
+    stats.bytes += s.bytes;
+  }
+
+  return stats;
+}
+
+}; // namespace ResultCache
+
+}; // namespace OS2DSRules
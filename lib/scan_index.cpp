@@ -0,0 +1,454 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <content_hash.hpp>
+#include <scan_index.hpp>
+
+#include "serialization.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define OS2DSRULES_SCAN_INDEX_POSIX 1
+#endif
+
+namespace OS2DSRules {
+
+namespace ScanIndex {
+
+namespace {
+
+using Serialization::Reader;
+using Serialization::Writer;
+
+constexpr char file_magic[8] = {'O', 'S', '2', 'D', 'S', 'I', 'D', 'X'};
+constexpr std::uint32_t file_version = 2;
+constexpr std::uint32_t byte_order_mark = 0x01020304;
+constexpr std::size_t file_header_size = 16;
+
+constexpr std::uint32_t record_magic = 0x31434552; // "REC1"
+constexpr std::size_t record_header_size = 16;
+
+std::string encode(const Entry &entry) {
+  Writer payload;
+  payload.put(std::string_view(entry.path));
+  payload.put(entry.size);
+  payload.put(entry.mtime);
+  payload.put(entry.content.low);
+  payload.put(entry.content.high);
+  payload.put(entry.config);
+  payload.put(static_cast<std::uint32_t>(entry.results.size()));
+
+  for (const auto &m : entry.results) {
+    payload.put(static_cast<std::uint64_t>(m.start()));
+    payload.put(static_cast<std::uint64_t>(m.end()));
+    payload.put(static_cast<std::int32_t>(m.sensitivity()));
+    payload.put(m.probability());
+    payload.put(std::string_view(m.match()));
+  }
+
+  Writer record;
+  record.put(record_magic);
+  record.put(static_cast<std::uint32_t>(payload.buffer().size()));
+  record.put(ContentHash::hash128(payload.buffer()).low);
+  record.buffer() += payload.buffer();
+  return std::move(record.buffer());
+}
+
+std::optional<Entry> decode(std::string_view payload) {
+  Reader reader(payload);
+  Entry entry;
+  std::uint32_t count = 0;
+
+  if (!reader.get(entry.path) || !reader.get(entry.size) ||
+      !reader.get(entry.mtime) || !reader.get(entry.content.low) ||
+      !reader.get(entry.content.high) || !reader.get(entry.config) ||
+      !reader.get(count))
+    return std::nullopt;
+
+  for (std::uint32_t i = 0; i < count; ++i) {
+    std::uint64_t start = 0, end = 0;
+    std::int32_t sensitivity = 0;
+    double probability = 0.0;
+    std::string match;
+
+    if (!reader.get(start) || !reader.get(end) || !reader.get(sensitivity) ||
+        !reader.get(probability) || !reader.get(match))
+      return std::nullopt;
+
+    entry.results.push_back(MatchResult(
+        std::move(match), std::size_t(start), std::size_t(end),
+        static_cast<Sensitivity>(sensitivity), probability));
+  }
+
+  if (!reader.done())
+    return std::nullopt;
+
+  return entry;
+}
+
+std::string file_header() {
+  Writer header;
+  header.buffer().append(file_magic, sizeof(file_magic));
+  header.put(file_version);
+  header.put(byte_order_mark);
+  return std::move(header.buffer());
+}
+
+#ifdef OS2DSRULES_SCAN_INDEX_POSIX
+// Writes all of data at offset, retrying short writes.
+bool write_all(int fd, std::string_view data, std::size_t offset) noexcept {
+  while (!data.empty()) {
+    const auto written =
+        ::pwrite(fd, data.data(), data.size(), static_cast<off_t>(offset));
+    if (written <= 0)
+      return false;
+    data.remove_prefix(std::size_t(written));
+    offset += std::size_t(written);
+  }
+  return true;
+}
+#endif
+
+} // namespace
+
+std::size_t ScanIndex::PathKeyHash::operator()(const PathKey &key) const noexcept {
+  return std::size_t(ContentHash::combine(
+      std::hash<std::string>()(key.path), key.config));
+}
+
+std::size_t
+ScanIndex::ContentKeyHash::operator()(const ContentKey &key) const noexcept {
+  return std::size_t(ContentHash::combine(key.content.low, key.config));
+}
+
+ScanIndex::ScanIndex(std::string path, int fd) noexcept
+    : path_(std::move(path)), fd_(fd) {}
+
+ScanIndex::ScanIndex(ScanIndex &&other) noexcept
+    : path_(std::move(other.path_)), fd_(std::exchange(other.fd_, -1)),
+      data_(std::exchange(other.data_, nullptr)),
+      mapped_(std::exchange(other.mapped_, 0)), end_(other.end_),
+      by_path_(std::move(other.by_path_)),
+      by_content_(std::move(other.by_content_)) {}
+
+ScanIndex &ScanIndex::operator=(ScanIndex &&other) noexcept {
+  if (this != &other) {
+    close();
+    path_ = std::move(other.path_);
+    fd_ = std::exchange(other.fd_, -1);
+    data_ = std::exchange(other.data_, nullptr);
+    mapped_ = std::exchange(other.mapped_, 0);
+    end_ = other.end_;
+    by_path_ = std::move(other.by_path_);
+    by_content_ = std::move(other.by_content_);
+  }
+  return *this;
+}
+
+ScanIndex::~ScanIndex() noexcept { close(); }
+
+std::optional<ScanIndex> ScanIndex::open(const std::string &path) noexcept {
+#ifdef OS2DSRULES_SCAN_INDEX_POSIX
+  const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0)
+    return std::nullopt;
+
+  ScanIndex index(path, fd);
+  if (!index.load())
+    return std::nullopt;
+
+  return index;
+#else
+  (void)path;
+  return std::nullopt;
+#endif
+}
+
+void ScanIndex::close() noexcept {
+  unmap();
+#ifdef OS2DSRULES_SCAN_INDEX_POSIX
+  if (fd_ >= 0)
+    ::close(fd_);
+#endif
+  fd_ = -1;
+}
+
+void ScanIndex::unmap() noexcept {
+#ifdef OS2DSRULES_SCAN_INDEX_POSIX
+  if (data_ != nullptr)
+    ::munmap(const_cast<char *>(data_), mapped_);
+#endif
+  data_ = nullptr;
+  mapped_ = 0;
+}
+
+bool ScanIndex::map() noexcept {
+#ifdef OS2DSRULES_SCAN_INDEX_POSIX
+  unmap();
+
+  struct stat st;
+  if (::fstat(fd_, &st) < 0)
+    return false;
+
+  const auto size = static_cast<std::size_t>(st.st_size);
+  if (size == 0)
+    return true;
+
+  void *data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd_, 0);
+  if (data == MAP_FAILED)
+    return false;
+
+  data_ = static_cast<const char *>(data);
+  mapped_ = size;
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool ScanIndex::load() noexcept {
+#ifdef OS2DSRULES_SCAN_INDEX_POSIX
+  if (!map())
+    return false;
+
+  const auto header = file_header();
+  if (mapped_ < file_header_size) {
+    // A new index, or one whose header was never completely written.
+    if (::ftruncate(fd_, 0) < 0 || !write_all(fd_, header, 0))
+      return false;
+    end_ = file_header_size;
+    return map();
+  }
+
+  if (std::string_view(data_, file_header_size) != header)
+    return false;
+
+  std::size_t offset = file_header_size;
+  while (offset + record_header_size <= mapped_) {
+    std::uint32_t magic = 0, length = 0;
+    std::uint64_t checksum = 0;
+    std::memcpy(&magic, data_ + offset, sizeof(magic));
+    std::memcpy(&length, data_ + offset + 4, sizeof(length));
+    std::memcpy(&checksum, data_ + offset + 8, sizeof(checksum));
+
+    const std::size_t payload = offset + record_header_size;
+    if (magic != record_magic || length > mapped_ - payload)
+      break;
+
+    const std::string_view bytes(data_ + payload, length);
+    if (ContentHash::hash128(bytes).low != checksum)
+      break;
+
+    const auto entry = decode(bytes);
+    if (!entry)
+      break;
+
+    index(entry.value(), offset);
+    offset = payload + length;
+  }
+
+  end_ = offset;
+
+  // Drop whatever a crash left behind after the last complete record.
+  if (end_ < mapped_) {
+    unmap();
+    if (::ftruncate(fd_, static_cast<off_t>(end_)) < 0)
+      return false;
+    return map();
+  }
+
+  return true;
+#else
+  return false;
+#endif
+}
+
+void ScanIndex::index(const Entry &entry, std::size_t offset) {
+  by_path_[PathKey{entry.path, entry.config}] = offset;
+  by_content_[ContentKey{entry.content, entry.config}] = offset;
+}
+
+std::optional<Entry> ScanIndex::decode_at(std::size_t offset) noexcept {
+  // Records appended since the file was mapped are not mapped yet.
+  if (offset + record_header_size > mapped_ && !map())
+    return std::nullopt;
+
+  if (offset + record_header_size > mapped_)
+    return std::nullopt;
+
+  std::uint32_t length = 0;
+  std::memcpy(&length, data_ + offset + 4, sizeof(length));
+  if (length > mapped_ - offset - record_header_size && !map())
+    return std::nullopt;
+
+  if (length > mapped_ - offset - record_header_size)
+    return std::nullopt;
+
+  return decode(std::string_view(data_ + offset + record_header_size, length));
+}
+
+std::optional<MatchResults> ScanIndex::lookup(std::string_view path,
+                                              std::uint64_t size,
+                                              std::int64_t mtime,
+                                              std::uint64_t config) noexcept {
+  auto it = by_path_.find(PathKey{std::string(path), config});
+  if (it == by_path_.end())
+    return std::nullopt;
+
+  auto entry = decode_at(it->second);
+  if (!entry || entry->size != size || entry->mtime != mtime)
+    return std::nullopt;
+
+  return std::move(entry->results);
+}
+
+std::optional<MatchResults>
+ScanIndex::lookup_content(const ContentHash::Hash128 &content,
+                          std::uint64_t config) noexcept {
+  auto it = by_content_.find(ContentKey{content, config});
+  if (it == by_content_.end())
+    return std::nullopt;
+
+  auto entry = decode_at(it->second);
+  if (!entry)
+    return std::nullopt;
+
+  return std::move(entry->results);
+}
+
+bool ScanIndex::record(const Entry &entry) noexcept {
+#ifdef OS2DSRULES_SCAN_INDEX_POSIX
+  const auto record = encode(entry);
+
+  if (!write_all(fd_, record, end_)) {
+    // Leave no partial record behind for the next append to follow.
+    (void)::ftruncate(fd_, static_cast<off_t>(end_));
+    return false;
+  }
+
+  index(entry, end_);
+  end_ += record.size();
+  return true;
+#else
+  (void)entry;
+  return false;
+#endif
+}
+
+bool ScanIndex::sync() noexcept {
+#ifdef OS2DSRULES_SCAN_INDEX_POSIX
+  return ::fsync(fd_) == 0;
+#else
+  return false;
+#endif
+}
+
+bool ScanIndex::compact() noexcept {
+#ifdef OS2DSRULES_SCAN_INDEX_POSIX
+  // Keep the latest record of every file, in the order they were written.
+  std::vector<std::size_t> offsets;
+  offsets.reserve(by_path_.size());
+  for (const auto &[key, offset] : by_path_)
+    offsets.push_back(offset);
+  std::sort(offsets.begin(), offsets.end());
+
+  const std::string temporary = path_ + ".tmp";
+  const int fd =
+      ::open(temporary.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0)
+    return false;
+
+  std::size_t end = 0;
+  bool ok = write_all(fd, file_header(), 0);
+  end = file_header_size;
+
+  for (std::size_t i = 0; ok && i < offsets.size(); ++i) {
+    auto entry = decode_at(offsets[i]);
+    if (!entry) {
+      ok = false;
+      break;
+    }
+
+    const auto record = encode(entry.value());
+    ok = write_all(fd, record, end);
+    end += record.size();
+  }
+
+  ok = ok && ::fsync(fd) == 0 &&
+       ::rename(temporary.c_str(), path_.c_str()) == 0;
+  if (!ok) {
+    ::close(fd);
+    ::unlink(temporary.c_str());
+    return false;
+  }
+
+  // Make the rename itself durable.
+  const auto directory =
+      std::filesystem::path(path_).parent_path().string();
+  const int dir = ::open(directory.empty() ? "." : directory.c_str(),
+                         O_RDONLY | O_CLOEXEC);
+  if (dir >= 0) {
+    (void)::fsync(dir);
+    ::close(dir);
+  }
+
+  close();
+  fd_ = fd;
+  by_path_.clear();
+  by_content_.clear();
+  return load();
+#else
+  return false;
+#endif
+}
+
+std::optional<std::pair<std::uint64_t, std::int64_t>>
+ScanIndex::stat_file(const std::string &path) noexcept {
+  std::error_code error;
+  const auto size = std::filesystem::file_size(path, error);
+  if (error)
+    return std::nullopt;
+
+  const auto mtime = std::filesystem::last_write_time(path, error);
+  if (error)
+    return std::nullopt;
+
+  const auto nanoseconds =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          mtime.time_since_epoch())
+          .count();
+  return std::make_pair(std::uint64_t(size), std::int64_t(nanoseconds));
+}
+
+std::optional<std::string>
+ScanIndex::read_file(const std::string &path) noexcept {
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    return std::nullopt;
+
+  std::string content((std::istreambuf_iterator<char>(file)),
+                      std::istreambuf_iterator<char>());
+  if (file.bad())
+    return std::nullopt;
+
+  return content;
+}
+
+}; // namespace ScanIndex
+
+}; // namespace OS2DSRules
@@ -0,0 +1,116 @@
+#ifndef SCAN_LIMITER_HPP
+#define SCAN_LIMITER_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+
+#include <os2dsrules.hpp>
+
+namespace OS2DSRules {
+
+/*
+  Enforces ScanOptions inside the loop of a rule.
+
+  Rules scan up to limit() and call proceed(pos) for every position.
+  That is a single comparison until the next checkpoint, every
+  check_interval bytes, where the deadline is read. Without a deadline
+  the first checkpoint is limit(), so such a scan never reads the clock.
+ */
+class ScanLimiter {
+public:
+  static constexpr std::size_t check_interval = 4096;
+
+  ScanLimiter(const ScanOptions &options, std::size_t size) noexcept
+      : options_(options), size_(size),
+        limit_(std::min(size, options.byte_budget)),
+        next_check_(options.deadline ? 0 : limit_) {
+    // With a cap of zero matches there is nothing to scan for.
+    (void)full(0);
+  }
+
+  // The number of bytes the scan may look at.
+  [[nodiscard]] std::size_t limit() const noexcept { return limit_; }
+
+  // False once the scan has to stop before the byte at pos.
+  [[nodiscard]] bool proceed(std::size_t pos) noexcept {
+    return pos < next_check_ || check(pos);
+  }
+
+  // Starts over at position 0, for rules that make more than one pass.
+  void rewind() noexcept {
+    if (!stopped())
+      next_check_ = options_.deadline ? 0 : limit_;
+  }
+
+  // True if the content may continue past offset, so that a token that
+  // reaches offset may not be complete.
+  [[nodiscard]] bool cut(std::size_t offset) const noexcept {
+    return offset < size_ || options_.partial;
+  }
+
+  // True if the scan stopped because of the deadline or the match cap.
+  [[nodiscard]] bool stopped() const noexcept {
+    return reason_ != StopReason::Completed;
+  }
+
+  // True, and stops the scan, once matches has reached the cap.
+  [[nodiscard]] bool full(std::size_t matches) noexcept {
+    if (matches < options_.max_matches)
+      return false;
+
+    reason_ = StopReason::MaxMatches;
+    next_check_ = 0;
+    return true;
+  }
+
+  /*
+    Packs the results of a scan that has covered content up to offset.
+    The scan is truncated if it ended before the end of the content, for
+    any other reason than a token left open at the end of a partial scan.
+   */
+  [[nodiscard]] ScanResult finish(MatchResults &&results,
+                                  std::size_t offset) const noexcept {
+    ScanResult result;
+    result.matches = std::move(results);
+    result.offset = std::min(offset, size_);
+    // A partial scan that looked at everything is complete, even if it
+    // left a token at the end for the next piece.
+    result.truncated = result.offset < size_ &&
+                       (!options_.partial || stopped() || limit_ < size_);
+
+    if (!result.truncated)
+      result.reason = StopReason::Completed;
+    else if (reason_ != StopReason::Completed)
+      result.reason = reason_;
+    else
+      result.reason = StopReason::ByteBudget;
+
+    return result;
+  }
+
+private:
+  bool check(std::size_t pos) noexcept {
+    if (stopped() || pos >= limit_)
+      return false;
+
+    if (options_.deadline && ScanOptions::Clock::now() >= *options_.deadline) {
+      reason_ = StopReason::Deadline;
+      next_check_ = 0;
+      return false;
+    }
+
+    next_check_ = std::min(limit_, pos + check_interval);
+    return true;
+  }
+
+  const ScanOptions &options_;
+  std::size_t size_;
+  std::size_t limit_;
+  std::size_t next_check_;
+  StopReason reason_ = StopReason::Completed;
+};
+
+}; // namespace OS2DSRules
+
+#endif
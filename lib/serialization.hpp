@@ -0,0 +1,70 @@
+#ifndef SERIALIZATION_HPP
+#define SERIALIZATION_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace OS2DSRules {
+
+namespace Serialization {
+
+/*
+  Appends fixed-size values, in host byte order, and length-prefixed
+  strings to a buffer. Lengths are 64-bit, so that a checkpoint of a
+  stream with gigabytes pending is written whole.
+ */
+class Writer {
+public:
+  template <typename T> void put(T value) {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    buffer_.append(bytes, sizeof(T));
+  }
+
+  void put(std::string_view s) {
+    put(static_cast<std::uint64_t>(s.size()));
+    buffer_.append(s.data(), s.size());
+  }
+
+  [[nodiscard]] std::string &buffer() noexcept { return buffer_; }
+
+private:
+  std::string buffer_;
+};
+
+// Reads what a Writer wrote, and fails instead of reading past the end.
+class Reader {
+public:
+  explicit Reader(std::string_view data) noexcept : data_(data) {}
+
+  template <typename T> bool get(T &value) noexcept {
+    if (data_.size() < sizeof(T))
+      return false;
+    std::memcpy(&value, data_.data(), sizeof(T));
+    data_.remove_prefix(sizeof(T));
+    return true;
+  }
+
+  bool get(std::string &s) {
+    std::uint64_t size = 0;
+    if (!get(size) || data_.size() < size)
+      return false;
+    s.assign(data_.data(), static_cast<std::size_t>(size));
+    data_.remove_prefix(static_cast<std::size_t>(size));
+    return true;
+  }
+
+  [[nodiscard]] bool done() const noexcept { return data_.empty(); }
+
+private:
+  std::string_view data_;
+};
+
+}; // namespace Serialization
+
+}; // namespace OS2DSRules
+
+#endif
@@ -0,0 +1,331 @@
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <serializer.hpp>
+
+namespace OS2DSRules {
+
+namespace Serializer {
+
+namespace {
+
+constexpr std::string_view replacement = "\xEF\xBF\xBD";
+
+constexpr bool plain(char c) noexcept {
+  const auto u = static_cast<unsigned char>(c);
+  return u >= 0x20 && u < 0x80 && c != '"' && c != '\\';
+}
+
+constexpr bool continuation(unsigned char u, unsigned char low = 0x80,
+                            unsigned char high = 0xBF) noexcept {
+  return low <= u && u <= high;
+}
+
+// The length of the valid UTF-8 character at the start of s, or 0.
+std::size_t utf8_length(std::string_view s) noexcept {
+  const auto at = [&](std::size_t i) -> unsigned char {
+    return i < s.size() ? static_cast<unsigned char>(s[i]) : 0;
+  };
+  const auto lead = at(0);
+
+  if (0xC2 <= lead && lead <= 0xDF)
+    return continuation(at(1)) ? 2 : 0;
+  if (0xE0 <= lead && lead <= 0xEF) {
+    const unsigned char low = lead == 0xE0 ? 0xA0 : 0x80;
+    const unsigned char high = lead == 0xED ? 0x9F : 0xBF;
+    return continuation(at(1), low, high) && continuation(at(2)) ? 3 : 0;
+  }
+  if (0xF0 <= lead && lead <= 0xF4) {
+    const unsigned char low = lead == 0xF0 ? 0x90 : 0x80;
+    const unsigned char high = lead == 0xF4 ? 0x8F : 0xBF;
+    return continuation(at(1), low, high) && continuation(at(2)) &&
+                   continuation(at(3))
+               ? 4
+               : 0;
+  }
+  return 0;
+}
+
+void append_escaped(std::string &out, char c) noexcept {
+  static constexpr char hex[] = "0123456789abcdef";
+  switch (c) {
+  case '"':
+    out += "\\\"";
+    break;
+  case '\\':
+    out += "\\\\";
+    break;
+  case '\n':
+    out += "\\n";
+    break;
+  case '\r':
+    out += "\\r";
+    break;
+  case '\t':
+    out += "\\t";
+    break;
+  default:
+    const auto u = static_cast<unsigned char>(c);
+    const char escape[] = {'\\', 'u', '0', '0', hex[u >> 4], hex[u & 0xF]};
+    out.append(escape, sizeof(escape));
+  }
+}
+
+void append_number(std::string &out, std::uint64_t value) noexcept {
+  char digits[20];
+  const auto end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+  out.append(digits, end);
+}
+
+void append_number(std::string &out, double value) noexcept {
+  // JSON has no infinities or NaN.
+  if (!std::isfinite(value)) {
+    out += "null";
+    return;
+  }
+
+  char digits[32];
+  const auto end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+  out.append(digits, end);
+}
+
+// The members of the JSON object of a match, without braces.
+void append_members(std::string &out, const MatchResult &match,
+                    std::size_t start, std::size_t end) noexcept {
+  out += "\"match\":";
+  append_json_string(out, match.match());
+  out += ",\"start\":";
+  append_number(out, std::uint64_t(start));
+  out += ",\"end\":";
+  append_number(out, std::uint64_t(end));
+  out += ",\"sensitivity\":";
+  append_number(out, std::uint64_t(match.sensitivity()));
+  out += ",\"probability\":";
+  append_number(out, match.probability());
+}
+
+void put_u32(std::string &out, std::size_t at, std::uint32_t value) noexcept {
+  for (std::size_t i = 0; i < 4; ++i)
+    out[at + i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+}
+
+void put_varint(std::string &out, std::uint64_t value) noexcept {
+  char bytes[10];
+  std::size_t n = 0;
+  while (value >= 0x80) {
+    bytes[n++] = static_cast<char>((value & 0x7F) | 0x80);
+    value >>= 7;
+  }
+  bytes[n++] = static_cast<char>(value);
+  out.append(bytes, n);
+}
+
+void put_string(std::string &out, std::string_view s) noexcept {
+  put_varint(out, s.size());
+  out.append(s);
+}
+
+constexpr std::uint64_t zigzag(std::int64_t value) noexcept {
+  return (static_cast<std::uint64_t>(value) << 1) ^
+         static_cast<std::uint64_t>(value >> 63);
+}
+
+constexpr std::int64_t unzigzag(std::uint64_t value) noexcept {
+  return static_cast<std::int64_t>(value >> 1) ^
+         -static_cast<std::int64_t>(value & 1);
+}
+
+// Reads what the functions above wrote, and fails instead of reading
+// past the end.
+class Cursor {
+public:
+  explicit Cursor(std::string_view data) noexcept : data_(data) {}
+
+  bool u32(std::uint32_t &value) noexcept {
+    if (data_.size() < 4)
+      return false;
+    value = 0;
+    for (std::size_t i = 0; i < 4; ++i)
+      value |= std::uint32_t(static_cast<unsigned char>(data_[i])) << (8 * i);
+    data_.remove_prefix(4);
+    return true;
+  }
+
+  bool f64(double &value) noexcept {
+    if (data_.size() < 8)
+      return false;
+    std::uint64_t bits = 0;
+    for (std::size_t i = 0; i < 8; ++i)
+      bits |= std::uint64_t(static_cast<unsigned char>(data_[i])) << (8 * i);
+    std::memcpy(&value, &bits, sizeof(value));
+    data_.remove_prefix(8);
+    return true;
+  }
+
+  bool varint(std::uint64_t &value) noexcept {
+    value = 0;
+    for (unsigned shift = 0; shift < 64 && !data_.empty(); shift += 7) {
+      const auto byte = static_cast<unsigned char>(data_[0]);
+      data_.remove_prefix(1);
+      value |= std::uint64_t(byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0)
+        return true;
+    }
+    return false;
+  }
+
+  bool string(std::string &s) {
+    std::uint64_t size = 0;
+    if (!varint(size) || data_.size() < size)
+      return false;
+    s.assign(data_.data(), std::size_t(size));
+    data_.remove_prefix(std::size_t(size));
+    return true;
+  }
+
+  [[nodiscard]] bool done() const noexcept { return data_.empty(); }
+
+private:
+  std::string_view data_;
+};
+
+} // namespace
+
+void append_json_string(std::string &out, std::string_view s) noexcept {
+  out += '"';
+  for (std::size_t i = 0; i < s.size();) {
+    // Most text needs no escaping, and is copied a run at a time.
+    std::size_t run = i;
+    while (run < s.size() && plain(s[run]))
+      ++run;
+    out.append(s.data() + i, run - i);
+    i = run;
+    if (i == s.size())
+      break;
+
+    if (static_cast<unsigned char>(s[i]) >= 0x80) {
+      const auto n = utf8_length(s.substr(i));
+      if (n > 0)
+        out.append(s.data() + i, n);
+      else
+        out += replacement;
+      i += n > 0 ? n : 1;
+    } else {
+      append_escaped(out, s[i]);
+      ++i;
+    }
+  }
+  out += '"';
+}
+
+void append_json_match(std::string &out, const MatchResult &match,
+                       std::size_t start, std::size_t end) noexcept {
+  out += '{';
+  append_members(out, match, start, end);
+  out += '}';
+}
+
+JsonLines::JsonLines(std::string &out, const Fields &fields) noexcept
+    : out_(out), prefix_("{") {
+  if (!fields.path.empty()) {
+    prefix_ += "\"path\":";
+    append_json_string(prefix_, fields.path);
+    prefix_ += ',';
+  }
+  if (!fields.rule.empty()) {
+    prefix_ += "\"rule\":";
+    append_json_string(prefix_, fields.rule);
+    prefix_ += ',';
+  }
+}
+
+void JsonLines::add(const MatchResult &match, std::size_t start,
+                    std::size_t end) noexcept {
+  out_ += prefix_;
+  append_members(out_, match, start, end);
+  out_ += "}\n";
+}
+
+BinaryRecord::BinaryRecord(std::string &out, const Fields &fields) noexcept
+    : out_(out), begin_(out.size()) {
+  // The length and count are filled in by finish().
+  out_.append(8, '\0');
+  put_string(out_, fields.path);
+  put_string(out_, fields.rule);
+}
+
+void BinaryRecord::add(const MatchResult &match, std::size_t start,
+                       std::size_t end) noexcept {
+  put_varint(out_, zigzag(std::int64_t(start) - std::int64_t(last_start_)));
+  put_varint(out_, zigzag(std::int64_t(end) - std::int64_t(start)));
+  put_varint(out_, std::uint64_t(match.sensitivity()));
+
+  std::uint64_t bits = 0;
+  const double probability = match.probability();
+  std::memcpy(&bits, &probability, sizeof(bits));
+  char bytes[8];
+  for (std::size_t i = 0; i < 8; ++i)
+    bytes[i] = static_cast<char>((bits >> (8 * i)) & 0xFF);
+  out_.append(bytes, sizeof(bytes));
+
+  put_string(out_, match.match());
+  last_start_ = start;
+  ++count_;
+}
+
+void BinaryRecord::finish() noexcept {
+  put_u32(out_, begin_, std::uint32_t(out_.size() - begin_ - 4));
+  put_u32(out_, begin_ + 4, count_);
+}
+
+std::optional<Record> read_record(std::string_view &data) noexcept {
+  Cursor header(data);
+  std::uint32_t length = 0;
+  if (!header.u32(length) || data.size() - 4 < length)
+    return std::nullopt;
+
+  Cursor cursor(data.substr(4, length));
+  Record record;
+  std::uint32_t count = 0;
+  if (!cursor.u32(count) || !cursor.string(record.path) ||
+      !cursor.string(record.rule))
+    return std::nullopt;
+
+  std::int64_t start = 0;
+  std::string match;
+  for (std::uint32_t i = 0; i < count; ++i) {
+    std::uint64_t delta = 0, size = 0, sensitivity = 0;
+    double probability = 0;
+    if (!cursor.varint(delta) || !cursor.varint(size) ||
+        !cursor.varint(sensitivity) || !cursor.f64(probability) ||
+        !cursor.string(match))
+      return std::nullopt;
+
+    start += unzigzag(delta);
+    const auto end = start + unzigzag(size);
+    if (start < 0 || end < 0)
+      return std::nullopt;
+
+    record.matches.emplace_back(std::move(match), std::size_t(start),
+                                std::size_t(end),
+                                static_cast<Sensitivity>(sensitivity),
+                                probability);
+  }
+
+  if (!cursor.done())
+    return std::nullopt;
+
+  data.remove_prefix(4 + std::size_t(length));
+  return record;
+}
+
+}; // namespace Serializer
+
+}; // namespace OS2DSRules
@@ -0,0 +1,89 @@
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include <stats.hpp>
+
+#include "thread_registry.hpp"
+
+namespace OS2DSRules {
+
+namespace Stats {
+
+ScanStats &ScanStats::operator+=(const ScanStats &other) noexcept {
+  scans += other.scans;
+  bytes_scanned += other.bytes_scanned;
+  state_transitions += other.state_transitions;
+  state_resets += other.state_resets;
+  candidate_tokens += other.candidate_tokens;
+  dictionary_probes += other.dictionary_probes;
+  dictionary_hits += other.dictionary_hits;
+  chain_links_walked += other.chain_links_walked;
+  blacklist_checks += other.blacklist_checks;
+  allocations += other.allocations;
+  return *this;
+}
+
+#ifdef OS2DSRULES_ENABLE_STATS
+
+namespace {
+
+ThreadRegistry<detail::CounterBlock> registry;
+
+thread_local std::size_t depth = 0;
+
+} // namespace
+
+namespace detail {
+
+CounterBlock &thread_counters() noexcept { return registry.local(); }
+
+std::size_t &scan_depth() noexcept { return depth; }
+
+} // namespace detail
+
+ScanStats snapshot() noexcept {
+  std::array<std::uint64_t, counter_count> totals{};
+
+  registry.for_each([&](const detail::CounterBlock &block) {
+    for (std::size_t i = 0; i < counter_count; ++i)
+      totals[i] += block.values[i].load(std::memory_order_relaxed);
+  });
+
+  const auto total = [&](Counter counter) {
+    return totals[static_cast<std::size_t>(counter)];
+  };
+
+  ScanStats stats;
+  stats.scans = total(Counter::Scans);
+  stats.bytes_scanned = total(Counter::BytesScanned);
+  stats.state_transitions = total(Counter::StateTransitions);
+  stats.state_resets = total(Counter::StateResets);
+  stats.candidate_tokens = total(Counter::CandidateTokens);
+  stats.dictionary_probes = total(Counter::DictionaryProbes);
+  stats.dictionary_hits = total(Counter::DictionaryHits);
+  stats.chain_links_walked = total(Counter::ChainLinksWalked);
+  stats.blacklist_checks = total(Counter::BlacklistChecks);
+  stats.allocations = total(Counter::Allocations);
+  return stats;
+}
+
+void reset() noexcept {
+  registry.for_each([](detail::CounterBlock &block) {
+    for (auto &value : block.values)
+      value.store(0, std::memory_order_relaxed);
+  });
+}
+
+#else
+
+ScanStats snapshot() noexcept { return {}; }
+
+void reset() noexcept {}
+
+#endif
+
+}; // namespace Stats
+
+}; // namespace OS2DSRules
@@ -0,0 +1,101 @@
+#ifndef THREAD_REGISTRY_HPP
+#define THREAD_REGISTRY_HPP
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace OS2DSRules {
+
+/*
+  A lock-free registry of per-thread blocks of counters.
+
+  Every thread gets a block of its own the first time it calls local(),
+  and only that thread writes to it. Blocks are pushed onto a list that
+  is never shrunk, so readers can walk it while other threads scan. When
+  a thread exits, its block is released and handed to the next thread
+  that asks for one, which keeps the counters of short-lived threads.
+
+  Blocks are allocated with malloc rather than operator new, so that a
+  replaced operator new may itself update counters in a block.
+ */
+template <typename Block> class ThreadRegistry {
+public:
+  constexpr ThreadRegistry() noexcept = default;
+  ThreadRegistry(const ThreadRegistry &) = delete;
+  ThreadRegistry &operator=(const ThreadRegistry &) = delete;
+
+  // The block of the calling thread.
+  [[nodiscard]] Block &local() noexcept {
+    thread_local Owner owner(*this);
+    return owner.node->block;
+  }
+
+  // Calls f with every block that has been handed out.
+  template <typename Function> void for_each(Function f) const noexcept {
+    for (auto *node = head_.load(std::memory_order_acquire); node != nullptr;
+         node = node->next) {
+      f(node->block);
+    }
+  }
+
+private:
+  struct Node {
+    Block block{};
+    std::atomic<bool> in_use{true};
+    Node *next = nullptr;
+  };
+
+  struct Owner {
+    explicit Owner(ThreadRegistry &registry) noexcept
+        : node(registry.claim()) {}
+    Owner(const Owner &) = delete;
+    Owner &operator=(const Owner &) = delete;
+    ~Owner() noexcept { node->in_use.store(false, std::memory_order_release); }
+
+    Node *node;
+  };
+
+  Node *claim() noexcept {
+    // Reuse a block that was released by a thread that has exited.
+    for (auto *node = head_.load(std::memory_order_acquire); node != nullptr;
+         node = node->next) {
+      bool expected = false;
+      if (node->in_use.compare_exchange_strong(expected, true,
+                                               std::memory_order_acquire))
+        return node;
+    }
+
+    void *memory = std::aligned_alloc(alignof(Node), round_up(sizeof(Node)));
+    if (memory == nullptr)
+      std::abort();
+
+    auto *node = ::new (memory) Node();
+    node->next = head_.load(std::memory_order_relaxed);
+    while (!head_.compare_exchange_weak(node->next, node,
+                                        std::memory_order_release,
+                                        std::memory_order_relaxed)) {
+    }
+
+    return node;
+  }
+
+  // aligned_alloc requires the size to be a multiple of the alignment.
+  static constexpr std::size_t round_up(std::size_t size) noexcept {
+    return (size + alignof(Node) - 1) / alignof(Node) * alignof(Node);
+  }
+
+  std::atomic<Node *> head_{nullptr};
+};
+
+// Adds n to a counter that only the calling thread writes to. A relaxed
+// load and store is enough and avoids a locked instruction.
+template <typename T>
+inline void add_relaxed(std::atomic<T> &counter, T n) noexcept {
+  counter.store(counter.load(std::memory_order_relaxed) + n,
+                std::memory_order_relaxed);
+}
+
+}; // namespace OS2DSRules
+
+#endif
@@ -1,28 +1,60 @@
 #include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <content_hash.hpp>
 #include <os2dsrules.hpp>
+#include <latency.hpp>
+#include <probes.hpp>
+#include <stats.hpp>
 #include <string_view>
 
 #include <wordlist_rule.hpp>
 
+#include "scan_limiter.hpp"
+
 namespace OS2DSRules {
 
 namespace WordListRule {
 
-void WordListRule::check_match(MatchResults &results,
+std::uint64_t WordListRule::hash_words(const Words &words) noexcept {
+  // The words are not ordered, so their hashes are summed.
+  std::uint64_t sum = 0;
+  for (const auto &word : words)
+    sum += ContentHash::hash128(word).low;
+
+  return ContentHash::combine(ContentHash::fnv1a("WordListRule/1"), sum);
+}
+
+bool WordListRule::check_match(MatchResults &results,
                                const std::string candidate,
                                const std::size_t start,
                                const std::size_t stop) const noexcept {
+  OS2DSRULES_STAT(CandidateTokens, 1);
+
   if (contains(candidate)) {
+    OS2DSRULES_PROBE3(match, "WordListRule", start, stop);
     results.push_back(MatchResult(candidate, start, stop));
+    return true;
   }
+
+  return false;
 }
 
 [[nodiscard]] MatchResults
-WordListRule::find_matches(const std::string &content) const noexcept {
+WordListRule::find_matches(std::string_view content) const noexcept {
+  return find_matches(content, ScanOptions()).matches;
+}
+
+[[nodiscard]] ScanResult
+WordListRule::find_matches(std::string_view content,
+                           const ScanOptions &options) const noexcept {
+  Stats::ScanScope scope(content.size());
+  Latency::ScanTimer timer(Latency::Rule::WordListRule, content.size());
+  OS2DSRULES_PROBE3(scan__start, "WordListRule", content.data(), content.size());
+  ScanLimiter limiter(options, content.size());
   MatchResults results;
 
-  std::string content_lower = content;
+  std::string content_lower(content.substr(0, limiter.limit()));
   std::transform(content_lower.begin(), content_lower.end(),
                  content_lower.begin(),
                  [](unsigned char ch) { return std::tolower(ch); });
@@ -31,22 +63,44 @@ WordListRule::find_matches(const std::string &content) const noexcept {
       make_predicate(' ', '\n', '.', ',', '\t', '!', '?');
 
   std::size_t start = 0;
+  std::size_t offset = content_lower.size();
   for (std::size_t i = 0; i < content_lower.size(); ++i) {
+    if (!limiter.proceed(i)) {
+      offset = start;
+      break;
+    }
+
     if (is_delimiter(content_lower[i])) {
-      check_match(results, content_lower.substr(start, i - start), start, i);
+      const bool found = check_match(
+          results, content_lower.substr(start, i - start), start, i);
       start = i + 1;
+
+      if (found && limiter.full(results.size())) {
+        offset = start;
+        break;
+      }
     }
   }
 
-  check_match(results, content_lower.substr(start), start,
-              content_lower.size() - 1);
+  // The last word may continue past the byte budget, or into the next piece.
+  if (limiter.cut(offset))
+    offset = std::min(offset, start);
+  else
+    (void)check_match(results, content_lower.substr(start), start,
+                      content_lower.size() - 1);
 
-  return results;
+  OS2DSRULES_PROBE3(scan__done, "WordListRule", content.size(), results.size());
+  return limiter.finish(std::move(results), offset);
 }
 
 [[nodiscard]] bool
 WordListRule::contains(const std::string_view target) const noexcept {
-  return words_.contains(target);
+  bool found = words_.contains(target);
+
+  OS2DSRULES_STAT(DictionaryProbes, 1);
+  OS2DSRULES_STAT(DictionaryHits, found);
+
+  return found;
 }
 
 [[nodiscard]] bool
@@ -55,8 +109,8 @@ WordListRule::contains(const std::string target) const noexcept {
 }
 
 [[nodiscard]] bool
-WordListRule::contains(const std::string::const_iterator start,
-                       const std::string::const_iterator stop) const noexcept {
+WordListRule::contains(const std::string_view::const_iterator start,
+                       const std::string_view::const_iterator stop) const noexcept {
   return contains(std::string_view(start, stop));
 }
 
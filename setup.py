@@ -4,48 +4,100 @@ from setuptools import Extension, setup
 
 CXX_FLAGS = ["/std:c++20"] if os.name == "nt" else ["-std=c++20", "-O3"]
 
+# Set OS2DSRULES_ENABLE_STATS=1 in the environment to compile in the
+# instrumentation counters returned by os2ds_rules.stats(). Allocations are
+# not counted, see include/stats_allocations.hpp.
+DEFINE_MACROS = ([("OS2DSRULES_ENABLE_STATS", "1")]
+                 if os.environ.get("OS2DSRULES_ENABLE_STATS") else [])
+
+# USDT probes are compiled in when <sys/sdt.h> is installed, unless
+# OS2DSRULES_ENABLE_PROBES=0 is set in the environment.
+if (os.environ.get("OS2DSRULES_ENABLE_PROBES", "1") != "0"
+        and os.path.exists("/usr/include/sys/sdt.h")):
+    DEFINE_MACROS.append(("OS2DSRULES_HAVE_SDT_H", "1"))
+
 CPR_SOURCES = (
     "src/os2ds_rules/cpr.cpp",
     "lib/cpr-detector.cpp",
+    "lib/aggregate.cpp",
+    "lib/content_hash.cpp",
+    "lib/encoding.cpp",
+    "lib/latency.cpp",
+    "lib/prescreen.cpp",
+    "lib/redact.cpp",
+    "lib/result_cache.cpp",
+    "lib/serializer.cpp",
+    "lib/stats.cpp",
     )
 
 NAMERULE_SOURCES = (
     "src/os2ds_rules/name_rule.cpp",
     "lib/name_rule.cpp",
+    "lib/aggregate.cpp",
+    "lib/content_hash.cpp",
+    "lib/encoding.cpp",
+    "lib/latency.cpp",
+    "lib/prescreen.cpp",
+    "lib/redact.cpp",
+    "lib/result_cache.cpp",
+    "lib/serializer.cpp",
+    "lib/stats.cpp",
     )
 
 ADDRESSRULE_SOURCES = (
     "src/os2ds_rules/address_rule.cpp",
     "lib/address_rule.cpp",
+    "lib/aggregate.cpp",
+    "lib/content_hash.cpp",
+    "lib/encoding.cpp",
+    "lib/latency.cpp",
+    "lib/prescreen.cpp",
+    "lib/redact.cpp",
+    "lib/result_cache.cpp",
+    "lib/serializer.cpp",
+    "lib/stats.cpp",
     )
 
 WORDLISTRULE_SOURCES = (
     "src/os2ds_rules/wordlist_rule.cpp",
     "lib/wordlist_rule.cpp",
+    "lib/aggregate.cpp",
+    "lib/content_hash.cpp",
+    "lib/encoding.cpp",
+    "lib/latency.cpp",
+    "lib/prescreen.cpp",
+    "lib/redact.cpp",
+    "lib/result_cache.cpp",
+    "lib/serializer.cpp",
+    "lib/stats.cpp",
     )
 
 cpr_detector = Extension(name="os2ds_rules.cpr_detector",
                          language="c++",
                          include_dirs=["include/"],
                          sources=[*CPR_SOURCES],
+                         define_macros=DEFINE_MACROS,
                          extra_compile_args=CXX_FLAGS)
 
 name_rule = Extension(name="os2ds_rules.name_rule",
                       language="c++",
                       include_dirs=["include/"],
                       sources=[*NAMERULE_SOURCES],
+                      define_macros=DEFINE_MACROS,
                       extra_compile_args=CXX_FLAGS)
 
 address_rule = Extension(name="os2ds_rules.address_rule",
                          language="c++",
                          include_dirs=["include/"],
                          sources=[*ADDRESSRULE_SOURCES],
+                         define_macros=DEFINE_MACROS,
                          extra_compile_args=CXX_FLAGS)
 
 wordlist_rule = Extension(name="os2ds_rules.wordlist_rule",
                           language="c++",
                           include_dirs=["include/"],
                           sources=[*WORDLISTRULE_SOURCES],
+                          define_macros=DEFINE_MACROS,
                           extra_compile_args=CXX_FLAGS)
 
 setup(
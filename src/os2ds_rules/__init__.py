@@ -1,31 +1,165 @@
-from .cpr_detector import find_matches as cpr_find_matches
-from .name_rule import find_matches as name_find_matches
-from .address_rule import find_matches as address_find_matches
+from .cpr_detector import CPRDetector as _CPRDetector
+from .name_rule import NameRule as _NameRule
+from .address_rule import AddressRule as _AddressRule
+from .wordlist_rule import WordListRule
+from . import cpr_detector as _cpr_detector
+from . import name_rule as _name_rule
+from . import address_rule as _address_rule
+from . import wordlist_rule as _wordlist_rule
 
+# Every extension module carries its own copy of the rules it wraps, and
+# therefore its own counters.
+_MODULES = (_cpr_detector, _name_rule, _address_rule, _wordlist_rule)
 
-class CPRDetector:
-    '''Drop-in replacement for CPRRule.'''
 
-    def __init__(self, check_mod11: bool = False, examine_context: bool = False):
-        self._check_mod11 = check_mod11
-        self._examine_context = examine_context
+class CPRDetector(_CPRDetector):
+    '''Drop-in replacement for CPRRule.
+
+    The configured detector is kept alive across calls to `find_matches`.'''
 
-    def find_matches(self, content: str):
-        yield from cpr_find_matches(content, self._check_mod11, self._examine_context)
+    def __init__(self, check_mod11: bool = False, examine_context: bool = False):
+        super().__init__(check_mod11, examine_context)
 
 
-class NameRule:
+class NameRule(_NameRule):
     '''Drop-in replacement for NameRule.'''
 
     def __init__(self, expansive: bool = False):
-            self._expansive = expansive
+        super().__init__(expansive)
 
-    def find_matches(self, content: str):
-        yield from name_find_matches(content, self._expansive)
 
-
-class AddressRule:
+class AddressRule(_AddressRule):
     '''Drop-in replacement for AddressRule.'''
 
-    def find_matches(self, content: str):
-        yield from address_find_matches(content)
+
+# The rules that declare pre-screen requirements, by their name in the
+# "rules" dict returned by prescreen().
+_SCREENED = ((_CPRDetector, "CPRDetector"), (_NameRule, "NameRule"),
+             (_AddressRule, "AddressRule"))
+
+
+def prescreen(content) -> dict:
+    '''Return the pre-screen features of a document.
+
+    The dict holds the size in bytes, the longest run of digits, the
+    number of tokens and capitalized tokens, their ratio, a histogram of
+    byte classes, and under "rules" whether each rule with requirements
+    can find anything in the document.'''
+    return _cpr_detector.prescreen(content)
+
+
+def plan(content, rules) -> list:
+    '''Return the rules worth running on a document.
+
+    Rules that cannot find anything in the document according to a
+    single pre-screen pass over it are left out. Rules without
+    requirements are always kept.'''
+    screen = prescreen(content)["rules"]
+
+    def runs(rule):
+        for kind, name in _SCREENED:
+            if isinstance(rule, kind):
+                return screen[name]
+        return True
+
+    return [rule for rule in rules if runs(rule)]
+
+
+def set_result_cache(capacity: int) -> None:
+    '''Cache the results of every rule for repeated content.
+
+    Scans without a timeout, byte_budget or max_matches look up their
+    results by a hash of the content and the rule configuration, and
+    large documents are cached in content-defined chunks, so that
+    near-duplicates reuse most of the work. The capacity in bytes is
+    split evenly between the rule modules. A capacity of 0 disables
+    the cache.'''
+    share = max(capacity // len(_MODULES), 1) if capacity > 0 else 0
+    for module in _MODULES:
+        module.set_result_cache(share)
+
+
+def result_cache_stats() -> dict:
+    '''Return the result cache counters summed over all rules.'''
+    total = {}
+    for module in _MODULES:
+        for key, value in module.result_cache_stats().items():
+            if key == "enabled":
+                total[key] = total.get(key, False) or value
+            else:
+                total[key] = total.get(key, 0) + value
+    lookups = total["hits"] + total["misses"]
+    total["hit_rate"] = total["hits"] / lookups if lookups else 0.0
+    return total
+
+
+def clear_result_cache() -> None:
+    '''Remove all entries from the result cache.'''
+    for module in _MODULES:
+        module.clear_result_cache()
+
+
+def stats() -> dict:
+    '''Return the instrumentation counters summed over all rules.
+
+    The counters are only collected when the extension was built with
+    OS2DSRULES_ENABLE_STATS=1; otherwise they are all zero and
+    `enabled` is False. Allocations are not counted by the extensions, as
+    that would mean replacing operator new for the whole interpreter.'''
+    total = {}
+    for module in _MODULES:
+        for key, value in module.stats().items():
+            if key == "enabled":
+                total[key] = value
+            else:
+                total[key] = total.get(key, 0) + value
+
+    probes = total["dictionary_probes"]
+    total["hit_rate"] = total["dictionary_hits"] / probes if probes else 0.0
+    total["average_chain_length"] = (
+        total["chain_links_walked"] / probes if probes else 0.0)
+    scans = total["scans"]
+    total["allocations_per_scan"] = (
+        total["allocations"] / scans if scans else 0.0)
+    return total
+
+
+def reset_stats() -> None:
+    '''Set the instrumentation counters of all rules to zero.'''
+    for module in _MODULES:
+        module.reset_stats()
+
+
+def latency() -> dict:
+    '''Return scan latency histograms as {rule: {size bucket: histogram}}.
+
+    Every histogram has count, mean, max and the p50, p99 and p999
+    percentiles in nanoseconds, and its non-empty buckets as a list of
+    (upper bound, count) pairs.'''
+    total = {}
+    for module in _MODULES:
+        for rule, sizes in module.latency().items():
+            total.setdefault(rule, {}).update(sizes)
+    return total
+
+
+def latency_text() -> str:
+    '''Return the scan latency percentiles of all rules as a table.'''
+    lines = []
+    for module in _MODULES:
+        header, *rows = module.latency_text().splitlines()
+        lines = lines or [header]
+        lines.extend(rows)
+    return "\n".join(lines) + "\n"
+
+
+def reset_latency() -> None:
+    '''Clear the scan latency histograms of all rules.'''
+    for module in _MODULES:
+        module.reset_latency()
+
+
+def set_latency_enabled(enabled: bool) -> None:
+    '''Turn recording of scan latencies on or off. It is on by default.'''
+    for module in _MODULES:
+        module.set_latency_enabled(enabled)
@@ -0,0 +1,1064 @@
+#ifndef OS2DS_RULES_COMMON_HPP
+#define OS2DS_RULES_COMMON_HPP
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <address_rule.hpp>
+#include <aggregate.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cpr-detector.hpp>
+#include <cstddef>
+#include <encoding.hpp>
+#include <name_rule.hpp>
+#include <os2dsrules.hpp>
+#include <latency.hpp>
+#include <memory>
+#include <prescreen.hpp>
+#include <redact.hpp>
+#include <result_cache.hpp>
+#include <serializer.hpp>
+#include <stats.hpp>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "offsets.hpp"
+
+/*
+  Helpers shared by the extension modules.
+
+  Every extension module is compiled separately, so everything in here
+  has internal linkage.
+ */
+namespace OS2DSRules {
+
+namespace Python {
+
+/*
+  A read-only view of the content passed to find_matches.
+
+  A str is scanned through its UTF-8 representation, which is cached by
+  the str itself, and any other object is scanned in place through the
+  buffer protocol (bytes, bytearray, memoryview, mmap, ...). The memory
+  stays valid without the GIL, since the caller holds a reference to the
+  object and an exported buffer cannot be resized or closed.
+
+  Must be constructed and destroyed while holding the GIL.
+ */
+class ContentView {
+public:
+  ContentView() noexcept = default;
+  ContentView(const ContentView &) = delete;
+  ContentView &operator=(const ContentView &) = delete;
+
+  ~ContentView() noexcept {
+    if (buffer_.obj != NULL)
+      PyBuffer_Release(&buffer_);
+  }
+
+  /*
+    Acquires the content. Returns false with a Python exception set on
+    failure.
+   */
+  bool acquire(PyObject *content) noexcept {
+    if (PyUnicode_Check(content)) {
+      Py_ssize_t size = 0;
+      data_ = PyUnicode_AsUTF8AndSize(content, &size);
+      size_ = static_cast<std::size_t>(size);
+      // Byte and code point offsets only differ for non-ASCII text.
+      code_point_offsets_ = !PyUnicode_IS_ASCII(content);
+      return data_ != NULL;
+    }
+
+    if (!PyObject_CheckBuffer(content)) {
+      PyErr_Format(PyExc_TypeError,
+                   "content must be str or a bytes-like object, not %.100s",
+                   Py_TYPE(content)->tp_name);
+      return false;
+    }
+
+    if (PyObject_GetBuffer(content, &buffer_, PyBUF_SIMPLE) < 0)
+      return false;
+
+    data_ = static_cast<const char *>(buffer_.buf);
+    size_ = static_cast<std::size_t>(buffer_.len);
+    return true;
+  }
+
+  [[nodiscard]] std::string_view text() const noexcept {
+    return std::string_view(data_, size_);
+  }
+
+  /*
+    Whether offsets into text() must be translated to code points for the
+    caller, which is the case for a str that is not pure ASCII.
+   */
+  [[nodiscard]] bool code_point_offsets() const noexcept {
+    return code_point_offsets_;
+  }
+
+private:
+  Py_buffer buffer_ = {};
+  const char *data_ = nullptr;
+  std::size_t size_ = 0;
+  bool code_point_offsets_ = false;
+};
+
+/*
+  The results of a scan in a columnar layout.
+
+  The columns are filled in while the GIL is released, so that the only
+  work left for the Python side is wrapping this in a PyMatchResults.
+ */
+struct ResultColumns {
+  explicit ResultColumns(ScanResult &&scan) noexcept
+      : results(std::move(scan.matches)), offset(Py_ssize_t(scan.offset)),
+        truncated(scan.truncated), reason(scan.reason) {
+    starts.reserve(results.size());
+    ends.reserve(results.size());
+    probabilities.reserve(results.size());
+
+    for (const auto &res : results) {
+      starts.push_back(Py_ssize_t(res.start()));
+      ends.push_back(Py_ssize_t(res.end()));
+      probabilities.push_back(res.probability());
+    }
+  }
+
+  /*
+    Translates the starts and ends and the offset from byte offsets into
+    text to code point offsets.
+   */
+  void translate_to_code_points(std::string_view text) noexcept {
+    CodePointIndex index(text);
+    for (std::size_t i = 0; i < results.size(); ++i) {
+      starts[i] = Py_ssize_t(index.translate(results[i].start()));
+      ends[i] = Py_ssize_t(index.translate(results[i].end()));
+    }
+    offset = Py_ssize_t(index.translate(std::size_t(offset)));
+  }
+
+  MatchResults results;
+  std::vector<Py_ssize_t> starts;
+  std::vector<Py_ssize_t> ends;
+  std::vector<double> probabilities;
+  Py_ssize_t offset;
+  bool truncated;
+  StopReason reason;
+};
+
+/*
+  A read-only sequence of matches backed by a ResultColumns.
+
+  Indexing creates the dict for a single match on demand, and the
+  starts, ends and probabilities are exposed as memoryviews without
+  creating any Python objects per match.
+ */
+typedef struct {
+  PyObject_HEAD ResultColumns *columns;
+} PyMatchResults;
+
+/*
+  A single column of a PyMatchResults, exported through the buffer
+  protocol. It keeps the PyMatchResults alive while it is referenced.
+ */
+typedef struct {
+  PyObject_HEAD PyObject *owner;
+  void *data;
+  Py_ssize_t length;
+  Py_ssize_t itemsize;
+  char *format;
+} PyMatchColumn;
+
+static void PyMatchResults_dealloc(PyMatchResults *self) {
+  delete self->columns;
+  Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static Py_ssize_t PyMatchResults_length(PyMatchResults *self) {
+  return Py_ssize_t(self->columns->results.size());
+}
+
+static PyObject *PyMatchResults_item(PyMatchResults *self, Py_ssize_t i) {
+  if (i < 0 || i >= PyMatchResults_length(self)) {
+    PyErr_SetString(PyExc_IndexError, "MatchResults index out of range");
+    return NULL;
+  }
+
+  // Content passed through the buffer protocol is not necessarily valid
+  // UTF-8, so undecodable bytes are kept as surrogates.
+  const auto &match = self->columns->results[std::size_t(i)].match();
+  PyObject *match_string = PyUnicode_DecodeUTF8(
+      match.data(), Py_ssize_t(match.size()), "surrogateescape");
+  if (match_string == NULL)
+    return NULL;
+
+  return Py_BuildValue("{s:N, s:n, s:n, s:d}", "match", match_string, "start",
+                       self->columns->starts[std::size_t(i)], "end",
+                       self->columns->ends[std::size_t(i)], "probability",
+                       self->columns->probabilities[std::size_t(i)]);
+}
+
+static PyObject *PyMatchResults_repr(PyMatchResults *self) {
+  if (self->columns->truncated)
+    return PyUnicode_FromFormat(
+        "<MatchResults with %zd matches, truncated at %zd>",
+        PyMatchResults_length(self), self->columns->offset);
+
+  return PyUnicode_FromFormat("<MatchResults with %zd matches>",
+                              PyMatchResults_length(self));
+}
+
+static PyObject *PyMatchResults_tolist(PyMatchResults *self,
+                                       PyObject *Py_UNUSED(ignored)) {
+  Py_ssize_t len = PyMatchResults_length(self);
+
+  PyObject *list_of_results = PyList_New(len);
+  if (list_of_results == NULL)
+    return NULL;
+
+  for (Py_ssize_t i = 0; i < len; ++i) {
+    PyObject *obj = PyMatchResults_item(self, i);
+    if (obj == NULL) {
+      Py_DECREF(list_of_results);
+      return NULL;
+    }
+    PyList_SET_ITEM(list_of_results, i, obj);
+  }
+
+  return list_of_results;
+}
+
+/*
+  Serializes the matches with a Serializer, with the GIL released. The
+  offsets written are those of the starts and ends columns.
+ */
+template <typename Writer>
+static PyObject *PyMatchResults_serialize(PyMatchResults *self,
+                                          PyObject *args, PyObject *kwargs) {
+  static const char *keywords[] = {"path", "rule", NULL};
+  const char *path = NULL, *rule = NULL;
+  Py_ssize_t path_size = 0, rule_size = 0;
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|$z#z#",
+                                   const_cast<char **>(keywords), &path,
+                                   &path_size, &rule, &rule_size))
+    return NULL;
+
+  const Serializer::Fields fields = {
+      .path = path ? std::string_view(path, std::size_t(path_size))
+                   : std::string_view(),
+      .rule = rule ? std::string_view(rule, std::size_t(rule_size))
+                   : std::string_view(),
+  };
+  const ResultColumns &columns = *self->columns;
+  std::string out;
+
+  Py_BEGIN_ALLOW_THREADS;
+  Writer writer(out, fields);
+  for (std::size_t i = 0; i < columns.results.size(); ++i)
+    writer.add(columns.results[i], std::size_t(columns.starts[i]),
+               std::size_t(columns.ends[i]));
+  if constexpr (std::is_same_v<Writer, Serializer::BinaryRecord>)
+    writer.finish();
+  Py_END_ALLOW_THREADS;
+
+  return PyBytes_FromStringAndSize(out.data(), Py_ssize_t(out.size()));
+}
+
+static void PyMatchColumn_dealloc(PyMatchColumn *self) {
+  Py_XDECREF(self->owner);
+  Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static int PyMatchColumn_getbuffer(PyMatchColumn *self, Py_buffer *view,
+                                   int flags) {
+  if (flags & PyBUF_WRITABLE) {
+    PyErr_SetString(PyExc_BufferError, "MatchResults columns are read-only");
+    view->obj = NULL;
+    return -1;
+  }
+
+  view->buf = self->data;
+  view->obj = (PyObject *)self;
+  Py_INCREF(self);
+  view->len = self->length * self->itemsize;
+  view->readonly = 1;
+  view->itemsize = self->itemsize;
+  view->format = (flags & PyBUF_FORMAT) ? self->format : NULL;
+  view->ndim = 1;
+  view->shape = (flags & PyBUF_ND) ? &self->length : NULL;
+  view->strides = (flags & PyBUF_STRIDES) ? &self->itemsize : NULL;
+  view->suboffsets = NULL;
+  view->internal = NULL;
+  return 0;
+}
+
+static PyBufferProcs PyMatchColumn_as_buffer = {
+    (getbufferproc)PyMatchColumn_getbuffer, /* bf_getbuffer */
+    0,                                      /* bf_releasebuffer */
+};
+
+static PyTypeObject PyMatchColumnType = {
+    PyVarObject_HEAD_INIT(NULL, 0) "os2ds_rules.MatchColumn", /* tp_name */
+    sizeof(PyMatchColumn),              /* tp_basicsize */
+    0,                                  /* tp_itemsize */
+    (destructor)PyMatchColumn_dealloc,  /* tp_dealloc */
+    0,                                  /* tp_vectorcall_offset */
+    0,                                  /* tp_getattr */
+    0,                                  /* tp_setattr */
+    0,                                  /* tp_as_async */
+    0,                                  /* tp_repr */
+    0,                                  /* tp_as_number */
+    0,                                  /* tp_as_sequence */
+    0,                                  /* tp_as_mapping */
+    0,                                  /* tp_hash */
+    0,                                  /* tp_call */
+    0,                                  /* tp_str */
+    0,                                  /* tp_getattro */
+    0,                                  /* tp_setattro */
+    &PyMatchColumn_as_buffer,           /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT,                 /* tp_flags */
+    PyDoc_STR("A column of MatchResults"), /* tp_doc */
+};
+
+static PyObject *make_column(PyMatchResults *owner, void *data,
+                             Py_ssize_t itemsize, const char *format) {
+  PyMatchColumn *column = PyObject_New(PyMatchColumn, &PyMatchColumnType);
+  if (column == NULL)
+    return NULL;
+
+  Py_INCREF(owner);
+  column->owner = (PyObject *)owner;
+  column->data = data;
+  column->length = PyMatchResults_length(owner);
+  column->itemsize = itemsize;
+  column->format = const_cast<char *>(format);
+
+  PyObject *view = PyMemoryView_FromObject((PyObject *)column);
+  Py_DECREF(column);
+  return view;
+}
+
+static PyObject *PyMatchResults_get_starts(PyMatchResults *self,
+                                           void *Py_UNUSED(closure)) {
+  return make_column(self, self->columns->starts.data(), sizeof(Py_ssize_t),
+                     "n");
+}
+
+static PyObject *PyMatchResults_get_ends(PyMatchResults *self,
+                                         void *Py_UNUSED(closure)) {
+  return make_column(self, self->columns->ends.data(), sizeof(Py_ssize_t),
+                     "n");
+}
+
+static PyObject *PyMatchResults_get_probabilities(PyMatchResults *self,
+                                                  void *Py_UNUSED(closure)) {
+  return make_column(self, self->columns->probabilities.data(),
+                     sizeof(double), "d");
+}
+
+static PyObject *PyMatchResults_get_truncated(PyMatchResults *self,
+                                              void *Py_UNUSED(closure)) {
+  return PyBool_FromLong(self->columns->truncated);
+}
+
+static PyObject *PyMatchResults_get_offset(PyMatchResults *self,
+                                           void *Py_UNUSED(closure)) {
+  return PyLong_FromSsize_t(self->columns->offset);
+}
+
+static PyObject *PyMatchResults_get_stop_reason(PyMatchResults *self,
+                                                void *Py_UNUSED(closure)) {
+  switch (self->columns->reason) {
+  case StopReason::Deadline:
+    return PyUnicode_FromString("deadline");
+  case StopReason::ByteBudget:
+    return PyUnicode_FromString("byte_budget");
+  case StopReason::MaxMatches:
+    return PyUnicode_FromString("max_matches");
+  default:
+    return PyUnicode_FromString("completed");
+  }
+}
+
+static PyGetSetDef PyMatchResults_getset[] = {
+    {"starts", (getter)PyMatchResults_get_starts, NULL,
+     "Start offsets of the matches as a memoryview.", NULL},
+    {"ends", (getter)PyMatchResults_get_ends, NULL,
+     "End offsets of the matches as a memoryview.", NULL},
+    {"probabilities", (getter)PyMatchResults_get_probabilities, NULL,
+     "Probabilities of the matches as a memoryview.", NULL},
+    {"truncated", (getter)PyMatchResults_get_truncated, NULL,
+     "Whether the scan stopped before the end of the content.", NULL},
+    {"offset", (getter)PyMatchResults_get_offset, NULL,
+     "Offset up to which the content has been scanned completely.", NULL},
+    {"stop_reason", (getter)PyMatchResults_get_stop_reason, NULL,
+     "Why the scan stopped: completed, deadline, byte_budget or max_matches.",
+     NULL},
+    {NULL} /* Sentinel */
+};
+
+static PyMethodDef PyMatchResults_methods[] = {
+    {"tolist", (PyCFunction)PyMatchResults_tolist, METH_NOARGS,
+     "Return the matches as a list of dicts."},
+    {"tojsonl",
+     (PyCFunction)(void (*)(void))
+         PyMatchResults_serialize<Serializer::JsonLines>,
+     METH_VARARGS | METH_KEYWORDS,
+     "tojsonl(*, path=None, rule=None)\n--\n\n"
+     "Return the matches as JSON Lines, a JSON object per line, in bytes.\n"
+     "The path and rule are included in every line if given."},
+    {"tobinary",
+     (PyCFunction)(void (*)(void))
+         PyMatchResults_serialize<Serializer::BinaryRecord>,
+     METH_VARARGS | METH_KEYWORDS,
+     "tobinary(*, path=None, rule=None)\n--\n\n"
+     "Return the matches as a single record of the compact binary format\n"
+     "of the Serializer, in bytes."},
+    {NULL} /* Sentinel */
+};
+
+static PySequenceMethods PyMatchResults_as_sequence = {
+    (lenfunc)PyMatchResults_length,    /* sq_length */
+    0,                                 /* sq_concat */
+    0,                                 /* sq_repeat */
+    (ssizeargfunc)PyMatchResults_item, /* sq_item */
+};
+
+static PyTypeObject PyMatchResultsType = {
+    PyVarObject_HEAD_INIT(NULL, 0) "os2ds_rules.MatchResults", /* tp_name */
+    sizeof(PyMatchResults),              /* tp_basicsize */
+    0,                                   /* tp_itemsize */
+    (destructor)PyMatchResults_dealloc,  /* tp_dealloc */
+    0,                                   /* tp_vectorcall_offset */
+    0,                                   /* tp_getattr */
+    0,                                   /* tp_setattr */
+    0,                                   /* tp_as_async */
+    (reprfunc)PyMatchResults_repr,       /* tp_repr */
+    0,                                   /* tp_as_number */
+    &PyMatchResults_as_sequence,         /* tp_as_sequence */
+    0,                                   /* tp_as_mapping */
+    0,                                   /* tp_hash */
+    0,                                   /* tp_call */
+    0,                                   /* tp_str */
+    0,                                   /* tp_getattro */
+    0,                                   /* tp_setattro */
+    0,                                   /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT,                  /* tp_flags */
+    PyDoc_STR("Matches found by a rule"), /* tp_doc */
+    0,                                   /* tp_traverse */
+    0,                                   /* tp_clear */
+    0,                                   /* tp_richcompare */
+    0,                                   /* tp_weaklistoffset */
+    0,                                   /* tp_iter */
+    0,                                   /* tp_iternext */
+    PyMatchResults_methods,              /* tp_methods */
+    0,                                   /* tp_members */
+    PyMatchResults_getset,               /* tp_getset */
+};
+
+/*
+  Wraps the columns in a PyMatchResults, which takes ownership of them.
+  Requires the GIL.
+ */
+static PyObject *make_match_results(ResultColumns *columns) {
+  PyMatchResults *self = PyObject_New(PyMatchResults, &PyMatchResultsType);
+  if (self == NULL) {
+    delete columns;
+    return NULL;
+  }
+
+  self->columns = columns;
+  return (PyObject *)self;
+}
+
+/*
+  Readies the result types and adds MatchResults to a module.
+ */
+static int add_result_types(PyObject *module) {
+  if (PyType_Ready(&PyMatchColumnType) < 0 ||
+      PyType_Ready(&PyMatchResultsType) < 0)
+    return -1;
+
+  Py_INCREF(&PyMatchResultsType);
+  if (PyModule_AddObject(module, "MatchResults",
+                         (PyObject *)&PyMatchResultsType) < 0) {
+    Py_DECREF(&PyMatchResultsType);
+    return -1;
+  }
+
+  return 0;
+}
+
+/*
+  The result cache of this module, if enabled. It is only replaced while
+  holding the GIL, and every scan keeps a reference to the cache it uses
+  while the GIL is released.
+ */
+static std::shared_ptr<ResultCache::ResultCache> result_cache;
+
+/*
+  Runs rule.find_matches on content with the GIL released.
+
+  The content is scanned in place, so the scan never touches Python
+  objects. Offsets into a str are reported in code points, and offsets
+  into any other object in bytes. Only the MatchResults object itself is
+  created once the GIL has been reacquired.
+
+  Unbounded scans go through the result cache when it is enabled.
+
+  Bytes-like content in another encoding than UTF-8 is scanned without
+  transcoding it first, and offsets are reported in its code units. Such
+  scans are unbounded, and bypass the cache.
+ */
+template <typename Rule>
+static PyObject *
+find_matches_without_gil(Rule &rule, PyObject *content,
+                         const ScanOptions &options,
+                         Encoding::Encoding encoding = Encoding::Encoding::UTF8) {
+  const bool bounded = options.deadline ||
+                       options.byte_budget != ScanOptions::unlimited ||
+                       options.max_matches != ScanOptions::unlimited;
+  const bool encoded = encoding != Encoding::Encoding::UTF8;
+
+  if (encoded && PyUnicode_Check(content)) {
+    PyErr_SetString(PyExc_TypeError,
+                    "encoding only applies to bytes-like content");
+    return NULL;
+  }
+
+  if (encoded && bounded) {
+    PyErr_SetString(PyExc_ValueError,
+                    "encoding cannot be combined with timeout, byte_budget "
+                    "or max_matches");
+    return NULL;
+  }
+
+  ContentView view;
+  if (!view.acquire(content))
+    return NULL;
+
+  std::string_view text = view.text();
+  const bool code_point_offsets = view.code_point_offsets();
+  ResultColumns *columns = nullptr;
+
+  auto cache = bounded || encoded ? nullptr : result_cache;
+
+  Py_BEGIN_ALLOW_THREADS
+  if (encoded)
+    columns = new ResultColumns(
+        ScanResult{Encoding::find_matches(rule, text, encoding),
+                   text.size() / Encoding::unit_size(encoding)});
+  else if (cache)
+    columns = new ResultColumns(
+        ScanResult{cache->find_matches_chunked(rule, text), text.size()});
+  else
+    columns = new ResultColumns(rule.find_matches(text, options));
+  if (code_point_offsets)
+    columns->translate_to_code_points(text);
+  Py_END_ALLOW_THREADS
+
+  return make_match_results(columns);
+}
+
+/*
+  Runs a redact(content, *, policy="fixed", fill="*", tag=None) method of
+  rule, named name, with the GIL released. Returns a str for a str, and
+  bytes for any other content.
+ */
+template <typename Rule>
+static PyObject *redact_without_gil(Rule &rule, const char *name,
+                                    PyObject *args, PyObject *kwargs) {
+  static const char *keywords[] = {"content", "policy", "fill", "tag", NULL};
+  PyObject *content = NULL;
+  const char *policy = "fixed";
+  int fill = '*';
+  const char *tag = NULL;
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|$sCz",
+                                   const_cast<char **>(keywords), &content,
+                                   &policy, &fill, &tag))
+    return NULL;
+
+  Redact::Mask mask;
+  const std::string_view policy_name(policy);
+  if (policy_name == "fixed") {
+    mask.policy = Redact::Policy::Fixed;
+  } else if (policy_name == "keep_last4") {
+    mask.policy = Redact::Policy::KeepLast4;
+  } else if (policy_name == "tag") {
+    mask.policy = Redact::Policy::Tag;
+  } else {
+    PyErr_Format(PyExc_ValueError,
+                 "policy must be one of 'fixed', 'keep_last4' or 'tag', "
+                 "not '%s'",
+                 policy);
+    return NULL;
+  }
+
+  if (fill >= 0x80) {
+    PyErr_SetString(PyExc_ValueError, "fill must be an ASCII character");
+    return NULL;
+  }
+  mask.fill = static_cast<char>(fill);
+  if (tag != NULL)
+    mask.tag = tag;
+
+  ContentView view;
+  if (!view.acquire(content))
+    return NULL;
+
+  Redact::Redactor redactor;
+  redactor.add_ref(name, rule, std::move(mask));
+  std::string out;
+
+  Py_BEGIN_ALLOW_THREADS;
+  out = redactor.redact(view.text());
+  Py_END_ALLOW_THREADS;
+
+  if (PyUnicode_Check(content))
+    return PyUnicode_DecodeUTF8(out.data(), Py_ssize_t(out.size()),
+                                "surrogateescape");
+  return PyBytes_FromStringAndSize(out.data(), Py_ssize_t(out.size()));
+}
+
+/*
+  Runs a find_unique(content, *, offsets=False) method of rule with the
+  GIL released. Returns a list of dicts with the match, its count, and
+  with offsets its first and last start, in the order of their first
+  occurrence.
+ */
+template <typename Rule>
+static PyObject *find_unique_without_gil(Rule &rule, PyObject *args,
+                                         PyObject *kwargs) {
+  static const char *keywords[] = {"content", "offsets", NULL};
+  PyObject *content = NULL;
+  int offsets = 0;
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|$p",
+                                   const_cast<char **>(keywords), &content,
+                                   &offsets))
+    return NULL;
+
+  ContentView view;
+  if (!view.acquire(content))
+    return NULL;
+
+  std::vector<Aggregate::Unique> unique;
+  const std::string_view text = view.text();
+  const bool code_point_offsets = offsets && view.code_point_offsets();
+
+  Py_BEGIN_ALLOW_THREADS;
+  unique = Aggregate::find_unique(rule, text);
+  if (code_point_offsets) {
+    CodePointIndex index(text);
+    for (auto &u : unique) {
+      u.first = index.translate(u.first);
+      u.last = index.translate(u.last);
+    }
+  }
+  Py_END_ALLOW_THREADS;
+
+  PyObject *list = PyList_New(Py_ssize_t(unique.size()));
+  if (list == NULL)
+    return NULL;
+
+  for (std::size_t i = 0; i < unique.size(); ++i) {
+    const auto &u = unique[i];
+    PyObject *match = PyUnicode_DecodeUTF8(
+        u.match.data(), Py_ssize_t(u.match.size()), "surrogateescape");
+    PyObject *item = NULL;
+    if (match != NULL && offsets)
+      item = Py_BuildValue("{s:N, s:n, s:n, s:n, s:i, s:d}", "match", match,
+                           "count", Py_ssize_t(u.count), "first",
+                           Py_ssize_t(u.first), "last", Py_ssize_t(u.last),
+                           "sensitivity", static_cast<int>(u.sensitivity),
+                           "probability", u.probability);
+    else if (match != NULL)
+      item = Py_BuildValue("{s:N, s:n, s:i, s:d}", "match", match, "count",
+                           Py_ssize_t(u.count), "sensitivity",
+                           static_cast<int>(u.sensitivity), "probability",
+                           u.probability);
+    if (item == NULL) {
+      Py_DECREF(list);
+      return NULL;
+    }
+    PyList_SET_ITEM(list, Py_ssize_t(i), item);
+  }
+  return list;
+}
+
+/*
+  Reads an optional, non-negative integer keyword argument into value.
+  None leaves it unlimited.
+ */
+static bool parse_limit(PyObject *arg, const char *name, std::size_t &value) {
+  if (arg == Py_None)
+    return true;
+
+  const Py_ssize_t limit = PyNumber_AsSsize_t(arg, PyExc_OverflowError);
+  if (limit == -1 && PyErr_Occurred())
+    return false;
+
+  if (limit < 0) {
+    PyErr_Format(PyExc_ValueError, "%s must not be negative", name);
+    return false;
+  }
+
+  value = std::size_t(limit);
+  return true;
+}
+
+/*
+  Parses the arguments of a METH_FASTCALL | METH_KEYWORDS find_matches
+  method: the content, the keyword-only limits timeout (in seconds),
+  byte_budget and max_matches, and the keyword-only encoding of
+  bytes-like content. The deadline is set from the timeout right away,
+  so it includes the time spent waiting for the GIL.
+ */
+static bool parse_find_matches_args(Py_ssize_t nargs, PyObject *const *args,
+                                    PyObject *kwnames, ScanOptions &options,
+                                    Encoding::Encoding &encoding) {
+  if (nargs != 1) {
+    PyErr_Format(PyExc_TypeError,
+                 "find_matches() takes exactly one positional argument "
+                 "(%zd given)",
+                 nargs);
+    return false;
+  }
+
+  const Py_ssize_t nkw = kwnames == NULL ? 0 : PyTuple_GET_SIZE(kwnames);
+  for (Py_ssize_t i = 0; i < nkw; ++i) {
+    PyObject *name = PyTuple_GET_ITEM(kwnames, i);
+    PyObject *value = args[nargs + i];
+
+    if (PyUnicode_CompareWithASCIIString(name, "timeout") == 0) {
+      if (value == Py_None)
+        continue;
+
+      const double seconds = PyFloat_AsDouble(value);
+      if (seconds == -1.0 && PyErr_Occurred())
+        return false;
+
+      const std::chrono::duration<double> timeout(std::max(seconds, 0.0));
+      options.deadline =
+          ScanOptions::Clock::now() +
+          std::chrono::duration_cast<ScanOptions::Clock::duration>(timeout);
+    } else if (PyUnicode_CompareWithASCIIString(name, "byte_budget") == 0) {
+      if (!parse_limit(value, "byte_budget", options.byte_budget))
+        return false;
+    } else if (PyUnicode_CompareWithASCIIString(name, "max_matches") == 0) {
+      if (!parse_limit(value, "max_matches", options.max_matches))
+        return false;
+    } else if (PyUnicode_CompareWithASCIIString(name, "encoding") == 0) {
+      if (value == Py_None)
+        continue;
+
+      const char *value_name = PyUnicode_Check(value) ? PyUnicode_AsUTF8(value)
+                                                      : NULL;
+      if (value_name == NULL && PyErr_Occurred())
+        return false;
+
+      const auto parsed = value_name == NULL
+                              ? std::nullopt
+                              : Encoding::parse(value_name);
+      if (!parsed) {
+        PyErr_Format(PyExc_ValueError,
+                     "encoding must be one of 'utf-8', 'utf-16-le', "
+                     "'latin-1' or 'cp1252', not %R",
+                     value);
+        return false;
+      }
+      encoding = parsed.value();
+    } else {
+      PyErr_Format(PyExc_TypeError,
+                   "find_matches() got an unexpected keyword argument '%U'",
+                   name);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/*
+  stats() returns the instrumentation counters of the rules compiled into
+  this module as a dict. The counters are all zero unless the extension
+  was built with OS2DSRULES_ENABLE_STATS.
+ */
+static PyObject *module_stats(PyObject *self, PyObject *args) {
+  const auto stats = OS2DSRules::Stats::snapshot();
+
+  return Py_BuildValue(
+      "{s:O, s:K, s:K, s:K, s:K, s:K, s:K, s:K, s:K, s:K, s:K}", "enabled",
+      OS2DSRules::Stats::enabled ? Py_True : Py_False, "scans",
+      (unsigned long long)stats.scans, "bytes_scanned",
+      (unsigned long long)stats.bytes_scanned, "state_transitions",
+      (unsigned long long)stats.state_transitions, "state_resets",
+      (unsigned long long)stats.state_resets, "candidate_tokens",
+      (unsigned long long)stats.candidate_tokens, "dictionary_probes",
+      (unsigned long long)stats.dictionary_probes, "dictionary_hits",
+      (unsigned long long)stats.dictionary_hits, "chain_links_walked",
+      (unsigned long long)stats.chain_links_walked, "blacklist_checks",
+      (unsigned long long)stats.blacklist_checks, "allocations",
+      (unsigned long long)stats.allocations);
+}
+
+static PyObject *module_reset_stats(PyObject *self, PyObject *args) {
+  OS2DSRules::Stats::reset();
+  Py_RETURN_NONE;
+}
+
+/*
+  Builds the dict for one histogram, with durations in nanoseconds. The
+  non-empty buckets are included as (upper bound, count) pairs, so
+  histograms from several processes can be merged.
+ */
+static PyObject *histogram_to_dict(const OS2DSRules::Latency::Histogram &h) {
+  using OS2DSRules::Latency::Histogram;
+
+  PyObject *buckets = PyList_New(0);
+  if (buckets == NULL)
+    return NULL;
+
+  for (std::size_t i = 0; i < Histogram::bucket_count; ++i) {
+    if (h.buckets()[i] == 0)
+      continue;
+
+    PyObject *pair =
+        Py_BuildValue("(KK)", (unsigned long long)Histogram::bucket_upper_bound(i),
+                      (unsigned long long)h.buckets()[i]);
+    if (pair == NULL || PyList_Append(buckets, pair) < 0) {
+      Py_XDECREF(pair);
+      Py_DECREF(buckets);
+      return NULL;
+    }
+    Py_DECREF(pair);
+  }
+
+  return Py_BuildValue(
+      "{s:K, s:d, s:K, s:K, s:K, s:K, s:N}", "count",
+      (unsigned long long)h.count(), "mean", h.mean(), "max",
+      (unsigned long long)h.max(), "p50",
+      (unsigned long long)h.percentile(0.5), "p99",
+      (unsigned long long)h.percentile(0.99), "p999",
+      (unsigned long long)h.percentile(0.999), "buckets", buckets);
+}
+
+/*
+  latency() returns the scan latency histograms of the rules compiled
+  into this module, as {rule: {size bucket: histogram}}. Only rules and
+  size buckets with recorded scans are included.
+ */
+static PyObject *module_latency(PyObject *self, PyObject *args) {
+  namespace Latency = OS2DSRules::Latency;
+  const auto snapshot = Latency::snapshot();
+
+  PyObject *result = PyDict_New();
+  if (result == NULL)
+    return NULL;
+
+  for (std::size_t r = 0; r < Latency::rule_count; ++r) {
+    const auto rule = static_cast<Latency::Rule>(r);
+    PyObject *sizes = NULL;
+
+    for (std::size_t s = 0; s < Latency::size_bucket_count; ++s) {
+      const auto size = static_cast<Latency::SizeBucket>(s);
+      const auto &histogram = snapshot.at(rule, size);
+      if (histogram.count() == 0)
+        continue;
+
+      if (sizes == NULL) {
+        sizes = PyDict_New();
+        if (sizes == NULL ||
+            PyDict_SetItemString(result, Latency::rule_name(rule).data(),
+                                 sizes) < 0) {
+          Py_XDECREF(sizes);
+          Py_DECREF(result);
+          return NULL;
+        }
+        Py_DECREF(sizes);
+      }
+
+      PyObject *entry = histogram_to_dict(histogram);
+      if (entry == NULL ||
+          PyDict_SetItemString(sizes, Latency::size_bucket_name(size).data(),
+                               entry) < 0) {
+        Py_XDECREF(entry);
+        Py_DECREF(result);
+        return NULL;
+      }
+      Py_DECREF(entry);
+    }
+  }
+
+  return result;
+}
+
+static PyObject *module_latency_text(PyObject *self, PyObject *args) {
+  const auto text = OS2DSRules::Latency::snapshot().to_text();
+  return PyUnicode_FromStringAndSize(text.data(), Py_ssize_t(text.size()));
+}
+
+static PyObject *module_reset_latency(PyObject *self, PyObject *args) {
+  OS2DSRules::Latency::reset();
+  Py_RETURN_NONE;
+}
+
+static PyObject *module_set_latency_enabled(PyObject *self, PyObject *arg) {
+  const int enabled = PyObject_IsTrue(arg);
+  if (enabled < 0)
+    return NULL;
+
+  OS2DSRules::Latency::set_enabled(enabled != 0);
+  Py_RETURN_NONE;
+}
+
+static PyMethodDef instrumentation_methods[] = {
+    {"stats", module_stats, METH_NOARGS,
+     "Return the instrumentation counters as a dict."},
+    {"reset_stats", module_reset_stats, METH_NOARGS,
+     "Set the instrumentation counters to zero."},
+    {"latency", module_latency, METH_NOARGS,
+     "Return the scan latency histograms as a dict."},
+    {"latency_text", module_latency_text, METH_NOARGS,
+     "Return the scan latency percentiles as a table."},
+    {"reset_latency", module_reset_latency, METH_NOARGS,
+     "Clear the scan latency histograms."},
+    {"set_latency_enabled", module_set_latency_enabled, METH_O,
+     "Turn recording of scan latencies on or off."},
+    {NULL, NULL, 0, NULL} /* Sentinel */
+};
+
+/*
+  Adds the stats and latency functions to a module.
+ */
+static int add_instrumentation_functions(PyObject *module) {
+  return PyModule_AddFunctions(module, instrumentation_methods);
+}
+
+/*
+  prescreen(content) returns the pre-screen features of a document, and
+  under "rules" whether each rule with requirements may find anything in
+  it. The content is analyzed without the GIL.
+ */
+static PyObject *module_prescreen(PyObject *self, PyObject *content) {
+  namespace PreScreen = OS2DSRules::PreScreen;
+  using PreScreen::ByteClass;
+
+  ContentView view;
+  if (!view.acquire(content))
+    return NULL;
+
+  std::string_view text = view.text();
+  PreScreen::Features f;
+
+  Py_BEGIN_ALLOW_THREADS
+  f = PreScreen::analyze(text);
+  Py_END_ALLOW_THREADS
+
+  const auto runs = [&f](const PreScreen::Requirements &requirements) {
+    return requirements.met_by(f) ? Py_True : Py_False;
+  };
+
+  return Py_BuildValue(
+      "{s:n, s:n, s:n, s:n, s:d, s:{s:n, s:n, s:n, s:n, s:n, s:n, s:n}, "
+      "s:{s:O, s:O, s:O}}",
+      "size", Py_ssize_t(f.size), "longest_digit_run",
+      Py_ssize_t(f.longest_digit_run), "tokens", Py_ssize_t(f.tokens),
+      "capitalized_tokens", Py_ssize_t(f.capitalized_tokens),
+      "uppercase_token_density", f.uppercase_token_density(), "byte_classes",
+      "digit", Py_ssize_t(f.count(ByteClass::Digit)), "upper",
+      Py_ssize_t(f.count(ByteClass::Upper)), "lower",
+      Py_ssize_t(f.count(ByteClass::Lower)), "space",
+      Py_ssize_t(f.count(ByteClass::Space)), "punctuation",
+      Py_ssize_t(f.count(ByteClass::Punctuation)), "control",
+      Py_ssize_t(f.count(ByteClass::Control)), "non_ascii",
+      Py_ssize_t(f.count(ByteClass::NonAscii)), "rules", "CPRDetector",
+      runs(CPRDetector::CPRDetector::requirements()), "NameRule",
+      runs(NameRule::NameRule::requirements()), "AddressRule",
+      runs(AddressRule::AddressRule::requirements()));
+}
+
+static PyMethodDef prescreen_methods[] = {
+    {"prescreen", module_prescreen, METH_O,
+     "Return the pre-screen features of a text as a dict."},
+    {NULL, NULL, 0, NULL} /* Sentinel */
+};
+
+/*
+  Adds the prescreen function to a module.
+ */
+static int add_prescreen_functions(PyObject *module) {
+  return PyModule_AddFunctions(module, prescreen_methods);
+}
+
+/*
+  set_result_cache(capacity) enables the result cache of this module with
+  room for about capacity bytes of results, replacing any previous cache.
+  A capacity of 0 disables it.
+ */
+static PyObject *module_set_result_cache(PyObject *self, PyObject *arg) {
+  const Py_ssize_t capacity = PyNumber_AsSsize_t(arg, PyExc_OverflowError);
+  if (capacity == -1 && PyErr_Occurred())
+    return NULL;
+
+  if (capacity < 0) {
+    PyErr_SetString(PyExc_ValueError, "capacity must not be negative");
+    return NULL;
+  }
+
+  if (capacity == 0)
+    result_cache.reset();
+  else
+    result_cache =
+        std::make_shared<ResultCache::ResultCache>(std::size_t(capacity));
+
+  Py_RETURN_NONE;
+}
+
+static PyObject *module_result_cache_stats(PyObject *self, PyObject *args) {
+  const auto stats =
+      result_cache ? result_cache->stats() : ResultCache::CacheStats();
+
+  return Py_BuildValue("{s:O, s:n, s:n, s:n, s:n, s:n, s:n, s:n}", "enabled",
+                       result_cache ? Py_True : Py_False, "capacity",
+                       Py_ssize_t(result_cache ? result_cache->capacity() : 0),
+                       "hits", Py_ssize_t(stats.hits), "misses",
+                       Py_ssize_t(stats.misses), "insertions",
+                       Py_ssize_t(stats.insertions), "evictions",
+                       Py_ssize_t(stats.evictions), "entries",
+                       Py_ssize_t(stats.entries), "bytes",
+                       Py_ssize_t(stats.bytes));
+}
+
+static PyObject *module_clear_result_cache(PyObject *self, PyObject *args) {
+  if (result_cache)
+    result_cache->clear();
+  Py_RETURN_NONE;
+}
+
+static PyMethodDef cache_methods[] = {
+    {"set_result_cache", module_set_result_cache, METH_O,
+     "Enable the result cache with a capacity in bytes, or disable it with 0."},
+    {"result_cache_stats", module_result_cache_stats, METH_NOARGS,
+     "Return the result cache counters as a dict."},
+    {"clear_result_cache", module_clear_result_cache, METH_NOARGS,
+     "Remove all entries from the result cache."},
+    {NULL, NULL, 0, NULL} /* Sentinel */
+};
+
+/*
+  Adds the result cache functions to a module.
+ */
+static int add_cache_functions(PyObject *module) {
+  return PyModule_AddFunctions(module, cache_methods);
+}
+
+}; // namespace Python
+
+}; // namespace OS2DSRules
+
+#endif
@@ -3,39 +3,169 @@
 
 #include <cpr-detector.hpp>
 #include <cstddef>
-#include <iostream>
 #include <string>
 
+#include "common.hpp"
+
 using namespace OS2DSRules::CPRDetector;
+using namespace OS2DSRules::Python;
+using OS2DSRules::Encoding::Encoding;
+using OS2DSRules::MatchResults;
+using OS2DSRules::ScanOptions;
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-static PyObject *detector_find_matches(PyObject *self, PyObject *args) {
-  const char *content;
+typedef struct {
+  PyObject_HEAD CPRDetector *detector;
+} PyCPRDetector;
+
+static void PyCPRDetector_dealloc(PyCPRDetector *self) {
+  delete self->detector;
+  Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *PyCPRDetector_new(PyTypeObject *type, PyObject *args,
+                                   PyObject *kwds) {
+  PyCPRDetector *self;
+  self = (PyCPRDetector *)type->tp_alloc(type, 0);
+  if (self != NULL) {
+    self->detector = nullptr;
+  }
+  return (PyObject *)self;
+}
+
+static int PyCPRDetector_init(PyCPRDetector *self, PyObject *args,
+                              PyObject *kwds) {
+  static char *kwlist[] = {(char *)"check_mod11", (char *)"examine_context",
+                           NULL};
   int check_mod11 = 0;
   int examine_context = 0;
 
-  if (!PyArg_ParseTuple(args, "s|pp", &content, &check_mod11, &examine_context))
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "|pp", kwlist, &check_mod11,
+                                   &examine_context))
+    return -1;
+
+  if (self->detector != nullptr) {
+    PyErr_SetString(PyExc_RuntimeError, "CPRDetector is already initialized.");
+    return -1;
+  }
+
+  self->detector = new CPRDetector(static_cast<bool>(check_mod11),
+                                   static_cast<bool>(examine_context));
+
+  return 0;
+}
+
+static PyObject *PyCPRDetector_find_matches(PyCPRDetector *self,
+                                            PyObject *const *args,
+                                            Py_ssize_t nargs,
+                                            PyObject *kwnames) {
+  ScanOptions options;
+  Encoding encoding = Encoding::UTF8;
+  if (!parse_find_matches_args(nargs, args, kwnames, options, encoding))
     return NULL;
 
-  CPRDetector detector(static_cast<bool>(check_mod11), static_cast<bool>(examine_context));
-  std::string text(content);
-  auto results = detector.find_matches(text);
-  Py_ssize_t len = Py_ssize_t(results.size());
+  if (self->detector == nullptr) {
+    PyErr_SetString(PyExc_RuntimeError, "CPRDetector is not initialized.");
+    return NULL;
+  }
 
-  PyObject *list_of_results = PyList_New(len);
+  return find_matches_without_gil(*self->detector, args[0], options,
+                                  encoding);
+}
 
-  for (Py_ssize_t i = 0; i < len; ++i) {
-    auto res = results[i];
-    PyObject *obj = Py_BuildValue(
-        "{s:s, s:i, s:i, s:d}", "match", res.match().c_str(), "start",
-        res.start(), "end", res.end(), "probability", res.probability());
-    PyList_SetItem(list_of_results, i, obj);
+static PyObject *PyCPRDetector_redact(PyCPRDetector *self, PyObject *args,
+                                      PyObject *kwargs) {
+  if (self->detector == nullptr) {
+    PyErr_SetString(PyExc_RuntimeError, "CPRDetector is not initialized.");
+    return NULL;
+  }
+
+  return redact_without_gil(*self->detector, "cpr", args, kwargs);
+}
+
+static PyObject *PyCPRDetector_find_unique(PyCPRDetector *self, PyObject *args,
+                                           PyObject *kwargs) {
+  if (self->detector == nullptr) {
+    PyErr_SetString(PyExc_RuntimeError, "CPRDetector is not initialized.");
+    return NULL;
   }
 
-  return list_of_results;
+  return find_unique_without_gil(*self->detector, args, kwargs);
+}
+
+static PyMethodDef PyCPRDetector_methods[] = {
+    {"find_matches", (PyCFunction)(void (*)(void))PyCPRDetector_find_matches,
+     METH_FASTCALL | METH_KEYWORDS,
+     "Find matches in a text, optionally with a timeout, byte_budget or "
+     "max_matches."},
+    {"redact", (PyCFunction)(void (*)(void))PyCPRDetector_redact,
+     METH_VARARGS | METH_KEYWORDS,
+     "redact(content, *, policy='fixed', fill='*', tag=None)\n--\n\n"
+     "Return a copy of content with the matches masked. policy is 'fixed',\n"
+     "'keep_last4' or 'tag'."},
+    {"find_unique", (PyCFunction)(void (*)(void))PyCPRDetector_find_unique,
+     METH_VARARGS | METH_KEYWORDS,
+     "find_unique(content, *, offsets=False)\n--\n\n"
+     "Return the unique normalized matches in content with their counts,\n"
+     "and with offsets the starts of their first and last occurrence."},
+    {NULL} /* Sentinel */
+};
+
+static PyTypeObject PyCPRDetectorType = {
+    PyVarObject_HEAD_INIT(NULL, 0) "cpr_detector.CPRDetector", /* tp_name */
+    sizeof(PyCPRDetector),                    /* tp_basicsize */
+    0,                                        /* tp_itemsize */
+    (destructor)PyCPRDetector_dealloc,        /* tp_dealloc */
+    0,                                        /* tp_vectorcall_offset */
+    0,                                        /* tp_getattr */
+    0,                                        /* tp_setattr */
+    0,                                        /* tp_as_async */
+    0,                                        /* tp_repr */
+    0,                                        /* tp_as_number */
+    0,                                        /* tp_as_sequence */
+    0,                                        /* tp_as_mapping */
+    0,                                        /* tp_hash */
+    0,                                        /* tp_call */
+    0,                                        /* tp_str */
+    0,                                        /* tp_getattro */
+    0,                                        /* tp_setattro */
+    0,                                        /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /* tp_flags */
+    PyDoc_STR("CPRDetector bindings"),        /* tp_doc */
+    0,                                        /* tp_traverse */
+    0,                                        /* tp_clear */
+    0,                                        /* tp_richcompare */
+    0,                                        /* tp_weaklistoffset */
+    0,                                        /* tp_iter */
+    0,                                        /* tp_iternext */
+    PyCPRDetector_methods,                    /* tp_methods */
+    0,                                        /* tp_members */
+    0,                                        /* tp_getset */
+    0,                                        /* tp_base */
+    0,                                        /* tp_dict */
+    0,                                        /* tp_descr_get */
+    0,                                        /* tp_descr_set */
+    0,                                        /* tp_dictoffset */
+    (initproc)PyCPRDetector_init,             /* tp_init */
+    0,                                        /* tp_alloc */
+    PyCPRDetector_new,                        /* tp_new */
+};
+
+static PyObject *detector_find_matches(PyObject *self, PyObject *args) {
+  PyObject *content;
+  int check_mod11 = 0;
+  int examine_context = 0;
+
+  if (!PyArg_ParseTuple(args, "O|pp", &content, &check_mod11,
+                        &examine_context))
+    return NULL;
+
+  CPRDetector detector(static_cast<bool>(check_mod11),
+                       static_cast<bool>(examine_context));
+  return find_matches_without_gil(detector, content, ScanOptions());
 }
 
 static PyMethodDef DetectorMethods[] = {
@@ -50,7 +180,29 @@ static struct PyModuleDef detectormodule = {PyModuleDef_HEAD_INIT,
                                             -1, DetectorMethods};
 
 PyMODINIT_FUNC PyInit_cpr_detector(void) {
-  return PyModule_Create(&detectormodule);
+  PyObject *m;
+  if (PyType_Ready(&PyCPRDetectorType) < 0)
+    return NULL;
+
+  m = PyModule_Create(&detectormodule);
+  if (m == NULL)
+    return NULL;
+
+  if (add_result_types(m) < 0 || add_instrumentation_functions(m) < 0 ||
+      add_prescreen_functions(m) < 0 || add_cache_functions(m) < 0) {
+    Py_DECREF(m);
+    return NULL;
+  }
+
+  Py_INCREF(&PyCPRDetectorType);
+  if (PyModule_AddObject(m, "CPRDetector", (PyObject *)&PyCPRDetectorType) <
+      0) {
+    Py_DECREF(&PyCPRDetectorType);
+    Py_DECREF(m);
+    return NULL;
+  }
+
+  return m;
 }
 
 #ifdef __cplusplus
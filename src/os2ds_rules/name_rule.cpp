@@ -5,35 +5,159 @@
 #include <name_rule.hpp>
 #include <string>
 
+#include "common.hpp"
+
 using namespace OS2DSRules::NameRule;
+using namespace OS2DSRules::Python;
+using OS2DSRules::Encoding::Encoding;
+using OS2DSRules::MatchResults;
+using OS2DSRules::ScanOptions;
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-static PyObject *name_rule_find_matches(PyObject *self, PyObject *args) {
-  const char *content;
+typedef struct {
+  PyObject_HEAD NameRule *rule;
+} PyNameRule;
+
+static void PyNameRule_dealloc(PyNameRule *self) {
+  delete self->rule;
+  Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *PyNameRule_new(PyTypeObject *type, PyObject *args,
+                                PyObject *kwds) {
+  PyNameRule *self;
+  self = (PyNameRule *)type->tp_alloc(type, 0);
+  if (self != NULL) {
+    self->rule = nullptr;
+  }
+  return (PyObject *)self;
+}
+
+static int PyNameRule_init(PyNameRule *self, PyObject *args, PyObject *kwds) {
+  static char *kwlist[] = {(char *)"expansive", NULL};
   int expansive = 0;
 
-  if (!PyArg_ParseTuple(args, "s|p", &content, &expansive))
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "|p", kwlist, &expansive))
+    return -1;
+
+  if (self->rule != nullptr) {
+    PyErr_SetString(PyExc_RuntimeError, "NameRule is already initialized.");
+    return -1;
+  }
+
+  self->rule = new NameRule(static_cast<bool>(expansive));
+
+  return 0;
+}
+
+static PyObject *PyNameRule_find_matches(PyNameRule *self,
+                                         PyObject *const *args,
+                                         Py_ssize_t nargs,
+                                         PyObject *kwnames) {
+  ScanOptions options;
+  Encoding encoding = Encoding::UTF8;
+  if (!parse_find_matches_args(nargs, args, kwnames, options, encoding))
     return NULL;
 
-  NameRule rule(static_cast<bool>(expansive));
-  std::string text(content);
-  auto results = rule.find_matches(text);
-  Py_ssize_t len = Py_ssize_t(results.size());
-
-  PyObject *list_of_results = PyList_New(len);
-
-  for (Py_ssize_t i = 0; i < len; ++i) {
-    auto res = results[i];
-    PyObject *obj = Py_BuildValue(
-        "{s:s, s:i, s:i, s:d}", "match", res.match().c_str(), "start",
-        res.start(), "end", res.end(), "probability", res.probability());
-    PyList_SetItem(list_of_results, i, obj);
+  if (self->rule == nullptr) {
+    PyErr_SetString(PyExc_RuntimeError, "NameRule is not initialized.");
+    return NULL;
+  }
+
+  return find_matches_without_gil(*self->rule, args[0], options,
+                                  encoding);
+}
+
+static PyObject *PyNameRule_redact(PyNameRule *self, PyObject *args,
+                                   PyObject *kwargs) {
+  if (self->rule == nullptr) {
+    PyErr_SetString(PyExc_RuntimeError, "NameRule is not initialized.");
+    return NULL;
+  }
+
+  return redact_without_gil(*self->rule, "name", args, kwargs);
+}
+
+static PyObject *PyNameRule_find_unique(PyNameRule *self, PyObject *args,
+                                        PyObject *kwargs) {
+  if (self->rule == nullptr) {
+    PyErr_SetString(PyExc_RuntimeError, "NameRule is not initialized.");
+    return NULL;
   }
 
-  return list_of_results;
+  return find_unique_without_gil(*self->rule, args, kwargs);
+}
+
+static PyMethodDef PyNameRule_methods[] = {
+    {"find_matches", (PyCFunction)(void (*)(void))PyNameRule_find_matches,
+     METH_FASTCALL | METH_KEYWORDS,
+     "Find matches in a text, optionally with a timeout, byte_budget or "
+     "max_matches."},
+    {"redact", (PyCFunction)(void (*)(void))PyNameRule_redact,
+     METH_VARARGS | METH_KEYWORDS,
+     "redact(content, *, policy='fixed', fill='*', tag=None)\n--\n\n"
+     "Return a copy of content with the matches masked. policy is 'fixed',\n"
+     "'keep_last4' or 'tag'."},
+    {"find_unique", (PyCFunction)(void (*)(void))PyNameRule_find_unique,
+     METH_VARARGS | METH_KEYWORDS,
+     "find_unique(content, *, offsets=False)\n--\n\n"
+     "Return the unique normalized matches in content with their counts,\n"
+     "and with offsets the starts of their first and last occurrence."},
+    {NULL} /* Sentinel */
+};
+
+static PyTypeObject PyNameRuleType = {
+    PyVarObject_HEAD_INIT(NULL, 0) "name_rule.NameRule", /* tp_name */
+    sizeof(PyNameRule),                       /* tp_basicsize */
+    0,                                        /* tp_itemsize */
+    (destructor)PyNameRule_dealloc,           /* tp_dealloc */
+    0,                                        /* tp_vectorcall_offset */
+    0,                                        /* tp_getattr */
+    0,                                        /* tp_setattr */
+    0,                                        /* tp_as_async */
+    0,                                        /* tp_repr */
+    0,                                        /* tp_as_number */
+    0,                                        /* tp_as_sequence */
+    0,                                        /* tp_as_mapping */
+    0,                                        /* tp_hash */
+    0,                                        /* tp_call */
+    0,                                        /* tp_str */
+    0,                                        /* tp_getattro */
+    0,                                        /* tp_setattro */
+    0,                                        /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /* tp_flags */
+    PyDoc_STR("NameRule bindings"),           /* tp_doc */
+    0,                                        /* tp_traverse */
+    0,                                        /* tp_clear */
+    0,                                        /* tp_richcompare */
+    0,                                        /* tp_weaklistoffset */
+    0,                                        /* tp_iter */
+    0,                                        /* tp_iternext */
+    PyNameRule_methods,                       /* tp_methods */
+    0,                                        /* tp_members */
+    0,                                        /* tp_getset */
+    0,                                        /* tp_base */
+    0,                                        /* tp_dict */
+    0,                                        /* tp_descr_get */
+    0,                                        /* tp_descr_set */
+    0,                                        /* tp_dictoffset */
+    (initproc)PyNameRule_init,                /* tp_init */
+    0,                                        /* tp_alloc */
+    PyNameRule_new,                           /* tp_new */
+};
+
+static PyObject *name_rule_find_matches(PyObject *self, PyObject *args) {
+  PyObject *content;
+  int expansive = 0;
+
+  if (!PyArg_ParseTuple(args, "O|p", &content, &expansive))
+    return NULL;
+
+  NameRule rule(static_cast<bool>(expansive));
+  return find_matches_without_gil(rule, content, ScanOptions());
 }
 
 static PyMethodDef NameRuleMethods[] = {
@@ -48,7 +172,28 @@ static struct PyModuleDef namerulemodule = {PyModuleDef_HEAD_INIT,
                                             -1, NameRuleMethods};
 
 PyMODINIT_FUNC PyInit_name_rule(void) {
-  return PyModule_Create(&namerulemodule);
+  PyObject *m;
+  if (PyType_Ready(&PyNameRuleType) < 0)
+    return NULL;
+
+  m = PyModule_Create(&namerulemodule);
+  if (m == NULL)
+    return NULL;
+
+  if (add_result_types(m) < 0 || add_instrumentation_functions(m) < 0 ||
+      add_prescreen_functions(m) < 0 || add_cache_functions(m) < 0) {
+    Py_DECREF(m);
+    return NULL;
+  }
+
+  Py_INCREF(&PyNameRuleType);
+  if (PyModule_AddObject(m, "NameRule", (PyObject *)&PyNameRuleType) < 0) {
+    Py_DECREF(&PyNameRuleType);
+    Py_DECREF(m);
+    return NULL;
+  }
+
+  return m;
 }
 
 #ifdef __cplusplus
@@ -0,0 +1,114 @@
+#ifndef OS2DS_RULES_OFFSETS_HPP
+#define OS2DS_RULES_OFFSETS_HPP
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define OS2DS_RULES_OFFSETS_SSE2 1
+#endif
+
+namespace OS2DSRules {
+
+namespace Python {
+
+/*
+  Translates byte offsets into UTF-8 text to code point offsets, which is
+  what Python uses to index a str.
+
+  The index stores the number of code points before every 64-byte block
+  of the text. A block is counted with a single popcount of the mask of
+  its continuation bytes, so building the index costs O(n/64) popcounts,
+  and translating an offset only has to count the bytes between the
+  start of its block and the offset itself.
+ */
+class CodePointIndex {
+public:
+  explicit CodePointIndex(std::string_view text) noexcept : text_(text) {
+    const std::size_t blocks = text.size() / block_size;
+    index_.reserve(blocks + 1);
+
+    std::size_t code_points = 0;
+    for (std::size_t b = 0; b < blocks; ++b) {
+      index_.push_back(code_points);
+      code_points += block_size - std::size_t(std::popcount(
+                                      continuation_mask(&text[b * block_size])));
+    }
+    index_.push_back(code_points);
+  }
+
+  /*
+    Returns the index of the code point that contains the byte at offset.
+    An offset at the end of the text maps to the number of code points.
+   */
+  [[nodiscard]] std::size_t translate(std::size_t offset) const noexcept {
+    if (offset > text_.size())
+      offset = text_.size();
+
+    const std::size_t block = offset / block_size;
+    std::size_t code_points = index_[block];
+
+    for (std::size_t i = block * block_size; i < offset; ++i) {
+      code_points += !is_continuation(text_[i]);
+    }
+
+    // An offset inside a multi-byte sequence belongs to the code point
+    // started by the preceding lead byte.
+    if (offset < text_.size() && is_continuation(text_[offset]))
+      --code_points;
+
+    return code_points;
+  }
+
+private:
+  static constexpr std::size_t block_size = 64;
+
+  static constexpr bool is_continuation(char c) noexcept {
+    return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+  }
+
+  // Returns a bitmask with one bit set for every continuation byte
+  // (10xxxxxx) in the 64 bytes starting at block.
+  static std::uint64_t continuation_mask(const char *block) noexcept {
+#ifdef OS2DS_RULES_OFFSETS_SSE2
+    // Continuation bytes are exactly the bytes in [-128, -65] when they
+    // are compared as signed integers.
+    const __m128i limit = _mm_set1_epi8(-64);
+    std::uint64_t mask = 0;
+    for (int i = 0; i < 4; ++i) {
+      const __m128i bytes =
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + 16 * i));
+      const auto lanes = static_cast<std::uint32_t>(
+          _mm_movemask_epi8(_mm_cmplt_epi8(bytes, limit)));
+      mask |= std::uint64_t(lanes) << (16 * i);
+    }
+    return mask;
+#else
+    // Portable fallback: the high bit of every continuation byte is set in
+    // the word, and its second highest bit is clear.
+    std::uint64_t count = 0;
+    for (std::size_t i = 0; i < block_size; i += 8) {
+      std::uint64_t word;
+      std::memcpy(&word, block + i, sizeof(word));
+      const std::uint64_t high = 0x8080808080808080ULL;
+      count += std::uint64_t(std::popcount(word & ~(word << 1) & high));
+    }
+    // Only the number of set bits matters to the caller.
+    return count == 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << count) - 1;
+#endif
+  }
+
+  std::string_view text_;
+  std::vector<std::size_t> index_;
+};
+
+}; // namespace Python
+
+}; // namespace OS2DSRules
+
+#endif
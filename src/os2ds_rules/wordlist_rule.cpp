@@ -7,7 +7,13 @@
 #include <vector>
 #include <wordlist_rule.hpp>
 
+#include "common.hpp"
+
 using namespace OS2DSRules::WordListRule;
+using namespace OS2DSRules::Python;
+using OS2DSRules::Encoding::Encoding;
+using OS2DSRules::MatchResults;
+using OS2DSRules::ScanOptions;
 
 #ifdef __cplusplus
 extern "C" {
@@ -15,11 +21,12 @@ extern "C" {
 
 typedef struct {
   PyObject_HEAD WordListRule *rule;
+  std::vector<std::string> *words;
 } PyWordListRule;
 
 static void PyWordListRule_dealloc(PyWordListRule *self) {
-  if (self->rule)
-    delete self->rule;
+  delete self->rule;
+  delete self->words;
   Py_TYPE(self)->tp_free((PyObject *)self);
 }
 
@@ -27,8 +34,10 @@ static PyObject *PyWordListRule_new(PyTypeObject *type, PyObject *args,
                                     PyObject *kwds) {
   PyWordListRule *self;
   self = (PyWordListRule *)type->tp_alloc(type, 0);
-  if (self != NULL)
+  if (self != NULL) {
     self->rule = nullptr;
+    self->words = nullptr;
+  }
   return (PyObject *)self;
 }
 
@@ -41,51 +50,92 @@ static int PyWordListRule_init(PyWordListRule *self, PyObject *args,
     return -1;
   }
 
+  if (self->rule != nullptr) {
+    PyErr_SetString(PyExc_RuntimeError, "WordListRule is already initialized.");
+    return -1;
+  }
+
   if (words && PyList_Check(words)) {
-    std::vector<std::string_view> words_v;
+    // The rule only holds views of the words, so they are owned by self.
+    auto *owned = new std::vector<std::string>();
+    owned->reserve(std::size_t(PyList_Size(words)));
+
     for (Py_ssize_t i = 0; i < PyList_Size(words); ++i) {
       PyObject *py_string = PyList_GetItem(words, i);
 
       if (PyUnicode_Check(py_string)) {
-        words_v.push_back(std::string_view(
-            PyBytes_AsString(PyUnicode_AsUTF8String(py_string))));
+        Py_ssize_t size = 0;
+        const char *data = PyUnicode_AsUTF8AndSize(py_string, &size);
+        if (data == NULL) {
+          delete owned;
+          return -1;
+        }
+        owned->emplace_back(data, std::size_t(size));
       }
     }
 
-    self->rule = new WordListRule(words_v.begin(), words_v.end());
+    self->words = owned;
+    self->rule = new WordListRule(owned->cbegin(), owned->cend());
   }
 
   return 0;
 }
 
 static PyObject *PyWordListRule_find_matches(PyWordListRule *self,
-                                             PyObject *args) {
-  const char *content;
+                                             PyObject *const *args,
+                                             Py_ssize_t nargs,
+                                             PyObject *kwnames) {
+  ScanOptions options;
+  Encoding encoding = Encoding::UTF8;
+  if (!parse_find_matches_args(nargs, args, kwnames, options, encoding))
+    return NULL;
 
-  if (!PyArg_ParseTuple(args, "s", &content))
+  if (self->rule == nullptr) {
+    PyErr_SetString(PyExc_RuntimeError, "WordListRule is not initialized.");
     return NULL;
+  }
 
-  std::string text(content);
-  auto results = self->rule->find_matches(text);
+  // The rule is immutable after construction and is kept alive by the
+  // reference to self held for the duration of this call.
+  return find_matches_without_gil(*self->rule, args[0], options,
+                                  encoding);
+}
 
-  Py_ssize_t len = Py_ssize_t(results.size());
+static PyObject *PyWordListRule_redact(PyWordListRule *self, PyObject *args,
+                                       PyObject *kwargs) {
+  if (self->rule == nullptr) {
+    PyErr_SetString(PyExc_RuntimeError, "WordListRule is not initialized.");
+    return NULL;
+  }
 
-  PyObject *list_of_results = PyList_New(len);
+  return redact_without_gil(*self->rule, "wordlist", args, kwargs);
+}
 
-  for (Py_ssize_t i = 0; i < len; ++i) {
-    auto res = results[i];
-    PyObject *obj = Py_BuildValue(
-        "{s:s, s:i, s:i, s:d}", "match", res.match().c_str(), "start",
-        res.start(), "end", res.end(), "probability", res.probability());
-    PyList_SetItem(list_of_results, i, obj);
+static PyObject *PyWordListRule_find_unique(PyWordListRule *self, PyObject *args,
+                                            PyObject *kwargs) {
+  if (self->rule == nullptr) {
+    PyErr_SetString(PyExc_RuntimeError, "WordListRule is not initialized.");
+    return NULL;
   }
 
-  return list_of_results;
+  return find_unique_without_gil(*self->rule, args, kwargs);
 }
 
 static PyMethodDef PyWordListRule_methods[] = {
-    {"find_matches", (PyCFunction)PyWordListRule_find_matches, METH_VARARGS,
-     "Find matches in a text."},
+    {"find_matches", (PyCFunction)(void (*)(void))PyWordListRule_find_matches,
+     METH_FASTCALL | METH_KEYWORDS,
+     "Find matches in a text, optionally with a timeout, byte_budget or "
+     "max_matches."},
+    {"redact", (PyCFunction)(void (*)(void))PyWordListRule_redact,
+     METH_VARARGS | METH_KEYWORDS,
+     "redact(content, *, policy='fixed', fill='*', tag=None)\n--\n\n"
+     "Return a copy of content with the matches masked. policy is 'fixed',\n"
+     "'keep_last4' or 'tag'."},
+    {"find_unique", (PyCFunction)(void (*)(void))PyWordListRule_find_unique,
+     METH_VARARGS | METH_KEYWORDS,
+     "find_unique(content, *, offsets=False)\n--\n\n"
+     "Return the unique normalized matches in content with their counts,\n"
+     "and with offsets the starts of their first and last occurrence."},
     {NULL} /* Sentinel */
 };
 
@@ -108,7 +158,7 @@ static PyTypeObject PyWordListRuleType = {
     0,                                  /* tp_getattro */
     0,                                  /* tp_setattro */
     0,                                  /* tp_as_buffer */
-    0,                                  /* tp_flags */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /* tp_flags */
     PyDoc_STR("WordListRule bindings"), /* tp_doc */
     0,                                  /* tp_traverse */
     0,                                  /* tp_clear */
@@ -145,6 +195,12 @@ PyMODINIT_FUNC PyInit_wordlist_rule(void) {
   if (m == NULL)
     return NULL;
 
+  if (add_result_types(m) < 0 || add_instrumentation_functions(m) < 0 ||
+      add_prescreen_functions(m) < 0 || add_cache_functions(m) < 0) {
+    Py_DECREF(m);
+    return NULL;
+  }
+
   Py_INCREF(&PyWordListRuleType);
   if (PyModule_AddObject(m, "WordListRule", (PyObject *)&PyWordListRuleType) <
       0) {
@@ -0,0 +1,522 @@
+#include <address_rule.hpp>
+#include <aggregate.hpp>
+#include <cpr-detector.hpp>
+#include <data_structures.hpp>
+#include <encoding.hpp>
+#include <health_rule.hpp>
+#include <ingest.hpp>
+#include <markup.hpp>
+#include <name_rule.hpp>
+#include <os2dsrules.hpp>
+#include <prescreen.hpp>
+#include <redact.hpp>
+#include <serializer.hpp>
+#include <wordlist_rule.hpp>
+
+#include "corpus_generator.hpp"
+
+#include <array>
+#include <benchmark/benchmark.h>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+using namespace OS2DSRules;
+using namespace OS2DSRules::Benchmarks;
+using namespace OS2DSRules::DataStructures;
+
+/*
+  C++ benchmarks for the rules, without the overhead of the Python
+  bindings. Every rule is run on the same corpora as the Python
+  benchmarks and reports both bytes/s and matches/s.
+ */
+
+namespace {
+
+static constexpr auto firstnames = std::to_array({
+#include "datasets/female_firstnames.txt"
+#include "datasets/male_firstnames.txt"
+});
+
+static constexpr auto lastnames = std::to_array<std::string_view>({
+#include "datasets/lastnames.txt"
+});
+
+static constexpr auto addresses = std::to_array({
+#include "datasets/da_addresses.txt"
+});
+
+enum Corpus : long { WikiHtml = 0, GccTxt = 1 };
+
+const std::string &corpus(long which) {
+  static const auto read = [](const char *name) {
+    std::ifstream file(std::string(OS2DSRULES_BENCHMARK_DATA_DIR) + "/" +
+                       name);
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+  };
+
+  static const std::string wiki = read("list_9_11_victims.html");
+  static const std::string gcc = read("gcc.txt");
+
+  return which == WikiHtml ? wiki : gcc;
+}
+
+// Runs rule.find_matches on a corpus and reports bytes/s and matches/s.
+template <typename Rule>
+void run_rule(benchmark::State &state, Rule &rule, const std::string &content) {
+  std::size_t matches = 0;
+
+  for (auto _ : state) {
+    auto results = rule.find_matches(content);
+    matches = results.size();
+    benchmark::DoNotOptimize(results);
+  }
+
+  state.SetBytesProcessed(int64_t(state.iterations()) *
+                          int64_t(content.size()));
+  state.counters["matches"] = benchmark::Counter(
+      double(matches), benchmark::Counter::kIsIterationInvariantRate);
+}
+
+// Returns a cached 1 MiB synthetic corpus.
+const std::string &synthetic_corpus(const CorpusOptions &options) {
+  using Key = std::tuple<int, double, double, double, double, double>;
+  static std::map<Key, std::string> cache;
+
+  const Key key{static_cast<int>(options.filler), options.valid_cprs,
+                options.invalid_cprs, options.names, options.addresses,
+                options.health_terms};
+
+  auto it = cache.find(key);
+  if (it == cache.end()) {
+    it = cache.emplace(key, CorpusGenerator(options).generate()).first;
+  }
+
+  return it->second;
+}
+
+void set_corpus_label(benchmark::State &state) {
+  state.SetLabel(state.range(0) == WikiHtml ? "list_9_11_victims.html"
+                                            : "gcc.txt");
+}
+
+} // namespace
+
+static void BM_CPRDetector(benchmark::State &state) {
+  CPRDetector::CPRDetector detector(state.range(1) != 0, state.range(2) != 0);
+  set_corpus_label(state);
+  run_rule(state, detector, corpus(state.range(0)));
+}
+BENCHMARK(BM_CPRDetector)
+    ->ArgNames({"corpus", "mod11", "context"})
+    ->ArgsProduct({{WikiHtml, GccTxt}, {0, 1}, {0, 1}});
+
+static void BM_NameRule(benchmark::State &state) {
+  NameRule::NameRule rule;
+  set_corpus_label(state);
+  run_rule(state, rule, corpus(state.range(0)));
+}
+BENCHMARK(BM_NameRule)->ArgName("corpus")->Arg(WikiHtml)->Arg(GccTxt);
+
+static void BM_AddressRule(benchmark::State &state) {
+  AddressRule::AddressRule rule;
+  set_corpus_label(state);
+  run_rule(state, rule, corpus(state.range(0)));
+}
+BENCHMARK(BM_AddressRule)->ArgName("corpus")->Arg(WikiHtml)->Arg(GccTxt);
+
+static void BM_HealthRule(benchmark::State &state) {
+  HealthRule::HealthRule rule;
+  set_corpus_label(state);
+  run_rule(state, rule, corpus(state.range(0)));
+}
+BENCHMARK(BM_HealthRule)->ArgName("corpus")->Arg(WikiHtml)->Arg(GccTxt);
+
+static void BM_WordListRule(benchmark::State &state) {
+  auto words = std::to_array<std::string_view>({"reference", "tower", "building"});
+  WordListRule::WordListRule rule(words.begin(), words.end());
+  set_corpus_label(state);
+  run_rule(state, rule, corpus(state.range(0)));
+}
+BENCHMARK(BM_WordListRule)->ArgName("corpus")->Arg(WikiHtml)->Arg(GccTxt);
+
+static void BM_FrozenHashSet_Contains(benchmark::State &state) {
+  static const auto set = std::make_unique<FrozenHashSet<lastnames.size()>>(lastnames);
+  // Alternate between a hit and a miss of similar length.
+  const auto queries = std::to_array<std::string_view>(
+      {"JENSEN", "JENSAN", "NIELSEN", "NIELSAN", "HANSEN", "HANSAN"});
+
+  std::size_t hits = 0;
+  for (auto _ : state) {
+    for (auto query : queries) {
+      hits += set->contains(query);
+    }
+  }
+
+  benchmark::DoNotOptimize(hits);
+  state.SetItemsProcessed(int64_t(state.iterations()) *
+                          int64_t(queries.size()));
+}
+BENCHMARK(BM_FrozenHashSet_Contains);
+
+template <auto &Words>
+static void BM_FrozenHashSet_Construct(benchmark::State &state) {
+  for (auto _ : state) {
+    auto set = std::make_unique<FrozenHashSet<Words.size()>>(Words);
+    benchmark::DoNotOptimize(set);
+  }
+
+  state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(Words.size()));
+}
+BENCHMARK(BM_FrozenHashSet_Construct<firstnames>)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_FrozenHashSet_Construct<lastnames>)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_FrozenHashSet_Construct<addresses>)->Unit(benchmark::kMillisecond);
+
+static void BM_HealthRule_Construct(benchmark::State &state) {
+  for (auto _ : state) {
+    HealthRule::HealthRule rule;
+    benchmark::DoNotOptimize(rule);
+  }
+}
+BENCHMARK(BM_HealthRule_Construct)->Unit(benchmark::kMicrosecond);
+
+/*
+  Synthetic corpora with a controlled density of matches. The density is
+  given in occurrences per KiB, and the same density of invalid
+  CPR-numbers as valid ones is used to exercise the validation path.
+ */
+
+static void BM_Synthetic_CPRDetector(benchmark::State &state) {
+  CorpusOptions options;
+  options.valid_cprs = double(state.range(0));
+  options.invalid_cprs = double(state.range(0));
+
+  CPRDetector::CPRDetector detector(state.range(1) != 0);
+  run_rule(state, detector, synthetic_corpus(options));
+}
+BENCHMARK(BM_Synthetic_CPRDetector)
+    ->ArgNames({"per_kib", "mod11"})
+    ->ArgsProduct({{0, 1, 8, 32}, {0, 1}});
+
+static void BM_Synthetic_NameRule(benchmark::State &state) {
+  CorpusOptions options;
+  options.names = double(state.range(0));
+
+  NameRule::NameRule rule;
+  run_rule(state, rule, synthetic_corpus(options));
+}
+BENCHMARK(BM_Synthetic_NameRule)->ArgName("per_kib")->Arg(0)->Arg(1)->Arg(8)->Arg(32);
+
+static void BM_Synthetic_AddressRule(benchmark::State &state) {
+  CorpusOptions options;
+  options.addresses = double(state.range(0));
+
+  AddressRule::AddressRule rule;
+  run_rule(state, rule, synthetic_corpus(options));
+}
+BENCHMARK(BM_Synthetic_AddressRule)->ArgName("per_kib")->Arg(0)->Arg(1)->Arg(8)->Arg(32);
+
+static void BM_Synthetic_HealthRule(benchmark::State &state) {
+  CorpusOptions options;
+  options.health_terms = double(state.range(0));
+
+  HealthRule::HealthRule rule;
+  run_rule(state, rule, synthetic_corpus(options));
+}
+BENCHMARK(BM_Synthetic_HealthRule)->ArgName("per_kib")->Arg(0)->Arg(1)->Arg(8)->Arg(32);
+
+/*
+  Adversarial corpora: long runs of digits and text in all capitals,
+  without any content that the rules look for.
+ */
+
+template <typename Rule>
+static void BM_Adversarial(benchmark::State &state) {
+  CorpusOptions options;
+  options.filler = state.range(0) == 0 ? Filler::DigitRuns : Filler::AllCaps;
+  state.SetLabel(state.range(0) == 0 ? "digit runs" : "all caps");
+
+  Rule rule;
+  run_rule(state, rule, synthetic_corpus(options));
+}
+BENCHMARK(BM_Adversarial<CPRDetector::CPRDetector>)->ArgName("filler")->Arg(0)->Arg(1);
+BENCHMARK(BM_Adversarial<NameRule::NameRule>)->ArgName("filler")->Arg(0)->Arg(1);
+BENCHMARK(BM_Adversarial<AddressRule::AddressRule>)->ArgName("filler")->Arg(0)->Arg(1);
+BENCHMARK(BM_Adversarial<HealthRule::HealthRule>)->ArgName("filler")->Arg(0)->Arg(1);
+
+/*
+  The pre-screen pass on its own, and every rule behind a Planner on the
+  fixed corpora, where documents a rule cannot match are skipped.
+ */
+
+static void BM_PreScreen_Analyze(benchmark::State &state) {
+  set_corpus_label(state);
+  const auto &content = corpus(state.range(0));
+
+  for (auto _ : state) {
+    auto features = PreScreen::analyze(content);
+    benchmark::DoNotOptimize(features);
+  }
+
+  state.SetBytesProcessed(int64_t(state.iterations()) *
+                          int64_t(content.size()));
+}
+BENCHMARK(BM_PreScreen_Analyze)->ArgName("corpus")->Arg(WikiHtml)->Arg(GccTxt);
+
+static void BM_PreScreen_Planned(benchmark::State &state) {
+  set_corpus_label(state);
+  const auto &content = corpus(state.range(0));
+
+  PreScreen::Planner planner;
+  const auto cpr = planner.add<CPRDetector::CPRDetector>();
+  const auto name = planner.add<NameRule::NameRule>();
+  const auto address = planner.add<AddressRule::AddressRule>();
+
+  CPRDetector::CPRDetector detector;
+  NameRule::NameRule name_rule;
+  AddressRule::AddressRule address_rule;
+
+  for (auto _ : state) {
+    const auto plan = planner.plan(content);
+    if (plan.runs(cpr))
+      benchmark::DoNotOptimize(detector.find_matches(content));
+    if (plan.runs(name))
+      benchmark::DoNotOptimize(name_rule.find_matches(content));
+    if (plan.runs(address))
+      benchmark::DoNotOptimize(address_rule.find_matches(content));
+  }
+
+  state.SetBytesProcessed(int64_t(state.iterations()) *
+                          int64_t(content.size()));
+}
+BENCHMARK(BM_PreScreen_Planned)->ArgName("corpus")->Arg(WikiHtml)->Arg(GccTxt);
+
+static void BM_Markup_Strip(benchmark::State &state) {
+  set_corpus_label(state);
+  const auto &content = corpus(state.range(0));
+
+  for (auto _ : state) {
+    auto document = Markup::strip(content);
+    benchmark::DoNotOptimize(document);
+  }
+
+  state.SetBytesProcessed(int64_t(state.iterations()) *
+                          int64_t(content.size()));
+}
+BENCHMARK(BM_Markup_Strip)->ArgName("corpus")->Arg(WikiHtml)->Arg(GccTxt);
+
+// Only finds the segments, as a streaming consumer would.
+static void BM_Markup_Segments(benchmark::State &state) {
+  set_corpus_label(state);
+  const auto &content = corpus(state.range(0));
+  std::vector<Markup::Segment> segments;
+
+  for (auto _ : state) {
+    Markup::Stripper stripper;
+    segments.clear();
+    stripper.feed(content, segments);
+    stripper.finish(segments);
+    benchmark::DoNotOptimize(segments.data());
+  }
+
+  state.SetBytesProcessed(int64_t(state.iterations()) *
+                          int64_t(content.size()));
+  state.counters["segments"] = double(segments.size());
+}
+BENCHMARK(BM_Markup_Segments)->ArgName("corpus")->Arg(WikiHtml)->Arg(GccTxt);
+
+static void BM_Markup_NameRule(benchmark::State &state) {
+  set_corpus_label(state);
+  const auto &content = corpus(state.range(0));
+  NameRule::NameRule rule;
+  std::size_t matches = 0;
+
+  for (auto _ : state) {
+    auto results = Markup::find_matches(rule, Markup::strip(content));
+    matches = results.size();
+    benchmark::DoNotOptimize(results);
+  }
+
+  state.SetBytesProcessed(int64_t(state.iterations()) *
+                          int64_t(content.size()));
+  state.counters["matches"] = benchmark::Counter(
+      double(matches), benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK(BM_Markup_NameRule)->ArgName("corpus")->Arg(WikiHtml);
+
+// The corpus in UTF-16LE, widening every byte as if it were Latin-1.
+static const std::string &utf16_corpus(long which) {
+  static std::map<long, std::string> cache;
+  auto &content = cache[which];
+  if (content.empty())
+    for (const unsigned char c : corpus(which)) {
+      content += static_cast<char>(c);
+      content += '\0';
+    }
+  return content;
+}
+
+template <typename Rule>
+static void BM_Encoding_UTF16(benchmark::State &state) {
+  set_corpus_label(state);
+  const auto &content = utf16_corpus(state.range(0));
+  Rule rule;
+
+  for (auto _ : state)
+    benchmark::DoNotOptimize(
+        Encoding::find_matches(rule, content, Encoding::Encoding::UTF16LE));
+
+  state.SetBytesProcessed(int64_t(state.iterations()) *
+                          int64_t(content.size()));
+}
+BENCHMARK(BM_Encoding_UTF16<CPRDetector::CPRDetector>)
+    ->ArgName("corpus")->Arg(WikiHtml)->Arg(GccTxt);
+BENCHMARK(BM_Encoding_UTF16<NameRule::NameRule>)
+    ->ArgName("corpus")->Arg(WikiHtml)->Arg(GccTxt);
+
+template <typename Rule>
+static void BM_Encoding_Latin1(benchmark::State &state) {
+  set_corpus_label(state);
+  const auto &content = corpus(state.range(0));
+  Rule rule;
+
+  for (auto _ : state)
+    benchmark::DoNotOptimize(
+        Encoding::find_matches(rule, content, Encoding::Encoding::Latin1));
+
+  state.SetBytesProcessed(int64_t(state.iterations()) *
+                          int64_t(content.size()));
+}
+BENCHMARK(BM_Encoding_Latin1<NameRule::NameRule>)
+    ->ArgName("corpus")->Arg(WikiHtml)->Arg(GccTxt);
+BENCHMARK(BM_Encoding_Latin1<AddressRule::AddressRule>)
+    ->ArgName("corpus")->Arg(WikiHtml)->Arg(GccTxt);
+
+// Many small files, as in a mail spool or a source tree.
+static const std::vector<std::string> &small_files() {
+  static std::vector<std::string> paths;
+  if (paths.empty()) {
+    const auto root =
+        std::filesystem::temp_directory_path() / "os2dsrules-bench-files";
+    std::filesystem::create_directories(root);
+    const auto &content = corpus(GccTxt);
+    for (std::size_t i = 0; i < 10000; ++i) {
+      const auto path = (root / std::to_string(i)).string();
+      if (!std::filesystem::exists(path)) {
+        std::ofstream file(path, std::ios::binary);
+        file.write(content.data() + (i * 4096) % (content.size() - 4096),
+                   std::streamsize(512 + i % 3584));
+      }
+      paths.push_back(path);
+    }
+  }
+  return paths;
+}
+
+static void BM_Ingest(benchmark::State &state) {
+  const auto &paths = small_files();
+  Ingest::Ingester ingester({.uring = state.range(0) != 0});
+  state.SetLabel(ingester.backend() == Ingest::Backend::Uring ? "io_uring"
+                                                              : "syscalls");
+
+  for (auto _ : state)
+    ingester.read(paths, [](std::size_t, std::optional<std::string_view> c) {
+      benchmark::DoNotOptimize(c);
+    });
+
+  state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(paths.size()));
+}
+BENCHMARK(BM_Ingest)->ArgName("uring")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+static void BM_Ingest_Streams(benchmark::State &state) {
+  const auto &paths = small_files();
+
+  for (auto _ : state)
+    for (const auto &path : paths) {
+      std::ifstream file(path, std::ios::binary);
+      std::string content((std::istreambuf_iterator<char>(file)),
+                          std::istreambuf_iterator<char>());
+      benchmark::DoNotOptimize(content);
+    }
+
+  state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(paths.size()));
+}
+BENCHMARK(BM_Ingest_Streams)->Unit(benchmark::kMillisecond);
+
+// Redacts the names and CPR-numbers in a corpus into a new string.
+static void BM_Redact(benchmark::State &state) {
+  set_corpus_label(state);
+  const auto &content = corpus(state.range(0));
+  Redact::Redactor redactor;
+  redactor.add("cpr", CPRDetector::CPRDetector(),
+               {.policy = Redact::Policy::KeepLast4});
+  redactor.add("name", NameRule::NameRule(), {.policy = Redact::Policy::Tag});
+
+  for (auto _ : state)
+    benchmark::DoNotOptimize(redactor.redact(content));
+
+  state.SetBytesProcessed(int64_t(state.iterations()) *
+                          int64_t(content.size()));
+}
+BENCHMARK(BM_Redact)->ArgName("corpus")->Arg(WikiHtml)->Arg(GccTxt);
+
+// Counts the unique names in a corpus, for comparison with BM_NameRule.
+static void BM_FindUnique_NameRule(benchmark::State &state) {
+  set_corpus_label(state);
+  const auto &content = corpus(state.range(0));
+  NameRule::NameRule rule;
+  std::size_t unique = 0;
+
+  for (auto _ : state) {
+    auto results = Aggregate::find_unique(rule, content);
+    unique = results.size();
+    benchmark::DoNotOptimize(results);
+  }
+
+  state.SetBytesProcessed(int64_t(state.iterations()) *
+                          int64_t(content.size()));
+  state.counters["unique"] = double(unique);
+}
+BENCHMARK(BM_FindUnique_NameRule)->ArgName("corpus")->Arg(WikiHtml)->Arg(GccTxt);
+
+enum Format : long { JsonLines = 0, Binary = 1 };
+
+// Serializes the names in the Wikipedia corpus into a reused buffer.
+static void BM_Serialize(benchmark::State &state) {
+  NameRule::NameRule rule;
+  const auto matches = rule.find_matches(corpus(WikiHtml));
+  const Serializer::Fields fields = {.path = "list_9_11_victims.html",
+                                     .rule = "name"};
+  state.SetLabel(state.range(0) == JsonLines ? "jsonl" : "binary");
+
+  std::string out;
+  for (auto _ : state) {
+    out.clear();
+    if (state.range(0) == JsonLines) {
+      Serializer::JsonLines(out, fields).add(matches);
+    } else {
+      Serializer::BinaryRecord record(out, fields);
+      record.add(matches);
+      record.finish();
+    }
+    benchmark::DoNotOptimize(out.data());
+  }
+
+  state.SetItemsProcessed(int64_t(state.iterations()) *
+                          int64_t(matches.size()));
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(out.size()));
+}
+BENCHMARK(BM_Serialize)->ArgName("format")->Arg(JsonLines)->Arg(Binary);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,288 @@
+#ifndef CORPUS_GENERATOR_HPP
+#define CORPUS_GENERATOR_HPP
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <string_view>
+
+/*
+  Generator for synthetic benchmark corpora with a controlled density of
+  content that the rules look for.
+
+  Densities are given as the expected number of occurrences per KiB of
+  generated text, so the same options describe the same kind of document
+  at any size. The output is deterministic for a given seed.
+ */
+namespace OS2DSRules {
+
+namespace Benchmarks {
+
+namespace CorpusData {
+static constexpr auto firstnames = std::to_array({
+#include "datasets/female_firstnames.txt"
+#include "datasets/male_firstnames.txt"
+});
+
+static constexpr auto lastnames = std::to_array({
+#include "datasets/lastnames.txt"
+});
+
+static constexpr auto addresses = std::to_array({
+#include "datasets/da_addresses.txt"
+});
+
+static constexpr auto health_terms = std::to_array({
+#include "datasets/health_terms.txt"
+});
+
+static constexpr auto filler_words = std::to_array<std::string_view>(
+    {"og", "i", "at", "det", "er", "en", "til", "som", "på", "de", "med",
+     "han", "af", "for", "ikke", "der", "var", "mig", "sig", "men", "et",
+     "har", "om", "vi", "min", "havde", "ham", "hun", "nu", "over", "da",
+     "fra", "du", "ud", "sin", "dem", "os", "op", "man", "hans", "hvor",
+     "eller", "hvad", "skal", "selv", "her", "alle", "vil", "blev", "kunne"});
+}; // namespace CorpusData
+
+// The text that surrounds the generated content.
+enum class Filler {
+  // Lowercase Danish words and punctuation.
+  Prose,
+  // Long runs of digits, which keep CPRDetector out of its Empty state.
+  DigitRuns,
+  // Capitalised words, which make every token a dictionary candidate.
+  AllCaps,
+};
+
+struct CorpusOptions {
+  std::size_t size = 1 << 20;
+  std::uint64_t seed = 42;
+  Filler filler = Filler::Prose;
+
+  // Occurrences per KiB of text.
+  double valid_cprs = 0.0;
+  double invalid_cprs = 0.0;
+  double names = 0.0;
+  double addresses = 0.0;
+  double health_terms = 0.0;
+
+  // Probability that a CPR-number is written with a separator.
+  double separator_probability = 0.5;
+};
+
+class CorpusGenerator {
+public:
+  explicit CorpusGenerator(const CorpusOptions &options) noexcept
+      : options_(options), rng_(options.seed) {}
+
+  [[nodiscard]] std::string generate() {
+    std::string content;
+    content.reserve(options_.size + 64);
+
+    // Every insertion point is roughly one filler word apart, so the
+    // probability of inserting something there is scaled by the average
+    // number of bytes per filler word.
+    const double per_byte = 1.0 / 1024.0;
+    const double bytes_per_slot = average_slot_size();
+    const std::array<double, 5> weights = {
+        options_.valid_cprs, options_.invalid_cprs, options_.names,
+        options_.addresses, options_.health_terms};
+
+    while (content.size() < options_.size) {
+      bool inserted = false;
+
+      for (std::size_t kind = 0; kind < weights.size(); ++kind) {
+        if (weights[kind] <= 0.0)
+          continue;
+
+        if (uniform() < weights[kind] * per_byte * bytes_per_slot) {
+          append_kind(content, kind);
+          inserted = true;
+          break;
+        }
+      }
+
+      if (!inserted)
+        append_filler(content);
+
+      content += separator_after_word();
+    }
+
+    content.resize(options_.size);
+    return content;
+  }
+
+  // A CPR-number that CPRDetector accepts with the modulus 11 check.
+  [[nodiscard]] std::string valid_cpr() {
+    for (;;) {
+      std::string cpr = date(pick(1, 28), pick(1, 12), pick(0, 99));
+      for (int i = 0; i < 3; ++i)
+        cpr += digit(0, 9);
+
+      // Choose the last digit such that the weighted sum is divisible by 11.
+      static constexpr std::array<int, 9> factors = {4, 3, 2, 7, 6,
+                                                     5, 4, 3, 2};
+      int sum = 0;
+      for (std::size_t i = 0; i < factors.size(); ++i)
+        sum += (cpr[i] - '0') * factors[i];
+
+      const int last = (11 - sum % 11) % 11;
+      if (last == 10 || (cpr.substr(6, 3) == "000" && last == 0))
+        continue;
+
+      cpr += char('0' + last);
+      return with_separator(cpr);
+    }
+  }
+
+  // A ten digit number that looks like a CPR-number, but is rejected
+  // either because of its date or because of the modulus 11 check.
+  [[nodiscard]] std::string invalid_cpr() {
+    std::string cpr;
+
+    if (uniform() < 0.5) {
+      cpr = date(pick(32, 39), pick(1, 12), pick(0, 99));
+    } else {
+      cpr = valid_cpr();
+      cpr.erase(std::remove_if(cpr.begin(), cpr.end(),
+                               [](char c) { return !std::isdigit(c); }),
+                cpr.end());
+      cpr[9] = char('0' + (cpr[9] - '0' + 1) % 10);
+      return with_separator(cpr);
+    }
+
+    for (int i = 0; i < 4; ++i)
+      cpr += digit(0, 9);
+
+    return with_separator(cpr);
+  }
+
+private:
+  CorpusOptions options_;
+  std::mt19937_64 rng_;
+
+  double uniform() {
+    return std::uniform_real_distribution<double>(0.0, 1.0)(rng_);
+  }
+
+  int pick(int low, int high) {
+    return std::uniform_int_distribution<int>(low, high)(rng_);
+  }
+
+  char digit(int low, int high) { return char('0' + pick(low, high)); }
+
+  template <typename Words> std::string_view choose(const Words &words) {
+    return words[std::uniform_int_distribution<std::size_t>(
+        0, words.size() - 1)(rng_)];
+  }
+
+  static std::string two_digits(int value) {
+    return std::string{char('0' + value / 10), char('0' + value % 10)};
+  }
+
+  static std::string date(int day, int month, int year) {
+    return two_digits(day) + two_digits(month) + two_digits(year);
+  }
+
+  std::string with_separator(const std::string &cpr) {
+    if (uniform() >= options_.separator_probability)
+      return cpr;
+
+    static constexpr std::array<char, 3> separators = {' ', '-', '/'};
+    return cpr.substr(0, 6) + separators[std::size_t(pick(0, 2))] +
+           cpr.substr(6);
+  }
+
+  // Converts an uppercase dictionary entry to "Capitalised" form.
+  static std::string capitalise(std::string_view word) {
+    std::string result(word);
+    bool first = true;
+
+    for (auto &c : result) {
+      auto ch = static_cast<unsigned char>(c);
+      if (ch >= 0x80) {
+        first = false;
+        continue;
+      }
+
+      c = first ? char(std::toupper(ch)) : char(std::tolower(ch));
+      first = c == ' ' || c == '-';
+    }
+
+    return result;
+  }
+
+  void append_kind(std::string &content, std::size_t kind) {
+    switch (kind) {
+    case 0:
+      content += valid_cpr();
+      break;
+    case 1:
+      content += invalid_cpr();
+      break;
+    case 2:
+      content += capitalise(choose(CorpusData::firstnames));
+      content += ' ';
+      content += capitalise(choose(CorpusData::lastnames));
+      break;
+    case 3:
+      content += choose(CorpusData::addresses);
+      content += ' ';
+      content += std::to_string(pick(1, 250));
+      break;
+    default:
+      content += choose(CorpusData::health_terms);
+      break;
+    }
+  }
+
+  void append_filler(std::string &content) {
+    switch (options_.filler) {
+    case Filler::Prose:
+      content += choose(CorpusData::filler_words);
+      break;
+    case Filler::DigitRuns: {
+      const int length = pick(1, 64);
+      for (int i = 0; i < length; ++i)
+        content += digit(0, 9);
+      break;
+    }
+    case Filler::AllCaps: {
+      auto word = choose(CorpusData::filler_words);
+      for (auto c : word)
+        content += char(std::toupper(static_cast<unsigned char>(c)));
+      break;
+    }
+    }
+  }
+
+  std::string_view separator_after_word() {
+    const double p = uniform();
+    if (p < 0.05)
+      return ". ";
+    if (p < 0.08)
+      return ",\n";
+    return " ";
+  }
+
+  double average_slot_size() const noexcept {
+    switch (options_.filler) {
+    case Filler::DigitRuns:
+      return 33.5;
+    case Filler::AllCaps:
+    case Filler::Prose:
+    default:
+      return 4.0;
+    }
+  }
+};
+
+}; // namespace Benchmarks
+
+}; // namespace OS2DSRules
+
+#endif
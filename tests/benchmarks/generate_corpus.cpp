@@ -0,0 +1,102 @@
+#include "corpus_generator.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+using namespace OS2DSRules::Benchmarks;
+
+/*
+  Command-line front end for CorpusGenerator, for producing synthetic
+  corpora to feed to the benchmarks or to the Python bindings.
+ */
+
+static void usage(const char *program) {
+  std::cerr
+      << "Usage: " << program << " [options]\n"
+      << "\n"
+      << "  --size BYTES            Size of the corpus (default: 1048576).\n"
+      << "  --seed N                Seed for the generator (default: 42).\n"
+      << "  --filler KIND           prose, digits or caps (default: prose).\n"
+      << "  --valid-cprs D          Valid CPR-numbers per KiB.\n"
+      << "  --invalid-cprs D        Invalid CPR-numbers per KiB.\n"
+      << "  --separators P          Probability of a separator in a CPR.\n"
+      << "  --names D               Full names per KiB.\n"
+      << "  --addresses D           Street addresses per KiB.\n"
+      << "  --health-terms D        Health terms per KiB.\n"
+      << "  --output FILE           Write to FILE instead of stdout.\n";
+}
+
+int main(int argc, char **argv) {
+  CorpusOptions options;
+  std::string output;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg(argv[i]);
+
+    if (arg == "--help" || arg == "-h") {
+      usage(argv[0]);
+      return EXIT_SUCCESS;
+    }
+
+    if (i + 1 >= argc) {
+      std::cerr << "Missing value for " << arg << "\n";
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+
+    const std::string value(argv[++i]);
+
+    if (arg == "--size") {
+      options.size = std::stoull(value);
+    } else if (arg == "--seed") {
+      options.seed = std::stoull(value);
+    } else if (arg == "--filler") {
+      if (value == "prose") {
+        options.filler = Filler::Prose;
+      } else if (value == "digits") {
+        options.filler = Filler::DigitRuns;
+      } else if (value == "caps") {
+        options.filler = Filler::AllCaps;
+      } else {
+        std::cerr << "Unknown filler: " << value << "\n";
+        return EXIT_FAILURE;
+      }
+    } else if (arg == "--valid-cprs") {
+      options.valid_cprs = std::stod(value);
+    } else if (arg == "--invalid-cprs") {
+      options.invalid_cprs = std::stod(value);
+    } else if (arg == "--separators") {
+      options.separator_probability = std::stod(value);
+    } else if (arg == "--names") {
+      options.names = std::stod(value);
+    } else if (arg == "--addresses") {
+      options.addresses = std::stod(value);
+    } else if (arg == "--health-terms") {
+      options.health_terms = std::stod(value);
+    } else if (arg == "--output") {
+      output = value;
+    } else {
+      std::cerr << "Unknown option: " << arg << "\n";
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  const std::string corpus = CorpusGenerator(options).generate();
+
+  if (output.empty()) {
+    std::cout.write(corpus.data(), std::streamsize(corpus.size()));
+  } else {
+    std::ofstream file(output, std::ios::binary);
+    file.write(corpus.data(), std::streamsize(corpus.size()));
+    if (!file) {
+      std::cerr << "Could not write " << output << "\n";
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,394 @@
+#include <address_rule.hpp>
+#include <cpr-detector.hpp>
+#include <data_structures.hpp>
+#include <health_rule.hpp>
+#include <name_rule.hpp>
+#include <os2dsrules.hpp>
+#include <wordlist_rule.hpp>
+
+#include "corpus_generator.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <latch>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <unordered_set>
+#include <vector>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+using namespace OS2DSRules;
+using namespace OS2DSRules::Benchmarks;
+using namespace OS2DSRules::DataStructures;
+
+/*
+  Thread-scaling and memory-footprint harness for the rules.
+
+  Every rule is run concurrently on a sweep of thread counts, each thread
+  scanning the same corpus a fixed number of times, and the aggregate
+  throughput is reported together with the parallel efficiency relative
+  to a single thread. Rules with a const find_matches share one instance
+  between the threads, like a worker process would; CPRDetector gets one
+  instance per thread.
+
+  Memory is reported as resident set size, read from the kernel, and as
+  heap allocations counted by replacing the global operator new. The
+  counters are thread local, so counting does not disturb the sweep.
+ */
+
+namespace {
+
+struct AllocationCounter {
+  std::size_t allocations = 0;
+  std::size_t deallocations = 0;
+  std::size_t bytes = 0;
+};
+
+// Constant-initialized, so it also counts allocations made by the static
+// initializers of the library before main is entered.
+thread_local AllocationCounter allocation_counter;
+
+void *counted_allocation(std::size_t size) {
+  ++allocation_counter.allocations;
+  allocation_counter.bytes += size;
+
+  if (void *ptr = std::malloc(size == 0 ? 1 : size))
+    return ptr;
+
+  throw std::bad_alloc();
+}
+
+void counted_deallocation(void *ptr) noexcept {
+  if (ptr == nullptr)
+    return;
+
+  ++allocation_counter.deallocations;
+  std::free(ptr);
+}
+
+} // namespace
+
+void *operator new(std::size_t size) { return counted_allocation(size); }
+void *operator new[](std::size_t size) { return counted_allocation(size); }
+void operator delete(void *ptr) noexcept { counted_deallocation(ptr); }
+void operator delete[](void *ptr) noexcept { counted_deallocation(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept {
+  counted_deallocation(ptr);
+}
+void operator delete[](void *ptr, std::size_t) noexcept {
+  counted_deallocation(ptr);
+}
+
+namespace {
+
+// Allocations made by the current thread between construction and
+// a call to delta().
+class AllocationScope {
+public:
+  AllocationScope() noexcept : start_(allocation_counter) {}
+
+  [[nodiscard]] AllocationCounter delta() const noexcept {
+    return {allocation_counter.allocations - start_.allocations,
+            allocation_counter.deallocations - start_.deallocations,
+            allocation_counter.bytes - start_.bytes};
+  }
+
+private:
+  AllocationCounter start_;
+};
+
+// Peak resident set size of the process in KiB.
+std::size_t peak_rss_kib() noexcept {
+  rusage usage{};
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0;
+
+  return static_cast<std::size_t>(usage.ru_maxrss);
+}
+
+// Current resident set size of the process in KiB, or 0 if the platform
+// does not provide /proc/self/statm.
+std::size_t current_rss_kib() {
+  std::ifstream statm("/proc/self/statm");
+  std::size_t size = 0, resident = 0;
+  if (!(statm >> size >> resident))
+    return 0;
+
+  return resident * static_cast<std::size_t>(sysconf(_SC_PAGESIZE)) / 1024;
+}
+
+double mib(std::size_t bytes) noexcept { return double(bytes) / (1 << 20); }
+
+struct Options {
+  std::size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+  std::size_t iterations = 8;
+  std::string input;
+  std::vector<std::string> rules;
+  CorpusOptions corpus;
+};
+
+/*
+  Runs a scan function on a sweep of thread counts and prints one line
+  per thread count. make_scanner is called once per thread, before the
+  clock is started.
+ */
+using Scanner = std::function<std::size_t(std::string_view)>;
+
+void sweep(const Options &options, std::string_view content,
+           const std::function<Scanner()> &make_scanner) {
+  std::vector<std::size_t> counts;
+  for (std::size_t n = 1; n < options.max_threads; n *= 2)
+    counts.push_back(n);
+  counts.push_back(options.max_threads);
+
+  double single_thread = 0.0;
+
+  for (auto threads : counts) {
+    std::vector<Scanner> scanners;
+    for (std::size_t t = 0; t < threads; ++t)
+      scanners.push_back(make_scanner());
+
+    std::latch start(std::ptrdiff_t(threads) + 1);
+    std::vector<std::thread> workers;
+    std::vector<std::size_t> matches(threads, 0);
+
+    for (std::size_t t = 0; t < threads; ++t) {
+      workers.emplace_back([&, t] {
+        start.arrive_and_wait();
+        for (std::size_t i = 0; i < options.iterations; ++i)
+          matches[t] += scanners[t](content);
+      });
+    }
+
+    start.arrive_and_wait();
+    const auto begin = std::chrono::steady_clock::now();
+    for (auto &worker : workers)
+      worker.join();
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - begin;
+
+    const double bytes =
+        double(content.size()) * double(options.iterations) * double(threads);
+    const double throughput = bytes / elapsed.count() / (1 << 20);
+    if (threads == 1)
+      single_thread = throughput;
+
+    std::printf("  threads %3zu  %10.2f MiB/s  efficiency %5.1f%%  "
+                "matches/scan %zu\n",
+                threads, throughput,
+                100.0 * throughput / (single_thread * double(threads)),
+                matches[0] / options.iterations);
+  }
+}
+
+/*
+  Reports construction and per-scan allocations for a rule, and then
+  runs the thread sweep on it.
+ */
+template <typename Rule, typename Factory>
+void measure(const Options &options, const char *name,
+             std::string_view content, Factory make_rule) {
+  const auto rss_before = current_rss_kib();
+
+  AllocationScope construction;
+  auto rule = std::make_shared<Rule>(make_rule());
+  const auto constructed = construction.delta();
+
+  AllocationScope scan;
+  const auto results = rule->find_matches(content);
+  const auto scanned = scan.delta();
+
+  std::printf("%s\n", name);
+  std::printf("  construction  %zu allocations, %.2f MiB\n",
+              constructed.allocations, mib(constructed.bytes));
+  std::printf("  per scan      %zu allocations, %.2f MiB, %zu matches "
+              "(%.2f MiB of MatchResults)\n",
+              scanned.allocations, mib(scanned.bytes), results.size(),
+              mib(results.capacity() * sizeof(MatchResult)));
+  std::printf("  rss           %+ld KiB\n",
+              long(current_rss_kib()) - long(rss_before));
+
+  if constexpr (requires(const Rule &r) { r.find_matches(content); }) {
+    // Stateless scans share a single instance between the threads.
+    sweep(options, content, [&] {
+      return Scanner([rule](std::string_view text) {
+        return rule->find_matches(text).size();
+      });
+    });
+  } else {
+    sweep(options, content, [&] {
+      auto own = std::make_shared<Rule>(make_rule());
+      return Scanner([own](std::string_view text) {
+        return own->find_matches(text).size();
+      });
+    });
+  }
+}
+
+/*
+  Reports the heap footprint of a freshly constructed dictionary. The
+  rules build their own copies during static initialization.
+ */
+template <typename Words>
+void measure_dictionary(const char *name, const Words &words) {
+  AllocationScope scope;
+  auto set = std::make_unique<FrozenHashSet<std::tuple_size_v<Words>>>(words);
+  const auto delta = scope.delta();
+
+  std::printf("  %-20s %8zu words  %8zu chain nodes  %7.2f MiB\n", name,
+              words.size(), delta.allocations - 1, mib(delta.bytes));
+}
+
+void measure_dictionaries() {
+  std::printf("Dictionaries (FrozenHashSet)\n");
+  measure_dictionary("firstnames", CorpusData::firstnames);
+  measure_dictionary("lastnames", CorpusData::lastnames);
+  measure_dictionary("addresses", CorpusData::addresses);
+
+  AllocationScope scope;
+  auto health = std::make_unique<std::unordered_set<std::string_view>>(
+      CorpusData::health_terms.begin(), CorpusData::health_terms.end());
+  const auto delta = scope.delta();
+  std::printf("  %-20s %8zu words  %8zu allocations  %7.2f MiB\n",
+              "health terms", health->size(), delta.allocations,
+              mib(delta.bytes));
+}
+
+bool selected(const Options &options, std::string_view rule) {
+  return options.rules.empty() ||
+         std::find(options.rules.begin(), options.rules.end(), rule) !=
+             options.rules.end();
+}
+
+void usage(const char *program) {
+  std::cerr
+      << "Usage: " << program << " [options]\n"
+      << "\n"
+      << "  --threads N         Largest number of threads (default: cores).\n"
+      << "  --iterations N      Scans per thread (default: 8).\n"
+      << "  --size BYTES        Size of the synthetic corpus (default: 1 MiB).\n"
+      << "  --input FILE        Scan FILE instead of a synthetic corpus.\n"
+      << "  --rule NAME         Only run NAME: cpr, name, address, health or\n"
+      << "                      wordlist. May be given more than once.\n";
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  // Allocations made before main are the static dictionaries of the rules.
+  const auto static_allocations = allocation_counter;
+  const auto rss_at_start = current_rss_kib();
+
+  Options options;
+  options.corpus.valid_cprs = 2.0;
+  options.corpus.invalid_cprs = 2.0;
+  options.corpus.names = 2.0;
+  options.corpus.addresses = 1.0;
+  options.corpus.health_terms = 1.0;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg(argv[i]);
+
+    if (arg == "--help" || arg == "-h") {
+      usage(argv[0]);
+      return EXIT_SUCCESS;
+    }
+
+    if (i + 1 >= argc) {
+      std::cerr << "Missing value for " << arg << "\n";
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+
+    const std::string value(argv[++i]);
+
+    if (arg == "--threads") {
+      options.max_threads = std::max<std::size_t>(1, std::stoull(value));
+    } else if (arg == "--iterations") {
+      options.iterations = std::max<std::size_t>(1, std::stoull(value));
+    } else if (arg == "--size") {
+      options.corpus.size = std::stoull(value);
+    } else if (arg == "--input") {
+      options.input = value;
+    } else if (arg == "--rule") {
+      options.rules.push_back(value);
+    } else {
+      std::cerr << "Unknown option: " << arg << "\n";
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::string content;
+  if (options.input.empty()) {
+    content = CorpusGenerator(options.corpus).generate();
+  } else {
+    std::ifstream file(options.input, std::ios::binary);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    if (!file) {
+      std::cerr << "Could not read " << options.input << "\n";
+      return EXIT_FAILURE;
+    }
+    content = buffer.str();
+  }
+
+  std::printf("Corpus %.2f MiB, %zu iterations per thread, up to %zu "
+              "threads\n\n",
+              mib(content.size()), options.iterations, options.max_threads);
+  std::printf("Static initialization\n");
+  std::printf("  %zu allocations, %.2f MiB, rss %zu KiB at start of main\n\n",
+              static_allocations.allocations, mib(static_allocations.bytes),
+              rss_at_start);
+
+  measure_dictionaries();
+  std::printf("\n");
+
+  if (selected(options, "cpr")) {
+    measure<CPRDetector::CPRDetector>(options, "CPRDetector", content, [] {
+      return CPRDetector::CPRDetector(true, true);
+    });
+  }
+
+  if (selected(options, "name")) {
+    measure<NameRule::NameRule>(options, "NameRule", content,
+                                [] { return NameRule::NameRule(); });
+  }
+
+  if (selected(options, "address")) {
+    measure<AddressRule::AddressRule>(options, "AddressRule", content,
+                                      [] { return AddressRule::AddressRule(); });
+  }
+
+  if (selected(options, "health")) {
+    measure<HealthRule::HealthRule>(options, "HealthRule", content,
+                                    [] { return HealthRule::HealthRule(); });
+  }
+
+  if (selected(options, "wordlist")) {
+    measure<WordListRule::WordListRule>(
+        options, "WordListRule", content, [] {
+          auto words = std::to_array<std::string_view>(
+              {"og", "skal", "hvor", "kunne"});
+          return WordListRule::WordListRule(words.begin(), words.end());
+        });
+  }
+
+  std::printf("\nPeak rss %zu KiB\n", peak_rss_kib());
+
+  return EXIT_SUCCESS;
+}
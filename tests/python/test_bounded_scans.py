@@ -0,0 +1,28 @@
+from os2ds_rules import CPRDetector, NameRule
+
+
+def test_offset_of_non_ascii_str_without_matches_is_in_code_points():
+    matches = CPRDetector().find_matches("æøå", max_matches=5)
+    assert len(matches) == 0
+    assert not matches.truncated
+    assert matches.offset == 3
+
+
+def test_truncated_scan_resumes_from_offset():
+    text = "Søren har 1111111118 og Åse har 2110625629."
+    matches = CPRDetector().find_matches(text, max_matches=1)
+    assert matches.truncated
+    assert matches.stop_reason == "max_matches"
+    assert text[matches[0]["start"]:matches[0]["end"] + 1] == "1111111118"
+
+    rest = CPRDetector().find_matches(text[matches.offset:])
+    assert [m["match"] for m in rest] == ["2110625629"]
+
+
+def test_byte_budget_counts_utf8_bytes():
+    text = "æ" * 10 + " John Hansen"
+    matches = NameRule().find_matches(text, byte_budget=10)
+    assert matches.truncated
+    assert matches.stop_reason == "byte_budget"
+    assert len(matches) == 0
+    assert matches.offset == 5
@@ -0,0 +1,53 @@
+import mmap
+
+import pytest
+
+from os2ds_rules import CPRDetector, NameRule
+
+TEXT = "Jens Hansen fra Århus har CPR 1111111118."
+DATA = TEXT.encode()
+
+
+def matches_of(rule, content):
+    return [(m["match"], m["start"], m["end"]) for m in rule.find_matches(content)]
+
+
+@pytest.mark.parametrize("wrap", [bytes, bytearray, memoryview])
+def test_bytes_like_content_is_scanned_as_utf8(wrap):
+    content = wrap(DATA)
+    start = DATA.index(b"1111")
+    assert matches_of(CPRDetector(), content) == [("1111111118", start, start + 9)]
+    assert matches_of(NameRule(), content) == [("Jens Hansen", 0, 11)]
+
+
+def test_mmap_is_scanned_in_place(tmp_path):
+    path = tmp_path / "brev.txt"
+    path.write_bytes(DATA * 1000)
+    with open(path, "rb") as file, \
+            mmap.mmap(file.fileno(), 0, access=mmap.ACCESS_READ) as mapped:
+        assert matches_of(CPRDetector(), mapped) == matches_of(CPRDetector(),
+                                                               DATA * 1000)
+
+
+def test_slices_of_a_memoryview_are_scanned_alone():
+    view = memoryview(DATA * 2)[len(DATA):]
+    assert matches_of(CPRDetector(), view) == matches_of(CPRDetector(), DATA)
+
+
+def test_buffers_exported_to_a_scan_are_released():
+    content = bytearray(DATA)
+    CPRDetector().find_matches(content)
+    content.extend(b" og 2110625629")
+    assert len(CPRDetector().find_matches(content)) == 2
+
+
+def test_invalid_utf8_is_scanned_past():
+    content = b"\xff\xfe Jens Hansen 1111111118"
+    assert matches_of(NameRule(), content) == [("Jens Hansen", 3, 14)]
+    assert matches_of(CPRDetector(), content) == [("1111111118", 15, 24)]
+
+
+@pytest.mark.parametrize("content", [42, None, ["1111111118"]])
+def test_other_objects_are_rejected(content):
+    with pytest.raises(TypeError, match="str or a bytes-like object"):
+        CPRDetector().find_matches(content)
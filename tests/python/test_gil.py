@@ -0,0 +1,58 @@
+import threading
+import time
+
+from os2ds_rules import AddressRule, CPRDetector, NameRule, WordListRule
+
+TEXT = "Kære John Hansen, dit CPR-nummer er 1111111118. Vi bor på Nørregade 12.\n"
+
+
+def rules():
+    return [CPRDetector(), NameRule(), AddressRule(),
+            WordListRule(["cpr-nummer", "hansen"])]
+
+
+def test_other_threads_run_while_a_scan_runs():
+    document = "Ingen Navne Her, kun tekst om Vejret. " * 1_000_000
+    rule = NameRule()
+    done = threading.Event()
+    elapsed = []
+
+    def scan():
+        start = time.perf_counter()
+        rule.find_matches(document)
+        elapsed.append(time.perf_counter() - start)
+        done.set()
+
+    thread = threading.Thread(target=scan)
+    thread.start()
+    gap = 0.0
+    last = time.perf_counter()
+    while not done.is_set():
+        now = time.perf_counter()
+        gap = max(gap, now - last)
+        last = now
+    thread.join()
+
+    # With the GIL held for the whole scan, this thread would stand still
+    # for as long as the scan takes.
+    assert elapsed[0] > 0.1
+    assert gap < elapsed[0] / 2
+
+
+def test_rules_are_shared_between_threads():
+    for rule in rules():
+        expected = rule.find_matches(TEXT).tolist()
+        assert expected
+        results = [None] * 8
+
+        def scan(i):
+            results[i] = [rule.find_matches(TEXT).tolist() for _ in range(50)]
+
+        threads = [threading.Thread(target=scan, args=(i,)) for i in range(8)]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+
+        for per_thread in results:
+            assert all(result == expected for result in per_thread)
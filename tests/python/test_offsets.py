@@ -0,0 +1,40 @@
+import pytest
+
+from os2ds_rules import AddressRule, CPRDetector, NameRule, WordListRule
+
+
+def test_offsets_into_ascii_str_are_bytes_and_code_points():
+    text = "Jens Hansen, CPR 1111111118."
+    m = CPRDetector().find_matches(text)[0]
+    assert text[m["start"]:m["end"] + 1] == "1111111118"
+
+
+@pytest.mark.parametrize("prefix", ["Æ", "ø" * 63, "€" * 70, "😀 " * 40])
+def test_offsets_into_non_ascii_str_are_code_points(prefix):
+    # The prefixes cross the blocks of the code point index.
+    text = prefix + " Jens Hansen bor på Nørregade 12, CPR 1111111118 æ"
+
+    m = CPRDetector().find_matches(text)[0]
+    assert text[m["start"]:m["end"] + 1] == "1111111118"
+    m = NameRule().find_matches(text)[0]
+    assert text[m["start"]:m["end"]] == "Jens Hansen"
+    m = AddressRule().find_matches(text)[0]
+    assert text[m["start"]:m["end"] + 1] == "Nørregade 12"
+
+
+def test_columns_are_in_code_points():
+    text = "ÆØÅ 1111111118 og 2110625629"
+    matches = CPRDetector().find_matches(text)
+    assert matches.starts.tolist() == [4, 18]
+    assert matches.ends.tolist() == [13, 27]
+
+
+def test_match_at_the_end_of_a_non_ascii_str():
+    text = "Søren og hemmelig"
+    m = WordListRule(["hemmelig"]).find_matches(text)[0]
+    assert (m["start"], m["end"]) == (9, 16)
+
+
+def test_offsets_into_bytes_stay_in_bytes():
+    data = "ÆØÅ 1111111118".encode()
+    assert CPRDetector().find_matches(data).starts.tolist() == [7]
@@ -0,0 +1,50 @@
+import gc
+
+import pytest
+
+from os2ds_rules import CPRDetector
+
+TEXT = "CPR 1111111118 og 2110625629."
+
+
+def test_results_are_a_sequence_of_dicts():
+    matches = CPRDetector().find_matches(TEXT)
+    assert len(matches) == 2
+    assert matches[0] == {"match": "1111111118", "start": 4, "end": 13,
+                          "probability": 1.0}
+    assert matches[-1]["match"] == "2110625629"
+    assert [m["match"] for m in matches] == ["1111111118", "2110625629"]
+    assert matches.tolist() == [matches[0], matches[1]]
+    assert repr(matches) == "<MatchResults with 2 matches>"
+    with pytest.raises(IndexError):
+        matches[2]
+
+
+def test_columns_are_memoryviews():
+    matches = CPRDetector().find_matches(TEXT)
+    starts, ends, probabilities = (matches.starts, matches.ends,
+                                   matches.probabilities)
+
+    assert isinstance(starts, memoryview)
+    assert starts.readonly
+    assert starts.format == "n" and probabilities.format == "d"
+    assert starts.tolist() == [m["start"] for m in matches]
+    assert ends.tolist() == [m["end"] for m in matches]
+    assert probabilities.tolist() == [1.0, 1.0]
+    with pytest.raises(TypeError):
+        starts[0] = 0
+
+
+def test_columns_keep_the_results_alive():
+    starts = CPRDetector().find_matches(TEXT).starts
+    gc.collect()
+    assert starts.tolist() == [4, 18]
+
+
+def test_empty_results():
+    matches = CPRDetector().find_matches("ingenting")
+    assert len(matches) == 0
+    assert matches.tolist() == []
+    assert matches.starts.tolist() == []
+    assert not matches.truncated
+    assert matches.stop_reason == "completed"
@@ -0,0 +1,41 @@
+import pytest
+
+from os2ds_rules import (AddressRule, CPRDetector, NameRule, WordListRule,
+                         _CPRDetector, _NameRule)
+
+
+def test_configuration_is_kept_across_calls():
+    lenient = CPRDetector()
+    strict = CPRDetector(check_mod11=True)
+    for _ in range(3):
+        assert len(lenient.find_matches("1111111111")) == 1
+        assert len(strict.find_matches("1111111111")) == 0
+        assert len(strict.find_matches("1111111118")) == 1
+
+
+def test_every_rule_finds_its_matches():
+    text = "Jens Hansen bor på Nørregade 12 og har CPR 1111111118."
+    assert [m["match"] for m in CPRDetector().find_matches(text)] == ["1111111118"]
+    assert [m["match"] for m in NameRule().find_matches(text)] == ["Jens Hansen"]
+    assert [m["match"] for m in AddressRule().find_matches(text)] == ["Nørregade 12"]
+    assert [m["match"] for m in WordListRule(["cpr"]).find_matches(text)] == ["cpr"]
+
+
+@pytest.mark.parametrize("kind, args", [(CPRDetector, ()), (NameRule, ()),
+                                        (WordListRule, (["hemmelig"],))])
+def test_rules_cannot_be_initialized_twice(kind, args):
+    rule = kind(*args)
+    text = "Jens Hansen, 1111111118, hemmelig"
+    before = rule.find_matches(text).tolist()
+    with pytest.raises(RuntimeError,
+                       match=f"{kind.__name__} is already initialized."):
+        rule.__init__(*args)
+    assert rule.find_matches(text).tolist() == before
+
+
+@pytest.mark.parametrize("kind, name", [(_CPRDetector, "CPRDetector"),
+                                        (_NameRule, "NameRule")])
+def test_uninitialized_rules_refuse_to_scan(kind, name):
+    rule = kind.__new__(kind)
+    with pytest.raises(RuntimeError, match=f"{name} is not initialized."):
+        rule.find_matches("Jens Hansen 1111111118")
@@ -3,6 +3,7 @@
 #include <gtest/gtest.h>
 #include <iostream>
 #include <string>
+#include <string_view>
 
 using namespace OS2DSRules::AddressRule;
 
@@ -47,6 +48,15 @@ TEST_F(AddressRuleTest, Test_Address_Invalid_Number_No_Matches) {
   ASSERT_EQ(0, results.size());
 }
 
+TEST_F(AddressRuleTest, Test_Address_Followed_By_Space_At_End_Of_String_View) {
+  const std::string buffer = "Aabyvej 1 Aabyvej ";
+  AddressRule rule;
+  auto results = rule.find_matches(std::string_view(buffer.data(), 10));
+
+  ASSERT_EQ(1, results.size());
+  ASSERT_EQ(std::string("Aabyvej 1"), results[0].match());
+}
+
 int main(int argc, char **argv) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
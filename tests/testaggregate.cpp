@@ -0,0 +1,111 @@
+#include <aggregate.hpp>
+#include <cpr-detector.hpp>
+#include <gtest/gtest.h>
+#include <name_rule.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <wordlist_rule.hpp>
+
+using namespace OS2DSRules;
+using namespace OS2DSRules::Aggregate;
+
+class AggregateTest : public testing::Test {};
+
+std::string normalized(std::string_view match, Normalize how) {
+  std::string out;
+  normalize(match, how, out);
+  return out;
+}
+
+TEST_F(AggregateTest, Matches_Are_Normalized) {
+  ASSERT_EQ("john hansen", normalized("John  Hansen", Normalize::Text));
+  ASSERT_EQ("søren ærø", normalized(" SØREN\n\xC2\xA0" "ÆRØ ", Normalize::Text));
+  ASSERT_EQ("a×b", normalized("A×B", Normalize::Text));
+  ASSERT_EQ("1111111118", normalized("111111-1118", Normalize::Digits));
+  ASSERT_EQ("1111111118", normalized("111111 1118", Normalize::Digits));
+}
+
+TEST_F(AggregateTest, Repeated_Matches_Are_Counted) {
+  std::string document;
+  for (int i = 0; i < 1000; ++i)
+    document += "John Hansen og JOHN HANSEN og Anna Jensen.\n";
+
+  NameRule::NameRule rule;
+  const auto unique = find_unique(rule, document, {.block_size = 4096});
+
+  ASSERT_EQ(2, unique.size());
+  ASSERT_EQ("john hansen", unique[0].match);
+  ASSERT_EQ(2000, unique[0].count);
+  ASSERT_EQ(0, unique[0].first);
+  ASSERT_EQ(document.rfind("JOHN HANSEN"), unique[0].last);
+  ASSERT_EQ("anna jensen", unique[1].match);
+  ASSERT_EQ(1000, unique[1].count);
+  ASSERT_EQ(document.find("Anna"), unique[1].first);
+  ASSERT_EQ(document.rfind("Anna"), unique[1].last);
+  ASSERT_EQ(Sensitivity::Critical, unique[1].sensitivity);
+}
+
+TEST_F(AggregateTest, Blocks_Do_Not_Change_The_Result) {
+  std::string document;
+  for (int i = 0; i < 50; ++i)
+    document += "CPR 111111-1118, 1111111118 og 2110625629 for John Hansen.\n";
+
+  CPRDetector::CPRDetector detector;
+  Counter whole(normalize_of<CPRDetector::CPRDetector>);
+  whole.add(detector.find_matches(document));
+  ASSERT_EQ(150, whole.occurrences());
+  ASSERT_EQ(2, whole.unique().size());
+  ASSERT_EQ("1111111118", whole.unique()[0].match);
+  ASSERT_EQ(100, whole.unique()[0].count);
+
+  NameRule::NameRule rule;
+  Counter names;
+  names.add(rule.find_matches(document));
+  ASSERT_EQ(50, names.occurrences());
+
+  for (const std::size_t block : {1, 7, 64, 4096}) {
+    const auto unique = find_unique(detector, document, {.block_size = block});
+    ASSERT_EQ(whole.unique(), unique) << block;
+    ASSERT_EQ(names.unique(), find_unique(rule, document, {.block_size = block}))
+        << block;
+  }
+}
+
+TEST_F(AggregateTest, Table_Grows) {
+  Counter counter;
+  for (int round = 0; round < 2; ++round)
+    for (std::size_t i = 0; i < 10000; ++i)
+      counter.add(MatchResult("Word" + std::to_string(i), i, i + 1));
+
+  ASSERT_EQ(20000, counter.occurrences());
+  ASSERT_EQ(10000, counter.unique().size());
+  for (std::size_t i = 0; i < 10000; ++i) {
+    const auto &unique = counter.unique()[i];
+    ASSERT_EQ("word" + std::to_string(i), unique.match);
+    ASSERT_EQ(2, unique.count);
+    ASSERT_EQ(i, unique.first);
+  }
+
+  const auto taken = counter.take();
+  ASSERT_EQ(10000, taken.size());
+  ASSERT_TRUE(counter.unique().empty());
+  counter.add(MatchResult("word0", 0, 4));
+  ASSERT_EQ(1, counter.unique()[0].count);
+}
+
+TEST_F(AggregateTest, Word_Lists_Are_Counted) {
+  std::vector<std::string> words = {"hemmelig", "fortrolig"};
+  WordListRule::WordListRule rule(words.begin(), words.end());
+  const auto unique =
+      find_unique(rule, "Hemmelig og fortrolig, HEMMELIG og hemmelig");
+  ASSERT_EQ(2, unique.size());
+  ASSERT_EQ("hemmelig", unique[0].match);
+  ASSERT_EQ(3, unique[0].count);
+  ASSERT_EQ(1, unique[1].count);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,203 @@
+#include <address_rule.hpp>
+#include <array>
+#include <content_hash.hpp>
+#include <cpr-detector.hpp>
+#include <gtest/gtest.h>
+#include <name_rule.hpp>
+#include <result_cache.hpp>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <wordlist_rule.hpp>
+
+using namespace OS2DSRules;
+using namespace OS2DSRules::ResultCache;
+
+class ResultCacheTest : public testing::Test {};
+
+// A document of paragraphs, with a CPR-number and a name in every fifth.
+std::string paragraphs(std::size_t count, const std::string &prefix = "") {
+  std::string content = prefix;
+  for (std::size_t i = 0; i < count; ++i) {
+    content += std::string(200, 'x');
+    if (i % 5 == 0)
+      content += " John har CPR-nummer 1111111118.";
+    content += " Afsnit " + std::to_string(i) + " handler om ingenting.\n\n";
+  }
+  return content;
+}
+
+TEST_F(ResultCacheTest, Hash_Is_Deterministic) {
+  using ContentHash::hash128;
+
+  ASSERT_EQ(hash128("hello"), hash128("hello"));
+  ASSERT_NE(hash128("hello"), hash128("hellp"));
+  ASSERT_NE(hash128("hello"), hash128("hello", 1));
+  ASSERT_NE(hash128(""), hash128(std::string_view("\0", 1)));
+
+  // Every length of tail is mixed in.
+  for (std::size_t size = 1; size < 40; ++size) {
+    std::string a(size, 'a');
+    std::string b = a;
+    b.back() = 'b';
+    ASSERT_NE(hash128(a), hash128(b)) << size;
+  }
+
+  ASSERT_EQ(32, hash128("hello").to_hex().size());
+}
+
+TEST_F(ResultCacheTest, Config_Hashes_Differ) {
+  CPRDetector::CPRDetector plain;
+  CPRDetector::CPRDetector mod11(true);
+  NameRule::NameRule names;
+  AddressRule::AddressRule addresses;
+
+  auto first = std::to_array<std::string_view>({"a", "b"});
+  auto second = std::to_array<std::string_view>({"b", "a"});
+  auto third = std::to_array<std::string_view>({"a", "c"});
+  WordListRule::WordListRule ab(first.begin(), first.end());
+  WordListRule::WordListRule ba(second.begin(), second.end());
+  WordListRule::WordListRule ac(third.begin(), third.end());
+
+  ASSERT_NE(plain.config_hash(), mod11.config_hash());
+  ASSERT_NE(names.config_hash(), addresses.config_hash());
+  ASSERT_EQ(ab.config_hash(), ba.config_hash());
+  ASSERT_NE(ab.config_hash(), ac.config_hash());
+}
+
+TEST_F(ResultCacheTest, Hit_Returns_Same_Results) {
+  ResultCache::ResultCache cache(1 << 20);
+  CPRDetector::CPRDetector detector;
+  const std::string content = "CPR: 1111111118 og 2110625629";
+
+  auto first = cache.find_matches(detector, content);
+  auto second = cache.find_matches(detector, content);
+
+  ASSERT_EQ(2, first.size());
+  ASSERT_EQ(first, second);
+
+  auto stats = cache.stats();
+  ASSERT_EQ(1, stats.hits);
+  ASSERT_EQ(1, stats.misses);
+  ASSERT_EQ(1, stats.entries);
+}
+
+TEST_F(ResultCacheTest, Rule_Configuration_Is_Part_Of_Key) {
+  ResultCache::ResultCache cache(1 << 20);
+  CPRDetector::CPRDetector plain;
+  CPRDetector::CPRDetector mod11(true);
+  const std::string content = "CPR: 1111111119";
+
+  ASSERT_EQ(1, cache.find_matches(plain, content).size());
+  ASSERT_EQ(0, cache.find_matches(mod11, content).size());
+  ASSERT_EQ(0, cache.stats().hits);
+}
+
+TEST_F(ResultCacheTest, Evicts_Least_Recently_Used) {
+  const MatchResults results = {MatchResult("match", 0, 4)};
+  const auto size = ResultCache::ResultCache::entry_size(results);
+  ResultCache::ResultCache cache(2 * size, 1);
+
+  const Key a{ContentHash::hash128("a"), 0};
+  const Key b{ContentHash::hash128("b"), 0};
+  const Key c{ContentHash::hash128("c"), 0};
+
+  cache.insert(a, results);
+  cache.insert(b, results);
+  ASSERT_TRUE(cache.find(a).has_value());
+  cache.insert(c, results);
+
+  ASSERT_TRUE(cache.find(a).has_value());
+  ASSERT_FALSE(cache.find(b).has_value());
+  ASSERT_TRUE(cache.find(c).has_value());
+  ASSERT_EQ(1, cache.stats().evictions);
+  ASSERT_LE(cache.stats().bytes, cache.capacity());
+}
+
+TEST_F(ResultCacheTest, Oversized_Results_Are_Not_Cached) {
+  ResultCache::ResultCache cache(16);
+  const Key key{ContentHash::hash128("a"), 0};
+
+  cache.insert(key, {MatchResult("match", 0, 4)});
+  ASSERT_FALSE(cache.find(key).has_value());
+}
+
+TEST_F(ResultCacheTest, Chunks_Cover_Content_At_Blank_Lines) {
+  const auto content = paragraphs(2000);
+  ChunkOptions options;
+  options.min_size = 4096;
+
+  const auto chunks = content_defined_chunks(content, options);
+  ASSERT_GT(chunks.size(), 2);
+
+  std::size_t covered = 0;
+  for (std::size_t i = 0; i < chunks.size(); ++i) {
+    ASSERT_EQ(content.data() + covered, chunks[i].data());
+    covered += chunks[i].size();
+    if (i + 1 < chunks.size()) {
+      ASSERT_GE(chunks[i].size(), options.min_size);
+      ASSERT_TRUE(chunks[i].ends_with("\n\n"));
+    }
+  }
+  ASSERT_EQ(content.size(), covered);
+}
+
+TEST_F(ResultCacheTest, Chunked_Scan_Matches_Whole_Scan) {
+  ResultCache::ResultCache cache(1 << 24);
+  CPRDetector::CPRDetector detector;
+  NameRule::NameRule names;
+  ChunkOptions options;
+  options.min_size = 4096;
+
+  const auto content = paragraphs(2000);
+
+  ASSERT_EQ(detector.find_matches(content),
+            cache.find_matches_chunked(detector, content, options));
+  ASSERT_EQ(names.find_matches(content),
+            cache.find_matches_chunked(names, content, options));
+}
+
+TEST_F(ResultCacheTest, Near_Duplicates_Reuse_Chunks) {
+  ResultCache::ResultCache cache(1 << 24);
+  CPRDetector::CPRDetector detector;
+  ChunkOptions options;
+  options.min_size = 4096;
+
+  const auto original = paragraphs(2000);
+  const auto edited = paragraphs(2000, "Et nyt første afsnit.\n\n");
+
+  (void)cache.find_matches_chunked(detector, original, options);
+  const auto before = cache.stats();
+  auto results = cache.find_matches_chunked(detector, edited, options);
+  const auto after = cache.stats();
+
+  ASSERT_EQ(detector.find_matches(edited), results);
+  // Only the chunks around the edit are scanned again.
+  ASSERT_GT(after.hits - before.hits, 0.8 * double(after.hits + after.misses -
+                                                  before.hits - before.misses));
+}
+
+TEST_F(ResultCacheTest, Concurrent_Use) {
+  ResultCache::ResultCache cache(1 << 20, 4);
+  const std::string content = "CPR: 1111111118";
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&cache, &content] {
+      CPRDetector::CPRDetector detector;
+      for (int i = 0; i < 1000; ++i)
+        ASSERT_EQ(1, cache.find_matches(detector, content).size());
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+
+  ASSERT_EQ(4000, cache.stats().hits + cache.stats().misses);
+  ASSERT_EQ(1, cache.stats().entries);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,258 @@
+#include <address_rule.hpp>
+#include <array>
+#include <checkpoint.hpp>
+#include <cpr-detector.hpp>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <health_rule.hpp>
+#include <name_rule.hpp>
+#include <string>
+#include <string_view>
+#include <wordlist_rule.hpp>
+
+using namespace OS2DSRules;
+using namespace OS2DSRules::Checkpoint;
+
+class CheckpointTest : public testing::Test {};
+
+const std::string document =
+    "Kære John Peter Hansen.\n"
+    "Dit CPR-nummer er 1111111118, og din datter Anna har 211062-5629.\n"
+    "Vi sender brevet til Aabyvej 12 i morgen. x1111111118 er ikke et\n"
+    "CPR-nummer, men 0101010000 og 3112999999 er heller ikke.\n\n"
+    "Hilsen Mette, som har cancer. Ring på 1111111118";
+
+// Feeds content to a stream in pieces of the given size, and returns every
+// match of the stream.
+template <typename Rule>
+MatchResults stream_matches(Rule &rule, std::string_view content,
+                            std::size_t piece) {
+  Stream<Rule> stream(rule);
+  MatchResults matches;
+
+  for (std::size_t i = 0; i < content.size(); i += piece)
+    for (auto &m : stream.feed(content.substr(i, piece)))
+      matches.push_back(m);
+
+  for (auto &m : stream.finish())
+    matches.push_back(m);
+
+  return matches;
+}
+
+// Scans content up to split, checkpoints, and resumes on the rest.
+template <typename Rule>
+MatchResults resumed_matches(Rule &rule, std::string_view content,
+                             std::size_t split) {
+  Stream<Rule> first(rule);
+  MatchResults matches = first.feed(content.substr(0, split));
+
+  auto checkpoint = deserialize(serialize(first.checkpoint()));
+  EXPECT_TRUE(checkpoint.has_value());
+
+  auto second = Stream<Rule>::resume(rule, checkpoint.value());
+  EXPECT_TRUE(second.has_value());
+
+  for (auto &m : second->feed(content.substr(split)))
+    matches.push_back(m);
+  for (auto &m : second->finish())
+    matches.push_back(m);
+
+  return matches;
+}
+
+template <typename Rule> void expect_same_as_full_scan(Rule &rule) {
+  const auto expected = rule.find_matches(document);
+  ASSERT_FALSE(expected.empty());
+
+  for (std::size_t split = 0; split <= document.size(); ++split)
+    ASSERT_EQ(expected, resumed_matches(rule, document, split))
+        << "split at " << split;
+
+  for (std::size_t piece : {1, 2, 3, 7, 64})
+    ASSERT_EQ(expected, stream_matches(rule, document, piece))
+        << "pieces of " << piece;
+}
+
+TEST_F(CheckpointTest, CPR_Resumes_Anywhere) {
+  CPRDetector::CPRDetector detector;
+  expect_same_as_full_scan(detector);
+}
+
+TEST_F(CheckpointTest, CPR_Mod11_Resumes_Anywhere) {
+  CPRDetector::CPRDetector detector(true);
+  expect_same_as_full_scan(detector);
+}
+
+TEST_F(CheckpointTest, Name_Resumes_Anywhere) {
+  NameRule::NameRule rule;
+  expect_same_as_full_scan(rule);
+}
+
+TEST_F(CheckpointTest, Address_Resumes_Anywhere) {
+  AddressRule::AddressRule rule;
+  expect_same_as_full_scan(rule);
+}
+
+TEST_F(CheckpointTest, WordList_Resumes_Anywhere) {
+  auto words = std::to_array<std::string_view>({"datter", "brevet", "hilsen"});
+  WordListRule::WordListRule rule(words.begin(), words.end());
+  expect_same_as_full_scan(rule);
+}
+
+TEST_F(CheckpointTest, Health_Resumes_Anywhere) {
+  HealthRule::HealthRule rule;
+  expect_same_as_full_scan(rule);
+}
+
+TEST_F(CheckpointTest, Context_Examining_CPR_Keeps_Everything_Pending) {
+  CPRDetector::CPRDetector detector(false, true);
+  Stream stream(detector);
+
+  ASSERT_TRUE(stream.feed("Her er 1111111118 ").empty());
+  ASSERT_EQ(stream.checkpoint().offset, stream.checkpoint().pending.size());
+
+  // A blacklisted word after the number may still rule it out.
+  ASSERT_TRUE(stream.feed("og 2110625629").empty());
+  ASSERT_EQ(detector.find_matches("Her er 1111111118 og 2110625629"),
+            stream.finish());
+}
+
+TEST_F(CheckpointTest, Pending_Bytes_Are_The_Open_Token) {
+  NameRule::NameRule rule;
+  Stream stream(rule);
+
+  ASSERT_TRUE(stream.feed("Her bor John Pe").empty());
+  ASSERT_EQ(15, stream.checkpoint().offset);
+  ASSERT_EQ(std::string("John Pe"), stream.checkpoint().pending);
+  ASSERT_EQ(8, stream.checkpoint().resume());
+
+  auto matches = stream.feed("ter og Anna.");
+  ASSERT_EQ(1, matches.size());
+  ASSERT_EQ(std::string("John Peter"), matches[0].match());
+  ASSERT_EQ(8, matches[0].start());
+}
+
+// Feeds a name, a long run of digits and a long word followed by a long
+// tail without matches, and expects the pending bytes to stay few.
+template <typename Rule> void expect_bounded_pending(Rule &rule) {
+  std::string content = "Her bor John Hansen, CPR 1111111118 og ";
+  for (int i = 0; i < 100; ++i)
+    content += "1234567890";
+  content += " og ";
+  for (int i = 0; i < 100; ++i)
+    content += "abcdefghij";
+  content += ".\n";
+  for (int i = 0; i < 1000; ++i)
+    content += "og der er ingen navne eller numre her i denne linje.\n";
+
+  Stream stream(rule);
+  MatchResults matches;
+  for (std::size_t i = 0; i < content.size(); i += 16) {
+    for (auto &m : stream.feed(std::string_view(content).substr(i, 16)))
+      matches.push_back(m);
+    ASSERT_GE(32, stream.checkpoint().pending.size()) << "at " << i;
+  }
+  for (auto &m : stream.finish())
+    matches.push_back(m);
+
+  ASSERT_EQ(rule.find_matches(content), matches);
+}
+
+TEST_F(CheckpointTest, Name_Pending_Stays_Bounded) {
+  NameRule::NameRule rule;
+  expect_bounded_pending(rule);
+}
+
+TEST_F(CheckpointTest, CPR_Pending_Stays_Bounded) {
+  CPRDetector::CPRDetector detector;
+  expect_bounded_pending(detector);
+}
+
+TEST_F(CheckpointTest, Checkpoint_Of_Another_Rule_Is_Rejected) {
+  CPRDetector::CPRDetector detector;
+  CPRDetector::CPRDetector strict(true);
+  Stream stream(detector);
+  (void)stream.feed("1111111118 og 2110");
+
+  ASSERT_FALSE(Stream<CPRDetector::CPRDetector>::resume(
+                   strict, stream.checkpoint())
+                   .has_value());
+}
+
+TEST_F(CheckpointTest, Pending_Size_Is_Written_In_64_Bits) {
+  Checkpoint::Checkpoint checkpoint{42, 100, "Joh"};
+  const auto data = serialize(checkpoint);
+
+  // The magic, the version, the config and the offset come first, and
+  // the checksum last.
+  constexpr std::size_t at = 8 + 4 + 8 + 8;
+  ASSERT_EQ(at + 8 + 3 + 8, data.size());
+  std::uint64_t size = 0;
+  std::memcpy(&size, data.data() + at, sizeof(size));
+  ASSERT_EQ(3, size);
+}
+
+TEST_F(CheckpointTest, Damaged_Checkpoints_Are_Rejected) {
+  Checkpoint::Checkpoint checkpoint{42, 100, "Joh"};
+  auto data = serialize(checkpoint);
+  ASSERT_EQ(checkpoint, deserialize(data));
+
+  for (std::size_t i = 0; i < data.size(); ++i) {
+    auto damaged = data;
+    damaged[i] = static_cast<char>(damaged[i] ^ 0x20);
+    ASSERT_FALSE(deserialize(damaged).has_value()) << "byte " << i;
+  }
+
+  ASSERT_FALSE(deserialize(data.substr(0, data.size() - 1)).has_value());
+  ASSERT_FALSE(deserialize("").has_value());
+}
+
+TEST_F(CheckpointTest, Appended_File_Is_Scanned_From_Checkpoint) {
+  const auto path =
+      (std::filesystem::temp_directory_path() / "os2ds-checkpoint.log")
+          .string();
+  CPRDetector::CPRDetector detector;
+
+  {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << "login 1111111118 ok\nlogin 21106";
+  }
+
+  Stream stream(detector);
+  auto first = stream.feed("login 1111111118 ok\nlogin 21106");
+  ASSERT_EQ(1, first.size());
+  const auto checkpoint = stream.checkpoint();
+
+  {
+    std::ofstream file(path, std::ios::binary | std::ios::app);
+    file << "25629 ok\n";
+  }
+
+  auto tail = read_appended(path, checkpoint);
+  ASSERT_TRUE(tail.has_value());
+  ASSERT_EQ(std::string("25629 ok\n"), tail.value());
+
+  auto resumed = Stream<CPRDetector::CPRDetector>::resume(detector, checkpoint);
+  auto second = resumed->feed(tail.value());
+  ASSERT_EQ(1, second.size());
+  ASSERT_EQ(std::string("2110625629"), second[0].match());
+  ASSERT_EQ(26, second[0].start());
+
+  // A file that was rewritten is not resumed.
+  {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << "login 1111111118 ok\nlogout 2110625629 ok\n";
+  }
+  ASSERT_FALSE(read_appended(path, checkpoint).has_value());
+
+  std::filesystem::remove(path);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
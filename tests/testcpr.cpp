@@ -3,6 +3,7 @@
 #include <gtest/gtest.h>
 #include <iostream>
 #include <string>
+#include <string_view>
 
 using namespace OS2DSRules::CPRDetector;
 
@@ -176,6 +177,28 @@ TEST_F(CPRDetectorTest, Test_Reject_CPR_Number_With_Blacklisted_Words) {
   ASSERT_EQ(0, results.size());
 }
 
+TEST_F(CPRDetectorTest, Test_Find_CPR_Number_At_End_Of_String_View) {
+  const std::string buffer = "1111111118#";
+  CPRDetector detector(false);
+
+  auto results = detector.find_matches(std::string_view(buffer.data(), 10));
+
+  ASSERT_EQ(1, results.size());
+  ASSERT_STREQ("1111111118", results[0].match().c_str());
+  ASSERT_EQ(9, results[0].end());
+}
+
+TEST_F(CPRDetectorTest, Test_Separator_Does_Not_Carry_Over_To_Next_Match) {
+  std::string content = "211062-5629 og 1111111118";
+  CPRDetector detector(false);
+
+  auto results = detector.find_matches(content);
+
+  ASSERT_EQ(2, results.size());
+  ASSERT_STREQ("211062-5629", results[0].match().c_str());
+  ASSERT_STREQ("1111111118", results[1].match().c_str());
+}
+
 int main(int argc, char **argv) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
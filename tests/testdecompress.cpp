@@ -0,0 +1,247 @@
+#include <algorithm>
+#include <cpr-detector.hpp>
+#include <cstdint>
+#include <decompress.hpp>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <name_rule.hpp>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#ifdef OS2DSRULES_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+using namespace OS2DSRules;
+using namespace OS2DSRules::Decompress;
+
+class DecompressTest : public testing::Test {};
+
+std::string temp_path(std::string_view name) {
+  return (std::filesystem::temp_directory_path() / name).string();
+}
+
+void write_file(const std::string &path, std::string_view content) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(content.data(), static_cast<std::streamsize>(content.size()));
+}
+
+// A log of some megabytes, with CPR-numbers and names that end up split
+// across blocks.
+std::string make_log() {
+  std::string log;
+  for (int i = 0; log.size() < (2 << 20); ++i) {
+    log += "2024-01-01 login user=" + std::to_string(i) + " ok\n";
+    if (i % 97 == 0)
+      log += "Kunde John Peter Hansen, CPR 1111111118.\n";
+  }
+  return log;
+}
+
+#ifdef OS2DSRULES_HAVE_ZLIB
+// Compresses content to a gzip member.
+std::string gzip(std::string_view content) {
+  z_stream z{};
+  EXPECT_EQ(Z_OK, deflateInit2(&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16,
+                               8, Z_DEFAULT_STRATEGY));
+
+  std::string out(deflateBound(&z, static_cast<uLong>(content.size())), '\0');
+  z.next_in =
+      reinterpret_cast<Bytef *>(const_cast<char *>(content.data()));
+  z.avail_in = static_cast<uInt>(content.size());
+  z.next_out = reinterpret_cast<Bytef *>(out.data());
+  z.avail_out = static_cast<uInt>(out.size());
+  EXPECT_EQ(Z_STREAM_END, deflate(&z, Z_FINISH));
+
+  out.resize(z.total_out);
+  deflateEnd(&z);
+  return out;
+}
+#endif
+
+TEST_F(DecompressTest, Formats_Are_Detected_By_Magic) {
+  ASSERT_EQ(Format::Gzip, detect("\x1f\x8b\x08\x00"));
+  ASSERT_EQ(Format::Zstd, detect("\x28\xb5\x2f\xfd"));
+  ASSERT_EQ(Format::Plain, detect("\x1f"));
+  ASSERT_EQ(Format::Plain, detect("1111111118"));
+  ASSERT_EQ(Format::Plain, detect(""));
+  ASSERT_TRUE(supported(Format::Plain));
+}
+
+TEST_F(DecompressTest, Ring_Passes_Blocks_In_Order) {
+  BlockRing ring(3, 8);
+  std::thread producer([&] {
+    for (char c = 'a'; c <= 'z'; ++c) {
+      auto block = ring.acquire();
+      ASSERT_EQ(8, block.size());
+      block[0] = c;
+      block[1] = c;
+      ring.publish(c == 'z' ? 1 : 2);
+    }
+    ring.close();
+  });
+
+  std::string received;
+  while (auto block = ring.next()) {
+    received += block.value();
+    ring.release();
+  }
+  producer.join();
+
+  ASSERT_FALSE(ring.failed());
+  ASSERT_EQ(51, received.size());
+  ASSERT_EQ(std::string("aabbc"), received.substr(0, 5));
+  ASSERT_EQ(std::string("yyz"), received.substr(48));
+}
+
+TEST_F(DecompressTest, Plain_File_Is_Scanned_In_Blocks) {
+  const auto path = temp_path("os2ds-decompress.log");
+  const auto log = make_log();
+  write_file(path, log);
+
+  CPRDetector::CPRDetector detector;
+  NameRule::NameRule rule;
+  const Options options{4096, 2};
+
+  auto cprs = scan_file(detector, path, options);
+  ASSERT_TRUE(cprs.has_value());
+  ASSERT_EQ(detector.find_matches(log), cprs.value());
+
+  auto names = scan_file(rule, path, options);
+  ASSERT_TRUE(names.has_value());
+  ASSERT_EQ(rule.find_matches(log), names.value());
+
+  std::filesystem::remove(path);
+}
+
+TEST_F(DecompressTest, Missing_File_Is_Not_Scanned) {
+  CPRDetector::CPRDetector detector;
+  ASSERT_FALSE(
+      scan_file(detector, temp_path("os2ds-decompress-missing")).has_value());
+}
+
+#ifdef OS2DSRULES_HAVE_ZLIB
+TEST_F(DecompressTest, Gzip_File_Is_Scanned_As_Decompressed) {
+  ASSERT_TRUE(supported(Format::Gzip));
+  const auto path = temp_path("os2ds-decompress.log.gz");
+  const auto log = make_log();
+  write_file(path, gzip(log));
+
+  auto decoder = Decoder::open(path);
+  ASSERT_TRUE(decoder.has_value());
+  ASSERT_EQ(Format::Gzip, decoder->format());
+
+  CPRDetector::CPRDetector detector;
+  for (std::size_t block_size : {1, 1000, 65536, 1 << 20}) {
+    auto matches = scan_file(detector, path, Options{block_size, 3});
+    ASSERT_TRUE(matches.has_value()) << "blocks of " << block_size;
+    ASSERT_EQ(detector.find_matches(log), matches.value())
+        << "blocks of " << block_size;
+  }
+
+  std::filesystem::remove(path);
+}
+
+// A rule that records the largest content it has been asked to scan.
+template <typename Rule> struct Measured {
+  Rule rule;
+  std::size_t largest = 0;
+
+  [[nodiscard]] std::uint64_t config_hash() const noexcept {
+    return rule.config_hash();
+  }
+
+  [[nodiscard]] MatchResults find_matches(std::string_view content) noexcept {
+    largest = std::max(largest, content.size());
+    return rule.find_matches(content);
+  }
+
+  [[nodiscard]] ScanResult find_matches(std::string_view content,
+                                        const ScanOptions &options) noexcept {
+    largest = std::max(largest, content.size());
+    return rule.find_matches(content, options);
+  }
+};
+
+TEST_F(DecompressTest, Long_Tail_After_A_Name_Is_Not_Held_Back) {
+  const auto path = temp_path("os2ds-decompress-tail.log.gz");
+  std::string log = "Kunde John Peter Hansen logget ind.\n";
+  for (int i = 0; log.size() < (4 << 20); ++i)
+    log += "2024-01-01 login user=" + std::to_string(i) + " ok\n";
+  write_file(path, gzip(log));
+
+  Measured<NameRule::NameRule> measured;
+  const Options options{65536, 3};
+  auto matches = scan_file(measured, path, options);
+  ASSERT_TRUE(matches.has_value());
+  ASSERT_EQ(measured.rule.find_matches(log), matches.value());
+
+  // Every scan is of a block and at most a short open token before it.
+  ASSERT_GE(options.block_size + 64, measured.largest);
+
+  std::filesystem::remove(path);
+}
+
+TEST_F(DecompressTest, Memory_Does_Not_Grow_With_The_File) {
+  const auto path = temp_path("os2ds-decompress-large.log.gz");
+  const auto log = make_log() + make_log();
+  write_file(path, gzip(log));
+
+  // The file is a hundred times the size of the ring.
+  const Options options{4096, 10};
+  ASSERT_LT(100 * options.blocks * options.block_size, log.size());
+
+  Measured<CPRDetector::CPRDetector> measured;
+  auto matches = scan_file(measured, path, options);
+  ASSERT_TRUE(matches.has_value());
+  ASSERT_EQ(measured.rule.find_matches(log), matches.value());
+  ASSERT_GE(options.block_size + 64, measured.largest);
+
+  // A rule whose matches depend on the whole content would have to hold
+  // all of it.
+  CPRDetector::CPRDetector context(false, true);
+  ASSERT_FALSE(scan_file(context, path, options).has_value());
+
+  std::filesystem::remove(path);
+}
+
+TEST_F(DecompressTest, Concatenated_Gzip_Members_Are_One_File) {
+  const auto path = temp_path("os2ds-decompress-members.gz");
+  write_file(path, gzip("Kunde John Peter Hansen, CPR 11111") +
+                       gzip("11118 og 2110625629.\n") +
+                       std::string(512, '\0'));
+
+  CPRDetector::CPRDetector detector;
+  auto matches = scan_file(detector, path);
+  ASSERT_TRUE(matches.has_value());
+  ASSERT_EQ(detector.find_matches(
+                "Kunde John Peter Hansen, CPR 1111111118 og 2110625629.\n"),
+            matches.value());
+
+  std::filesystem::remove(path);
+}
+
+TEST_F(DecompressTest, Damaged_Gzip_File_Is_Not_Scanned) {
+  const auto path = temp_path("os2ds-decompress-damaged.gz");
+  const auto compressed = gzip(make_log());
+  CPRDetector::CPRDetector detector;
+
+  write_file(path, compressed.substr(0, compressed.size() / 2));
+  ASSERT_FALSE(scan_file(detector, path).has_value());
+
+  auto damaged = compressed;
+  damaged[damaged.size() / 2] ^= 0x55;
+  damaged[damaged.size() / 2 + 1] ^= 0x55;
+  write_file(path, damaged);
+  ASSERT_FALSE(scan_file(detector, path).has_value());
+
+  std::filesystem::remove(path);
+}
+#endif
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,235 @@
+#include <address_rule.hpp>
+#include <array>
+#include <cpr-detector.hpp>
+#include <encoding.hpp>
+#include <gtest/gtest.h>
+#include <name_rule.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <wordlist_rule.hpp>
+
+using namespace OS2DSRules;
+using namespace OS2DSRules::Encoding;
+
+class EncodingTest : public testing::Test {};
+
+const std::string document =
+    "Kære Søren.\n"
+    "John Peter Hansen har CPR-nummer 111111-1118, og bor på Aabyvej 12.\n"
+    "Anna 😀 har 2110625629 og bor i Århus. pnr 0101010000\n";
+
+// The code points of UTF-8 text.
+std::u32string code_points(std::string_view text) {
+  std::u32string out;
+  for (std::size_t i = 0; i < text.size();) {
+    const auto b = static_cast<unsigned char>(text[i]);
+    const std::size_t n = b < 0x80 ? 1 : b < 0xE0 ? 2 : b < 0xF0 ? 3 : 4;
+    char32_t c = n == 1 ? b : b & (0x7F >> n);
+    for (std::size_t j = 1; j < n; ++j)
+      c = (c << 6) | (static_cast<unsigned char>(text[i + j]) & 0x3F);
+    out += c;
+    i += n;
+  }
+  return out;
+}
+
+std::string to_latin1(std::string_view text) {
+  std::string out;
+  for (const auto c : code_points(text))
+    out += static_cast<char>(c < 0x100 ? c : '?');
+  return out;
+}
+
+std::string to_utf16le(std::string_view text) {
+  std::string out;
+  const auto put = [&](char32_t u) {
+    out += static_cast<char>(u & 0xFF);
+    out += static_cast<char>(u >> 8);
+  };
+  for (const auto c : code_points(text)) {
+    if (c < 0x10000) {
+      put(c);
+    } else {
+      put(0xD800 + ((c - 0x10000) >> 10));
+      put(0xDC00 + ((c - 0x10000) & 0x3FF));
+    }
+  }
+  return out;
+}
+
+// The index of the code unit that the byte at pos of UTF-8 text belongs
+// to, counting characters outside the BMP as two units if utf16.
+std::size_t unit_of(std::string_view text, std::size_t pos, bool utf16) {
+  std::size_t unit = 0;
+  for (std::size_t i = 0; i < pos && i < text.size(); ++i) {
+    const auto b = static_cast<unsigned char>(text[i]);
+    if ((b & 0xC0) != 0x80)
+      unit += utf16 && b >= 0xF0 ? 2 : 1;
+  }
+  // A position within a character belongs to the character.
+  if (pos < text.size() && (static_cast<unsigned char>(text[pos]) & 0xC0) == 0x80)
+    unit -= 1;
+  // The last byte of a surrogate pair comes from its second unit.
+  if (utf16 && pos < text.size() && pos >= 3 &&
+      static_cast<unsigned char>(text[pos - 3]) >= 0xF0)
+    unit += 1;
+  return unit;
+}
+
+// The matches of a scan of the UTF-8 text, with offsets in code units.
+template <typename Rule>
+MatchResults expected_matches(Rule &rule, std::string_view text, bool utf16) {
+  MatchResults expected;
+  for (const auto &m : rule.find_matches(text))
+    expected.push_back(MatchResult(m.match(), unit_of(text, m.start(), utf16),
+                                   unit_of(text, m.end(), utf16),
+                                   m.sensitivity(), m.probability()));
+  return expected;
+}
+
+TEST_F(EncodingTest, Names_Are_Parsed) {
+  ASSERT_EQ(Encoding::Encoding::UTF16LE, parse("UTF-16-LE"));
+  ASSERT_EQ(Encoding::Encoding::UTF16LE, parse("utf_16le"));
+  ASSERT_EQ(Encoding::Encoding::Latin1, parse("latin-1"));
+  ASSERT_EQ(Encoding::Encoding::Latin1, parse("ISO-8859-1"));
+  ASSERT_EQ(Encoding::Encoding::Windows1252, parse("cp1252"));
+  ASSERT_EQ(Encoding::Encoding::UTF8, parse("utf-8"));
+  ASSERT_FALSE(parse("utf-16-be").has_value());
+}
+
+TEST_F(EncodingTest, UTF16_Is_Narrowed_A_Byte_Per_Unit) {
+  std::string out;
+  narrow(to_utf16le("ø1 😀"), out);
+  ASSERT_EQ(std::string("\x1a" "1 \x1a\x1a"), out);
+}
+
+TEST_F(EncodingTest, Decoder_Maps_Bytes_To_Units) {
+  Decoder decoder(Encoding::Encoding::UTF16LE);
+  std::string text;
+  std::vector<std::size_t> units;
+  decoder.decode(to_utf16le("aø😀b"), text, units);
+  decoder.finish(text, units);
+
+  ASSERT_EQ(std::string("aø😀b"), text);
+  ASSERT_EQ((std::vector<std::size_t>{0, 1, 1, 2, 2, 2, 3, 4}), units);
+  ASSERT_EQ(5, decoder.unit());
+}
+
+TEST_F(EncodingTest, Decoder_Takes_Pieces_Of_Any_Size) {
+  const auto source = to_utf16le(document);
+  Decoder whole(Encoding::Encoding::UTF16LE);
+  std::string expected_text;
+  std::vector<std::size_t> expected_units;
+  whole.decode(source, expected_text, expected_units);
+  whole.finish(expected_text, expected_units);
+  ASSERT_EQ(document, expected_text);
+
+  for (std::size_t piece = 1; piece <= 5; ++piece) {
+    Decoder decoder(Encoding::Encoding::UTF16LE);
+    std::string text;
+    std::vector<std::size_t> units;
+    for (std::size_t i = 0; i < source.size(); i += piece)
+      decoder.decode(source.substr(i, piece), text, units);
+    decoder.finish(text, units);
+
+    ASSERT_EQ(expected_text, text) << "pieces of " << piece;
+    ASSERT_EQ(expected_units, units) << "pieces of " << piece;
+  }
+}
+
+TEST_F(EncodingTest, Broken_UTF16_Is_Replaced) {
+  Decoder decoder(Encoding::Encoding::UTF16LE);
+  std::string text;
+  std::vector<std::size_t> units;
+  // A lone low surrogate, a high surrogate without its pair, an odd byte.
+  decoder.decode(std::string("\x00\xdc" "a\x00" "\x00\xd8" "b\x00" "c", 9),
+                 text, units);
+  decoder.finish(text, units);
+  ASSERT_EQ(std::string("�a�b�"), text);
+  ASSERT_EQ(5, decoder.unit());
+}
+
+TEST_F(EncodingTest, Windows1252_Differs_From_Latin1) {
+  for (auto encoding : {Encoding::Encoding::Windows1252, Encoding::Encoding::Latin1}) {
+    Decoder decoder(encoding);
+    std::string text;
+    std::vector<std::size_t> units;
+    decoder.decode("\x80\x92\xe6", text, units);
+    ASSERT_EQ(encoding == Encoding::Encoding::Windows1252 ? std::string("€’æ")
+                                                : std::string("\u0080\u0092æ"),
+              text);
+  }
+}
+
+TEST_F(EncodingTest, CPR_Offsets_Are_Code_Units) {
+  CPRDetector::CPRDetector detector;
+  for (auto utf16 : {false, true}) {
+    const auto source = utf16 ? to_utf16le(document) : to_latin1(document);
+    const auto matches = find_matches(
+        detector, source, utf16 ? Encoding::Encoding::UTF16LE : Encoding::Encoding::Latin1);
+
+    ASSERT_EQ(expected_matches(detector, document, utf16), matches);
+    ASSERT_EQ(2, matches.size());
+  }
+}
+
+template <typename Rule>
+void expect_same_as_utf8(Rule &rule, std::string_view base = document) {
+  // Long enough to be scanned in several blocks.
+  std::string text;
+  while (text.size() < 4 * block_units)
+    text += base;
+
+  ASSERT_FALSE(rule.find_matches(text).empty());
+  ASSERT_EQ(expected_matches(rule, text, true),
+            find_matches(rule, to_utf16le(text), Encoding::Encoding::UTF16LE));
+
+  // Latin-1 has no emoji, which become '?'.
+  const auto latin1 = to_latin1(text);
+  std::string decoded;
+  for (const unsigned char c : latin1)
+    decoded += c < 0x80 ? std::string(1, static_cast<char>(c))
+                        : std::string{static_cast<char>(0xC0 | (c >> 6)),
+                                      static_cast<char>(0x80 | (c & 0x3F))};
+  ASSERT_EQ(expected_matches(rule, decoded, false),
+            find_matches(rule, latin1, Encoding::Encoding::Latin1));
+  ASSERT_EQ(expected_matches(rule, decoded, false),
+            find_matches(rule, latin1, Encoding::Encoding::Windows1252));
+}
+
+TEST_F(EncodingTest, CPR_Is_The_Same_As_In_UTF8) {
+  CPRDetector::CPRDetector detector;
+  expect_same_as_utf8(detector);
+  // The context of the document is examined as a whole.
+  CPRDetector::CPRDetector context(false, true);
+  expect_same_as_utf8(context, document.substr(0, document.find("pnr")));
+}
+
+TEST_F(EncodingTest, Names_Are_The_Same_As_In_UTF8) {
+  NameRule::NameRule rule;
+  expect_same_as_utf8(rule);
+}
+
+TEST_F(EncodingTest, Addresses_Are_The_Same_As_In_UTF8) {
+  AddressRule::AddressRule rule;
+  expect_same_as_utf8(rule);
+}
+
+TEST_F(EncodingTest, Words_Are_The_Same_As_In_UTF8) {
+  auto words = std::to_array<std::string_view>({"søren", "århus", "anna"});
+  WordListRule::WordListRule rule(words.begin(), words.end());
+  expect_same_as_utf8(rule);
+
+  const auto matches = find_matches(rule, to_latin1("Hej Søren!"),
+                                    Encoding::Encoding::Latin1);
+  ASSERT_EQ(1, matches.size());
+  ASSERT_EQ(std::string("søren"), matches[0].match());
+  ASSERT_EQ(4, matches[0].start());
+  ASSERT_EQ(9, matches[0].end());
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
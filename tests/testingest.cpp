@@ -0,0 +1,159 @@
+#include <cpr-detector.hpp>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <ingest.hpp>
+#include <map>
+#include <optional>
+#include <pipeline.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace OS2DSRules;
+using namespace OS2DSRules::Ingest;
+
+class IngestTest : public testing::Test {
+protected:
+  void SetUp() override {
+    root_ = std::filesystem::temp_directory_path() / "os2ds-ingest";
+    std::filesystem::remove_all(root_);
+    std::filesystem::create_directories(root_);
+  }
+
+  void TearDown() override { std::filesystem::remove_all(root_); }
+
+  std::string write_file(const std::string &name, std::string_view content) {
+    const auto path = (root_ / name).string();
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(content.data(), static_cast<std::streamsize>(content.size()));
+    return path;
+  }
+
+  // Files around the size of the buffers, and one that is missing.
+  void make_files(std::size_t buffer_size) {
+    for (const std::size_t size :
+         {std::size_t(0), std::size_t(1), buffer_size - 1, buffer_size,
+          buffer_size + 1, 5 * buffer_size + 3}) {
+      for (int copy = 0; copy < 3; ++copy) {
+        std::string content;
+        for (std::size_t i = 0; i < size; ++i)
+          content += static_cast<char>('a' + (i + size + copy) % 26);
+        paths_.push_back(write_file(
+            std::to_string(size) + "-" + std::to_string(copy), content));
+        contents_.push_back(content);
+      }
+    }
+    paths_.push_back((root_ / "missing").string());
+    contents_.push_back(std::nullopt);
+  }
+
+  void expect_read(Ingester &ingester) {
+    std::vector<std::optional<std::string>> read(paths_.size());
+    std::vector<std::size_t> order;
+    ingester.read(paths_, [&](std::size_t i,
+                              std::optional<std::string_view> content) {
+      order.push_back(i);
+      if (content)
+        read[i].emplace(content.value());
+    });
+
+    ASSERT_EQ(paths_.size(), order.size());
+    for (std::size_t i = 0; i < order.size(); ++i)
+      ASSERT_EQ(i, order[i]);
+    for (std::size_t i = 0; i < paths_.size(); ++i)
+      ASSERT_EQ(contents_[i], read[i]) << paths_[i];
+  }
+
+  std::filesystem::path root_;
+  std::vector<std::string> paths_;
+  std::vector<std::optional<std::string>> contents_;
+};
+
+TEST_F(IngestTest, Syscalls_Read_Every_File) {
+  make_files(100);
+  Ingester ingester({.batch = 4, .buffer_size = 100, .uring = false});
+  ASSERT_EQ(Backend::Syscalls, ingester.backend());
+  expect_read(ingester);
+}
+
+TEST_F(IngestTest, Uring_Reads_Every_File) {
+  make_files(100);
+  Ingester ingester({.batch = 4, .buffer_size = 100, .uring = true});
+  if (ingester.backend() != Backend::Uring)
+    GTEST_SKIP() << "io_uring is not available";
+
+  // Again, with the files of the last batch still to be closed.
+  expect_read(ingester);
+  expect_read(ingester);
+}
+
+TEST_F(IngestTest, Batches_May_Be_Larger_Than_The_Files) {
+  make_files(4096);
+  Ingester ingester({.batch = 1000, .buffer_size = 4096});
+  expect_read(ingester);
+
+  Ingester moved = std::move(ingester);
+  expect_read(moved);
+}
+
+TEST_F(IngestTest, Lent_Buffers_Outlive_Their_Batch) {
+  make_files(100);
+
+  for (const bool uring : {false, true}) {
+    std::deque<std::pair<std::size_t, Buffer>> held;
+    const auto check = [&](const std::pair<std::size_t, Buffer> &lent) {
+      ASSERT_EQ(contents_[lent.first], std::string(lent.second.view()));
+    };
+
+    {
+      Ingester ingester({.batch = 4, .buffer_size = 100, .uring = uring});
+      // Every file is held until the whole batch after it has been read.
+      ingester.lend(paths_, [&](std::size_t i, std::optional<Buffer> buffer) {
+        if (!buffer) {
+          ASSERT_FALSE(contents_[i].has_value());
+          return;
+        }
+        held.emplace_back(i, std::move(buffer.value()));
+        while (held.size() > 4) {
+          check(held.front());
+          held.pop_front();
+        }
+      });
+    }
+
+    ASSERT_FALSE(held.empty());
+    for (const auto &lent : held)
+      check(lent);
+  }
+}
+
+TEST_F(IngestTest, Pipeline_Reads_In_Batches) {
+  make_files(64);
+
+  Pipeline::RuleSet rules;
+  rules.add("cpr", CPRDetector::CPRDetector());
+  Pipeline::Options options;
+  options.ingest = Options{.batch = 8, .buffer_size = 64};
+  Pipeline::Pipeline pipeline(std::move(rules), options);
+
+  std::map<std::string, Pipeline::FileResult> results;
+  const auto stats =
+      pipeline.run(paths_, [&](Pipeline::FileResult &result) {
+        results[result.path] = std::move(result);
+      });
+
+  ASSERT_EQ(paths_.size(), stats.read.items);
+  ASSERT_EQ(paths_.size(), results.size());
+  for (std::size_t i = 0; i < paths_.size(); ++i) {
+    const auto &result = results.at(paths_[i]);
+    ASSERT_EQ(contents_[i].has_value(), result.ok);
+    ASSERT_EQ(contents_[i].value_or("").size(), result.size);
+  }
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
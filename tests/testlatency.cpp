@@ -0,0 +1,130 @@
+#include <cpr-detector.hpp>
+#include <gtest/gtest.h>
+#include <health_rule.hpp>
+#include <latency.hpp>
+#include <string>
+#include <thread>
+
+using namespace OS2DSRules;
+using namespace OS2DSRules::Latency;
+
+class LatencyTest : public testing::Test {
+protected:
+  void SetUp() override {
+    set_enabled(true);
+    reset();
+  }
+};
+
+TEST_F(LatencyTest, Small_Values_Are_Exact) {
+  for (std::uint64_t value = 0; value < Histogram::sub_buckets; ++value) {
+    ASSERT_EQ(value, Histogram::bucket_upper_bound(Histogram::bucket_index(value)));
+  }
+}
+
+TEST_F(LatencyTest, Buckets_Have_Bounded_Relative_Error) {
+  for (std::uint64_t value = 16; value < (std::uint64_t(1) << 40);
+       value = value * 3 / 2 + 1) {
+    const auto upper = Histogram::bucket_upper_bound(Histogram::bucket_index(value));
+
+    ASSERT_LE(value, upper);
+    ASSERT_LE(double(upper - value), double(value) / 16.0);
+  }
+}
+
+TEST_F(LatencyTest, Largest_Values_Use_The_Last_Bucket) {
+  ASSERT_EQ(Histogram::bucket_count - 1,
+            Histogram::bucket_index(Histogram::max_value));
+  ASSERT_EQ(Histogram::bucket_count - 1,
+            Histogram::bucket_index(~std::uint64_t(0)));
+}
+
+TEST_F(LatencyTest, Percentiles) {
+  Histogram histogram;
+  for (std::uint64_t value = 1; value <= 1000; ++value)
+    histogram.record(value * 1000);
+
+  ASSERT_EQ(1000, histogram.count());
+  ASSERT_EQ(1000000, histogram.max());
+  ASSERT_DOUBLE_EQ(500500.0, histogram.mean());
+  ASSERT_NEAR(500000.0, double(histogram.percentile(0.5)), 500000.0 / 16);
+  ASSERT_NEAR(990000.0, double(histogram.percentile(0.99)), 990000.0 / 16);
+  ASSERT_EQ(1000000, histogram.percentile(1.0));
+}
+
+TEST_F(LatencyTest, Merge) {
+  Histogram first, second;
+  first.record(100);
+  second.record(200);
+  second.record(300);
+
+  first.merge(second);
+
+  ASSERT_EQ(3, first.count());
+  ASSERT_EQ(300, first.max());
+  ASSERT_DOUBLE_EQ(200.0, first.mean());
+}
+
+TEST_F(LatencyTest, Records_Scans_By_Rule_And_Size) {
+  CPRDetector::CPRDetector detector;
+  const std::string small = "1111111118";
+  const std::string large(20000, 'a');
+
+  (void)detector.find_matches(small);
+  (void)detector.find_matches(small);
+  (void)detector.find_matches(large);
+
+  const auto snap = snapshot();
+  ASSERT_EQ(2, snap.at(Rule::CPRDetector, SizeBucket::UpTo1KiB).count());
+  ASSERT_EQ(1, snap.at(Rule::CPRDetector, SizeBucket::UpTo256KiB).count());
+  ASSERT_EQ(0, snap.at(Rule::NameRule, SizeBucket::UpTo1KiB).count());
+}
+
+TEST_F(LatencyTest, Nested_Rules_Are_Not_Recorded) {
+  HealthRule::HealthRule rule;
+  (void)rule.find_matches("Cancer er en grim sygdom");
+
+  const auto snap = snapshot();
+  ASSERT_EQ(1, snap.at(Rule::HealthRule, SizeBucket::UpTo1KiB).count());
+  ASSERT_EQ(0, snap.at(Rule::WordListRule, SizeBucket::UpTo1KiB).count());
+}
+
+TEST_F(LatencyTest, Aggregates_Across_Threads) {
+  const auto scan = [] {
+    CPRDetector::CPRDetector detector;
+    for (int i = 0; i < 10; ++i)
+      (void)detector.find_matches("1111111118");
+  };
+
+  std::thread first(scan);
+  std::thread second(scan);
+  first.join();
+  second.join();
+
+  ASSERT_EQ(20, snapshot().at(Rule::CPRDetector, SizeBucket::UpTo1KiB).count());
+}
+
+TEST_F(LatencyTest, Disabled_Recording) {
+  set_enabled(false);
+
+  CPRDetector::CPRDetector detector;
+  (void)detector.find_matches("1111111118");
+
+  ASSERT_EQ(0, snapshot().at(Rule::CPRDetector, SizeBucket::UpTo1KiB).count());
+}
+
+TEST_F(LatencyTest, Text_Report) {
+  CPRDetector::CPRDetector detector;
+  (void)detector.find_matches("1111111118");
+
+  const auto text = snapshot().to_text();
+  ASSERT_NE(std::string::npos, text.find("p99.9"));
+  ASSERT_NE(std::string::npos, text.find("CPRDetector"));
+  ASSERT_NE(std::string::npos, text.find("<=1KiB"));
+  ASSERT_EQ(std::string::npos, text.find("NameRule"));
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
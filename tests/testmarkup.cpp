@@ -0,0 +1,196 @@
+#include <cpr-detector.hpp>
+#include <gtest/gtest.h>
+#include <markup.hpp>
+#include <name_rule.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <wordlist_rule.hpp>
+
+using namespace OS2DSRules;
+using namespace OS2DSRules::Markup;
+
+class MarkupTest : public testing::Test {};
+
+// Strips source in pieces of the given size.
+Document strip_in_pieces(std::string_view source, std::size_t piece) {
+  Stripper stripper;
+  Document document;
+
+  for (std::size_t i = 0; i < source.size(); i += piece) {
+    std::vector<Segment> segments;
+    stripper.feed(source.substr(i, piece), segments);
+    for (const auto &segment : segments) {
+      document.text += segment.text();
+      document.map.append(segment);
+    }
+  }
+
+  std::vector<Segment> segments;
+  stripper.finish(segments);
+  for (const auto &segment : segments) {
+    document.text += segment.text();
+    document.map.append(segment);
+  }
+
+  return document;
+}
+
+TEST_F(MarkupTest, Tags_Are_Dropped) {
+  ASSERT_EQ(std::string("John Peter Hansen"),
+            strip("<b>John</b> <i class=\"x\">Peter</i> Hansen").text);
+}
+
+TEST_F(MarkupTest, Block_Tags_Break_Lines) {
+  ASSERT_EQ(std::string("\nJohn\n\nPeter\n\nHansen"),
+            strip("<td>John</td><td>Peter</td><br/>Hansen").text);
+}
+
+TEST_F(MarkupTest, Entities_Are_Decoded) {
+  ASSERT_EQ(std::string("René & Søren æ < Å"),
+            strip("Ren&eacute; &amp; S&#248;ren &#xE6; &lt; &Aring;").text);
+  ASSERT_EQ(std::string("Hansen"), strip("Han&shy;sen").text);
+  ASSERT_EQ(std::string("John Peter"), strip("John&nbsp;Peter").text);
+  ASSERT_EQ(std::string("\xEF\xBF\xBD"), strip("&#0;").text);
+}
+
+TEST_F(MarkupTest, Text_That_Looks_Like_Markup_Is_Kept) {
+  ASSERT_EQ(std::string("A & B &foo; C < D &x"),
+            strip("A & B &foo; C < D &x").text);
+}
+
+TEST_F(MarkupTest, Scripts_Styles_And_Comments_Are_Dropped) {
+  ASSERT_EQ(std::string("ab"),
+            strip("a<script>if (x<y) s='</p>';</SCRIPT >"
+                  "<style>p > b { }</style><!-- <b>-> --->b")
+                .text);
+}
+
+TEST_F(MarkupTest, Quoted_Attributes_May_Contain_Brackets) {
+  ASSERT_EQ(std::string("link"),
+            strip("<a title=\"x>y\" data-x = 'a>b' alt=it's>link</a>").text);
+}
+
+TEST_F(MarkupTest, Declarations_Are_Dropped) {
+  ASSERT_EQ(std::string("text"),
+            strip("<?xml version=\"1.0\"?><!DOCTYPE html>text").text);
+}
+
+TEST_F(MarkupTest, Pieces_Give_The_Same_Text_And_Offsets) {
+  const std::string source =
+      "<html><head><style>td { x: '<' }</style></head><body>\n"
+      "<!-- a -- comment -->&AElig;bleskov &amp; S&#xf8;n: <a "
+      "href=\"/x?a=1&amp;b=2\">John</a>&nbsp;<b>Peter</b> &unknown; & "
+      "1111111118<br>Aabyvej 12</body></html>&am";
+  const auto expected = strip(source);
+
+  for (std::size_t piece = 1; piece <= 17; ++piece) {
+    const auto document = strip_in_pieces(source, piece);
+    ASSERT_EQ(expected.text, document.text) << "pieces of " << piece;
+
+    for (std::size_t i = 0; i < expected.text.size(); ++i) {
+      ASSERT_EQ(expected.map.to_source(i), document.map.to_source(i));
+      ASSERT_EQ(expected.map.to_source_end(i), document.map.to_source_end(i));
+    }
+  }
+}
+
+TEST_F(MarkupTest, Offsets_Point_Into_The_Source) {
+  const std::string source = "<p>S&oslash;ren har <b>CPR</b> 1111111118.</p>";
+  const auto document = strip(source);
+  ASSERT_EQ(std::string("\nSøren har CPR 1111111118.\n"), document.text);
+
+  // Verbatim text maps byte for byte.
+  const auto h = document.text.find("har");
+  ASSERT_EQ(source.find("har"), document.map.to_source(h));
+
+  // Both bytes of the decoded 'ø' map to the whole entity.
+  const auto o = document.text.find("ø");
+  ASSERT_EQ(source.find("&oslash;"), document.map.to_source(o));
+  ASSERT_EQ(source.find("&oslash;") + 7, document.map.to_source_end(o + 1));
+
+  // The end of the text maps to the end of the source.
+  ASSERT_EQ(source.size(), document.map.to_source(document.text.size()));
+}
+
+TEST_F(MarkupTest, Matches_Are_Reported_In_The_Source) {
+  const std::string source =
+      "<td>Kunde:</td><td><b>John</b> Peter</td><td>1111111118</td>";
+  const auto document = strip(source);
+
+  NameRule::NameRule rule;
+  auto names = find_matches(rule, document);
+  ASSERT_EQ(1, names.size());
+  ASSERT_EQ(std::string("John Peter"), names[0].match());
+  ASSERT_EQ(source.find("John"), names[0].start());
+
+  CPRDetector::CPRDetector detector;
+  auto cprs = find_matches(detector, document);
+  ASSERT_EQ(1, cprs.size());
+  ASSERT_EQ(std::string("1111111118"),
+            source.substr(cprs[0].start(),
+                          cprs[0].end() - cprs[0].start() + 1));
+}
+
+TEST_F(MarkupTest, Exclusive_Ends_Stop_Before_The_Closing_Tag) {
+  const std::string source = "<tr><td>Jens Hansen</td><td>hemmelig</td></tr>";
+  const auto document = strip(source);
+
+  NameRule::NameRule rule;
+  auto names = find_matches(rule, document);
+  ASSERT_EQ(1, names.size());
+  ASSERT_EQ(source.find("Jens"), names[0].start());
+  ASSERT_EQ(source.find("</td>"), names[0].end());
+
+  std::vector<std::string> words = {"hemmelig"};
+  WordListRule::WordListRule wordlist(words.begin(), words.end());
+  auto found = find_matches(wordlist, document);
+  ASSERT_EQ(1, found.size());
+  ASSERT_EQ(source.find("hemmelig"), found[0].start());
+  ASSERT_EQ(source.rfind("</td>"), found[0].end());
+
+  // A name at the very end keeps the end of its last byte.
+  const auto bare = strip("<b>Jens</b> Hansen");
+  names = find_matches(rule, bare);
+  ASSERT_EQ(1, names.size());
+  ASSERT_EQ(17, names[0].end());
+}
+
+TEST_F(MarkupTest, Ends_At_The_End_Of_The_Text_Follow_The_Rule) {
+  std::vector<std::string> words = {"hemmelig"};
+  WordListRule::WordListRule wordlist(words.begin(), words.end());
+
+  // The match text is lower case, and the word runs to the end.
+  std::string source = "<b>HEMMELIG</b>";
+  auto found = find_matches(wordlist, strip(source));
+  ASSERT_EQ(1, found.size());
+  ASSERT_EQ(source.find('G'), found[0].end());
+
+  // The last byte is decoded from an entity, which is the whole of it.
+  NameRule::NameRule rule;
+  source = "<b>Jens Hanse&#110;</b>";
+  auto names = find_matches(rule, strip(source));
+  ASSERT_EQ(1, names.size());
+  ASSERT_EQ(source.find(';'), names[0].end());
+
+  // The byte after the match is the last one, and an entity.
+  source = "hemmelig&#33;";
+  found = find_matches(wordlist, strip(source));
+  ASSERT_EQ(1, found.size());
+  ASSERT_EQ(source.find('&'), found[0].end());
+}
+
+TEST_F(MarkupTest, Map_Has_A_Span_Per_Markup_Boundary) {
+  const auto document = strip("<p>one <b>two</b> three &amp; four</p>");
+
+  // "\n", "one ", "two", " three ", "&", " four", "\n"
+  ASSERT_EQ(7, document.map.spans());
+
+  // Text without markup is a single span.
+  ASSERT_EQ(1, strip(std::string(100000, 'x')).map.spans());
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,229 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cpr-detector.hpp>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <map>
+#include <name_rule.hpp>
+#include <pipeline.hpp>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace OS2DSRules;
+using namespace OS2DSRules::Pipeline;
+
+class PipelineTest : public testing::Test {
+protected:
+  void SetUp() override {
+    root_ = std::filesystem::temp_directory_path() / "os2ds-pipeline";
+    std::filesystem::remove_all(root_);
+    std::filesystem::create_directories(root_ / "a" / "b");
+  }
+
+  void TearDown() override { std::filesystem::remove_all(root_); }
+
+  std::string write_file(const std::string &name, std::string_view content) {
+    const auto path = (root_ / name).string();
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(content.data(), static_cast<std::streamsize>(content.size()));
+    return path;
+  }
+
+  std::filesystem::path root_;
+};
+
+RuleSet make_rules() {
+  RuleSet rules;
+  rules.add("cpr", CPRDetector::CPRDetector());
+  rules.add("name", NameRule::NameRule());
+  return rules;
+}
+
+TEST_F(PipelineTest, Queue_Delivers_Every_Value_Once) {
+  BoundedQueue<int> queue(8);
+  ASSERT_EQ(8, queue.capacity());
+
+  constexpr int producers = 3, consumers = 3, count = 10000;
+  std::vector<std::thread> threads;
+  std::vector<std::vector<int>> popped(consumers);
+  std::atomic<int> remaining = producers;
+
+  for (int p = 0; p < producers; ++p)
+    threads.emplace_back([&, p] {
+      for (int i = 0; i < count; ++i)
+        ASSERT_TRUE(queue.push(p * count + i));
+      if (remaining.fetch_sub(1) == 1)
+        queue.close();
+    });
+  for (int c = 0; c < consumers; ++c)
+    threads.emplace_back([&, c] {
+      while (auto value = queue.pop())
+        popped[c].push_back(value.value());
+    });
+  for (auto &thread : threads)
+    thread.join();
+
+  std::vector<int> all;
+  for (const auto &values : popped) {
+    // The values of a producer are popped in the order they were pushed.
+    std::map<int, int> last;
+    for (const auto v : values) {
+      const auto it = last.find(v / count);
+      if (it != last.end()) {
+        ASSERT_LT(it->second, v);
+      }
+      last[v / count] = v;
+    }
+    all.insert(all.end(), values.begin(), values.end());
+  }
+  std::sort(all.begin(), all.end());
+  ASSERT_EQ(producers * count, all.size());
+  for (int i = 0; i < producers * count; ++i)
+    ASSERT_EQ(i, all[i]);
+}
+
+TEST_F(PipelineTest, Full_Queue_Refuses_Values) {
+  BoundedQueue<std::string> queue(2);
+  std::string a = "a", b = "b", c = "c";
+  ASSERT_TRUE(queue.try_push(a));
+  ASSERT_TRUE(queue.try_push(b));
+  ASSERT_FALSE(queue.try_push(c));
+  // A value that was refused is left as it was.
+  ASSERT_EQ("c", c);
+
+  ASSERT_EQ("a", queue.try_pop());
+  queue.close();
+  ASSERT_FALSE(queue.push("d"));
+  ASSERT_EQ("b", queue.pop());
+  ASSERT_FALSE(queue.pop().has_value());
+}
+
+TEST_F(PipelineTest, Results_Are_Those_Of_The_Rules) {
+  std::map<std::string, std::string> contents = {
+      {"one.txt", "John Peter Hansen har CPR 1111111118."},
+      {"a/two.txt", "Intet at se her."},
+      {"a/b/three.txt", "Anna Jensen og 2110625629, og 1111111118."},
+      {"a/b/empty.txt", ""},
+  };
+  for (const auto &[name, content] : contents)
+    write_file(name, content);
+
+  Options options;
+  options.scanners = 3;
+  options.queue_size = 2;
+  Pipeline::Pipeline pipeline(make_rules(), options);
+
+  std::map<std::string, FileResult> results;
+  const auto stats = pipeline.run({root_.string()}, [&](FileResult &result) {
+    results[result.path] = std::move(result);
+  });
+
+  CPRDetector::CPRDetector cpr;
+  NameRule::NameRule names;
+  ASSERT_EQ(contents.size(), results.size());
+  for (const auto &[name, content] : contents) {
+    const auto &result = results.at((root_ / name).string());
+    ASSERT_TRUE(result.ok);
+    ASSERT_EQ(content.size(), result.size);
+    ASSERT_EQ(2, result.matches.size());
+    ASSERT_EQ(cpr.find_matches(content), result.matches[0]) << name;
+    ASSERT_EQ(names.find_matches(content), result.matches[1]) << name;
+  }
+
+  ASSERT_EQ(contents.size(), stats.enumerate.items);
+  ASSERT_EQ(contents.size(), stats.read.items);
+  ASSERT_EQ(contents.size(), stats.scan.items);
+  ASSERT_EQ(contents.size(), stats.write.items);
+  ASSERT_EQ(3, stats.scan.threads);
+  ASSERT_EQ(2, stats.read.threads);
+
+  std::uint64_t bytes = 0;
+  for (const auto &[name, content] : contents)
+    bytes += content.size();
+  ASSERT_EQ(bytes, stats.bytes);
+}
+
+TEST_F(PipelineTest, Unreadable_Files_Are_Reported) {
+  const auto path = write_file("one.txt", "CPR 1111111118");
+  const auto missing = (root_ / "missing.txt").string();
+
+  Pipeline::Pipeline pipeline(make_rules());
+  std::map<std::string, FileResult> results;
+  pipeline.run({path, missing}, [&](FileResult &result) {
+    results[result.path] = std::move(result);
+  });
+
+  ASSERT_EQ(2, results.size());
+  ASSERT_TRUE(results[path].ok);
+  ASSERT_EQ(1, results[path].matches[0].size());
+  ASSERT_FALSE(results[missing].ok);
+  ASSERT_TRUE(results[missing].matches[0].empty());
+}
+
+TEST_F(PipelineTest, Files_Are_Mapped) {
+  const auto path = write_file("one.txt", "CPR 1111111118");
+  const auto empty = write_file("empty.txt", "");
+
+  auto mapped = Content::map(path);
+  ASSERT_TRUE(mapped.has_value());
+  ASSERT_EQ("CPR 1111111118", mapped->view());
+  Content moved = std::move(mapped.value());
+  ASSERT_EQ("CPR 1111111118", moved.view());
+  ASSERT_TRUE(mapped->view().empty());
+
+  // Empty files cannot be mapped, and are read instead.
+  ASSERT_FALSE(Content::map(empty).has_value());
+  ASSERT_EQ("", map_file(empty)->view());
+  ASSERT_FALSE(map_file((root_ / "missing.txt").string()).has_value());
+
+  Options options;
+  options.reader = map_file;
+  Pipeline::Pipeline pipeline(make_rules(), options);
+  std::map<std::string, FileResult> results;
+  pipeline.run({root_.string()}, [&](FileResult &result) {
+    results[result.path] = std::move(result);
+  });
+  ASSERT_EQ(2, results.size());
+  ASSERT_EQ(1, results[path].matches[0].size());
+  ASSERT_TRUE(results[empty].ok);
+}
+
+TEST_F(PipelineTest, Slow_Writer_Holds_Back_The_Readers) {
+  for (int i = 0; i < 32; ++i)
+    write_file("a/" + std::to_string(i) + ".txt", "CPR 1111111118");
+
+  // Counts the documents read but not yet written.
+  std::atomic<int> in_flight = 0;
+  int most = 0;
+
+  Options options;
+  options.readers = 2;
+  options.scanners = 2;
+  options.queue_size = 2;
+  options.reader = [&](const std::string &path) {
+    ++in_flight;
+    return read_file(path);
+  };
+
+  Pipeline::Pipeline pipeline(make_rules(), options);
+  const auto stats = pipeline.run({root_.string()}, [&](FileResult &) {
+    most = std::max(most, in_flight.load());
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    --in_flight;
+  });
+
+  ASSERT_EQ(32, stats.write.items);
+  // Two queues of two, and a document in the hands of every reader and
+  // scanner, besides the one being written.
+  ASSERT_LE(most, 2 + 2 + 2 + 2 + 1);
+  ASSERT_GT(stats.write.busy, stats.write.starved);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
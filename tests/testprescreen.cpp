@@ -0,0 +1,156 @@
+#include <address_rule.hpp>
+#include <cpr-detector.hpp>
+#include <gtest/gtest.h>
+#include <health_rule.hpp>
+#include <name_rule.hpp>
+#include <prescreen.hpp>
+#include <random>
+#include <string>
+
+using namespace OS2DSRules;
+using namespace OS2DSRules::PreScreen;
+
+class PreScreenTest : public testing::Test {};
+
+TEST_F(PreScreenTest, Empty_Content) {
+  auto features = analyze("");
+
+  ASSERT_EQ(0, features.size);
+  ASSERT_EQ(0, features.longest_digit_run);
+  ASSERT_EQ(0, features.tokens);
+  ASSERT_DOUBLE_EQ(0.0, features.uppercase_token_density());
+}
+
+TEST_F(PreScreenTest, Byte_Classes) {
+  auto features = analyze("Ab 1,\t\x01\xc3\xa6");
+
+  ASSERT_EQ(9, features.size);
+  ASSERT_EQ(1, features.count(ByteClass::Upper));
+  ASSERT_EQ(1, features.count(ByteClass::Lower));
+  ASSERT_EQ(1, features.count(ByteClass::Digit));
+  ASSERT_EQ(2, features.count(ByteClass::Space));
+  ASSERT_EQ(1, features.count(ByteClass::Punctuation));
+  ASSERT_EQ(1, features.count(ByteClass::Control));
+  ASSERT_EQ(2, features.count(ByteClass::NonAscii));
+  ASSERT_FALSE(features.is_ascii());
+}
+
+TEST_F(PreScreenTest, Longest_Digit_Run_Across_Blocks) {
+  // The run straddles the boundary between the first two 16-byte blocks.
+  const std::string content = "abcdefghijklm 1234567890 and 12 and 123";
+  auto features = analyze(content);
+
+  ASSERT_EQ(10, features.longest_digit_run);
+  ASSERT_EQ(32, analyze(std::string(32, '7')).longest_digit_run);
+  ASSERT_EQ(5, analyze("12345").longest_digit_run);
+}
+
+TEST_F(PreScreenTest, Tokens_And_Capitalized_Tokens) {
+  auto features = analyze("John og Anna bor i Aarhus, ikke i KBH.");
+
+  ASSERT_EQ(9, features.tokens);
+  ASSERT_EQ(4, features.capitalized_tokens);
+  ASSERT_DOUBLE_EQ(4.0 / 9.0, features.uppercase_token_density());
+}
+
+TEST_F(PreScreenTest, Matches_Scalar_Definition) {
+  std::mt19937 random(42);
+  const std::string alphabet = "0123456789 Aa.\n\xc3\xb8";
+  std::uniform_int_distribution<std::size_t> pick(0, alphabet.size() - 1);
+
+  for (std::size_t size = 0; size < 100; ++size) {
+    std::string content;
+    for (std::size_t i = 0; i < size; ++i)
+      content += alphabet[pick(random)];
+
+    std::size_t run = 0, longest = 0, digits = 0;
+    for (char c : content) {
+      run = ('0' <= c && c <= '9') ? run + 1 : 0;
+      longest = std::max(longest, run);
+      digits += ('0' <= c && c <= '9');
+    }
+
+    auto features = analyze(content);
+    ASSERT_EQ(longest, features.longest_digit_run) << content;
+    ASSERT_EQ(digits, features.count(ByteClass::Digit)) << content;
+  }
+}
+
+TEST_F(PreScreenTest, Rule_Requirements) {
+  ASSERT_FALSE(CPRDetector::CPRDetector::requirements().met_by(
+      analyze("Intet CPR-nummer, kun 12345 og 1234-56.")));
+  ASSERT_TRUE(CPRDetector::CPRDetector::requirements().met_by(
+      analyze("CPR: 111111-1118")));
+
+  ASSERT_FALSE(NameRule::NameRule::requirements().met_by(
+      analyze("ingen navne her")));
+  ASSERT_TRUE(NameRule::NameRule::requirements().met_by(analyze("John")));
+
+  ASSERT_FALSE(AddressRule::AddressRule::requirements().met_by(
+      analyze("Aabyvej uden nummer")));
+  ASSERT_TRUE(requirements_of<HealthRule::HealthRule>().trivial());
+}
+
+TEST_F(PreScreenTest, Skipped_Rules_Have_No_Matches) {
+  CPRDetector::CPRDetector detector;
+  NameRule::NameRule name_rule;
+  AddressRule::AddressRule address_rule;
+
+  const char *documents[] = {
+      "",
+      "ingen navne og ingen tal",
+      "12345 er ikke et CPR-nummer",
+      "xJohn har ikke et efternavn",
+      "1111111118",
+      "Aabyvej 1",
+      "Peter bor på Aabyvej",
+  };
+
+  for (const char *document : documents) {
+    const auto features = analyze(document);
+
+    if (!CPRDetector::CPRDetector::requirements().met_by(features)) {
+      ASSERT_EQ(0, detector.find_matches(document).size()) << document;
+    }
+    if (!NameRule::NameRule::requirements().met_by(features)) {
+      ASSERT_EQ(0, name_rule.find_matches(document).size()) << document;
+    }
+    if (!AddressRule::AddressRule::requirements().met_by(features)) {
+      ASSERT_EQ(0, address_rule.find_matches(document).size()) << document;
+    }
+  }
+}
+
+TEST_F(PreScreenTest, Planner) {
+  Planner planner;
+  const auto cpr = planner.add<CPRDetector::CPRDetector>();
+  const auto name = planner.add<NameRule::NameRule>();
+  const auto health = planner.add<HealthRule::HealthRule>();
+
+  ASSERT_EQ(3, planner.size());
+
+  auto plan = planner.plan("John har CPR-nummer 1111111118");
+  ASSERT_TRUE(plan.screened);
+  ASSERT_TRUE(plan.runs(cpr));
+  ASSERT_TRUE(plan.runs(name));
+  ASSERT_TRUE(plan.runs(health));
+
+  plan = planner.plan("ingen navne og ingen tal");
+  ASSERT_FALSE(plan.runs(cpr));
+  ASSERT_FALSE(plan.runs(name));
+  ASSERT_TRUE(plan.runs(health));
+}
+
+TEST_F(PreScreenTest, Planner_Without_Requirements_Does_Not_Analyze) {
+  Planner planner;
+  const auto health = planner.add<HealthRule::HealthRule>();
+
+  auto plan = planner.plan("noget tekst");
+  ASSERT_FALSE(plan.screened);
+  ASSERT_TRUE(plan.runs(health));
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
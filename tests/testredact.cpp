@@ -0,0 +1,167 @@
+#include <address_rule.hpp>
+#include <cpr-detector.hpp>
+#include <gtest/gtest.h>
+#include <name_rule.hpp>
+#include <redact.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <wordlist_rule.hpp>
+
+using namespace OS2DSRules;
+using namespace OS2DSRules::Redact;
+
+class RedactTest : public testing::Test {};
+
+const std::string document =
+    "John Hansen har CPR-nummer 111111-1118 og bor på Nørregade 12.\n";
+
+TEST_F(RedactTest, Policies_Mask_Matches) {
+  Redactor fixed;
+  fixed.add("cpr", CPRDetector::CPRDetector());
+  ASSERT_EQ("John Hansen har CPR-nummer *********** og bor på Nørregade 12.\n",
+            fixed.redact(document));
+
+  Redactor last4;
+  last4.add("cpr", CPRDetector::CPRDetector(), {.policy = Policy::KeepLast4});
+  ASSERT_EQ("John Hansen har CPR-nummer ******-1118 og bor på Nørregade 12.\n",
+            last4.redact(document));
+
+  Redactor tags;
+  tags.add("cpr", CPRDetector::CPRDetector(), {.policy = Policy::Tag});
+  tags.add("name", NameRule::NameRule(),
+           {.policy = Policy::Tag, .tag = "<NAVN>"});
+  tags.add("address", AddressRule::AddressRule(), {.fill = '#'});
+  ASSERT_EQ("<NAVN> har CPR-nummer [cpr] og bor på ############.\n",
+            tags.redact(document));
+}
+
+TEST_F(RedactTest, Characters_Are_Masked_Whole) {
+  std::vector<std::string> words = {"søren"};
+  Redactor redactor;
+  redactor.add("word", WordListRule::WordListRule(words.begin(), words.end()));
+  ASSERT_EQ("Hej ***** og Ø.", redactor.redact("Hej Søren og Ø."));
+}
+
+TEST_F(RedactTest, Matches_At_The_End_Are_Masked_Whole) {
+  std::vector<std::string> words = {"hemmelig"};
+  Redactor redactor;
+  redactor.add("cpr", CPRDetector::CPRDetector());
+  redactor.add("name", NameRule::NameRule());
+  redactor.add("address", AddressRule::AddressRule());
+  redactor.add("word", WordListRule::WordListRule(words.begin(), words.end()));
+
+  ASSERT_EQ("**********", redactor.redact("1111111118"));
+  ASSERT_EQ("***********", redactor.redact("John Hansen"));
+  ASSERT_EQ("***********.", redactor.redact("John Hansen."));
+  ASSERT_EQ("************", redactor.redact("Nørregade 12"));
+  ASSERT_EQ("********", redactor.redact("Hemmelig"));
+  ASSERT_EQ("********!", redactor.redact("Hemmelig!"));
+}
+
+TEST_F(RedactTest, Overlapping_Matches_Are_Merged) {
+  std::vector<std::string> words = {"hansen", "bor"};
+  Redactor redactor;
+  redactor.add("word", WordListRule::WordListRule(words.begin(), words.end()),
+               {.policy = Policy::Tag});
+  redactor.add("name", NameRule::NameRule(), {.policy = Policy::Tag});
+
+  // The name covers the word, and is tagged as the word, which was added
+  // first.
+  const auto spans = redactor.spans(document);
+  ASSERT_EQ(2, spans.size());
+  ASSERT_EQ((Span{.start = 0, .end = 11, .rule = 0}), spans[0]);
+  ASSERT_EQ("[word] har CPR-nummer 111111-1118 og [word] på Nørregade 12.\n",
+            redactor.redact(document));
+
+  std::vector<Span> merged = {{.start = 5, .end = 8, .rule = 1},
+                              {.start = 0, .end = 6, .rule = 2},
+                              {.start = 8, .end = 9, .rule = 0},
+                              {.start = 7, .end = 8, .rule = 0}};
+  merge(merged);
+  ASSERT_EQ((std::vector<Span>{{.start = 0, .end = 8, .rule = 0},
+                               {.start = 8, .end = 9, .rule = 0}}),
+            merged);
+}
+
+TEST_F(RedactTest, In_Place_Matches_Copy) {
+  const std::vector<std::string> tags = {"", "#", "[CPR-NUMMER-FJERNET]"};
+  const std::vector<std::string> texts = {
+      document, "", "1111111118", "1111111118 2110625629 1111111118 x",
+      document + document + "Anna Jensen 2110625629"};
+
+  for (const auto &tag : tags) {
+    Redactor redactor;
+    redactor.add("cpr", CPRDetector::CPRDetector(),
+                 {.policy = Policy::Tag, .tag = tag});
+    redactor.add("name", NameRule::NameRule());
+
+    for (const auto &text : texts) {
+      auto copy = text;
+      redactor.redact_in_place(copy);
+      ASSERT_EQ(redactor.redact(text), copy) << tag << ": " << text;
+    }
+  }
+}
+
+TEST_F(RedactTest, Streams_Match_Whole_Documents) {
+  std::vector<std::string> words = {"nummer", "hemmelig"};
+  Redactor redactor;
+  redactor.add("cpr", CPRDetector::CPRDetector(), {.policy = Policy::KeepLast4});
+  redactor.add("name", NameRule::NameRule(), {.policy = Policy::Tag});
+  redactor.add("word", WordListRule::WordListRule(words.begin(), words.end()));
+
+  const std::string text = document + "Anna Jensen, 2110625629 hemmelig";
+  const auto expected = redactor.redact(text);
+
+  for (std::size_t size = 1; size <= text.size(); ++size) {
+    Stream stream(redactor);
+    std::string out;
+    for (std::size_t at = 0; at < text.size(); at += size)
+      stream.feed(std::string_view(text).substr(at, size), out);
+    stream.finish(out);
+    ASSERT_EQ(expected, out) << size;
+  }
+}
+
+TEST_F(RedactTest, Streams_Write_As_They_Go) {
+  CPRDetector::CPRDetector detector;
+  Redactor redactor;
+  redactor.add_ref("cpr", detector);
+
+  Stream stream(redactor);
+  std::string out;
+  stream.feed("CPR 1111111118 og 21106", out);
+  // Only the open token is held back.
+  ASSERT_EQ("CPR ********** og ", out);
+  stream.feed("25629.", out);
+  stream.finish(out);
+  ASSERT_EQ("CPR ********** og **********.", out);
+}
+
+TEST_F(RedactTest, Streams_Are_Not_Held_Back_By_A_Name) {
+  Redactor redactor;
+  redactor.add("name", NameRule::NameRule());
+
+  Stream stream(redactor);
+  std::string text = "Hej John Hansen\n";
+  std::string out;
+  stream.feed(text, out);
+
+  const std::string line = "der er ingen navne her.\n";
+  for (int i = 0; i < 1000; ++i) {
+    stream.feed(line, out);
+    text += line;
+    // Only the last word fed may still be held back.
+    ASSERT_GE(out.size() + 8, text.size()) << i;
+  }
+
+  stream.finish(out);
+  ASSERT_EQ(redactor.redact(text), out);
+  ASSERT_EQ(0, out.find("Hej ***********\n"));
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
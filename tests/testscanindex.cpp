@@ -0,0 +1,223 @@
+#include <cpr-detector.hpp>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <name_rule.hpp>
+#include <scan_index.hpp>
+#include <string>
+
+using namespace OS2DSRules;
+using namespace OS2DSRules::ScanIndex;
+
+class ScanIndexTest : public testing::Test {
+protected:
+  void SetUp() override {
+    directory_ = std::filesystem::temp_directory_path() /
+                 ("os2ds-scanindex-" +
+                  std::string(testing::UnitTest::GetInstance()
+                                  ->current_test_info()
+                                  ->name()));
+    std::filesystem::remove_all(directory_);
+    std::filesystem::create_directories(directory_);
+  }
+
+  void TearDown() override { std::filesystem::remove_all(directory_); }
+
+  std::string path(const std::string &name) const {
+    return (directory_ / name).string();
+  }
+
+  void write(const std::string &name, const std::string &content) const {
+    std::ofstream file(path(name), std::ios::binary | std::ios::trunc);
+    file << content;
+  }
+
+  std::filesystem::path directory_;
+};
+
+TEST_F(ScanIndexTest, Records_Survive_Reopen) {
+  const auto file = path("index");
+  Entry entry{"a.txt", 42, 7, ContentHash::hash128("content"), 3,
+              {MatchResult("1111111118", 4, 13, Sensitivity::Critical, 0.5)}};
+
+  {
+    auto index = ScanIndex::ScanIndex::open(file);
+    ASSERT_TRUE(index.has_value());
+    ASSERT_TRUE(index->record(entry));
+    ASSERT_TRUE(index->sync());
+  }
+
+  auto index = ScanIndex::ScanIndex::open(file);
+  ASSERT_TRUE(index.has_value());
+  ASSERT_EQ(1, index->size());
+
+  auto results = index->lookup("a.txt", 42, 7, 3);
+  ASSERT_TRUE(results.has_value());
+  ASSERT_EQ(1, results->size());
+  ASSERT_EQ(std::string("1111111118"), (*results)[0].match());
+  ASSERT_EQ(4, (*results)[0].start());
+  ASSERT_EQ(13, (*results)[0].end());
+  ASSERT_EQ(0.5, (*results)[0].probability());
+
+  ASSERT_FALSE(index->lookup("a.txt", 43, 7, 3).has_value());
+  ASSERT_FALSE(index->lookup("a.txt", 42, 8, 3).has_value());
+  ASSERT_FALSE(index->lookup("a.txt", 42, 7, 4).has_value());
+  ASSERT_TRUE(index->lookup_content(entry.content, 3).has_value());
+}
+
+TEST_F(ScanIndexTest, Unchanged_Files_Are_Not_Rescanned) {
+  write("doc.txt", "Ring til John på 1111111118.");
+  auto index = ScanIndex::ScanIndex::open(path("index"));
+  ASSERT_TRUE(index.has_value());
+  CPRDetector::CPRDetector detector;
+
+  auto first = index->scan_file(detector, path("doc.txt"));
+  ASSERT_TRUE(first.has_value());
+  ASSERT_EQ(Source::Scanned, first->source);
+  ASSERT_EQ(1, first->matches.size());
+
+  auto second = index->scan_file(detector, path("doc.txt"));
+  ASSERT_TRUE(second.has_value());
+  ASSERT_EQ(Source::Unchanged, second->source);
+  ASSERT_EQ(1, second->matches.size());
+  ASSERT_EQ(first->matches[0].start(), second->matches[0].start());
+
+  // Another rule configuration has not scanned the file yet.
+  CPRDetector::CPRDetector strict(true);
+  auto third = index->scan_file(strict, path("doc.txt"));
+  ASSERT_TRUE(third.has_value());
+  ASSERT_EQ(Source::Scanned, third->source);
+}
+
+TEST_F(ScanIndexTest, Known_Content_Is_Not_Rescanned) {
+  write("a.txt", "John Peter og Anna");
+  write("b.txt", "John Peter og Anna");
+  auto index = ScanIndex::ScanIndex::open(path("index"));
+  ASSERT_TRUE(index.has_value());
+  NameRule::NameRule rule;
+
+  auto a = index->scan_file(rule, path("a.txt"));
+  ASSERT_TRUE(a.has_value());
+  ASSERT_EQ(Source::Scanned, a->source);
+
+  auto b = index->scan_file(rule, path("b.txt"));
+  ASSERT_TRUE(b.has_value());
+  ASSERT_EQ(Source::KnownContent, b->source);
+  ASSERT_EQ(a->matches.size(), b->matches.size());
+  ASSERT_EQ(2, index->size());
+}
+
+TEST_F(ScanIndexTest, Changed_Files_Are_Rescanned) {
+  write("doc.txt", "1111111118");
+  auto index = ScanIndex::ScanIndex::open(path("index"));
+  ASSERT_TRUE(index.has_value());
+  CPRDetector::CPRDetector detector;
+
+  ASSERT_EQ(1, index->scan_file(detector, path("doc.txt"))->matches.size());
+
+  write("doc.txt", "1111111118 og 2110625629");
+  auto changed = index->scan_file(detector, path("doc.txt"));
+  ASSERT_TRUE(changed.has_value());
+  ASSERT_EQ(Source::Scanned, changed->source);
+  ASSERT_EQ(2, changed->matches.size());
+  ASSERT_EQ(1, index->size());
+}
+
+TEST_F(ScanIndexTest, Missing_Files_Are_Not_Scanned) {
+  auto index = ScanIndex::ScanIndex::open(path("index"));
+  ASSERT_TRUE(index.has_value());
+  CPRDetector::CPRDetector detector;
+
+  ASSERT_FALSE(index->scan_file(detector, path("missing.txt")).has_value());
+  ASSERT_EQ(0, index->size());
+}
+
+TEST_F(ScanIndexTest, Torn_Append_Is_Discarded) {
+  const auto file = path("index");
+  {
+    auto index = ScanIndex::ScanIndex::open(file);
+    ASSERT_TRUE(index.has_value());
+    ASSERT_TRUE(index->record(Entry{"a.txt", 1, 1, {}, 0, {}}));
+    ASSERT_TRUE(index->record(Entry{"b.txt", 2, 2, {}, 0, {}}));
+  }
+
+  // Cut the last record in half, as a crash during the append would.
+  const auto size = std::filesystem::file_size(file);
+  std::filesystem::resize_file(file, size - 5);
+
+  {
+    auto index = ScanIndex::ScanIndex::open(file);
+    ASSERT_TRUE(index.has_value());
+    ASSERT_EQ(1, index->size());
+    ASSERT_TRUE(index->lookup("a.txt", 1, 1, 0).has_value());
+    ASSERT_FALSE(index->lookup("b.txt", 2, 2, 0).has_value());
+
+    // Appends continue after the last complete record.
+    ASSERT_TRUE(index->record(Entry{"c.txt", 3, 3, {}, 0, {}}));
+  }
+
+  auto index = ScanIndex::ScanIndex::open(file);
+  ASSERT_TRUE(index.has_value());
+  ASSERT_EQ(2, index->size());
+  ASSERT_TRUE(index->lookup("c.txt", 3, 3, 0).has_value());
+}
+
+TEST_F(ScanIndexTest, Corrupt_Record_Is_Discarded) {
+  const auto file = path("index");
+  {
+    auto index = ScanIndex::ScanIndex::open(file);
+    ASSERT_TRUE(index.has_value());
+    ASSERT_TRUE(index->record(Entry{"a.txt", 1, 1, {}, 0, {}}));
+  }
+
+  const auto size = std::filesystem::file_size(file);
+  {
+    std::fstream stream(file, std::ios::in | std::ios::out | std::ios::binary);
+    stream.seekp(static_cast<std::streamoff>(size - 1));
+    stream.put('?');
+  }
+
+  auto index = ScanIndex::ScanIndex::open(file);
+  ASSERT_TRUE(index.has_value());
+  ASSERT_EQ(0, index->size());
+}
+
+TEST_F(ScanIndexTest, Foreign_Files_Are_Rejected) {
+  write("index", "not a scan index at all");
+
+  ASSERT_FALSE(ScanIndex::ScanIndex::open(path("index")).has_value());
+}
+
+TEST_F(ScanIndexTest, Compaction_Keeps_Latest_Records) {
+  const auto file = path("index");
+  {
+    auto index = ScanIndex::ScanIndex::open(file);
+    ASSERT_TRUE(index.has_value());
+    for (int i = 0; i < 100; ++i)
+      ASSERT_TRUE(index->record(
+          Entry{"a.txt", 1, i, {}, 0, {MatchResult("x", 0, 1)}}));
+    ASSERT_TRUE(index->record(Entry{"b.txt", 2, 2, {}, 0, {}}));
+
+    const auto before = std::filesystem::file_size(file);
+    ASSERT_TRUE(index->compact());
+    ASSERT_LT(std::filesystem::file_size(file), before / 10);
+    ASSERT_FALSE(std::filesystem::exists(file + ".tmp"));
+
+    ASSERT_EQ(2, index->size());
+    ASSERT_TRUE(index->lookup("a.txt", 1, 99, 0).has_value());
+    ASSERT_FALSE(index->lookup("a.txt", 1, 98, 0).has_value());
+    ASSERT_TRUE(index->record(Entry{"c.txt", 3, 3, {}, 0, {}}));
+  }
+
+  auto index = ScanIndex::ScanIndex::open(file);
+  ASSERT_TRUE(index.has_value());
+  ASSERT_EQ(3, index->size());
+  ASSERT_TRUE(index->lookup("a.txt", 1, 99, 0).has_value());
+  ASSERT_TRUE(index->lookup("b.txt", 2, 2, 0).has_value());
+  ASSERT_TRUE(index->lookup("c.txt", 3, 3, 0).has_value());
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
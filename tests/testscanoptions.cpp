@@ -0,0 +1,193 @@
+#include <address_rule.hpp>
+#include <array>
+#include <chrono>
+#include <cpr-detector.hpp>
+#include <gtest/gtest.h>
+#include <health_rule.hpp>
+#include <name_rule.hpp>
+#include <os2dsrules.hpp>
+#include <string>
+#include <string_view>
+#include <wordlist_rule.hpp>
+
+using namespace OS2DSRules;
+
+class ScanOptionsTest : public testing::Test {};
+
+TEST_F(ScanOptionsTest, Unlimited_Scan_Completes) {
+  CPRDetector::CPRDetector detector;
+  const std::string content = "1111111118 and 2110625629";
+
+  auto result = detector.find_matches(content, ScanOptions());
+
+  ASSERT_FALSE(result.truncated);
+  ASSERT_EQ(StopReason::Completed, result.reason);
+  ASSERT_EQ(content.size(), result.offset);
+  ASSERT_EQ(2, result.matches.size());
+}
+
+TEST_F(ScanOptionsTest, CPR_Max_Matches) {
+  CPRDetector::CPRDetector detector;
+  const std::string content = "1111111118 and 2110625629";
+  ScanOptions options;
+  options.max_matches = 1;
+
+  auto result = detector.find_matches(content, options);
+
+  ASSERT_TRUE(result.truncated);
+  ASSERT_EQ(StopReason::MaxMatches, result.reason);
+  ASSERT_EQ(1, result.matches.size());
+  ASSERT_EQ(10, result.offset);
+
+  auto rest = detector.find_matches(content.substr(result.offset), options);
+  ASSERT_FALSE(rest.truncated);
+  ASSERT_EQ(1, rest.matches.size());
+  ASSERT_EQ(std::string("2110625629"), rest.matches[0].match());
+}
+
+TEST_F(ScanOptionsTest, CPR_Byte_Budget_Leaves_Cut_Candidate) {
+  CPRDetector::CPRDetector detector;
+  const std::string content = "abc 1111111118";
+  ScanOptions options;
+  options.byte_budget = 8;
+
+  auto result = detector.find_matches(content, options);
+
+  ASSERT_TRUE(result.truncated);
+  ASSERT_EQ(StopReason::ByteBudget, result.reason);
+  ASSERT_EQ(0, result.matches.size());
+  ASSERT_EQ(4, result.offset);
+}
+
+TEST_F(ScanOptionsTest, CPR_Resumed_Scans_Find_Every_Match) {
+  CPRDetector::CPRDetector detector;
+  const std::string content =
+      "Her er 1111111118, 211062-5629 og 0101010000 samt 1111111118.";
+  ScanOptions options;
+  options.byte_budget = 16;
+
+  const auto expected = detector.find_matches(content);
+  MatchResults found;
+  std::size_t offset = 0;
+
+  while (offset < content.size()) {
+    auto result = detector.find_matches(
+        std::string_view(content).substr(offset), options);
+    ASSERT_TRUE(result.offset > 0 || !result.truncated);
+
+    for (const auto &m : result.matches)
+      found.push_back(MatchResult(m.match(), m.start() + offset,
+                                  m.end() + offset));
+    offset += result.offset;
+  }
+
+  ASSERT_EQ(expected.size(), found.size());
+  for (std::size_t i = 0; i < expected.size(); ++i) {
+    ASSERT_EQ(expected[i].start(), found[i].start());
+    ASSERT_EQ(expected[i].end(), found[i].end());
+  }
+}
+
+TEST_F(ScanOptionsTest, Expired_Deadline_Stops_Scan) {
+  CPRDetector::CPRDetector detector;
+  const std::string content(100000, '1');
+
+  auto result = detector.find_matches(
+      content, ScanOptions::with_timeout(std::chrono::nanoseconds(0)));
+
+  ASSERT_TRUE(result.truncated);
+  ASSERT_EQ(StopReason::Deadline, result.reason);
+  ASSERT_EQ(0, result.offset);
+}
+
+TEST_F(ScanOptionsTest, Zero_Max_Matches_Scans_Nothing) {
+  NameRule::NameRule rule;
+  ScanOptions options;
+  options.max_matches = 0;
+
+  auto result = rule.find_matches("John Peter", options);
+
+  ASSERT_TRUE(result.truncated);
+  ASSERT_EQ(StopReason::MaxMatches, result.reason);
+  ASSERT_EQ(0, result.offset);
+  ASSERT_EQ(0, result.matches.size());
+}
+
+TEST_F(ScanOptionsTest, Name_Max_Matches_Keeps_Composed_Name) {
+  NameRule::NameRule rule;
+  const std::string content = "John Peter og Anna";
+  ScanOptions options;
+  options.max_matches = 1;
+
+  auto result = rule.find_matches(content, options);
+
+  ASSERT_TRUE(result.truncated);
+  ASSERT_EQ(1, result.matches.size());
+  ASSERT_EQ(std::string("John Peter"), result.matches[0].match());
+  ASSERT_EQ(content.find("Anna"), result.offset);
+}
+
+TEST_F(ScanOptionsTest, Name_Byte_Budget_Leaves_Unfinished_Name) {
+  NameRule::NameRule rule;
+  ScanOptions options;
+  options.byte_budget = 7;
+
+  auto result = rule.find_matches("John Peter", options);
+
+  ASSERT_TRUE(result.truncated);
+  ASSERT_EQ(StopReason::ByteBudget, result.reason);
+  ASSERT_EQ(0, result.matches.size());
+  ASSERT_EQ(0, result.offset);
+}
+
+TEST_F(ScanOptionsTest, Address_Number_At_Byte_Budget) {
+  AddressRule::AddressRule rule;
+  const std::string content = "Aabyvej 12";
+  ScanOptions options;
+  options.byte_budget = 9;
+
+  auto cut = rule.find_matches(content, options);
+
+  ASSERT_TRUE(cut.truncated);
+  ASSERT_EQ(0, cut.matches.size());
+  ASSERT_EQ(0, cut.offset);
+
+  options.byte_budget = content.size();
+  auto whole = rule.find_matches(content, options);
+
+  ASSERT_FALSE(whole.truncated);
+  ASSERT_EQ(1, whole.matches.size());
+  ASSERT_EQ(std::string("Aabyvej 12"), whole.matches[0].match());
+}
+
+TEST_F(ScanOptionsTest, WordList_Max_Matches) {
+  auto words = std::to_array<std::string_view>({"hello", "world"});
+  WordListRule::WordListRule rule(words.begin(), words.end());
+  ScanOptions options;
+  options.max_matches = 1;
+
+  auto result = rule.find_matches("Hello, World!", options);
+
+  ASSERT_TRUE(result.truncated);
+  ASSERT_EQ(1, result.matches.size());
+  ASSERT_EQ(std::string("hello"), result.matches[0].match());
+  ASSERT_EQ(6, result.offset);
+}
+
+TEST_F(ScanOptionsTest, Health_Byte_Budget) {
+  HealthRule::HealthRule rule;
+  ScanOptions options;
+  options.byte_budget = 3;
+
+  auto result = rule.find_matches("Cancer er en grim sygdom", options);
+
+  ASSERT_TRUE(result.truncated);
+  ASSERT_EQ(StopReason::ByteBudget, result.reason);
+  ASSERT_EQ(0, result.matches.size());
+  ASSERT_EQ(0, result.offset);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,143 @@
+#include <cpr-detector.hpp>
+#include <gtest/gtest.h>
+#include <name_rule.hpp>
+#include <serializer.hpp>
+#include <string>
+#include <string_view>
+
+using namespace OS2DSRules;
+using namespace OS2DSRules::Serializer;
+
+class SerializerTest : public testing::Test {};
+
+const std::string document =
+    "John Peter Hansen har CPR-nummer 111111-1118, og Anna har 2110625629.\n";
+
+std::string json_string(std::string_view s) {
+  std::string out;
+  append_json_string(out, s);
+  return out;
+}
+
+TEST_F(SerializerTest, JSON_Strings_Are_Escaped) {
+  ASSERT_EQ(R"("plain")", json_string("plain"));
+  ASSERT_EQ(R"("a\"b\\c\n\t\u0001")", json_string("a\"b\\c\n\t\x01"));
+  ASSERT_EQ(R"("Søren 😀")", json_string("Søren 😀"));
+}
+
+TEST_F(SerializerTest, Invalid_UTF8_Is_Replaced) {
+  // A lone continuation byte, a truncated character, an overlong encoding
+  // and a surrogate.
+  ASSERT_EQ("\"a\xEF\xBF\xBD" "b\xEF\xBF\xBD\"", json_string("a\x80" "b\xC3"));
+  ASSERT_EQ("\"\xEF\xBF\xBD\xEF\xBF\xBD\"", json_string("\xC0\xAF"));
+  ASSERT_EQ("\"\xEF\xBF\xBD\xEF\xBF\xBD\xEF\xBF\xBD\"",
+            json_string("\xED\xA0\x80"));
+}
+
+TEST_F(SerializerTest, JSON_Lines_Have_A_Line_Per_Match) {
+  CPRDetector::CPRDetector detector;
+  const auto matches = detector.find_matches(document);
+  ASSERT_EQ(2, matches.size());
+
+  std::string out;
+  JsonLines lines(out, {.path = "dir/a.txt", .rule = "cpr"});
+  lines.add(matches);
+
+  ASSERT_EQ(
+      R"({"path":"dir/a.txt","rule":"cpr","match":"111111-1118","start":33,"end":43,"sensitivity":1000,"probability":1})"
+      "\n"
+      R"({"path":"dir/a.txt","rule":"cpr","match":"2110625629","start":58,"end":67,"sensitivity":1000,"probability":1})"
+      "\n",
+      out);
+}
+
+TEST_F(SerializerTest, Fields_And_Offsets_Are_Optional) {
+  std::string out;
+  JsonLines lines(out);
+  lines.add(MatchResult("x", 1, 2, Sensitivity::Notice, 0.25), 7, 8);
+  ASSERT_EQ(
+      R"({"match":"x","start":7,"end":8,"sensitivity":250,"probability":0.25})"
+      "\n",
+      out);
+
+  out.clear();
+  append_json_match(out, MatchResult("y", 3, 4), 3, 4);
+  ASSERT_EQ(
+      R"({"match":"y","start":3,"end":4,"sensitivity":1000,"probability":1})",
+      out);
+}
+
+TEST_F(SerializerTest, Binary_Records_Read_Back) {
+  NameRule::NameRule names;
+  CPRDetector::CPRDetector detector;
+  auto first = names.find_matches(document);
+  const auto second = detector.find_matches(document);
+  ASSERT_FALSE(first.empty());
+  // Starts need not increase.
+  first.push_back(MatchResult("back", 2, 5, Sensitivity::Warning, 0.5));
+
+  std::string out;
+  BinaryRecord a(out, {.path = "a.txt", .rule = "name"});
+  a.add(first);
+  a.finish();
+  BinaryRecord b(out, {.path = "a.txt", .rule = "cpr"});
+  b.add(second);
+  b.finish();
+  BinaryRecord empty(out);
+  empty.finish();
+
+  std::string_view data = out;
+  const auto ra = read_record(data);
+  const auto rb = read_record(data);
+  const auto re = read_record(data);
+  ASSERT_TRUE(ra && rb && re);
+  ASSERT_TRUE(data.empty());
+
+  ASSERT_EQ("a.txt", ra->path);
+  ASSERT_EQ("name", ra->rule);
+  ASSERT_EQ(first, ra->matches);
+  ASSERT_EQ("cpr", rb->rule);
+  ASSERT_EQ(second, rb->matches);
+  ASSERT_EQ("", re->path);
+  ASSERT_TRUE(re->matches.empty());
+}
+
+TEST_F(SerializerTest, Partial_Records_Are_Not_Read) {
+  CPRDetector::CPRDetector detector;
+  std::string out;
+  BinaryRecord record(out, {.path = "a.txt"});
+  record.add(detector.find_matches(document));
+  record.finish();
+
+  for (std::size_t size = 0; size < out.size(); ++size) {
+    std::string_view data(out.data(), size);
+    ASSERT_FALSE(read_record(data).has_value());
+    ASSERT_EQ(size, data.size());
+  }
+
+  // Offsets are small deltas, so the varints of a match take at most four
+  // bytes besides its probability and text.
+  ASSERT_LE(out.size(), 8 + 7 + 2 * (4 + 8 + 12));
+}
+
+TEST_F(SerializerTest, Reused_Buffers_Do_Not_Grow) {
+  NameRule::NameRule names;
+  const auto matches = names.find_matches(document);
+
+  std::string out;
+  JsonLines(out, {.rule = "name"}).add(matches);
+  const auto size = out.size();
+  const auto capacity = out.capacity();
+  const auto *data = out.data();
+
+  out.clear();
+  JsonLines(out, {.rule = "name"}).add(matches);
+  ASSERT_EQ(size, out.size());
+  ASSERT_EQ(capacity, out.capacity());
+  ASSERT_EQ(data, out.data());
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,119 @@
+#include <cpr-detector.hpp>
+#include <gtest/gtest.h>
+#include <health_rule.hpp>
+#include <limits>
+#include <new>
+#include <name_rule.hpp>
+#include <stats.hpp>
+#include <stats_allocations.hpp>
+#include <string>
+#include <thread>
+
+using namespace OS2DSRules;
+
+class StatsTest : public testing::Test {
+protected:
+  void SetUp() override { Stats::reset(); }
+};
+
+TEST_F(StatsTest, Disabled_Build_Reports_Nothing) {
+  if constexpr (Stats::enabled)
+    GTEST_SKIP() << "Built with OS2DSRULES_ENABLE_STATS.";
+
+  NameRule::NameRule rule;
+  const auto results = rule.find_matches("Hej Jens Hansen");
+
+  ASSERT_EQ(1, results.size());
+  ASSERT_EQ(Stats::ScanStats{}, Stats::snapshot());
+}
+
+TEST_F(StatsTest, Counts_CPRDetector_Scan) {
+  if constexpr (!Stats::enabled)
+    GTEST_SKIP() << "Built without OS2DSRULES_ENABLE_STATS.";
+
+  CPRDetector::CPRDetector detector(false, true);
+  const std::string content = "Her er et CPR-nummer 1111111118 og ikke mere.";
+
+  const auto results = detector.find_matches(content);
+  const auto stats = Stats::snapshot();
+
+  ASSERT_EQ(1, results.size());
+  ASSERT_EQ(1, stats.scans);
+  ASSERT_EQ(content.size(), stats.bytes_scanned);
+  ASSERT_EQ(1, stats.candidate_tokens);
+  ASSERT_LE(10, stats.state_transitions);
+  ASSERT_LT(0, stats.blacklist_checks);
+  ASSERT_EQ(stats.blacklist_checks, stats.dictionary_probes);
+  ASSERT_LE(stats.dictionary_probes, stats.chain_links_walked);
+  ASSERT_LT(0, stats.allocations);
+}
+
+TEST_F(StatsTest, Nested_Scan_Counts_Once) {
+  if constexpr (!Stats::enabled)
+    GTEST_SKIP() << "Built without OS2DSRULES_ENABLE_STATS.";
+
+  HealthRule::HealthRule rule;
+  const std::string content = "Cancer er en grim sygdom";
+
+  const auto results = rule.find_matches(content);
+  const auto stats = Stats::snapshot();
+
+  ASSERT_EQ(2, results.size());
+  ASSERT_EQ(1, stats.scans);
+  ASSERT_EQ(content.size(), stats.bytes_scanned);
+  ASSERT_EQ(5, stats.candidate_tokens);
+  ASSERT_EQ(5, stats.dictionary_probes);
+  ASSERT_EQ(2, stats.dictionary_hits);
+  ASSERT_DOUBLE_EQ(0.4, stats.hit_rate());
+}
+
+TEST_F(StatsTest, Aggregates_Across_Threads) {
+  if constexpr (!Stats::enabled)
+    GTEST_SKIP() << "Built without OS2DSRULES_ENABLE_STATS.";
+
+  const std::string content = "Hej Jens Hansen";
+  const auto scan = [&] {
+    NameRule::NameRule rule;
+    for (int i = 0; i < 10; ++i)
+      (void)rule.find_matches(content);
+  };
+
+  std::thread first(scan);
+  std::thread second(scan);
+  first.join();
+  second.join();
+
+  // The counters of both threads outlive the threads themselves.
+  const auto stats = Stats::snapshot();
+  ASSERT_EQ(20, stats.scans);
+  ASSERT_EQ(20 * content.size(), stats.bytes_scanned);
+  ASSERT_EQ(60, stats.candidate_tokens);
+}
+
+namespace {
+
+bool handled = false;
+
+void handle_failed_allocation() {
+  handled = true;
+  std::set_new_handler(nullptr);
+}
+
+} // namespace
+
+TEST_F(StatsTest, Failed_Allocation_Calls_The_New_Handler) {
+  if constexpr (!Stats::enabled)
+    GTEST_SKIP() << "Built without OS2DSRULES_ENABLE_STATS.";
+
+  // Too large for malloc, but not for operator new to try.
+  volatile std::size_t size = std::numeric_limits<std::size_t>::max() / 2;
+  std::set_new_handler(handle_failed_allocation);
+
+  ASSERT_THROW(::operator delete(::operator new(size)), std::bad_alloc);
+  ASSERT_TRUE(handled);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,431 @@
+#include <address_rule.hpp>
+#include <cpr-detector.hpp>
+#include <health_rule.hpp>
+#include <ingest.hpp>
+#include <name_rule.hpp>
+#include <os2dsrules.hpp>
+#include <pipeline.hpp>
+#include <serializer.hpp>
+#include <wordlist_rule.hpp>
+
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace OS2DSRules;
+
+/*
+  Scans files and directory trees with a chosen set of rules, without a
+  Python interpreter.
+
+  The paths given are scanned with a Pipeline: files are mapped into
+  memory by default, and scanned by a pool of threads. Every file with
+  matches, and every file that could not be read, is written out as a
+  line of JSON:
+
+    {"path":"a.txt","ok":true,"size":120,"matches":{"cpr":[{"match":...}]}}
+
+  or, in the binary format, as the records of a Serializer::BinaryRecord
+  after a header:
+
+    file := "OS2DSRES" u32:version record*
+
+  A file has a record for every rule that matched it. A file without
+  matches has a single record with no rule, and a file that could not be
+  read a single record with the rule "!unreadable".
+ */
+
+namespace {
+
+enum class Format { JSONL, Binary };
+
+enum class IO { Map, Read, Batch };
+
+constexpr char binary_magic[8] = {'O', 'S', '2', 'D', 'S', 'R', 'E', 'S'};
+constexpr std::uint32_t binary_version = 2;
+
+// The rule of the record of a file that could not be read.
+constexpr std::string_view unreadable = "!unreadable";
+
+struct Options {
+  bool cpr = false;
+  bool mod11 = false;
+  bool context = false;
+  bool name = false;
+  bool address = false;
+  bool health = false;
+  std::vector<std::string> wordlists;
+
+  std::size_t scanners = 0;
+  std::size_t readers = 2;
+  IO io = IO::Map;
+  Format format = Format::JSONL;
+  std::string output;
+  bool all = false;
+  bool stats = false;
+  std::vector<std::string> paths;
+};
+
+// Reads a word per line, skipping empty lines.
+std::optional<std::vector<std::string>> read_words(const std::string &path) {
+  std::ifstream file(path);
+  if (!file)
+    return std::nullopt;
+
+  std::vector<std::string> words;
+  std::string line;
+  while (std::getline(file, line)) {
+    if (!line.empty() && line.back() == '\r')
+      line.pop_back();
+    if (!line.empty())
+      words.push_back(line);
+  }
+  return words;
+}
+
+/*
+  Writes the records to a file, and counts what it wrote.
+ */
+class Output {
+public:
+  Output(std::FILE *file, const Pipeline::RuleSet &rules, Format format,
+         bool all) noexcept
+      : file_(file), rules_(rules), format_(format), all_(all) {}
+
+  bool begin() {
+    if (format_ != Format::Binary)
+      return true;
+
+    char header[sizeof(binary_magic) + 4];
+    std::memcpy(header, binary_magic, sizeof(binary_magic));
+    for (std::size_t i = 0; i < 4; ++i)
+      header[sizeof(binary_magic) + i] =
+          static_cast<char>((binary_version >> (8 * i)) & 0xFF);
+    return write(std::string_view(header, sizeof(header)));
+  }
+
+  void operator()(Pipeline::FileResult &result) {
+    std::size_t count = 0;
+    for (const auto &matches : result.matches)
+      count += matches.size();
+
+    failed_ += result.ok ? 0 : 1;
+    matches_ += count;
+    if (result.ok && count == 0 && !all_)
+      return;
+
+    if (format_ == Format::Binary)
+      binary(result, count);
+    else
+      json(result);
+    ok_ = write(record_) && ok_;
+  }
+
+  [[nodiscard]] bool ok() const noexcept { return ok_; }
+  [[nodiscard]] std::size_t failed() const noexcept { return failed_; }
+  [[nodiscard]] std::size_t matches() const noexcept { return matches_; }
+
+private:
+  bool write(std::string_view data) {
+    return std::fwrite(data.data(), 1, data.size(), file_) == data.size();
+  }
+
+  void json(const Pipeline::FileResult &result) {
+    record_.clear();
+    record_ += "{\"path\":";
+    Serializer::append_json_string(record_, result.path);
+    record_ += ",\"ok\":";
+    record_ += result.ok ? "true" : "false";
+    record_ += ",\"size\":";
+    record_ += std::to_string(result.size);
+    record_ += ",\"matches\":{";
+
+    bool first = true;
+    for (std::size_t rule = 0; rule < result.matches.size(); ++rule) {
+      if (result.matches[rule].empty())
+        continue;
+      if (!first)
+        record_ += ',';
+      first = false;
+      Serializer::append_json_string(record_, rules_.name(rule));
+      record_ += ":[";
+      for (const auto &m : result.matches[rule]) {
+        if (record_.back() == '}')
+          record_ += ',';
+        Serializer::append_json_match(record_, m, m.start(), m.end());
+      }
+      record_ += ']';
+    }
+    record_ += "}}\n";
+  }
+
+  void binary(const Pipeline::FileResult &result, std::size_t count) {
+    record_.clear();
+    if (!result.ok || count == 0) {
+      Serializer::BinaryRecord record(
+          record_, {.path = result.path,
+                    .rule = result.ok ? std::string_view() : unreadable});
+      record.finish();
+      return;
+    }
+
+    for (std::size_t rule = 0; rule < result.matches.size(); ++rule) {
+      if (result.matches[rule].empty())
+        continue;
+      Serializer::BinaryRecord record(
+          record_, {.path = result.path, .rule = rules_.name(rule)});
+      record.add(result.matches[rule]);
+      record.finish();
+    }
+  }
+
+  std::FILE *file_;
+  const Pipeline::RuleSet &rules_;
+  Format format_;
+  bool all_;
+  std::string record_;
+  bool ok_ = true;
+  std::size_t failed_ = 0;
+  std::size_t matches_ = 0;
+};
+
+void print_stage(const char *name, const Pipeline::StageStats &stage,
+                 std::chrono::nanoseconds wall) {
+  const auto ms = [](std::chrono::nanoseconds t) {
+    return static_cast<double>(t.count()) / 1e6;
+  };
+  std::fprintf(stderr,
+               "  %-10s %3zu threads %9llu items %5.1f%% busy "
+               "%10.1f ms starved %10.1f ms blocked\n",
+               name, stage.threads,
+               static_cast<unsigned long long>(stage.items),
+               100.0 * stage.utilization(wall), ms(stage.starved),
+               ms(stage.blocked));
+}
+
+void print_stats(const Pipeline::Stats &stats) {
+  const double seconds = static_cast<double>(stats.wall.count()) / 1e9;
+  std::fprintf(stderr, "%llu files, %.2f MiB in %.3f s: %.0f files/s, "
+                       "%.1f MiB/s\n",
+               static_cast<unsigned long long>(stats.write.items),
+               static_cast<double>(stats.bytes) / (1 << 20), seconds,
+               static_cast<double>(stats.write.items) / seconds,
+               static_cast<double>(stats.bytes) / (1 << 20) / seconds);
+  print_stage("enumerate", stats.enumerate, stats.wall);
+  print_stage("read", stats.read, stats.wall);
+  print_stage("scan", stats.scan, stats.wall);
+  print_stage("write", stats.write, stats.wall);
+}
+
+void usage(const char *program) {
+  std::cerr
+      << "Usage: " << program << " [options] PATH...\n"
+      << "\n"
+      << "Scans the files and directory trees in PATH with the rules chosen.\n"
+      << "\n"
+      << "Rules, at least one of:\n"
+      << "  --cpr               CPR-numbers.\n"
+      << "  --cpr-mod11         CPR-numbers that pass the modulus 11 check.\n"
+      << "  --cpr-context       CPR-numbers not ruled out by their context.\n"
+      << "  --name              Names.\n"
+      << "  --address           Addresses.\n"
+      << "  --health            Health terms.\n"
+      << "  --wordlist FILE     The words in FILE, one per line and in lower\n"
+      << "                      case. May be given more than once.\n"
+      << "\n"
+      << "  --threads N         Scanner threads, 1 to 1024 (default: cores).\n"
+      << "  --readers N         Reader threads, 1 to 1024 (default: 2).\n"
+      << "  --io MODE           mmap (default), read, or batch, which reads\n"
+      << "                      small files in batches with io_uring.\n"
+      << "  --format FORMAT     jsonl (default) or binary.\n"
+      << "  --output FILE       Write to FILE instead of standard output.\n"
+      << "  --all               Write a record for files without matches too.\n"
+      << "  --stats             Print throughput and stage statistics to\n"
+      << "                      standard error.\n";
+}
+
+// The most threads of a kind that may be asked for.
+constexpr std::size_t max_threads = 1024;
+
+// Parses a number of threads. Returns std::nullopt unless value is a
+// number from 1 to max_threads.
+std::optional<std::size_t> parse_threads(std::string_view value) noexcept {
+  std::size_t n = 0;
+  const auto *end = value.data() + value.size();
+  const auto [ptr, error] = std::from_chars(value.data(), end, n);
+  if (error != std::errc() || ptr != end || n == 0 || n > max_threads)
+    return std::nullopt;
+  return n;
+}
+
+// Parses the command line. Returns the exit status if the program should
+// exit right away.
+std::optional<int> parse(int argc, char **argv, Options &options) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg(argv[i]);
+
+    if (arg == "--help" || arg == "-h") {
+      usage(argv[0]);
+      return EXIT_SUCCESS;
+    } else if (arg == "--cpr") {
+      options.cpr = true;
+    } else if (arg == "--cpr-mod11") {
+      options.cpr = options.mod11 = true;
+    } else if (arg == "--cpr-context") {
+      options.cpr = options.context = true;
+    } else if (arg == "--name") {
+      options.name = true;
+    } else if (arg == "--address") {
+      options.address = true;
+    } else if (arg == "--health") {
+      options.health = true;
+    } else if (arg == "--all") {
+      options.all = true;
+    } else if (arg == "--stats") {
+      options.stats = true;
+    } else if (arg.starts_with("--")) {
+      if (i + 1 >= argc) {
+        std::cerr << "Missing value for " << arg << "\n";
+        usage(argv[0]);
+        return EXIT_FAILURE;
+      }
+
+      const std::string value(argv[++i]);
+      if (arg == "--wordlist") {
+        options.wordlists.push_back(value);
+      } else if (arg == "--threads" || arg == "--readers") {
+        const auto n = parse_threads(value);
+        if (!n) {
+          std::cerr << "Invalid value for " << arg << ": " << value
+                    << " (expected 1 to " << max_threads << ")\n";
+          usage(argv[0]);
+          return EXIT_FAILURE;
+        }
+        (arg == "--threads" ? options.scanners : options.readers) = n.value();
+      } else if (arg == "--io" && value == "mmap") {
+        options.io = IO::Map;
+      } else if (arg == "--io" && value == "read") {
+        options.io = IO::Read;
+      } else if (arg == "--io" && value == "batch") {
+        options.io = IO::Batch;
+      } else if (arg == "--format" && value == "jsonl") {
+        options.format = Format::JSONL;
+      } else if (arg == "--format" && value == "binary") {
+        options.format = Format::Binary;
+      } else if (arg == "--output") {
+        options.output = value;
+      } else {
+        std::cerr << "Unknown option: " << arg << " " << value << "\n";
+        usage(argv[0]);
+        return EXIT_FAILURE;
+      }
+    } else {
+      options.paths.emplace_back(arg);
+    }
+  }
+
+  if (!(options.cpr || options.name || options.address || options.health ||
+        !options.wordlists.empty())) {
+    std::cerr << "No rules chosen\n";
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  if (options.paths.empty()) {
+    std::cerr << "No paths given\n";
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  return std::nullopt;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (const auto status = parse(argc, argv, options))
+    return status.value();
+
+  // The word list rules refer to the words, which must outlive them.
+  std::vector<std::unique_ptr<std::vector<std::string>>> words;
+
+  Pipeline::RuleSet rules;
+  if (options.cpr)
+    rules.add("cpr", CPRDetector::CPRDetector(options.mod11, options.context));
+  if (options.name)
+    rules.add("name", NameRule::NameRule());
+  if (options.address)
+    rules.add("address", AddressRule::AddressRule());
+  if (options.health)
+    rules.add("health", HealthRule::HealthRule());
+  for (const auto &path : options.wordlists) {
+    auto list = read_words(path);
+    if (!list) {
+      std::cerr << "Could not read " << path << "\n";
+      return EXIT_FAILURE;
+    }
+    words.push_back(std::make_unique<std::vector<std::string>>(
+        std::move(list.value())));
+    rules.add("wordlist:" + path,
+              WordListRule::WordListRule(words.back()->begin(),
+                                         words.back()->end()));
+  }
+
+  std::FILE *file = stdout;
+  if (!options.output.empty()) {
+    file = std::fopen(options.output.c_str(), "wb");
+    if (file == nullptr) {
+      std::cerr << "Could not open " << options.output << "\n";
+      return EXIT_FAILURE;
+    }
+  }
+  std::setvbuf(file, nullptr, _IOFBF, 1 << 20);
+
+  Pipeline::Options pipeline_options;
+  pipeline_options.readers = options.readers;
+  pipeline_options.scanners = options.scanners;
+  switch (options.io) {
+  case IO::Map:
+    pipeline_options.reader = Pipeline::map_file;
+    break;
+  case IO::Read:
+    pipeline_options.reader = Pipeline::read_file;
+    break;
+  case IO::Batch:
+    pipeline_options.ingest = Ingest::Options();
+    break;
+  }
+
+  Pipeline::Pipeline pipeline(std::move(rules), pipeline_options);
+  Output output(file, pipeline.rules(), options.format, options.all);
+  bool ok = output.begin();
+
+  const auto stats = pipeline.run(
+      options.paths, [&](Pipeline::FileResult &result) { output(result); });
+
+  ok = output.ok() && ok;
+  ok = (file == stdout ? std::fflush(file) : std::fclose(file)) == 0 && ok;
+  if (!ok) {
+    std::cerr << "Could not write the results\n";
+    return EXIT_FAILURE;
+  }
+
+  if (output.failed() > 0)
+    std::cerr << output.failed() << " files could not be read\n";
+  if (options.stats) {
+    std::fprintf(stderr, "%zu matches\n", output.matches());
+    print_stats(stats);
+  }
+
+  return EXIT_SUCCESS;
+}